@@ -15,10 +15,13 @@ if "%clang%"=="1"   set msvc=0 && echo [clang compile]
 :: --- Unpack Command Line Build Arguments ------------------------------------
 set auto_compile_flags=
 if "%asan%"=="1"      set auto_compile_flags=%auto_compile_flags% -fsanitize=address && echo [asan enabled]
+if "%avx2%"=="1" if "%msvc%"=="1"  set auto_compile_flags=%auto_compile_flags% /arch:AVX2 && echo [avx2 enabled]
+if "%avx2%"=="1" if "%clang%"=="1" set auto_compile_flags=%auto_compile_flags% -mavx2 && echo [avx2 enabled]
+if "%neon%"=="1"      set auto_compile_flags=%auto_compile_flags% -DMATH_ENABLE_NEON=1 && echo [neon enabled]
 
 :: --- Compile/Link Line Definitions ------------------------------------------
 set cl_common=     /I..\src\ /I..\libs\SDL\include\ /I..\libs\SDL_image\include\ -I..\libs\SDL_net\include\ /nologo /FC /Z7 /MD /W4 /wd4244 /wd4201
-set clang_common=  -I..\src\ -I..\libs\SDL\include\ -I..\libs\SDL_image\include\ -I..\libs\SDL_net\include\ -fdiagnostics-absolute-paths -Wall -Wno-unused-variable -Wno-missing-braces -Wno-unused-function -Wno-microsoft-static-assert -Wno-c2x-extensions
+set clang_common=  -I..\src\ -I..\libs\SDL\include\ -I..\libs\SDL_image\include\ -I..\libs\SDL_net\include\ -fdiagnostics-absolute-paths -Wall -Wno-unused-variable -Wno-missing-braces -Wno-unused-function -Wno-microsoft-static-assert -Wno-c2x-extensions -ffp-contract=off
 set cl_debug=      call cl /Od /Ob1 /DBUILD_DEBUG=1 %cl_common% %auto_compile_flags%
 set cl_release=    call cl /O2 /DBUILD_DEBUG=0 %cl_common% %auto_compile_flags%
 set cl_libs=       User32.lib Advapi32.lib Shell32.lib Gdi32.lib Version.lib OleAut32.lib Imm32.lib Ole32.lib Cfgmgr32.lib Setupapi.lib Winmm.lib Ws2_32.lib Iphlpapi.lib ..\libs\SDL\build\win\Debug\SDL3-static.lib ..\libs\SDL_image\build\win\Debug\SDL3_image-static.lib ..\libs\SDL_net\build\win\Debug\SDL3_net-static.lib
@@ -89,6 +92,10 @@ if "%sdl%"=="1" (
 
 pushd build
 if "%game%"=="1"    set didbuild=1 && %compile% ..\src\main.c    %compile_link% %out%demongus.exe || exit /b 1
+if "%proxy%"=="1"   set didbuild=1 && %compile% ..\src\proxy_main.c %compile_link% %out%proxy.exe || exit /b 1
+if "%packer%"=="1"  set didbuild=1 && %compile% ..\src\packer_main.c %compile_link% %out%packer.exe && packer.exe || exit /b 1
+if "%bench%"=="1"   set didbuild=1 && %compile% ..\src\bench_main.c %compile_link% %out%bench.exe || exit /b 1
+if "%loadgen%"=="1" set didbuild=1 && %compile% ..\src\loadgen_main.c %compile_link% %out%loadgen.exe || exit /b 1
 popd
 
 :: --- Unset ------------------------------------------------------------------
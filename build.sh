@@ -14,17 +14,19 @@ if [ -v gcc ];       then compiler="${CC:-gcc}"; echo "[gcc compile]"; fi
 
 # --- Unpack Command Line Build Arguments -------------------------------------
 auto_compile_flags=''
+if [ -v avx2 ];      then auto_compile_flags="$auto_compile_flags -mavx2"; echo "[avx2 enabled]"; fi
+if [ -v neon ];      then auto_compile_flags="$auto_compile_flags -DMATH_ENABLE_NEON=1"; echo "[neon enabled]"; fi
 
 # --- Compile/Link Line Definitions -------------------------------------------
-clang_common='-I../src/ -I../libs/SDL/include/ -I../libs/SDL_image/include/ -g -fdiagnostics-absolute-paths -Wall -Wno-unused-variable -std=c23'
+clang_common='-I../src/ -I../libs/SDL/include/ -I../libs/SDL_image/include/ -I../libs/SDL_net/include/ -g -fdiagnostics-absolute-paths -Wall -Wno-unused-variable -std=c23 -ffp-contract=off'
 clang_debug="$compiler -O0 -DBUILD_DEBUG=1 ${clang_common} ${auto_compile_flags}"
 clang_release="$compiler -O2 -DBUILD_DEBUG=0 ${clang_common} ${auto_compile_flags}"
-clang_link="../libs/SDL/build/libSDL3.a ../libs/SDL_image/build/libSDL3_image.a -lm"
+clang_link="../libs/SDL/build/libSDL3.a ../libs/SDL_image/build/libSDL3_image.a ../libs/SDL_net/build/libSDL3_net.a -lm"
 clang_out="-o"
-gcc_common='-I../src/ -I../libs/SDL/include/ -I../libs/SDL_image/include/ -g -Wall -Wno-unused-variable -std=c23'
+gcc_common='-I../src/ -I../libs/SDL/include/ -I../libs/SDL_image/include/ -I../libs/SDL_net/include/ -g -Wall -Wno-unused-variable -std=c23 -ffp-contract=off'
 gcc_debug="$compiler -O0 -DBUILD_DEBUG=1 ${gcc_common} ${auto_compile_flags}"
 gcc_release="$compiler -O2 -DBUILD_DEBUG=0 ${gcc_common} ${auto_compile_flags}"
-gcc_link="../libs/SDL/build/libSDL3.a ../libs/SDL_image/build/libSDL3_image.a -lm"
+gcc_link="../libs/SDL/build/libSDL3.a ../libs/SDL_image/build/libSDL3_image.a ../libs/SDL_net/build/libSDL3_net.a -lm"
 gcc_out="-o"
 
 # --- Choose Compile/Link Lines -----------------------------------------------
@@ -62,15 +64,26 @@ if [ -v sdl ]; then
     else
         echo "SDL_image directory not found! Make sure to initialize git submodules."
     fi
+    if [ -d "libs/SDL_net" ]; then
+        cd libs/SDL_net
+        cmake -S . -B build -DBUILD_SHARED_LIBS=OFF "-DSDL3_DIR=..\SDL\build" && cmake --build build
+        cd ../../
+    else
+        echo "SDL_net directory not found! Make sure to initialize git submodules."
+    fi
 fi
 
 cd build
 if [ -v game ];    then didbuild=1 && $compile ../src/main.c     $compile_link $out demongus; fi
+if [ -v proxy ];   then didbuild=1 && $compile ../src/proxy_main.c $compile_link $out proxy; fi
+if [ -v packer ];  then didbuild=1 && $compile ../src/packer_main.c $compile_link $out packer && ./packer; fi
+if [ -v bench ];   then didbuild=1 && $compile ../src/bench_main.c $compile_link $out bench; fi
+if [ -v loadgen ]; then didbuild=1 && $compile ../src/loadgen_main.c $compile_link $out loadgen; fi
 cd ..
 
 # --- Warn On No Builds -------------------------------------------------------
 if [ ! -v didbuild ]
 then
-  echo "[WARNING] no valid build target specified; must use build target names as arguments to this script, like \`./build.sh sdl game\` or \`./build.sh game\`."
+  echo "[WARNING] no valid build target specified; must use build target names as arguments to this script, like \`./build.sh sdl game\` or \`./build.sh game proxy\`."
   exit 1
 fi
@@ -0,0 +1,94 @@
+#!/bin/bash
+# Runs a dedicated server with loadgen bots, the proxy and a headless client
+# for every proxy profile and fails when bandwidth, position error or
+# convergence time go over the limits below.
+#   ./build.sh game proxy loadgen release
+#   ./nettest.sh                     # all profiles
+#   ./nettest.sh wifi bad seconds=30 # some profiles, longer runs
+set -eu
+cd "$(dirname "$0")"
+
+# --- Unpack Arguments --------------------------------------------------------
+for arg in "$@"; do
+    if [[ "$arg" == *=* ]]; then declare "$arg"; else declare $arg='1'; fi
+done
+seconds="${seconds:-20}"   # per profile
+warmup="${warmup:-3}"      # stats reports skipped while everything connects
+bots="${bots:-8}"          # loadgen bots connected directly to the server; they move the objects the client watches
+export SDL_VIDEO_DRIVER="${SDL_VIDEO_DRIVER:-offscreen}"
+
+# --- Limits ------------------------------------------------------------------
+# profile, max B/s proxy -> client, max avg position error, max convergence ms
+# max_bw=, max_error= and max_converge= override them for every profile
+limits=(
+    "none    64000   1.0    500"
+    "lan     64000   2.0    500"
+    "wifi    64000   4.0   1000"
+    "mobile  64000   8.0   2000"
+    "bad     64000  16.0   4000"
+)
+
+selected=0
+for line in "${limits[@]}"; do
+    read -r name _ <<< "$line"
+    if [ -v $name ]; then selected=1; fi
+done
+
+# --- Helpers -----------------------------------------------------------------
+# max of the numbers on stdin, skipping the first $1
+Max() { awk -v skip="$1" '{ n += 1; if (n > skip && (!seen || $1 > m)) { m = $1; seen = 1 } } END { print m + 0 }'; }
+Greater() { awk -v a="$1" -v b="$2" 'BEGIN { exit !(a > b) }'; }
+
+pids=()
+Stop() {
+    for pid in "${pids[@]}"; do kill "$pid" 2>/dev/null || true; done
+    for pid in "${pids[@]}"; do wait "$pid" 2>/dev/null || true; done
+    pids=()
+}
+trap Stop EXIT
+
+# --- Run Profiles ------------------------------------------------------------
+cd build
+for bin in demongus proxy loadgen; do
+    if [ ! -x "$bin" ]; then echo "build/$bin not found! Run: ./build.sh game proxy loadgen release"; exit 1; fi
+done
+mkdir -p nettest
+
+failed=0
+for line in "${limits[@]}"; do
+    read -r name limit_bw limit_error limit_converge <<< "$line"
+    if [ $selected == 1 ] && [ ! -v $name ]; then continue; fi
+    limit_bw="${max_bw:-$limit_bw}"
+    limit_error="${max_error:-$limit_error}"
+    limit_converge="${max_converge:-$limit_converge}"
+
+    log="nettest/$name"
+    ./demongus -dedicated > "$log.server.log" 2>&1 & pids+=($!)
+    sleep 1
+    ./loadgen -bots "$bots" > "$log.loadgen.log" 2>&1 & pids+=($!)
+    ./proxy -profile "$name" > "$log.proxy.log" 2>&1 & pids+=($!)
+    sleep 1
+    ./demongus -port 21038 -netstats > "$log.client.log" 2>&1 & pids+=($!)
+    sleep "$seconds"
+    Stop
+
+    reports=$(grep -c "CLIENT: recv" "$log.client.log" || true)
+    bw=$(grep "PROXY: to client:" "$log.proxy.log" | sed 's/.*to client: \([0-9.]*\) B\/s.*/\1/' | Max "$warmup")
+    error=$(grep "CLIENT: recv" "$log.client.log" | sed 's/.*pos error avg \([0-9.]*\).*/\1/' | Max "$warmup")
+    converge=$(grep -o "converged after [0-9]*" "$log.client.log" | awk '{ print $3 }' | Max 0)
+    diverged=$(grep "CLIENT: recv" "$log.client.log" | tail -n 1 | grep -c "; diverged;" || true)
+
+    result="ok"
+    if [ "$reports" -le "$warmup" ];            then result="FAIL (client sent only $reports stats reports)"; fi
+    if Greater "$bw" "$limit_bw";               then result="FAIL (bandwidth)"; fi
+    if Greater "$error" "$limit_error";         then result="FAIL (position error)"; fi
+    if Greater "$converge" "$limit_converge";   then result="FAIL (convergence)"; fi
+    if [ "$diverged" != 0 ];                    then result="FAIL (still diverged at the end)"; fi
+    if [ "$result" != "ok" ]; then failed=1; fi
+
+    printf "%-7s %8.0f B/s (max %s), pos error %6.2f (max %s), convergence %5s ms (max %s): %s\n" \
+           "$name" "$bw" "$limit_bw" "$error" "$limit_error" "$converge" "$limit_converge" "$result"
+done
+
+if [ $failed == 1 ]; then echo "logs are in build/nettest/"; fi
+exit $failed
@@ -0,0 +1,1093 @@
+//
+// @info(mg) Benchmarks of engine systems outside of the game loop.
+//           Every benchmark is a subcommand; run it from build directory:
+//             ./bench snapshot               # 4k and 100k objects
+//             ./bench snapshot 20000 500000  # custom object counts
+//             ./bench math                   # batch vector math vs scalar
+//             ./bench string 64              # S8_Find/S8_Count on 64 MB of text
+//             ./bench bvh                    # BVH queries vs brute force
+//             ./bench pool                   # fill object pool to its reserve
+//
+#define SDL_ASSERT_LEVEL 2
+#include <SDL3/SDL_stdinc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <float.h>
+
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+#include <SDL3_net/SDL_net.h>
+
+#define WINDOW_HEIGHT 640
+#define WINDOW_WIDTH 854
+
+#include "de_base.h"
+#include "de_math.h"
+#include "de_vertices.h"
+#include "de_string.h"
+#include "de_arena.h"
+#include "de_log.h"
+#include "de_pack.h"
+#include "de_map.h"
+#include "de_main.h"
+#include "de_log.c"
+#include "de_sprite.c"
+#include "de_object.c"
+#include "de_sim.c"
+#include "de_bvh.c"
+#include "de_map.c"
+#include "de_visibility.c"
+#include "de_replay.c"
+#include "de_jitter.c"
+#include "de_interest.c"
+#include "de_lockstep.c"
+#include "de_network.c"
+#include "de_tick.c"
+
+typedef struct
+{
+    Uint64 sum_ns;
+    Uint64 max_ns;
+    Uint64 count;
+} Bench_Timer;
+
+static void Bench_Add(Bench_Timer *timer, Uint64 ns)
+{
+    timer->sum_ns += ns;
+    timer->max_ns = Max(timer->max_ns, ns);
+    timer->count += 1;
+}
+
+static double Bench_AvgUs(Bench_Timer *timer)
+{
+    return (double)timer->sum_ns / (double)Max(timer->count, 1) / 1000.0;
+}
+
+static double Bench_MaxUs(Bench_Timer *timer)
+{
+    return (double)timer->max_ns / 1000.0;
+}
+
+static Uint32 Bench_Random(Uint32 *state)
+{
+    // xorshift32
+    Uint32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static float Bench_RandomF(Uint32 *state, float min, float max)
+{
+    float t = (float)(Bench_Random(state) >> 8) * (1.f / (float)(1u << 24));
+    return min + t * (max - min);
+}
+
+// AppState with pools and the sim region but no window, sockets or assets.
+static AppState *Bench_CreateApp(void)
+{
+    Arena perm;
+    if (!Arena_Init(&perm, "perm", ARENA_PERM_RESERVE))
+        return 0;
+
+    AppState *app = Arena_PushStruct(&perm, AppState);
+    Assert(app);
+    app->perm = perm;
+    app->tick_rate = TICK_RATE;
+    app->time_step = 1.f / (float)app->tick_rate;
+    app->tick_id = NET_MAX_TICK_HISTORY;
+
+    Arena_Init(&app->frame_arena, "frame", ARENA_SCRATCH_RESERVE);
+    Arena_Init(&app->tick_arena, "tick", ARENA_SCRATCH_RESERVE);
+    Sim_Init(app);
+    Object_InitPool(app);
+    Sprite_InitPool(app);
+    return app;
+}
+
+static void Bench_DestroyApp(AppState *app)
+{
+    Arena_Release(&app->frame_arena);
+    Arena_Release(&app->tick_arena);
+    Arena_Release(&app->sprite_arena);
+    Sim_Deinit(app);
+
+    Arena perm = app->perm; // app lives inside of perm
+    Arena_Release(&perm);
+}
+
+//
+// :: snapshot ::
+// Static objects with a few hundred movers scattered through the dense
+// order (worst case for page granularity). Every tick is snapshotted;
+// every few ticks the state is restored a few snapshots back and its hash
+// is compared with the one taken at that snapshot.
+// Full copy of the committed sim region is timed for comparison.
+//
+#define BENCH_SNAPSHOT_MOVERS 256
+#define BENCH_SNAPSHOT_TICKS 600
+#define BENCH_SNAPSHOT_RESTORE_EVERY 8
+#define BENCH_SNAPSHOT_RESTORE_BACK 4
+
+static bool Bench_SnapshotRun(Uint32 object_count)
+{
+    AppState *app = Bench_CreateApp();
+    if (!app)
+        return false;
+
+    Uint32 rng = 0x1234'5678;
+    Sprite *wall = Sprite_CreateNoTex(app, Vertices_FromRect((V2){0}, (V2){20, 20}));
+    Uint32 wall_sprite_id = Sprite_IdFromPointer(app, wall);
+
+    Uint32 mover_every = Max(object_count / BENCH_SNAPSHOT_MOVERS, 1);
+    float half_size = 0.5f * 60.f * SqrtF((float)object_count);
+    ForU32(i, object_count)
+    {
+        bool mover = (i % mover_every == 0);
+        Uint32 flags = (mover ? ObjectFlag_Draw|ObjectFlag_Move|ObjectFlag_Collide : ObjectFlag_Draw);
+        Object *obj = Object_Create(app, wall_sprite_id, flags);
+        obj->p = (V2){Bench_RandomF(&rng, -half_size, half_size),
+                      Bench_RandomF(&rng, -half_size, half_size)};
+        obj->prev_p = obj->p;
+    }
+
+    Uint64 committed = 0;
+    ForArray(i, app->sim.arenas)
+        committed += app->sim.arenas[i]->committed;
+    Uint8 *full_copy = (Uint8 *)SDL_malloc(committed);
+    Assert(full_copy);
+
+    Bench_Timer tick_timer = {0};
+    Bench_Timer snapshot_timer = {0};
+    Bench_Timer restore_timer = {0};
+    Bench_Timer full_copy_timer = {0};
+    Uint64 snapshot_pages = 0;
+    Uint64 restore_pages = 0;
+    Uint64 restore_mismatches = 0;
+
+    Uint64 hashes[SIM_SNAPSHOT_HISTORY] = {0};
+    Uint64 ids[SIM_SNAPSHOT_HISTORY] = {0};
+    Uint32 history_next = 0;
+
+    Sim_Save(app); // first one copies everything
+    ForU32(tick, BENCH_SNAPSHOT_TICKS)
+    {
+        Arena_Reset(&app->tick_arena);
+        for (Uint32 i = 1; i < app->object_count; i += mover_every)
+        {
+            Object *obj = app->object_pool + i;
+            obj->dp = (V2){Bench_RandomF(&rng, -4.f, 4.f), Bench_RandomF(&rng, -4.f, 4.f)};
+        }
+
+        Uint64 start_ns = SDL_GetTicksNS();
+        app->tick_id += 1;
+        Tick_AdvanceSimulation(app, (Tick_Input){0});
+        Bench_Add(&tick_timer, SDL_GetTicksNS() - start_ns);
+
+        start_ns = SDL_GetTicksNS();
+        Uint64 id = Sim_Save(app);
+        Bench_Add(&snapshot_timer, SDL_GetTicksNS() - start_ns);
+        snapshot_pages += app->sim.snapshot_pages;
+
+        ids[history_next] = id;
+        hashes[history_next] = Replay_StateHash(app);
+        history_next = (history_next + 1) % SIM_SNAPSHOT_HISTORY;
+
+        start_ns = SDL_GetTicksNS();
+        {
+            Uint64 offset = 0;
+            ForArray(i, app->sim.arenas)
+            {
+                Arena *arena = app->sim.arenas[i];
+                memcpy(full_copy + offset, arena->base, arena->committed);
+                offset += arena->committed;
+            }
+        }
+        Bench_Add(&full_copy_timer, SDL_GetTicksNS() - start_ns);
+
+        if (tick % BENCH_SNAPSHOT_RESTORE_EVERY == BENCH_SNAPSHOT_RESTORE_EVERY - 1)
+        {
+            // state moves on a bit after the snapshot before going back
+            app->tick_id += 1;
+            Tick_AdvanceSimulation(app, (Tick_Input){0});
+
+            Uint32 back = (history_next + SIM_SNAPSHOT_HISTORY - 1 - BENCH_SNAPSHOT_RESTORE_BACK) % SIM_SNAPSHOT_HISTORY;
+            start_ns = SDL_GetTicksNS();
+            bool ok = Sim_Restore(app, ids[back]);
+            Bench_Add(&restore_timer, SDL_GetTicksNS() - start_ns);
+            restore_pages += app->sim.restore_pages;
+
+            if (!ok || Replay_StateHash(app) != hashes[back])
+                restore_mismatches += 1;
+            history_next = (back + 1) % SIM_SNAPSHOT_HISTORY;
+        }
+    }
+
+    double committed_kb = committed / 1024.0;
+    SDL_Log("BENCH snapshot: %u objects (%u movers); sim region committed %.1f KB",
+            app->object_count - 1, (object_count + mover_every - 1) / mover_every, committed_kb);
+    SDL_Log("BENCH snapshot:   tick      avg %8.2f us, max %8.2f us",
+            Bench_AvgUs(&tick_timer), Bench_MaxUs(&tick_timer));
+    SDL_Log("BENCH snapshot:   snapshot  avg %8.2f us, max %8.2f us, avg %6.1f pages (%.1f KB)",
+            Bench_AvgUs(&snapshot_timer), Bench_MaxUs(&snapshot_timer),
+            (double)snapshot_pages / (double)snapshot_timer.count,
+            (double)snapshot_pages * app->sim.watch.page_size / 1024.0 / (double)snapshot_timer.count);
+    SDL_Log("BENCH snapshot:   restore   avg %8.2f us, max %8.2f us, avg %6.1f pages (%u snapshots back)",
+            Bench_AvgUs(&restore_timer), Bench_MaxUs(&restore_timer),
+            (double)restore_pages / (double)Max(restore_timer.count, 1), BENCH_SNAPSHOT_RESTORE_BACK);
+    SDL_Log("BENCH snapshot:   full copy avg %8.2f us, max %8.2f us",
+            Bench_AvgUs(&full_copy_timer), Bench_MaxUs(&full_copy_timer));
+    if (restore_mismatches)
+    {
+        SDL_Log("BENCH snapshot:   FAILED %llu of %llu restores don't match the snapshot hash",
+                restore_mismatches, restore_timer.count);
+    }
+
+    SDL_free(full_copy);
+    Bench_DestroyApp(app);
+    return !restore_mismatches;
+}
+
+static bool Bench_Snapshot(int argc, char **argv)
+{
+    Uint32 default_counts[] = {4000, 100000};
+    bool ok = true;
+    if (argc)
+    {
+        for (int i = 0; i < argc; i += 1)
+            ok &= Bench_SnapshotRun((Uint32)SDL_strtoul(argv[i], 0, 0));
+    }
+    else
+    {
+        ForArray(i, default_counts)
+            ok &= Bench_SnapshotRun(default_counts[i]);
+    }
+    return ok;
+}
+
+//
+// :: math ::
+// Vertex generation + camera transform and SAT projections done the way
+// they were before the batch math layer (one vertex at a time) versus
+// through V2x4 and stream functions. Results are compared too.
+//
+#define BENCH_MATH_REPEATS 20
+
+// per vertex version of Game_VerticesCameraTransform
+static void Bench_CameraTransformScalar(V2 *verts, Uint64 vert_count, V2 camera_p, float camera_scale,
+                                        V2 window_transform, float window_height)
+{
+    ForU64(i, vert_count)
+    {
+        verts[i].x = (verts[i].x - camera_p.x) * camera_scale + window_transform.x;
+        verts[i].y = window_height - ((verts[i].y - camera_p.y) * camera_scale + window_transform.y);
+    }
+}
+
+static Col_Projection Bench_CollisionProjectionScalar(Col_Normals normals, Col_Vertices verts)
+{
+    Col_Projection result = {0};
+    ForArray(normal_index, normals.arr)
+    {
+        RngF *projection = result.arr + normal_index;
+        projection->min = FLT_MAX;
+        projection->max = -FLT_MAX;
+        ForArray(vert_index, verts.arr)
+        {
+            float inner = V2_Inner(normals.arr[normal_index], verts.arr[vert_index]);
+            projection->min = Min(inner, projection->min);
+            projection->max = Max(inner, projection->max);
+        }
+    }
+    return result;
+}
+
+static bool Bench_MathRun(Uint32 object_count)
+{
+    Arena arena;
+    if (!Arena_Init(&arena, "bench math", (Uint64)object_count * 256 + ARENA_COMMIT_BLOCK))
+        return false;
+
+    Uint32 rng = 0x1234'5678;
+    V2 *positions = Arena_PushArrayNoZero(&arena, V2, object_count);
+    Col_Vertices *shapes = Arena_PushArrayNoZero(&arena, Col_Vertices, object_count);
+    Col_Normals *normals = Arena_PushArrayNoZero(&arena, Col_Normals, object_count);
+    V2 *verts_scalar = Arena_PushArrayNoZero(&arena, V2, (Uint64)object_count * 4);
+    V2 *verts_batch = Arena_PushArrayNoZero(&arena, V2, (Uint64)object_count * 4);
+    Assert(positions && shapes && normals && verts_scalar && verts_batch);
+
+    ForU32(i, object_count)
+    {
+        positions[i] = (V2){Bench_RandomF(&rng, -5000, 5000), Bench_RandomF(&rng, -5000, 5000)};
+        shapes[i] = Vertices_FromRect((V2){0}, (V2){Bench_RandomF(&rng, 5, 200), Bench_RandomF(&rng, 5, 200)});
+        Vertices_Rotate(shapes[i].arr, ArrayCount(shapes[i].arr), Bench_RandomF(&rng, 0, 1));
+        Vertices_Normals(normals[i].arr, shapes[i].arr, ArrayCount(shapes[i].arr));
+    }
+
+    V2 camera_p = {123.f, -456.f};
+    float camera_scale = 1.7f;
+    V2 window_transform = {427.f, 320.f};
+    float window_height = 640.f;
+    V2 x_axis = {camera_scale, 0};
+    V2 y_axis = {0, -camera_scale};
+    V2 offset = {window_transform.x - camera_p.x * camera_scale,
+                 window_height - window_transform.y + camera_p.y * camera_scale};
+
+    Bench_Timer scalar_timer = {0};
+    Bench_Timer batch_timer = {0};
+    ForU32(repeat, BENCH_MATH_REPEATS)
+    {
+        Uint64 start_ns = SDL_GetTicksNS();
+        ForU32(i, object_count)
+        {
+            V2 *verts = verts_scalar + (Uint64)i*4;
+            ForU32(j, 4)
+                verts[j] = V2_Add(shapes[i].arr[j], positions[i]);
+            Bench_CameraTransformScalar(verts, 4, camera_p, camera_scale, window_transform, window_height);
+        }
+        Bench_Add(&scalar_timer, SDL_GetTicksNS() - start_ns);
+
+        start_ns = SDL_GetTicksNS();
+        ForU32(i, object_count)
+            V2x4_Store(verts_batch + (Uint64)i*4, V2x4_Add(V2x4_Load(shapes[i].arr), V2x4_Set1(positions[i])));
+        V2_StreamTransform(verts_batch, verts_batch, (Uint64)object_count*4, x_axis, y_axis, offset);
+        Bench_Add(&batch_timer, SDL_GetTicksNS() - start_ns);
+    }
+
+    // transforms are folded differently, so results differ by rounding
+    float max_error = 0;
+    ForU64(i, (Uint64)object_count*4)
+    {
+        V2 d = V2_Sub(verts_scalar[i], verts_batch[i]);
+        max_error = Max(max_error, Max(AbsF(d.x), AbsF(d.y)));
+    }
+
+    // SAT: every shape projected on normals of the next one
+    Bench_Timer proj_scalar_timer = {0};
+    Bench_Timer proj_batch_timer = {0};
+    float sum_scalar = 0, sum_batch = 0;
+    Uint64 proj_mismatches = 0;
+    ForU32(repeat, BENCH_MATH_REPEATS)
+    {
+        Uint64 start_ns = SDL_GetTicksNS();
+        ForU32(i, object_count)
+        {
+            Col_Projection p = Bench_CollisionProjectionScalar(normals[(i + 1) % object_count], shapes[i]);
+            sum_scalar += p.arr[0].min + p.arr[3].max;
+        }
+        Bench_Add(&proj_scalar_timer, SDL_GetTicksNS() - start_ns);
+
+        start_ns = SDL_GetTicksNS();
+        ForU32(i, object_count)
+        {
+            Col_Projection p = CollisionProjection(normals[(i + 1) % object_count], shapes[i]);
+            sum_batch += p.arr[0].min + p.arr[3].max;
+        }
+        Bench_Add(&proj_batch_timer, SDL_GetTicksNS() - start_ns);
+    }
+    ForU32(i, object_count)
+    {
+        Col_Projection a = Bench_CollisionProjectionScalar(normals[(i + 1) % object_count], shapes[i]);
+        Col_Projection b = CollisionProjection(normals[(i + 1) % object_count], shapes[i]);
+        if (0 != memcmp(&a, &b, sizeof(a)))
+            proj_mismatches += 1;
+    }
+
+    const char *isa = "scalar";
+#if MATH_AVX2
+    isa = "avx2";
+#elif MATH_SSE2
+    isa = "sse2";
+#elif MATH_NEON
+    isa = "neon";
+#endif
+    SDL_Log("BENCH math: %u objects (%s)", object_count, isa);
+    SDL_Log("BENCH math:   quads + camera  scalar avg %8.2f us, batch avg %8.2f us (%.2fx), max error %g",
+            Bench_AvgUs(&scalar_timer), Bench_AvgUs(&batch_timer),
+            Bench_AvgUs(&scalar_timer) / Bench_AvgUs(&batch_timer), max_error);
+    SDL_Log("BENCH math:   SAT projection  scalar avg %8.2f us, batch avg %8.2f us (%.2fx)%s",
+            Bench_AvgUs(&proj_scalar_timer), Bench_AvgUs(&proj_batch_timer),
+            Bench_AvgUs(&proj_scalar_timer) / Bench_AvgUs(&proj_batch_timer),
+            sum_scalar == sum_batch ? "" : " (sums differ)");
+    if (proj_mismatches)
+        SDL_Log("BENCH math:   FAILED %llu projections differ from scalar ones", proj_mismatches);
+
+    Arena_Release(&arena);
+    return !proj_mismatches && max_error < 0.01f;
+}
+
+static bool Bench_Math(int argc, char **argv)
+{
+    Uint32 default_counts[] = {4000, 100000};
+    bool ok = true;
+    if (argc)
+    {
+        for (int i = 0; i < argc; i += 1)
+            ok &= Bench_MathRun((Uint32)SDL_strtoul(argv[i], 0, 0));
+    }
+    else
+    {
+        ForArray(i, default_counts)
+            ok &= Bench_MathRun(default_counts[i]);
+    }
+    return ok;
+}
+
+//
+// :: string ::
+// S8_Find and S8_Count on generated text that looks like config files,
+// logs and map text versus the naive scan they replaced (S8_Match at
+// every offset). Results of both have to be the same.
+//
+#define BENCH_STRING_REPEATS 5
+
+static S8_FindResult Bench_S8FindNaive(S8 str, S8 substring, Uint64 start_pos, S8_MatchFlags flags)
+{
+    S8_FindResult result = {0};
+    for (Uint64 i = start_pos; i < str.size; i += 1)
+    {
+        if (i + substring.size <= str.size)
+        {
+            S8 substr_from_str = S8_Substring(str, i, i+substring.size);
+            if (S8_Match(substr_from_str, substring, flags))
+            {
+                result.index = i;
+                result.found = 1;
+                if (!(flags & S8Match_FindLast))
+                    break;
+            }
+        }
+    }
+    return result;
+}
+
+static Uint64 Bench_S8CountNaive(S8 str, S8 substring, Uint64 start_pos, S8_MatchFlags flags)
+{
+    flags &= ~S8Match_FindLast;
+    Uint64 counter = 0;
+    for (;;)
+    {
+        S8_FindResult find = Bench_S8FindNaive(str, substring, start_pos, flags);
+        if (!find.found)
+            break;
+        start_pos = find.index + substring.size;
+        counter += 1;
+    }
+    return counter;
+}
+
+static S8 Bench_StringText(Arena *arena, Uint64 size)
+{
+    Uint8 *text = Arena_PushNoZero(arena, size, 1);
+    Assert(text);
+
+    Uint32 rng = 0x1234'5678;
+    Uint64 used = 0;
+    Uint32 line_id = 0;
+    for (;;)
+    {
+        char line[128];
+        Uint32 r = Bench_Random(&rng);
+        int len = 0;
+        switch (line_id % 4)
+        {
+            case 0: len = SDL_snprintf(line, sizeof(line), "net.tick_rate = %u\nwindow.width = %u\n",
+                                       r % 120, 640 + r % 1280); break;
+            case 1: len = SDL_snprintf(line, sizeof(line), "[%02u:%02u:%02u] Net: user %u connected from 192.168.%u.%u\n",
+                                       r % 24, r % 60, (r >> 8) % 60, r % 64, (r >> 4) % 256, (r >> 12) % 256); break;
+            case 2: len = SDL_snprintf(line, sizeof(line), "[00:00:00] Sprites: loaded C:\\Users\\mg\\demongus\\assets\\sprite_%u.png\n",
+                                       r % 4096); break;
+            case 3: len = SDL_snprintf(line, sizeof(line), "object %u wall p %d %d size %u %u\n",
+                                       line_id, (int)(r % 20000) - 10000, (int)((r >> 16) % 20000) - 10000,
+                                       8 + r % 256, 8 + (r >> 8) % 256); break;
+        }
+        if (used + (Uint64)len > size)
+            break;
+        memcpy(text + used, line, (Uint64)len);
+        used += (Uint64)len;
+        line_id += 1;
+    }
+
+    // one rare line close to the end
+    const char rare[] = "[23:59:59] Net: DESYNC at tick 123456\n";
+    Uint64 rare_at = used - Min(used, (Uint64)(used / 16 + sizeof(rare)));
+    memcpy(text + rare_at, rare, sizeof(rare) - 1);
+    return S8_Make(text, used);
+}
+
+static bool Bench_StringRun(Uint32 megabytes)
+{
+    Uint64 size = (Uint64)megabytes * 1024 * 1024;
+    Arena arena;
+    if (!Arena_Init(&arena, "bench string", size + ARENA_COMMIT_BLOCK))
+        return false;
+
+    S8 text = Bench_StringText(&arena, size);
+    struct { const char *name; const char *needle; S8_MatchFlags flags; bool count; } cases[] =
+    {
+        {"find rare",             "DESYNC at tick", 0, false},
+        {"find last",             "connected from", S8Match_FindLast, false},
+        {"find case-insensitive", "desync AT TICK", S8Match_CaseInsensitive, false},
+        {"find path",             "c:/users/mg/demongus/assets/sprite_4095.png",
+                                  S8Match_CaseInsensitive | S8Match_SlashInsensitive | S8Match_FindLast, false},
+        {"find missing",          "Net: user 99 ", 0, false},
+        {"count word",            "user", 0, true},
+        {"count case-insensitive","NET:", S8Match_CaseInsensitive, true},
+        {"count newlines",        "\n", 0, true},
+    };
+
+    SDL_Log("BENCH string: %.1f MB of text", text.size / (1024.0 * 1024.0));
+    bool ok = true;
+    ForArray(case_index, cases)
+    {
+        S8 needle = S8_MakeFromCstr(cases[case_index].needle);
+        S8_MatchFlags flags = cases[case_index].flags;
+        bool count = cases[case_index].count;
+
+        Bench_Timer naive_timer = {0};
+        Bench_Timer fast_timer = {0};
+        Uint64 naive_result = 0, fast_result = 0;
+        ForU32(repeat, BENCH_STRING_REPEATS)
+        {
+            Uint64 start_ns = SDL_GetTicksNS();
+            if (count)
+            {
+                naive_result = Bench_S8CountNaive(text, needle, 0, flags);
+            }
+            else
+            {
+                S8_FindResult find = Bench_S8FindNaive(text, needle, 0, flags);
+                naive_result = (find.found ? find.index : ~0ull);
+            }
+            Bench_Add(&naive_timer, SDL_GetTicksNS() - start_ns);
+
+            start_ns = SDL_GetTicksNS();
+            if (count)
+            {
+                fast_result = S8_Count(text, needle, 0, flags);
+            }
+            else
+            {
+                S8_FindResult find = S8_Find(text, needle, 0, flags);
+                fast_result = (find.found ? find.index : ~0ull);
+            }
+            Bench_Add(&fast_timer, SDL_GetTicksNS() - start_ns);
+        }
+
+        double naive_us = Bench_AvgUs(&naive_timer);
+        double fast_us = Bench_AvgUs(&fast_timer);
+        double megabytes_scanned = text.size / (1024.0 * 1024.0);
+        SDL_Log("BENCH string:   %-22s naive %10.1f us, new %10.1f us (%6.1fx, %7.0f MB/s) -> %lld%s",
+                cases[case_index].name, naive_us, fast_us, naive_us / Max(fast_us, 0.001),
+                megabytes_scanned / (Max(fast_us, 0.001) / 1000000.0), (long long)fast_result,
+                naive_result == fast_result ? "" : " MISMATCH");
+        ok &= (naive_result == fast_result);
+    }
+
+    Arena_Release(&arena);
+    return ok;
+}
+
+static bool Bench_String(int argc, char **argv)
+{
+    Uint32 default_megabytes[] = {1, 32};
+    bool ok = true;
+    if (argc)
+    {
+        for (int i = 0; i < argc; i += 1)
+            ok &= Bench_StringRun((Uint32)SDL_strtoul(argv[i], 0, 0));
+    }
+    else
+    {
+        ForArray(i, default_megabytes)
+            ok &= Bench_StringRun(default_megabytes[i]);
+    }
+    return ok;
+}
+
+//
+// :: bvh ::
+// Random rotated quads (walls) queried through the BVH, one by one and
+// batched, versus testing every shape. Brute force is too slow for big
+// counts, so it runs only on the first queries; results of those have
+// to match. "fan" rays come in groups of 4 from one origin (vision,
+// line of sight); "random" rays are unrelated.
+//
+#define BENCH_BVH_QUERIES 8192
+#define BENCH_BVH_BRUTE_BUDGET 40'000'000ull // shape tests per query kind
+#define BENCH_BVH_RANGE 600.f
+
+static Bvh_RayHit Bench_BruteRaycast(Bvh *bvh, Bvh_Ray ray)
+{
+    Bvh_RayHit result = {0};
+    float best_t = ray.max_t;
+    ForU32(i, bvh->shape_count)
+    {
+        float t;
+        V2 normal;
+        if (Bvh_RayShape(bvh->shapes + i, ray.origin, ray.dir, best_t, &t, &normal) &&
+            (!result.hit || t < best_t))
+        {
+            best_t = t;
+            result.hit = true;
+            result.t = t;
+            result.id = bvh->shapes[i].id;
+        }
+    }
+    return result;
+}
+
+static bool Bench_BruteSegment(Bvh *bvh, V2 from, V2 to)
+{
+    ForU32(i, bvh->shape_count)
+    {
+        float t;
+        V2 normal;
+        if (Bvh_RayShape(bvh->shapes + i, from, V2_Sub(to, from), 1.f, &t, &normal))
+            return true;
+    }
+    return false;
+}
+
+static Uint32 Bench_BrutePoint(Bvh *bvh, V2 p)
+{
+    Uint32 result = 0;
+    ForU32(i, bvh->shape_count)
+        result += Bvh_PointShape(bvh->shapes + i, p);
+    return result;
+}
+
+static Uint32 Bench_BruteBox(Bvh *bvh, Bvh_Box box)
+{
+    Uint32 result = 0;
+    ForU32(i, bvh->shape_count)
+        result += Bvh_BoxShape(box, bvh->shapes + i);
+    return result;
+}
+
+// t of the closest hit can differ by rounding when boxes are entered differently
+static bool Bench_SameHit(Bvh_RayHit a, Bvh_RayHit b)
+{
+    if (a.hit != b.hit)
+        return false;
+    return (!a.hit || AbsF(a.t - b.t) <= 1e-4f * Max(1.f, a.t));
+}
+
+static double Bench_NsPerQuery(Uint64 ns, Uint32 count)
+{
+    return (double)ns / (double)Max(count, 1);
+}
+
+static bool Bench_BvhRun(Uint32 shape_count)
+{
+    Uint32 query_count = BENCH_BVH_QUERIES;
+    Uint64 arena_size = ((Uint64)shape_count * (sizeof(Bvh_Shape) + 2 * sizeof(Bvh_Node)) +
+                         (Uint64)query_count * (2 * sizeof(Bvh_Ray) + 2 * sizeof(Bvh_RayHit) + 8 * sizeof(V2) + 16) +
+                         ARENA_COMMIT_BLOCK * 4);
+    Arena arena;
+    if (!shape_count || !Arena_Init(&arena, "bench bvh", arena_size))
+        return false;
+
+    Uint32 rng = 0x1234'5678;
+    float half_size = 0.5f * 60.f * SqrtF((float)shape_count);
+    Bvh_Shape *shapes = Arena_PushArrayNoZero(&arena, Bvh_Shape, shape_count);
+    Assert(shapes);
+    ForU32(i, shape_count)
+    {
+        Col_Vertices verts = Vertices_FromRect((V2){0}, (V2){Bench_RandomF(&rng, 5, 60), Bench_RandomF(&rng, 5, 60)});
+        Vertices_Rotate(verts.arr, ArrayCount(verts.arr), Bench_RandomF(&rng, 0, 1));
+        Vertices_Offset(verts.arr, ArrayCount(verts.arr),
+                        (V2){Bench_RandomF(&rng, -half_size, half_size), Bench_RandomF(&rng, -half_size, half_size)});
+        Col_Normals normals;
+        Vertices_Normals(normals.arr, verts.arr, ArrayCount(verts.arr));
+        shapes[i] = Bvh_MakeShape(verts, normals, i);
+    }
+
+    Uint64 start_ns = SDL_GetTicksNS();
+    Bvh bvh = Bvh_Build(&arena, shapes, shape_count);
+    Uint64 build_ns = SDL_GetTicksNS() - start_ns;
+    Assert(bvh.node_count);
+
+    Bvh_Ray *random_rays = Arena_PushArrayNoZero(&arena, Bvh_Ray, query_count);
+    Bvh_Ray *fan_rays = Arena_PushArrayNoZero(&arena, Bvh_Ray, query_count);
+    Bvh_RayHit *hits = Arena_PushArrayNoZero(&arena, Bvh_RayHit, query_count);
+    Bvh_RayHit *batch_hits = Arena_PushArrayNoZero(&arena, Bvh_RayHit, query_count);
+    V2 *from = Arena_PushArrayNoZero(&arena, V2, query_count);
+    V2 *to = Arena_PushArrayNoZero(&arena, V2, query_count);
+    V2 *points = Arena_PushArrayNoZero(&arena, V2, query_count);
+    Bvh_Box *boxes = Arena_PushArrayNoZero(&arena, Bvh_Box, query_count);
+    bool *blocked = Arena_PushArrayNoZero(&arena, bool, query_count);
+    bool *batch_blocked = Arena_PushArrayNoZero(&arena, bool, query_count);
+    Uint32 *counts = Arena_PushArrayNoZero(&arena, Uint32, query_count);
+    Uint32 *expected = Arena_PushArrayNoZero(&arena, Uint32, query_count);
+    Assert(random_rays && fan_rays && hits && batch_hits && from && to &&
+           points && boxes && blocked && batch_blocked && counts && expected);
+
+    ForU32(i, query_count)
+    {
+        V2 origin = {Bench_RandomF(&rng, -half_size, half_size), Bench_RandomF(&rng, -half_size, half_size)};
+        float angle = Bench_RandomF(&rng, 0, 1);
+        random_rays[i] = (Bvh_Ray){origin, V2_Rotate((V2){1, 0}, angle), BENCH_BVH_RANGE};
+
+        if (i % 4 == 0)
+            fan_rays[i] = random_rays[i];
+        else
+            fan_rays[i] = (Bvh_Ray){fan_rays[i - 1].origin, V2_Rotate(fan_rays[i - 1].dir, 0.002f), BENCH_BVH_RANGE};
+
+        from[i] = origin;
+        to[i] = V2_Add(origin, (V2){Bench_RandomF(&rng, -400, 400), Bench_RandomF(&rng, -400, 400)});
+        points[i] = (V2){Bench_RandomF(&rng, -half_size, half_size), Bench_RandomF(&rng, -half_size, half_size)};
+        V2 half_dim = {Bench_RandomF(&rng, 10, 100), Bench_RandomF(&rng, 10, 100)};
+        boxes[i] = (Bvh_Box){V2_Sub(points[i], half_dim), V2_Add(points[i], half_dim)};
+    }
+
+    Uint32 brute_count = (Uint32)Clamp(64ull, (Uint64)query_count, BENCH_BVH_BRUTE_BUDGET / shape_count);
+    Uint64 mismatches = 0;
+    Uint64 hit_count = 0;
+
+    SDL_Log("BENCH bvh: %u shapes; %u nodes, depth %u, built in %.2f ms; brute force on %u of %u queries",
+            shape_count, bvh.node_count, bvh.depth, (double)build_ns / (double)SDL_NS_PER_MS,
+            brute_count, query_count);
+
+    // rays
+    Bvh_Ray *ray_sets[] = {random_rays, fan_rays};
+    const char *ray_names[] = {"random rays", "fan rays   "};
+    ForArray(set, ray_sets)
+    {
+        Bvh_Ray *rays = ray_sets[set];
+
+        start_ns = SDL_GetTicksNS();
+        ForU32(i, brute_count)
+            hits[i] = Bench_BruteRaycast(&bvh, rays[i]);
+        Uint64 brute_ns = SDL_GetTicksNS() - start_ns;
+        ForU32(i, brute_count)
+            batch_hits[i] = Bvh_Raycast(&bvh, rays[i]);
+        ForU32(i, brute_count)
+            mismatches += !Bench_SameHit(hits[i], batch_hits[i]);
+
+        start_ns = SDL_GetTicksNS();
+        ForU32(i, query_count)
+            hits[i] = Bvh_Raycast(&bvh, rays[i]);
+        Uint64 single_ns = SDL_GetTicksNS() - start_ns;
+
+        start_ns = SDL_GetTicksNS();
+        Bvh_RaycastBatch(&bvh, rays, batch_hits, query_count);
+        Uint64 batch_ns = SDL_GetTicksNS() - start_ns;
+
+        ForU32(i, query_count)
+        {
+            mismatches += !Bench_SameHit(hits[i], batch_hits[i]);
+            hit_count += hits[i].hit;
+        }
+
+        SDL_Log("BENCH bvh:   %s brute %10.1f ns, bvh %8.1f ns (%6.1fx), batch %8.1f ns (%6.1fx)",
+                ray_names[set], Bench_NsPerQuery(brute_ns, brute_count),
+                Bench_NsPerQuery(single_ns, query_count),
+                Bench_NsPerQuery(brute_ns, brute_count) / Bench_NsPerQuery(single_ns, query_count),
+                Bench_NsPerQuery(batch_ns, query_count),
+                Bench_NsPerQuery(brute_ns, brute_count) / Bench_NsPerQuery(batch_ns, query_count));
+    }
+
+    // segments
+    {
+        start_ns = SDL_GetTicksNS();
+        ForU32(i, brute_count)
+            blocked[i] = Bench_BruteSegment(&bvh, from[i], to[i]);
+        Uint64 brute_ns = SDL_GetTicksNS() - start_ns;
+        ForU32(i, brute_count)
+            mismatches += (blocked[i] != Bvh_SegmentBlocked(&bvh, from[i], to[i]));
+
+        start_ns = SDL_GetTicksNS();
+        ForU32(i, query_count)
+            blocked[i] = Bvh_SegmentBlocked(&bvh, from[i], to[i]);
+        Uint64 single_ns = SDL_GetTicksNS() - start_ns;
+
+        start_ns = SDL_GetTicksNS();
+        Bvh_SegmentBatch(&bvh, from, to, batch_blocked, query_count);
+        Uint64 batch_ns = SDL_GetTicksNS() - start_ns;
+
+        ForU32(i, query_count)
+            mismatches += (blocked[i] != batch_blocked[i]);
+
+        SDL_Log("BENCH bvh:   segments    brute %10.1f ns, bvh %8.1f ns (%6.1fx), batch %8.1f ns (%6.1fx)",
+                Bench_NsPerQuery(brute_ns, brute_count), Bench_NsPerQuery(single_ns, query_count),
+                Bench_NsPerQuery(brute_ns, brute_count) / Bench_NsPerQuery(single_ns, query_count),
+                Bench_NsPerQuery(batch_ns, query_count),
+                Bench_NsPerQuery(brute_ns, brute_count) / Bench_NsPerQuery(batch_ns, query_count));
+    }
+
+    // points and boxes
+    {
+        Uint32 ids[64];
+        Uint64 brute_ns[2] = {0};
+        Uint64 bvh_ns[2] = {0};
+        ForU32(kind, 2)
+        {
+            start_ns = SDL_GetTicksNS();
+            ForU32(i, brute_count)
+                expected[i] = (kind ? Bench_BruteBox(&bvh, boxes[i]) : Bench_BrutePoint(&bvh, points[i]));
+            brute_ns[kind] = SDL_GetTicksNS() - start_ns;
+
+            start_ns = SDL_GetTicksNS();
+            ForU32(i, query_count)
+            {
+                counts[i] = (kind ?
+                             Bvh_QueryBox(&bvh, boxes[i], ids, ArrayCount(ids)) :
+                             Bvh_QueryPoint(&bvh, points[i], ids, ArrayCount(ids)));
+            }
+            bvh_ns[kind] = SDL_GetTicksNS() - start_ns;
+
+            ForU32(i, brute_count)
+                mismatches += (counts[i] != expected[i]);
+        }
+
+        SDL_Log("BENCH bvh:   points      brute %10.1f ns, bvh %8.1f ns (%6.1fx)",
+                Bench_NsPerQuery(brute_ns[0], brute_count), Bench_NsPerQuery(bvh_ns[0], query_count),
+                Bench_NsPerQuery(brute_ns[0], brute_count) / Bench_NsPerQuery(bvh_ns[0], query_count));
+        SDL_Log("BENCH bvh:   boxes       brute %10.1f ns, bvh %8.1f ns (%6.1fx)",
+                Bench_NsPerQuery(brute_ns[1], brute_count), Bench_NsPerQuery(bvh_ns[1], query_count),
+                Bench_NsPerQuery(brute_ns[1], brute_count) / Bench_NsPerQuery(bvh_ns[1], query_count));
+    }
+
+    SDL_Log("BENCH bvh:   %.1f%% of rays hit something", 100.0 * (double)hit_count / (double)(query_count * 2));
+    if (mismatches)
+        SDL_Log("BENCH bvh:   FAILED %llu queries differ from brute force or single queries", mismatches);
+
+    Arena_Release(&arena);
+    return !mismatches;
+}
+
+static bool Bench_Bvh(int argc, char **argv)
+{
+    Uint32 default_counts[] = {1000, 100000};
+    bool ok = true;
+    if (argc)
+    {
+        for (int i = 0; i < argc; i += 1)
+            ok &= Bench_BvhRun((Uint32)SDL_strtoul(argv[i], 0, 0));
+    }
+    else
+    {
+        ForArray(i, default_counts)
+            ok &= Bench_BvhRun(default_counts[i]);
+    }
+    return ok;
+}
+
+//
+// :: visibility ::
+// Visibility polygons of random viewers among random walls (same layout
+// as bvh bench). Random points around each viewer have to be inside of
+// its polygon exactly when the segment to them isn't blocked
+// (Bvh_SegmentBlocked); points grazing a corner can go either way, so a
+// tiny fraction of mismatches is tolerated.
+//
+#define BENCH_VISIBILITY_VIEWERS 1024
+#define BENCH_VISIBILITY_POINTS 64 // per viewer
+
+static bool Bench_VisibilityRun(Uint32 shape_count)
+{
+    Uint32 viewer_count = BENCH_VISIBILITY_VIEWERS;
+    Uint64 arena_size = ((Uint64)shape_count * (sizeof(Bvh_Shape) + 2 * sizeof(Bvh_Node)) +
+                         (Uint64)viewer_count * (sizeof(V2) + sizeof(Visibility_Polygon)) +
+                         ARENA_COMMIT_BLOCK * 4);
+    Arena arena, scratch;
+    if (!shape_count || !Arena_Init(&arena, "bench visibility", arena_size))
+        return false;
+    if (!Arena_Init(&scratch, "bench visibility scratch", 64*1024*1024))
+    {
+        Arena_Release(&arena);
+        return false;
+    }
+
+    // same density as the bvh bench: ~one wall per 60x60 area
+    Uint32 rng = 0x1234'5678;
+    float half_size = 0.5f * 60.f * SqrtF((float)shape_count);
+    Bvh_Shape *shapes = Arena_PushArrayNoZero(&arena, Bvh_Shape, shape_count);
+    Assert(shapes);
+    ForU32(i, shape_count)
+    {
+        Col_Vertices verts = Vertices_FromRect((V2){0}, (V2){Bench_RandomF(&rng, 5, 60), Bench_RandomF(&rng, 5, 60)});
+        Vertices_Rotate(verts.arr, ArrayCount(verts.arr), Bench_RandomF(&rng, 0, 1));
+        Vertices_Offset(verts.arr, ArrayCount(verts.arr),
+                        (V2){Bench_RandomF(&rng, -half_size, half_size), Bench_RandomF(&rng, -half_size, half_size)});
+        Col_Normals normals;
+        Vertices_Normals(normals.arr, verts.arr, ArrayCount(verts.arr));
+        shapes[i] = Bvh_MakeShape(verts, normals, i);
+    }
+    Bvh bvh = Bvh_Build(&arena, shapes, shape_count);
+    Assert(bvh.node_count);
+
+    // viewers stand outside of walls, like players do
+    V2 *viewers = Arena_PushArrayNoZero(&arena, V2, viewer_count);
+    Visibility_Polygon *polys = Arena_PushArray(&arena, Visibility_Polygon, viewer_count);
+    Assert(viewers && polys);
+    ForU32(i, viewer_count)
+    {
+        do
+        {
+            viewers[i] = (V2){Bench_RandomF(&rng, -half_size, half_size), Bench_RandomF(&rng, -half_size, half_size)};
+        } while (Bvh_QueryPoint(&bvh, viewers[i], 0, 0));
+    }
+
+    // first pass grows polygon buffers
+    ForU32(i, viewer_count)
+        Visibility_Compute(&scratch, &bvh, viewers[i], VISIBILITY_RANGE, polys + i);
+
+    Uint64 start_ns = SDL_GetTicksNS();
+    ForU32(i, viewer_count)
+        Visibility_Compute(&scratch, &bvh, viewers[i], VISIBILITY_RANGE, polys + i);
+    Uint64 compute_ns = SDL_GetTicksNS() - start_ns;
+
+    Uint64 vert_count = 0;
+    Uint32 max_verts = 0;
+    ForU32(i, viewer_count)
+    {
+        vert_count += polys[i].count;
+        max_verts = Max(max_verts, polys[i].count);
+    }
+
+    Uint64 checks = 0;
+    Uint64 visible = 0;
+    Uint64 mismatches = 0;
+    Uint64 contains_ns = 0;
+    Uint64 segment_ns = 0;
+    ForU32(i, viewer_count)
+    {
+        ForU32(point_index, BENCH_VISIBILITY_POINTS)
+        {
+            V2 p = V2_Add(viewers[i], (V2){Bench_RandomF(&rng, -VISIBILITY_RANGE, VISIBILITY_RANGE),
+                                           Bench_RandomF(&rng, -VISIBILITY_RANGE, VISIBILITY_RANGE)});
+
+            Uint64 t0 = SDL_GetTicksNS();
+            bool contains = Visibility_Contains(polys + i, p);
+            Uint64 t1 = SDL_GetTicksNS();
+            bool blocked = Bvh_SegmentBlocked(&bvh, viewers[i], p);
+            Uint64 t2 = SDL_GetTicksNS();
+            contains_ns += t1 - t0;
+            segment_ns += t2 - t1;
+
+            checks += 1;
+            visible += contains;
+            mismatches += (contains == blocked);
+        }
+    }
+
+    double polygon_us = (double)compute_ns / (double)viewer_count / 1000.0;
+    SDL_Log("BENCH visibility: %u shapes, %u viewers, range %.0f", shape_count, viewer_count, VISIBILITY_RANGE);
+    SDL_Log("BENCH visibility:   polygon     %8.1f us (%.0f polygons per 1 ms), %.1f verts avg, %u max",
+            polygon_us, 1000.0 / Max(polygon_us, 0.001),
+            (double)vert_count / (double)viewer_count, max_verts);
+    SDL_Log("BENCH visibility:   contains    %8.1f ns, segment test %8.1f ns; %.1f%% of points visible",
+            Bench_NsPerQuery(contains_ns, (Uint32)checks), Bench_NsPerQuery(segment_ns, (Uint32)checks),
+            100.0 * (double)visible / (double)checks);
+
+    bool ok = (mismatches * 1000 <= checks);
+    SDL_Log("BENCH visibility:   %s %llu of %llu points differ from segment tests",
+            ok ? "ok," : "FAILED", mismatches, checks);
+
+    ForU32(i, viewer_count)
+        Visibility_Free(polys + i);
+    Arena_Release(&scratch);
+    Arena_Release(&arena);
+    return ok;
+}
+
+static bool Bench_Visibility(int argc, char **argv)
+{
+    Uint32 default_counts[] = {1000, 100000};
+    bool ok = true;
+    if (argc)
+    {
+        for (int i = 0; i < argc; i += 1)
+            ok &= Bench_VisibilityRun((Uint32)SDL_strtoul(argv[i], 0, 0));
+    }
+    else
+    {
+        ForArray(i, default_counts)
+            ok &= Bench_VisibilityRun(default_counts[i]);
+    }
+    return ok;
+}
+
+//
+// :: pool ::
+// Creates objects until the object pool runs out of reserved space.
+// Object_Create has to keep returning the nil object after that and
+// objects created before have to stay readable through their handles.
+//
+static bool Bench_Pool(int argc, char **argv)
+{
+    (void)argc; (void)argv;
+    AppState *app = Bench_CreateApp();
+    if (!app)
+        return false;
+
+    Object_Handle first = Object_HandleFromPointer(app, Object_Create(app, 0, ObjectFlag_Draw));
+    Uint64 start_ns = SDL_GetTicksNS();
+    Uint32 created = 1;
+    for (;;)
+    {
+        Object *obj = Object_Create(app, 0, ObjectFlag_Draw);
+        if (Object_IsZero(app, obj))
+            break;
+        obj->p = (V2){(float)created, 0};
+        created += 1;
+    }
+    Uint64 create_ns = SDL_GetTicksNS() - start_ns;
+
+    // more attempts after the pool is full; like Map_LoadChunk does
+    bool ok = true;
+    ForU32(i, 16)
+        ok &= Object_IsZero(app, Object_Create(app, 0, ObjectFlag_Draw));
+
+    Object *nil = Object_Get(app, 0);
+    ok &= (app->object_pool && nil && !nil->flags);
+    ok &= !Object_IsZero(app, Object_FromHandle(app, first));
+    ok &= Object_IsZero(app, Object_FromHandle(app, 0));
+    ok &= (app->object_count == created + 1); // + nil
+
+    Object *last = Object_Get(app, app->object_count - 1);
+    ok &= (last->p.x == (float)(created - 1));
+
+    SDL_Log("BENCH pool: %u objects (max %u) created in %.2f ms; %.1f MB committed",
+            created, OBJECT_MAX_COUNT, (double)create_ns / (double)SDL_NS_PER_MS,
+            (double)app->object_arena.committed / (1024.0 * 1024.0));
+    SDL_Log("BENCH pool:   %s nil object and existing objects after the pool is full",
+            ok ? "ok," : "FAILED,");
+
+    Bench_DestroyApp(app);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    struct { const char *name; bool (*run)(int argc, char **argv); } benches[] =
+    {
+        {"snapshot", Bench_Snapshot},
+        {"math", Bench_Math},
+        {"string", Bench_String},
+        {"bvh", Bench_Bvh},
+        {"visibility", Bench_Visibility},
+        {"pool", Bench_Pool},
+    };
+
+    if (argc < 2)
+    {
+        SDL_Log("BENCH: usage: bench <name> [args]; available:");
+        ForArray(i, benches)
+            SDL_Log("BENCH:   %s", benches[i].name);
+        return 1;
+    }
+
+    ForArray(i, benches)
+    {
+        if (0 == strcmp(argv[1], benches[i].name))
+            return benches[i].run(argc - 2, argv + 2) ? 0 : 1;
+    }
+
+    SDL_Log("BENCH: Unknown benchmark %s", argv[1]);
+    return 1;
+}
@@ -0,0 +1,474 @@
+//
+// Virtual memory
+// Address space is reserved up front and committed in blocks
+// as the arena grows, so memory that is never touched is never committed.
+// Read-only file mappings live here too.
+//
+typedef struct
+{
+    Uint8 *base; // 0 if file couldn't be mapped
+    Uint64 size;
+} Os_MappedFile;
+
+typedef enum
+{
+    Os_Page_Untracked, // not committed or committed after the last Os_WatchReset
+    Os_Page_Clean,
+    Os_Page_Dirty, // listed in dirty_pages
+} Os_PageState;
+
+// :: write_watch ::
+// Reservation that reports which of its pages were written to since
+// they were last reset. Windows does it natively (MEM_WRITE_WATCH).
+// POSIX protects clean pages; the first write faults, the fault handler
+// lists the page and unprotects it. Only one watch can be started at a time.
+// Pages are only protected after Os_WatchStart, so processes that never
+// start their watch keep the default SIGSEGV/SIGBUS handling.
+// @info(mg) Debuggers stop on these faults; in gdb use `handle SIGSEGV nostop noprint`.
+typedef struct
+{
+    Uint8 *base;
+    Uint64 size;
+    Uint64 page_size;
+    Uint32 page_count;
+    Uint8 *page_states; // Os_PageState per page
+    Uint32 *dirty_pages; // in order they were found
+    Uint32 dirty_count;
+    void **addresses; // Windows: GetWriteWatch output
+} Os_WriteWatch;
+
+static bool Os_WatchAlloc(Os_WriteWatch *watch, Uint64 size, Uint64 page_size)
+{
+    watch->size = size;
+    watch->page_size = page_size;
+    watch->page_count = (Uint32)(size / page_size);
+    watch->page_states = SDL_calloc(watch->page_count, sizeof(*watch->page_states));
+    watch->dirty_pages = SDL_malloc(watch->page_count * sizeof(*watch->dirty_pages));
+    watch->addresses = SDL_malloc(watch->page_count * sizeof(*watch->addresses));
+    return (watch->page_states && watch->dirty_pages && watch->addresses);
+}
+
+static void Os_WatchFree(Os_WriteWatch *watch)
+{
+    SDL_free(watch->page_states);
+    SDL_free(watch->dirty_pages);
+    SDL_free(watch->addresses);
+    SDL_zerop(watch);
+}
+
+// Lists a page as dirty; pages committed after the last reset aren't tracked
+// by the OS yet, so their owner has to list them.
+static void Os_WatchMark(Os_WriteWatch *watch, Uint32 page)
+{
+    if (watch->page_states[page] != Os_Page_Dirty)
+    {
+        watch->page_states[page] = Os_Page_Dirty;
+        watch->dirty_pages[watch->dirty_count] = page;
+        watch->dirty_count += 1;
+    }
+}
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+static void *Os_Reserve(Uint64 size)
+{
+    return VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+static bool Os_Commit(void *ptr, Uint64 size)
+{
+    return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != 0;
+}
+static void Os_Release(void *ptr, Uint64 size)
+{
+    (void)size;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+static Os_MappedFile Os_MapFile(const char *path)
+{
+    Os_MappedFile result = {0};
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE)
+        return result;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+        if (mapping)
+        {
+            result.base = (Uint8 *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (result.base)
+                result.size = (Uint64)size.QuadPart;
+            CloseHandle(mapping); // view keeps the mapping alive
+        }
+    }
+    CloseHandle(file);
+    return result;
+}
+static void Os_UnmapFile(Os_MappedFile *file)
+{
+    if (file->base)
+        UnmapViewOfFile(file->base);
+    SDL_zerop(file);
+}
+
+static bool Os_WatchInit(Os_WriteWatch *watch, Uint64 size)
+{
+    SDL_zerop(watch);
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    watch->base = (Uint8 *)VirtualAlloc(0, size, MEM_RESERVE|MEM_WRITE_WATCH, PAGE_NOACCESS);
+    if (!watch->base)
+        return false;
+    return Os_WatchAlloc(watch, size, info.dwPageSize);
+}
+
+static void Os_WatchStart(Os_WriteWatch *watch)
+{
+    (void)watch; // MEM_WRITE_WATCH tracks writes from the start
+}
+
+static void Os_WatchRelease(Os_WriteWatch *watch)
+{
+    if (watch->base)
+        VirtualFree(watch->base, 0, MEM_RELEASE);
+    Os_WatchFree(watch);
+}
+
+// Lists pages written since they were last reset.
+static void Os_WatchCollect(Os_WriteWatch *watch)
+{
+    ULONG_PTR count = watch->page_count;
+    DWORD granularity = 0;
+    if (GetWriteWatch(0, watch->base, watch->size, watch->addresses, &count, &granularity) != 0)
+        return;
+
+    ForU64(i, count)
+    {
+        Uint64 offset = (Uint8 *)watch->addresses[i] - watch->base;
+        Os_WatchMark(watch, (Uint32)(offset / watch->page_size));
+    }
+}
+
+// Dirty pages become clean; runs of consecutive pages are reset at once.
+static void Os_WatchReset(Os_WriteWatch *watch)
+{
+    for (Uint32 i = 0; i < watch->dirty_count;)
+    {
+        Uint32 first = watch->dirty_pages[i];
+        Uint32 run = 1;
+        while (i + run < watch->dirty_count && watch->dirty_pages[i + run] == first + run)
+            run += 1;
+
+        ForU32(j, run)
+            watch->page_states[first + j] = Os_Page_Clean;
+        ResetWriteWatch(watch->base + (Uint64)first * watch->page_size, (Uint64)run * watch->page_size);
+        i += run;
+    }
+    watch->dirty_count = 0;
+}
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+
+static void *Os_Reserve(Uint64 size)
+{
+    void *result = mmap(0, size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    return (result == MAP_FAILED ? 0 : result);
+}
+static bool Os_Commit(void *ptr, Uint64 size)
+{
+    return 0 == mprotect(ptr, size, PROT_READ|PROT_WRITE);
+}
+static void Os_Release(void *ptr, Uint64 size)
+{
+    munmap(ptr, size);
+}
+
+static Os_MappedFile Os_MapFile(const char *path)
+{
+    Os_MappedFile result = {0};
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return result;
+
+    struct stat st;
+    if (0 == fstat(fd, &st) && st.st_size > 0)
+    {
+        void *base = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base != MAP_FAILED)
+        {
+            result.base = (Uint8 *)base;
+            result.size = (Uint64)st.st_size;
+        }
+    }
+    close(fd); // mapping stays valid after the descriptor is closed
+    return result;
+}
+static void Os_UnmapFile(Os_MappedFile *file)
+{
+    if (file->base)
+        munmap(file->base, file->size);
+    SDL_zerop(file);
+}
+
+static Os_WriteWatch *os_active_watch;
+static struct sigaction os_prev_sigsegv;
+static struct sigaction os_prev_sigbus;
+
+static void Os_WatchFault(int sig, siginfo_t *info, void *context)
+{
+    Os_WriteWatch *watch = os_active_watch;
+    Uint8 *address = (Uint8 *)info->si_addr;
+    if (watch && address >= watch->base && address < watch->base + watch->size)
+    {
+        Uint32 page = (Uint32)((Uint64)(address - watch->base) / watch->page_size);
+        if (watch->page_states[page] == Os_Page_Clean)
+        {
+            Os_WatchMark(watch, page);
+            mprotect(watch->base + (Uint64)page * watch->page_size, watch->page_size, PROT_READ|PROT_WRITE);
+            return;
+        }
+    }
+
+    // not ours; pass it on
+    struct sigaction *prev = (sig == SIGBUS ? &os_prev_sigbus : &os_prev_sigsegv);
+    if (prev->sa_flags & SA_SIGINFO)
+    {
+        prev->sa_sigaction(sig, info, context);
+    }
+    else if (prev->sa_handler == SIG_DFL || prev->sa_handler == SIG_IGN)
+    {
+        sigaction(sig, prev, 0); // faulting instruction reruns and crashes as usual
+    }
+    else
+    {
+        prev->sa_handler(sig);
+    }
+}
+
+static bool Os_WatchInit(Os_WriteWatch *watch, Uint64 size)
+{
+    SDL_zerop(watch);
+    watch->base = (Uint8 *)Os_Reserve(size);
+    if (!watch->base)
+        return false;
+    return Os_WatchAlloc(watch, size, (Uint64)sysconf(_SC_PAGESIZE));
+}
+
+// Installs the fault handler; has to run before the first Os_WatchReset protects pages.
+static void Os_WatchStart(Os_WriteWatch *watch)
+{
+    if (os_active_watch == watch)
+        return;
+    Assert(!os_active_watch);
+
+    // macOS reports writes to protected pages as SIGBUS
+    struct sigaction action = {0};
+    action.sa_sigaction = Os_WatchFault;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &os_prev_sigsegv);
+    sigaction(SIGBUS, &action, &os_prev_sigbus);
+    os_active_watch = watch;
+}
+
+static void Os_WatchRelease(Os_WriteWatch *watch)
+{
+    if (os_active_watch == watch)
+    {
+        sigaction(SIGSEGV, &os_prev_sigsegv, 0);
+        sigaction(SIGBUS, &os_prev_sigbus, 0);
+        os_active_watch = 0;
+    }
+    if (watch->base)
+        Os_Release(watch->base, watch->size);
+    Os_WatchFree(watch);
+}
+
+// Lists pages written since they were last reset;
+// on POSIX the fault handler has already done it.
+static void Os_WatchCollect(Os_WriteWatch *watch)
+{
+    (void)watch;
+}
+
+// Dirty pages become clean. Clean pages between them are protected again
+// too; it keeps the region in a few big mappings instead of one per
+// written page (mprotect and faults get slow with thousands of them).
+static void Os_WatchReset(Os_WriteWatch *watch)
+{
+    if (!watch->dirty_count)
+        return;
+
+    Uint32 first = watch->page_count;
+    Uint32 last = 0;
+    ForU32(i, watch->dirty_count)
+    {
+        Uint32 page = watch->dirty_pages[i];
+        watch->page_states[page] = Os_Page_Clean;
+        first = Min(first, page);
+        last = Max(last, page);
+    }
+
+    // untracked pages in between (not committed yet) split it into runs
+    for (Uint32 page = first; page <= last;)
+    {
+        Uint32 run = 0;
+        while (page + run <= last && watch->page_states[page + run] == Os_Page_Clean)
+            run += 1;
+
+        if (run)
+            mprotect(watch->base + (Uint64)page * watch->page_size, (Uint64)run * watch->page_size, PROT_READ);
+        page += Max(run, 1);
+    }
+    watch->dirty_count = 0;
+}
+#endif
+
+//
+// Arena
+// Linear allocator over reserved address space. Memory is only
+// freed all at once with Arena_Reset (committed pages are kept).
+//
+#define ARENA_COMMIT_BLOCK (64 * 1024)
+#define ARENA_DEFAULT_ALIGN 16
+
+typedef struct
+{
+    const char *name;
+    Uint8 *base;
+    Uint64 reserved;
+    Uint64 committed;
+    Uint64 used;
+    Uint64 used_high_water;
+    bool borrowed; // part of a bigger reservation; released by its owner
+} Arena;
+
+static bool Arena_Init(Arena *arena, const char *name, Uint64 reserve_size)
+{
+    SDL_zerop(arena);
+    arena->name = name;
+    reserve_size = AlignUp(reserve_size, ARENA_COMMIT_BLOCK);
+    arena->base = (Uint8 *)Os_Reserve(reserve_size);
+    if (!arena->base)
+    {
+        SDL_Log("Arena %s: failed to reserve %llu bytes", name, reserve_size);
+        return false;
+    }
+    arena->reserved = reserve_size;
+    return true;
+}
+
+// Arena over already reserved address space; reserve_size has to be
+// a multiple of ARENA_COMMIT_BLOCK so commits stay inside of it.
+static void Arena_InitBorrowed(Arena *arena, const char *name, Uint8 *base, Uint64 reserve_size)
+{
+    Assert(reserve_size % ARENA_COMMIT_BLOCK == 0);
+    SDL_zerop(arena);
+    arena->name = name;
+    arena->base = base;
+    arena->reserved = reserve_size;
+    arena->borrowed = true;
+}
+
+static void Arena_Release(Arena *arena)
+{
+    if (arena->base && !arena->borrowed)
+        Os_Release(arena->base, arena->reserved);
+    SDL_zerop(arena);
+}
+
+// Returns uninitialized memory; 0 when reserved space runs out.
+static void *Arena_PushNoZero(Arena *arena, Uint64 size, Uint64 align)
+{
+    Uint64 start = AlignUp(arena->used, align);
+    Uint64 end = start + size;
+    if (end > arena->reserved)
+    {
+        SDL_Log("Arena %s: out of reserved memory (%llu/%llu bytes)",
+                arena->name, end, arena->reserved);
+        Assert(false);
+        return 0;
+    }
+
+    if (end > arena->committed)
+    {
+        Uint64 new_committed = Min(AlignUp(end, ARENA_COMMIT_BLOCK), arena->reserved);
+        if (!Os_Commit(arena->base + arena->committed, new_committed - arena->committed))
+        {
+            SDL_Log("Arena %s: failed to commit %llu bytes", arena->name, new_committed);
+            Assert(false);
+            return 0;
+        }
+        arena->committed = new_committed;
+    }
+
+    arena->used = end;
+    arena->used_high_water = Max(arena->used_high_water, end);
+    return arena->base + start;
+}
+
+static void *Arena_Push(Arena *arena, Uint64 size, Uint64 align)
+{
+    void *result = Arena_PushNoZero(arena, size, align);
+    if (result)
+        memset(result, 0, size);
+    return result;
+}
+
+#define Arena_PushStruct(Arena, Type) ((Type *)Arena_Push((Arena), sizeof(Type), ARENA_DEFAULT_ALIGN))
+#define Arena_PushArray(Arena, Type, Count) ((Type *)Arena_Push((Arena), sizeof(Type)*(Count), ARENA_DEFAULT_ALIGN))
+#define Arena_PushArrayNoZero(Arena, Type, Count) ((Type *)Arena_PushNoZero((Arena), sizeof(Type)*(Count), ARENA_DEFAULT_ALIGN))
+
+static void Arena_Reset(Arena *arena)
+{
+    arena->used = 0;
+}
+
+// Frees everything pushed after mark (arena->used read before pushing).
+static void Arena_PopTo(Arena *arena, Uint64 mark)
+{
+    Assert(mark <= arena->used);
+    arena->used = mark;
+}
+
+static void Arena_Report(Arena *arena)
+{
+    SDL_Log("Arena %-14s used high water %8.1f KB; committed %8.1f KB; reserved %8.1f MB",
+            arena->name,
+            arena->used_high_water / 1024.0,
+            arena->committed / 1024.0,
+            arena->reserved / (1024.0 * 1024.0));
+}
+
+//
+// Pool
+// Array that lives alone in its arena and grows in place, so
+// elements never move and pointers to them stay valid. Capacity
+// is limited only by the reserved size.
+//
+static void *Pool_Grow(Arena *arena, Uint64 elem_size, Uint32 *capacity, Uint32 min_capacity)
+{
+    if (*capacity < min_capacity)
+    {
+        Uint32 new_capacity = Max(64, *capacity * 2);
+        while (new_capacity < min_capacity) new_capacity *= 2;
+        new_capacity = (Uint32)Min(new_capacity, arena->reserved / elem_size);
+        if (new_capacity < min_capacity)
+            return 0;
+
+        Uint64 grow = (Uint64)(new_capacity - *capacity) * elem_size;
+        if (!Arena_Push(arena, grow, 1))
+            return 0;
+        *capacity = new_capacity;
+    }
+    return arena->base;
+}
@@ -0,0 +1,747 @@
+//
+// Bounding volume hierarchy
+// Static collision shapes (convex quads like sprite collision vertices)
+// in a binary tree of boxes, for ray, segment, point and box queries
+// (line of sight, range checks) without visiting every shape.
+// Built top down once: every node is split where the surface area
+// heuristic (half perimeter in 2D) estimated over BVH_BINS buckets
+// of shape centers is the lowest. Shapes aren't modified after the build;
+// moving objects still go through the SAT loop in Tick_AdvanceSimulation.
+//
+static Bvh_Box Bvh_BoxEmpty(void)
+{
+    return (Bvh_Box){{FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX}};
+}
+
+static Bvh_Box Bvh_BoxUnion(Bvh_Box a, Bvh_Box b)
+{
+    a.min.x = Min(a.min.x, b.min.x);
+    a.min.y = Min(a.min.y, b.min.y);
+    a.max.x = Max(a.max.x, b.max.x);
+    a.max.y = Max(a.max.y, b.max.y);
+    return a;
+}
+
+static Bvh_Box Bvh_BoxAddPoint(Bvh_Box a, V2 p)
+{
+    return Bvh_BoxUnion(a, (Bvh_Box){p, p});
+}
+
+static V2 Bvh_BoxCenter(Bvh_Box a)
+{
+    return V2_Scale(V2_Add(a.min, a.max), 0.5f);
+}
+
+// 2D counterpart of surface area; proportional to the chance
+// of a random line crossing the box. 0 for empty boxes.
+static float Bvh_BoxHalfPerimeter(Bvh_Box a)
+{
+    V2 dim = V2_Sub(a.max, a.min);
+    if (dim.x < 0.f || dim.y < 0.f)
+        return 0.f;
+    return dim.x + dim.y;
+}
+
+static bool Bvh_BoxOverlap(Bvh_Box a, Bvh_Box b)
+{
+    return (a.min.x <= b.max.x && b.min.x <= a.max.x &&
+            a.min.y <= b.max.y && b.min.y <= a.max.y);
+}
+
+static bool Bvh_BoxContains(Bvh_Box a, V2 p)
+{
+    return (p.x >= a.min.x && p.x <= a.max.x &&
+            p.y >= a.min.y && p.y <= a.max.y);
+}
+
+static Bvh_Shape Bvh_MakeShape(Col_Vertices verts, Col_Normals normals, Uint32 id)
+{
+    Bvh_Shape result = {0};
+    result.verts = verts;
+    result.normals = normals;
+    result.box = Bvh_BoxEmpty();
+    ForArray(i, verts.arr)
+        result.box = Bvh_BoxAddPoint(result.box, verts.arr[i]);
+    result.id = id;
+    return result;
+}
+
+//
+// Shape tests
+//
+// Cyrus-Beck: the ray is clipped by every edge's half plane.
+// Returns false when nothing is left of [0, max_t].
+static bool Bvh_RayShape(Bvh_Shape *shape, V2 origin, V2 dir, float max_t,
+                         float *out_t, V2 *out_normal)
+{
+    float t_enter = 0.f;
+    float t_exit = max_t;
+    V2 normal = {0};
+    ForArray(i, shape->verts.arr)
+    {
+        V2 n = shape->normals.arr[i];
+        float denom = V2_Inner(n, dir);
+        float num = V2_Inner(n, V2_Sub(shape->verts.arr[i], origin));
+        if (denom == 0.f)
+        {
+            if (num < 0.f)
+                return false; // parallel to the edge and outside of it
+            continue;
+        }
+
+        float t = num / denom;
+        if (denom < 0.f)
+        {
+            if (t > t_enter)
+            {
+                t_enter = t;
+                normal = n;
+            }
+        }
+        else
+        {
+            t_exit = Min(t_exit, t);
+        }
+
+        if (t_enter > t_exit)
+            return false;
+    }
+
+    *out_t = t_enter;
+    *out_normal = normal;
+    return true;
+}
+
+static bool Bvh_PointShape(Bvh_Shape *shape, V2 p)
+{
+    ForArray(i, shape->verts.arr)
+    {
+        if (V2_Inner(shape->normals.arr[i], V2_Sub(p, shape->verts.arr[i])) > 0.f)
+            return false;
+    }
+    return true;
+}
+
+// SAT; box axes are covered by the bounding box test.
+static bool Bvh_BoxShape(Bvh_Box box, Bvh_Shape *shape)
+{
+    if (!Bvh_BoxOverlap(box, shape->box))
+        return false;
+
+    Col_Vertices box_verts = {0};
+    box_verts.arr[0] = (V2){box.min.x, box.min.y};
+    box_verts.arr[1] = (V2){box.max.x, box.min.y};
+    box_verts.arr[2] = (V2){box.max.x, box.max.y};
+    box_verts.arr[3] = (V2){box.min.x, box.max.y};
+
+    Col_Projection proj_box = CollisionProjection(shape->normals, box_verts);
+    Col_Projection proj_shape = CollisionProjection(shape->normals, shape->verts);
+    ForArray(i, proj_box.arr)
+    {
+        if (RngF_MaxDistance(proj_box.arr[i], proj_shape.arr[i]) > 0.f)
+            return false;
+    }
+    return true;
+}
+
+//
+// Build
+//
+typedef struct
+{
+    Uint32 node;
+    Uint32 start, end; // shapes
+    Uint32 depth;
+} Bvh_BuildTask;
+
+typedef struct
+{
+    Bvh_Box box;
+    Uint32 count;
+} Bvh_Bin;
+
+static float Bvh_ShapeCenter(Bvh_Shape *shape, Uint32 axis)
+{
+    return Bvh_BoxCenter(shape->box).E[axis];
+}
+
+// Partial sort: shapes[nth] ends up where it would be if [start, end)
+// was sorted by center on axis, smaller ones before it.
+static void Bvh_SelectNth(Bvh_Shape *shapes, Uint32 start, Uint32 end, Uint32 nth, Uint32 axis)
+{
+    Sint64 first = start;
+    Sint64 last = (Sint64)end - 1;
+    while (first < last)
+    {
+        float pivot = Bvh_ShapeCenter(shapes + first + (last - first) / 2, axis);
+        Sint64 lo = first;
+        Sint64 hi = last;
+        while (lo <= hi)
+        {
+            while (Bvh_ShapeCenter(shapes + lo, axis) < pivot) lo += 1;
+            while (Bvh_ShapeCenter(shapes + hi, axis) > pivot) hi -= 1;
+            if (lo <= hi)
+            {
+                Bvh_Shape tmp = shapes[lo];
+                shapes[lo] = shapes[hi];
+                shapes[hi] = tmp;
+                lo += 1;
+                hi -= 1;
+            }
+        }
+
+        // [first, hi] <= pivot <= [lo, last]
+        if ((Sint64)nth <= hi)      last = hi;
+        else if ((Sint64)nth >= lo) first = lo;
+        else                        break;
+    }
+}
+
+// Returns the split index or 0 when the node should be a leaf.
+static Uint32 Bvh_SplitSAH(Bvh_Shape *shapes, Uint32 start, Uint32 end,
+                           Bvh_Box node_box, Bvh_Box center_box, Uint32 *out_axis)
+{
+    Uint32 count = end - start;
+    float best_cost = FLT_MAX;
+    Uint32 best_axis = 0;
+    Uint32 best_bin = 0;
+
+    ForU32(axis, 2)
+    {
+        float min = center_box.min.E[axis];
+        float extent = center_box.max.E[axis] - min;
+        if (!(extent > 0.f))
+            continue;
+
+        Bvh_Bin bins[BVH_BINS];
+        ForArray(i, bins)
+        {
+            bins[i].box = Bvh_BoxEmpty();
+            bins[i].count = 0;
+        }
+
+        float scale = (float)BVH_BINS / extent;
+        for (Uint32 i = start; i < end; i += 1)
+        {
+            Uint32 bin = (Uint32)((Bvh_ShapeCenter(shapes + i, axis) - min) * scale);
+            bin = Min(bin, BVH_BINS - 1);
+            bins[bin].box = Bvh_BoxUnion(bins[bin].box, shapes[i].box);
+            bins[bin].count += 1;
+        }
+
+        // right_cost[i]: cost of bins [i, BVH_BINS) on the right side
+        float right_cost[BVH_BINS];
+        {
+            Bvh_Box box = Bvh_BoxEmpty();
+            Uint32 right_count = 0;
+            for (Uint32 i = BVH_BINS; i > 0; i -= 1)
+            {
+                box = Bvh_BoxUnion(box, bins[i - 1].box);
+                right_count += bins[i - 1].count;
+                right_cost[i - 1] = Bvh_BoxHalfPerimeter(box) * (float)right_count;
+            }
+        }
+
+        Bvh_Box box = Bvh_BoxEmpty();
+        Uint32 left_count = 0;
+        ForU32(i, BVH_BINS - 1)
+        {
+            box = Bvh_BoxUnion(box, bins[i].box);
+            left_count += bins[i].count;
+            if (!left_count || left_count == count)
+                continue;
+
+            float cost = Bvh_BoxHalfPerimeter(box) * (float)left_count + right_cost[i + 1];
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = axis;
+                best_bin = i;
+            }
+        }
+    }
+
+    if (best_cost == FLT_MAX)
+        return 0; // all centers are in one spot
+
+    // traversing a node costs about as much as testing one shape
+    float node_area = Bvh_BoxHalfPerimeter(node_box);
+    float leaf_cost = node_area * (float)count;
+    if (node_area + best_cost >= leaf_cost && count <= BVH_MAX_LEAF_SIZE)
+        return 0;
+
+    // partition with the same bin math as above
+    float min = center_box.min.E[best_axis];
+    float scale = (float)BVH_BINS / (center_box.max.E[best_axis] - min);
+    Uint32 mid = start;
+    for (Uint32 i = start; i < end; i += 1)
+    {
+        Uint32 bin = (Uint32)((Bvh_ShapeCenter(shapes + i, best_axis) - min) * scale);
+        if (Min(bin, BVH_BINS - 1) <= best_bin)
+        {
+            Bvh_Shape tmp = shapes[mid];
+            shapes[mid] = shapes[i];
+            shapes[i] = tmp;
+            mid += 1;
+        }
+    }
+
+    *out_axis = best_axis;
+    return (mid > start && mid < end ? mid : 0);
+}
+
+// Reorders shapes in place; the result points to them and to nodes
+// allocated from arena. Returns an empty BVH when arena is full.
+static Bvh Bvh_Build(Arena *arena, Bvh_Shape *shapes, Uint32 shape_count)
+{
+    Bvh result = {0};
+    if (!shape_count)
+        return result;
+
+    Uint32 max_nodes = shape_count * 2 - 1;
+    Bvh_Node *nodes = Arena_PushArrayNoZero(arena, Bvh_Node, max_nodes);
+    if (!nodes)
+        return result;
+
+    result.nodes = nodes;
+    result.node_count = 1;
+    result.shapes = shapes;
+    result.shape_count = shape_count;
+
+    // every task pops one and pushes up to two; stack never
+    // holds more than one pending sibling per level
+    Bvh_BuildTask stack[BVH_MAX_DEPTH + 2];
+    Uint32 stack_count = 0;
+    stack[stack_count++] = (Bvh_BuildTask){0, 0, shape_count, 1};
+
+    while (stack_count)
+    {
+        Bvh_BuildTask task = stack[--stack_count];
+        Bvh_Node *node = nodes + task.node;
+        result.depth = Max(result.depth, task.depth);
+
+        Bvh_Box box = Bvh_BoxEmpty();
+        Bvh_Box center_box = Bvh_BoxEmpty();
+        for (Uint32 i = task.start; i < task.end; i += 1)
+        {
+            box = Bvh_BoxUnion(box, shapes[i].box);
+            center_box = Bvh_BoxAddPoint(center_box, Bvh_BoxCenter(shapes[i].box));
+        }
+        node->box = box;
+        node->axis = 0;
+
+        Uint32 count = task.end - task.start;
+        Uint32 mid = 0;
+        Uint32 axis = 0;
+        if (count > BVH_LEAF_SIZE && task.depth < BVH_MAX_DEPTH)
+        {
+            // @info(mg) Past half of BVH_MAX_DEPTH nodes are split in half
+            //           so degenerate inputs can't run out of depth.
+            if (task.depth < BVH_MAX_DEPTH / 2)
+                mid = Bvh_SplitSAH(shapes, task.start, task.end, box, center_box, &axis);
+
+            if (!mid && (count > BVH_MAX_LEAF_SIZE || task.depth >= BVH_MAX_DEPTH / 2))
+            {
+                V2 extent = V2_Sub(center_box.max, center_box.min);
+                axis = (extent.y > extent.x ? 1 : 0);
+                mid = task.start + count / 2;
+                Bvh_SelectNth(shapes, task.start, task.end, mid, axis);
+            }
+        }
+
+        if (!mid)
+        {
+            Assert(count <= 0xffff); // BVH_MAX_DEPTH is too small for this many shapes
+            node->first = task.start;
+            node->count = (Uint16)count;
+            continue;
+        }
+
+        Uint32 left = result.node_count;
+        result.node_count += 2;
+        Assert(result.node_count <= max_nodes);
+        node->first = left;
+        node->count = 0;
+        node->axis = (Uint16)axis;
+
+        Assert(stack_count + 2 <= ArrayCount(stack));
+        stack[stack_count++] = (Bvh_BuildTask){left + 1, mid, task.end, task.depth + 1};
+        stack[stack_count++] = (Bvh_BuildTask){left, task.start, mid, task.depth + 1};
+    }
+    return result;
+}
+
+//
+// Queries
+//
+#define BVH_STACK_SIZE (BVH_MAX_DEPTH + 2)
+
+// Zero components are replaced so slab math doesn't produce NaNs.
+static V2 Bvh_InvDir(V2 dir)
+{
+    V2 result;
+    result.x = 1.f / (dir.x != 0.f ? dir.x : 1e-30f);
+    result.y = 1.f / (dir.y != 0.f ? dir.y : 1e-30f);
+    return result;
+}
+
+// Returns distance at which the ray enters the box or FLT_MAX
+// when it misses it in [0, max_t].
+static float Bvh_RayBox(Bvh_Box box, V2 origin, V2 inv_dir, float max_t)
+{
+    float tx0 = (box.min.x - origin.x) * inv_dir.x;
+    float tx1 = (box.max.x - origin.x) * inv_dir.x;
+    float ty0 = (box.min.y - origin.y) * inv_dir.y;
+    float ty1 = (box.max.y - origin.y) * inv_dir.y;
+    float t_enter = Max(Max(Min(tx0, tx1), Min(ty0, ty1)), 0.f);
+    float t_exit = Min(Min(Max(tx0, tx1), Max(ty0, ty1)), max_t);
+    return (t_enter <= t_exit ? t_enter : FLT_MAX);
+}
+
+// Closest hit; shapes the origin is inside of are hit at t = 0.
+static Bvh_RayHit Bvh_Raycast(Bvh *bvh, Bvh_Ray ray)
+{
+    Bvh_RayHit result = {0};
+    if (!bvh->node_count)
+        return result;
+
+    V2 inv_dir = Bvh_InvDir(ray.dir);
+    float best_t = ray.max_t;
+    Uint32 stack[BVH_STACK_SIZE];
+    Uint32 stack_count = 0;
+    stack[stack_count++] = 0;
+
+    while (stack_count)
+    {
+        Bvh_Node *node = bvh->nodes + stack[--stack_count];
+        if (Bvh_RayBox(node->box, ray.origin, inv_dir, best_t) == FLT_MAX)
+            continue;
+
+        if (node->count)
+        {
+            ForU32(i, node->count)
+            {
+                Bvh_Shape *shape = bvh->shapes + node->first + i;
+                float t;
+                V2 normal;
+                if (Bvh_RayShape(shape, ray.origin, ray.dir, best_t, &t, &normal) &&
+                    (!result.hit || t < best_t))
+                {
+                    best_t = t;
+                    result.hit = true;
+                    result.t = t;
+                    result.normal = normal;
+                    result.id = shape->id;
+                }
+            }
+        }
+        else
+        {
+            // near child is popped first
+            Uint32 near_first = (ray.dir.E[node->axis] < 0.f ? 1 : 0);
+            stack[stack_count++] = node->first + (near_first ^ 1);
+            stack[stack_count++] = node->first + near_first;
+        }
+    }
+
+    if (result.hit)
+        result.p = V2_Add(ray.origin, V2_Scale(ray.dir, result.t));
+    return result;
+}
+
+// Any hit; for line of sight. Touching a shape counts as blocked.
+static bool Bvh_SegmentBlocked(Bvh *bvh, V2 from, V2 to)
+{
+    if (!bvh->node_count)
+        return false;
+
+    V2 dir = V2_Sub(to, from);
+    V2 inv_dir = Bvh_InvDir(dir);
+    Uint32 stack[BVH_STACK_SIZE];
+    Uint32 stack_count = 0;
+    stack[stack_count++] = 0;
+
+    while (stack_count)
+    {
+        Bvh_Node *node = bvh->nodes + stack[--stack_count];
+        if (Bvh_RayBox(node->box, from, inv_dir, 1.f) == FLT_MAX)
+            continue;
+
+        if (node->count)
+        {
+            ForU32(i, node->count)
+            {
+                float t;
+                V2 normal;
+                if (Bvh_RayShape(bvh->shapes + node->first + i, from, dir, 1.f, &t, &normal))
+                    return true;
+            }
+        }
+        else
+        {
+            stack[stack_count++] = node->first + 1;
+            stack[stack_count++] = node->first;
+        }
+    }
+    return false;
+}
+
+// Writes ids of shapes that contain p (up to max_ids of them);
+// returns how many there are.
+static Uint32 Bvh_QueryPoint(Bvh *bvh, V2 p, Uint32 *ids, Uint32 max_ids)
+{
+    Uint32 result = 0;
+    if (!bvh->node_count)
+        return result;
+
+    Uint32 stack[BVH_STACK_SIZE];
+    Uint32 stack_count = 0;
+    stack[stack_count++] = 0;
+
+    while (stack_count)
+    {
+        Bvh_Node *node = bvh->nodes + stack[--stack_count];
+        if (!Bvh_BoxContains(node->box, p))
+            continue;
+
+        if (node->count)
+        {
+            ForU32(i, node->count)
+            {
+                Bvh_Shape *shape = bvh->shapes + node->first + i;
+                if (Bvh_BoxContains(shape->box, p) && Bvh_PointShape(shape, p))
+                {
+                    if (result < max_ids)
+                        ids[result] = shape->id;
+                    result += 1;
+                }
+            }
+        }
+        else
+        {
+            stack[stack_count++] = node->first + 1;
+            stack[stack_count++] = node->first;
+        }
+    }
+    return result;
+}
+
+// Writes ids of shapes that overlap box (up to max_ids of them);
+// returns how many there are.
+static Uint32 Bvh_QueryBox(Bvh *bvh, Bvh_Box box, Uint32 *ids, Uint32 max_ids)
+{
+    Uint32 result = 0;
+    if (!bvh->node_count)
+        return result;
+
+    Uint32 stack[BVH_STACK_SIZE];
+    Uint32 stack_count = 0;
+    stack[stack_count++] = 0;
+
+    while (stack_count)
+    {
+        Bvh_Node *node = bvh->nodes + stack[--stack_count];
+        if (!Bvh_BoxOverlap(node->box, box))
+            continue;
+
+        if (node->count)
+        {
+            ForU32(i, node->count)
+            {
+                Bvh_Shape *shape = bvh->shapes + node->first + i;
+                if (Bvh_BoxShape(box, shape))
+                {
+                    if (result < max_ids)
+                        ids[result] = shape->id;
+                    result += 1;
+                }
+            }
+        }
+        else
+        {
+            stack[stack_count++] = node->first + 1;
+            stack[stack_count++] = node->first;
+        }
+    }
+    return result;
+}
+
+// Writes indices into bvh->shapes of shapes whose bounds overlap box
+// (up to max_count of them); returns how many there are. For callers
+// that need shape geometry, not only ids.
+static Uint32 Bvh_QueryBoxShapes(Bvh *bvh, Bvh_Box box, Uint32 *indices, Uint32 max_count)
+{
+    Uint32 result = 0;
+    if (!bvh->node_count)
+        return result;
+
+    Uint32 stack[BVH_STACK_SIZE];
+    Uint32 stack_count = 0;
+    stack[stack_count++] = 0;
+
+    while (stack_count)
+    {
+        Bvh_Node *node = bvh->nodes + stack[--stack_count];
+        if (!Bvh_BoxOverlap(node->box, box))
+            continue;
+
+        if (node->count)
+        {
+            ForU32(i, node->count)
+            {
+                if (!Bvh_BoxOverlap(bvh->shapes[node->first + i].box, box))
+                    continue;
+                if (result < max_count)
+                    indices[result] = node->first + i;
+                result += 1;
+            }
+        }
+        else
+        {
+            stack[stack_count++] = node->first + 1;
+            stack[stack_count++] = node->first;
+        }
+    }
+    return result;
+}
+
+//
+// Batched queries
+// @speed Rays are traversed in packets of 4: one walk down the tree tests
+//        a node's box against all of them at once (F32x4) and a node is
+//        skipped only when every ray misses it. Pays off for coherent rays
+//        like line of sight or vision rays from one player; for unrelated
+//        rays it visits the union of their paths.
+//
+static void Bvh_RaycastPacket(Bvh *bvh, Bvh_Ray *rays, Bvh_RayHit *hits, Uint32 lane_count, bool any_hit)
+{
+    Assert(lane_count && lane_count <= 4);
+    float ox[4], oy[4], ix[4], iy[4];
+    float best_t[4]; // < 0 for lanes that are done
+    ForU32(lane, 4)
+    {
+        Bvh_Ray *ray = rays + Min(lane, lane_count - 1);
+        V2 inv_dir = Bvh_InvDir(ray->dir);
+        ox[lane] = ray->origin.x;
+        oy[lane] = ray->origin.y;
+        ix[lane] = inv_dir.x;
+        iy[lane] = inv_dir.y;
+        best_t[lane] = (lane < lane_count ? ray->max_t : -1.f);
+        if (lane < lane_count)
+            SDL_zerop(hits + lane);
+    }
+    if (!bvh->node_count)
+        return;
+
+    F32x4 origin_x = F32x4_Load(ox);
+    F32x4 origin_y = F32x4_Load(oy);
+    F32x4 inv_x = F32x4_Load(ix);
+    F32x4 inv_y = F32x4_Load(iy);
+    F32x4 zero = F32x4_Set1(0.f);
+
+    Uint32 stack[BVH_STACK_SIZE];
+    Uint32 stack_count = 0;
+    stack[stack_count++] = 0;
+
+    while (stack_count)
+    {
+        Bvh_Node *node = bvh->nodes + stack[--stack_count];
+
+        F32x4 tx0 = F32x4_Mul(F32x4_Sub(F32x4_Set1(node->box.min.x), origin_x), inv_x);
+        F32x4 tx1 = F32x4_Mul(F32x4_Sub(F32x4_Set1(node->box.max.x), origin_x), inv_x);
+        F32x4 ty0 = F32x4_Mul(F32x4_Sub(F32x4_Set1(node->box.min.y), origin_y), inv_y);
+        F32x4 ty1 = F32x4_Mul(F32x4_Sub(F32x4_Set1(node->box.max.y), origin_y), inv_y);
+        F32x4 t_enter = F32x4_Max(F32x4_Max(F32x4_Min(tx0, tx1), F32x4_Min(ty0, ty1)), zero);
+        F32x4 t_exit = F32x4_Min(F32x4_Max(tx0, tx1), F32x4_Max(ty0, ty1));
+
+        float enter[4], exit[4];
+        F32x4_Store(enter, t_enter);
+        F32x4_Store(exit, t_exit);
+
+        Uint32 mask = 0;
+        ForU32(lane, 4)
+        {
+            if (enter[lane] <= exit[lane] && enter[lane] <= best_t[lane])
+                mask |= 1u << lane;
+        }
+        if (!mask)
+            continue;
+
+        if (node->count)
+        {
+            ForU32(lane, lane_count)
+            {
+                if (!(mask & (1u << lane))) continue;
+
+                Bvh_Ray *ray = rays + lane;
+                Bvh_RayHit *hit = hits + lane;
+                ForU32(i, node->count)
+                {
+                    Bvh_Shape *shape = bvh->shapes + node->first + i;
+                    float t;
+                    V2 normal;
+                    if (Bvh_RayShape(shape, ray->origin, ray->dir, best_t[lane], &t, &normal) &&
+                        (!hit->hit || t < best_t[lane]))
+                    {
+                        best_t[lane] = t;
+                        hit->hit = true;
+                        hit->t = t;
+                        hit->normal = normal;
+                        hit->id = shape->id;
+                        if (any_hit)
+                        {
+                            best_t[lane] = -1.f;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if (any_hit && best_t[0] < 0.f && best_t[1] < 0.f && best_t[2] < 0.f && best_t[3] < 0.f)
+                break;
+        }
+        else
+        {
+            // order by the first ray that reached this node
+            Uint32 lane = 0;
+            while (!(mask & (1u << lane))) lane += 1;
+            Uint32 near_first = (rays[Min(lane, lane_count - 1)].dir.E[node->axis] < 0.f ? 1 : 0);
+            stack[stack_count++] = node->first + (near_first ^ 1);
+            stack[stack_count++] = node->first + near_first;
+        }
+    }
+
+    ForU32(lane, lane_count)
+    {
+        if (hits[lane].hit)
+            hits[lane].p = V2_Add(rays[lane].origin, V2_Scale(rays[lane].dir, hits[lane].t));
+    }
+}
+
+// Same results as Bvh_Raycast for every ray.
+static void Bvh_RaycastBatch(Bvh *bvh, Bvh_Ray *rays, Bvh_RayHit *hits, Uint32 count)
+{
+    for (Uint32 i = 0; i < count; i += 4)
+        Bvh_RaycastPacket(bvh, rays + i, hits + i, Min(count - i, 4), false);
+}
+
+// Same results as Bvh_SegmentBlocked for every segment.
+static void Bvh_SegmentBatch(Bvh *bvh, V2 *from, V2 *to, bool *blocked, Uint32 count)
+{
+    for (Uint32 i = 0; i < count; i += 4)
+    {
+        Bvh_Ray rays[4];
+        Bvh_RayHit hits[4];
+        Uint32 lane_count = Min(count - i, 4);
+        ForU32(lane, lane_count)
+        {
+            rays[lane].origin = from[i + lane];
+            rays[lane].dir = V2_Sub(to[i + lane], from[i + lane]);
+            rays[lane].max_t = 1.f;
+        }
+
+        Bvh_RaycastPacket(bvh, rays, hits, lane_count, true);
+        ForU32(lane, lane_count)
+            blocked[i + lane] = hits[lane].hit;
+    }
+}
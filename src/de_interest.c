@@ -0,0 +1,217 @@
+//
+// Interest management
+// Server sends each user only the network objects that are close
+// to that user's player. Objects become relevant inside
+// INTEREST_ENTER_RADIUS and stop being relevant only after leaving
+// INTEREST_EXIT_RADIUS, so they don't flap in and out on the border.
+// With -fog objects also have to be inside of the player's visibility
+// polygon (see de_visibility.c), so clients don't get what their
+// player can't see.
+//
+static Uint32 Interest_Bucket(Interest_Grid *grid, Sint32 cell_x, Sint32 cell_y)
+{
+    Uint32 hash = ((Uint32)cell_x * 0x8da6b343u) ^ ((Uint32)cell_y * 0xd8163841u);
+    return hash & (grid->bucket_count - 1);
+}
+
+static Sint32 Interest_Cell(float value)
+{
+    return (Sint32)FloorF(value * (1.f / INTEREST_CELL_SIZE));
+}
+
+static void Interest_BuildGrid(AppState *app)
+{
+    Interest_Grid *grid = &app->net.interest_grid;
+
+    Uint32 slot_count = app->network_slot_count;
+
+    // keep ~2 buckets per object
+    Uint32 bucket_count = 64;
+    while (bucket_count < slot_count * 2) bucket_count *= 2;
+
+    grid->bucket_count = bucket_count;
+    grid->bucket_start = Arena_PushArray(&app->frame_arena, Uint32, bucket_count + 1);
+    grid->slots = Arena_PushArrayNoZero(&app->frame_arena, Uint32, slot_count);
+    if (!grid->bucket_start || !grid->slots)
+    {
+        grid->bucket_count = 0;
+        return;
+    }
+
+    // counting sort of network slots by bucket
+    ForU32(slot, slot_count)
+    {
+        Object *obj = Object_Network(app, slot);
+        if (Object_IsZero(app, obj) || !obj->flags) continue;
+        Uint32 bucket = Interest_Bucket(grid, Interest_Cell(obj->p.x), Interest_Cell(obj->p.y));
+        grid->bucket_start[bucket + 1] += 1;
+    }
+
+    ForU32(bucket, grid->bucket_count)
+        grid->bucket_start[bucket + 1] += grid->bucket_start[bucket];
+
+    ForU32(slot, slot_count)
+    {
+        Object *obj = Object_Network(app, slot);
+        if (Object_IsZero(app, obj) || !obj->flags) continue;
+        Uint32 bucket = Interest_Bucket(grid, Interest_Cell(obj->p.x), Interest_Cell(obj->p.y));
+        // bucket_start[bucket] is used as write cursor; shifted back below
+        grid->slots[grid->bucket_start[bucket]] = slot;
+        grid->bucket_start[bucket] += 1;
+    }
+
+    for (Uint32 bucket = grid->bucket_count; bucket > 0; bucket -= 1)
+        grid->bucket_start[bucket] = grid->bucket_start[bucket - 1];
+    grid->bucket_start[0] = 0;
+}
+
+static bool Interest_IsRelevant(Net_User *user, Uint32 network_slot)
+{
+    Uint32 word = network_slot / 64;
+    if (word >= user->interest_word_count)
+        return false;
+    return (user->interest_bits[word] >> (network_slot % 64)) & 1;
+}
+
+static void Interest_SetRelevant(Net_User *user, Uint32 network_slot)
+{
+    Uint32 word = network_slot / 64;
+    Assert(word < user->interest_word_count);
+    Uint64 bit = 1llu << (network_slot % 64);
+    if (!(user->interest_bits[word] & bit))
+    {
+        user->interest_bits[word] |= bit;
+        user->interest_count += 1;
+    }
+}
+
+// Object's center or a corner of its collision shape is visible.
+static bool Interest_IsVisible(AppState *app, Visibility_Polygon *visibility, Object *obj)
+{
+    if (Visibility_Contains(visibility, obj->p))
+        return true;
+
+    Col_Vertices verts = Sprite_Get(app, obj->sprite_id)->collision_vertices;
+    ForArray(i, verts.arr)
+    {
+        if (Visibility_Contains(visibility, V2_Add(verts.arr[i], obj->p)))
+            return true;
+    }
+    return false;
+}
+
+static void Interest_UpdateUser(AppState *app, Net_User *user)
+{
+    Interest_Grid *grid = &app->net.interest_grid;
+
+    // words past interest_word_count are still zero from Net_AddUser
+    Uint32 word_count = (app->network_slot_count + 63) / 64;
+    Assert(word_count <= ArrayCount(user->interest_bits));
+    user->interest_word_count = Max(user->interest_word_count, word_count);
+
+    V2 center = Object_Network(app, user->network_slot)->p;
+    Visibility_Polygon *visibility = 0;
+    if (app->net.fog && app->map.bvh.node_count)
+    {
+        Uint64 start_ns = SDL_GetTicksNS();
+        if (Visibility_Update(app, &user->visibility, center, VISIBILITY_RANGE))
+        {
+            app->net.visibility_computed += 1;
+            app->net.visibility_ns += SDL_GetTicksNS() - start_ns;
+        }
+        else
+        {
+            app->net.visibility_reused += 1;
+        }
+        visibility = &user->visibility;
+    }
+
+    float exit_radius_sq = INTEREST_EXIT_RADIUS * INTEREST_EXIT_RADIUS;
+    float enter_radius_sq = INTEREST_ENTER_RADIUS * INTEREST_ENTER_RADIUS;
+
+    // drop objects that left exit radius (or disappeared)
+    user->interest_count = 0;
+    ForU32(word, user->interest_word_count)
+    {
+        Uint64 bits = user->interest_bits[word];
+        while (bits)
+        {
+            Uint32 bit = LowestBitIndexU64(bits);
+            bits &= bits - 1;
+
+            Uint32 slot = word * 64 + bit;
+            Object *obj = Object_Network(app, slot);
+            bool keep = (!Object_IsZero(app, obj) && obj->flags &&
+                         V2_LengthSq(V2_Sub(obj->p, center)) <= exit_radius_sq &&
+                         (!visibility || Interest_IsVisible(app, visibility, obj)));
+            if (keep)
+                user->interest_count += 1;
+            else
+                user->interest_bits[word] &= ~(1llu << bit);
+        }
+    }
+
+    // user's own player is always relevant
+    if (user->network_slot < app->network_slot_count)
+        Interest_SetRelevant(user, user->network_slot);
+
+    if (!grid->bucket_count)
+        return;
+
+    // add objects that entered enter radius
+    Sint32 min_x = Interest_Cell(center.x - INTEREST_ENTER_RADIUS);
+    Sint32 max_x = Interest_Cell(center.x + INTEREST_ENTER_RADIUS);
+    Sint32 min_y = Interest_Cell(center.y - INTEREST_ENTER_RADIUS);
+    Sint32 max_y = Interest_Cell(center.y + INTEREST_ENTER_RADIUS);
+    for (Sint32 cell_y = min_y; cell_y <= max_y; cell_y += 1)
+    {
+        for (Sint32 cell_x = min_x; cell_x <= max_x; cell_x += 1)
+        {
+            // buckets are shared by multiple cells; distance check filters false positives
+            Uint32 bucket = Interest_Bucket(grid, cell_x, cell_y);
+            for (Uint32 i = grid->bucket_start[bucket]; i < grid->bucket_start[bucket + 1]; i += 1)
+            {
+                Uint32 slot = grid->slots[i];
+                Object *obj = Object_Network(app, slot);
+                if (V2_LengthSq(V2_Sub(obj->p, center)) <= enter_radius_sq &&
+                    (!visibility || Interest_IsVisible(app, visibility, obj)))
+                {
+                    Interest_SetRelevant(user, slot);
+                }
+            }
+        }
+    }
+}
+
+static void Interest_Update(AppState *app)
+{
+    Interest_BuildGrid(app);
+    ForU32(user_index, app->net.user_count)
+    {
+        Interest_UpdateUser(app, app->net.users + user_index);
+    }
+}
+
+static void Interest_ReportStats(AppState *app)
+{
+    Uint64 total = app->net.interest_sent_bytes + app->net.interest_saved_bytes;
+    float saved_percent = (total ? 100.f * (float)app->net.interest_saved_bytes / (float)total : 0.f);
+
+    LogInfo(LogCat_Net, "SERVER: snapshot objects %llu B/s sent, %llu B/s saved by interest management (%.1f%%); %d users",
+                        app->net.interest_sent_bytes, app->net.interest_saved_bytes,
+                        saved_percent, (int)app->net.user_count);
+
+    app->net.interest_sent_bytes = 0;
+    app->net.interest_saved_bytes = 0;
+
+    if (app->net.fog)
+    {
+        LogInfo(LogCat_Net, "SERVER: visibility %llu polygons computed (%.1f us avg), %llu reused from cache",
+                            app->net.visibility_computed,
+                            (double)app->net.visibility_ns / (double)Max(app->net.visibility_computed, 1) / 1000.0,
+                            app->net.visibility_reused);
+        app->net.visibility_computed = 0;
+        app->net.visibility_reused = 0;
+        app->net.visibility_ns = 0;
+    }
+}
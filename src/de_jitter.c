@@ -0,0 +1,261 @@
+//
+// Client side jitter buffer
+// Server snapshots are stored by their tick_id and played back
+// with a small delay that adapts to measured packet jitter.
+//
+static double Jitter_LocalTick(AppState *app)
+{
+    return (double)app->frame_time * ((double)app->tick_rate / 1000.0);
+}
+
+static Tick_NetworkObjState *Jitter_Get(Jitter_Buffer *jitter, Uint64 tick_id)
+{
+    Tick_NetworkObjState *state = jitter->states + (tick_id % ArrayCount(jitter->states));
+    if (state->tick_id != tick_id || !tick_id)
+        return 0;
+    return state;
+}
+
+static void Jitter_MeasureError(AppState *app, Tick_NetworkObjState *state)
+{
+    Jitter_Buffer *jitter = &app->jitter;
+    Uint64 index = state->tick_id % ArrayCount(jitter->error_samples);
+    if (jitter->error_samples[index].tick_id != state->tick_id)
+        return; // this tick wasn't displayed yet
+
+    float error = 0.f;
+    Uint32 slot_count = Min(state->obj_count, jitter->error_samples[index].count);
+    ForU32(slot, slot_count)
+    {
+        if (!state->objs[slot].flags) continue;
+        V2 displayed = jitter->error_samples[index].p[slot];
+        error = Max(error, V2_Length(V2_Sub(displayed, state->objs[slot].p)));
+    }
+
+    jitter->max_position_error = Max(jitter->max_position_error, error);
+    jitter->sum_position_error += error;
+    jitter->position_error_count += 1;
+
+    if (error > JITTER_CONVERGED_ERROR)
+    {
+        if (!jitter->diverged_at_ms)
+            jitter->diverged_at_ms = app->frame_time;
+    }
+    else if (jitter->diverged_at_ms)
+    {
+        jitter->last_convergence_ms = app->frame_time - jitter->diverged_at_ms;
+        jitter->diverged_at_ms = 0;
+        LogInfo(LogCat_Net, "CLIENT: converged after %llu ms", jitter->last_convergence_ms);
+    }
+}
+
+// Returns state that should be filled by the decoder.
+// Returns 0 if that tick is already in the buffer (or is too old).
+static Tick_NetworkObjState *Jitter_InsertBegin(Jitter_Buffer *jitter, Uint64 tick_id)
+{
+    Tick_NetworkObjState *state = jitter->states + (tick_id % ArrayCount(jitter->states));
+    if (!tick_id || state->tick_id >= tick_id)
+        return 0; // duplicate or older than what we already have
+
+    state->tick_id = 0; // invalid until Jitter_InsertEnd
+    Object_NetworkStateResize(state, 0);
+    return state;
+}
+
+static void Jitter_InsertEnd(AppState *app, Tick_NetworkObjState *state, Uint64 tick_id)
+{
+    Jitter_Buffer *jitter = &app->jitter;
+    state->tick_id = tick_id;
+    jitter->latest_tick_id = Max(jitter->latest_tick_id, tick_id);
+    jitter->received_snapshots += 1;
+    Jitter_MeasureError(app, state);
+}
+
+// Called once per received packet with the newest tick_id it carried.
+static void Jitter_OnPacket(AppState *app, Uint64 server_tick_id)
+{
+    Jitter_Buffer *jitter = &app->jitter;
+    double sample = (double)server_tick_id - Jitter_LocalTick(app);
+
+    if (!jitter->clock_initialized)
+    {
+        jitter->clock_initialized = true;
+        jitter->clock_offset = sample;
+        jitter->jitter = 0.f;
+        jitter->delay = JITTER_MIN_DELAY;
+        jitter->target_delay = JITTER_MIN_DELAY;
+        return;
+    }
+
+    float deviation = (float)(sample - jitter->clock_offset);
+
+    // @info(mg) Jitter estimator from RFC 3550 (RTP), measured in ticks.
+    jitter->jitter += (AbsF(deviation) - jitter->jitter) * (1.f / 16.f);
+
+    if (deviation > 0.f)
+    {
+        // Packet arrived earlier than we expected - that's the best
+        // lower bound for network latency we have. Adopt it immediately.
+        jitter->clock_offset = sample;
+    }
+    else
+    {
+        // Packet was late. Slowly drift towards it so we can follow
+        // clock drift between client and server.
+        jitter->clock_offset += deviation * (1.f / 64.f);
+    }
+
+    float target = JITTER_MIN_DELAY + 2.5f * jitter->jitter;
+    jitter->target_delay = Clamp(JITTER_MIN_DELAY, JITTER_MAX_DELAY, target);
+}
+
+// Position of network slot at fractional tick. Interpolated between
+// from and to; extrapolated from `from` when `to` is missing.
+static V2 Jitter_Position(Tick_NetworkObjState *from, Tick_NetworkObjState *to, double tick, Uint32 slot)
+{
+    Object *src = from->objs + slot;
+    if (to)
+    {
+        if (slot >= to->obj_count || !to->objs[slot].flags)
+            return src->p;
+
+        Object *dst = to->objs + slot;
+        float t = (float)((tick - (double)from->tick_id) /
+                          (double)(to->tick_id - from->tick_id));
+        t = Clamp(0.f, 1.f, t);
+        return (V2){LerpF(src->p.x, dst->p.x, t), LerpF(src->p.y, dst->p.y, t)};
+    }
+
+    // velocity per tick from the last two positions known for that snapshot
+    float t = (float)(tick - (double)from->tick_id);
+    t = Clamp(0.f, JITTER_MAX_EXTRAPOLATION, t);
+    V2 velocity = V2_Sub(src->p, src->prev_p);
+    return V2_Add(src->p, V2_Scale(velocity, t));
+}
+
+// Runs every frame (not every tick) on the client so interpolation is smooth.
+static void Jitter_Playback(AppState *app)
+{
+    Jitter_Buffer *jitter = &app->jitter;
+    if (!jitter->clock_initialized)
+        return;
+
+    // move delay towards target; grow fast, shrink slowly
+    // so playback speed changes stay unnoticeable
+    {
+        float diff = jitter->target_delay - jitter->delay;
+        float max_change = (diff > 0.f ? 4.f : 0.5f) * app->dt;
+        jitter->delay += Clamp(-max_change, max_change, diff);
+    }
+
+    double playback_tick = Jitter_LocalTick(app) + jitter->clock_offset - jitter->delay;
+    playback_tick = Max(playback_tick, jitter->playback_tick); // never go back in time
+    jitter->playback_tick = playback_tick;
+
+    // find closest snapshots around playback_tick
+    Tick_NetworkObjState *from = 0;
+    Tick_NetworkObjState *to = 0;
+    {
+        Uint64 base = (Uint64)playback_tick;
+        ForU32(i, ArrayCount(jitter->states))
+        {
+            if (i > base) break;
+            from = Jitter_Get(jitter, base - i);
+            if (from) break;
+        }
+
+        if (from)
+        {
+            for (Uint64 tick_id = from->tick_id + 1; tick_id <= jitter->latest_tick_id; tick_id += 1)
+            {
+                if (tick_id >= from->tick_id + ArrayCount(jitter->states)) break;
+                to = Jitter_Get(jitter, tick_id);
+                if (to) break;
+            }
+        }
+    }
+
+    if (!from)
+    {
+        jitter->starved_frames += 1;
+        return;
+    }
+
+    if (!to)
+        jitter->extrapolated_frames += 1;
+
+    ForU32(slot, from->obj_count)
+    {
+        Object *src = from->objs + slot;
+        if (!src->flags) continue;
+
+        if (!Object_ReserveNetworkSlot(app, slot))
+            break;
+
+        if (!app->network_handles[slot])
+        {
+            app->network_handles[slot] =
+                Object_HandleFromPointer(app, Object_Create(app, 0, 0));
+        }
+
+        Object *obj = Object_Network(app, slot);
+        Object_Assign(app, obj, src);
+        obj->p = Jitter_Position(from, to, playback_tick, slot);
+    }
+
+    // destroy objects that aren't in the snapshot anymore
+    ForU32(slot, app->network_slot_count)
+    {
+        if (!app->network_handles[slot]) continue;
+        if (slot >= from->obj_count || !from->objs[slot].flags)
+            Object_ReleaseNetworkSlot(app, slot);
+    }
+
+    // remember what would be displayed at integer ticks
+    // so it can be compared with real snapshots for those ticks
+    Uint64 sample_tick_id = (Uint64)playback_tick;
+    if (sample_tick_id > jitter->last_sampled_tick_id)
+    {
+        jitter->last_sampled_tick_id = sample_tick_id;
+        Uint64 index = sample_tick_id % ArrayCount(jitter->error_samples);
+        Jitter_ErrorSample *sample = jitter->error_samples + index;
+        sample->tick_id = sample_tick_id;
+
+        if (!sample->arena.base)
+            Arena_Init(&sample->arena, "jitter error sample", NET_MAX_NETWORK_OBJECTS * sizeof(*sample->p));
+        sample->p = Pool_Grow(&sample->arena, sizeof(*sample->p), &sample->capacity, from->obj_count);
+        Assert(sample->p);
+        sample->count = from->obj_count;
+
+        ForU32(slot, sample->count)
+            sample->p[slot] = Jitter_Position(from, to, (double)sample_tick_id, slot);
+
+        // snapshot for this tick might be already here
+        Tick_NetworkObjState *actual = Jitter_Get(jitter, sample_tick_id);
+        if (actual)
+            Jitter_MeasureError(app, actual);
+    }
+}
+
+static void Jitter_ReportStats(AppState *app)
+{
+    Jitter_Buffer *jitter = &app->jitter;
+    float avg_error = (jitter->position_error_count ?
+                       jitter->sum_position_error / (float)jitter->position_error_count :
+                       0.f);
+
+    LogInfo(LogCat_Net, "CLIENT: recv %llu B/s; delay %.2f ticks (target %.2f, jitter %.2f); "
+                        "pos error avg %.2f max %.2f; %s; extrapolated %llu, starved %llu frames; "
+                        "server frame %.2f ms",
+                        jitter->received_bytes,
+                        jitter->delay, jitter->target_delay, jitter->jitter,
+                        avg_error, jitter->max_position_error,
+                        jitter->diverged_at_ms ? "diverged" : "converged",
+                        jitter->extrapolated_frames, jitter->starved_frames,
+                        (double)app->net.server_work_us / 1000.0);
+
+    jitter->received_bytes = 0;
+    jitter->max_position_error = 0.f;
+    jitter->sum_position_error = 0.f;
+    jitter->position_error_count = 0;
+}
@@ -0,0 +1,263 @@
+//
+// Deterministic lockstep
+// With -lockstep the server doesn't send object state. After every tick
+// it records a frame: input applied to every player, players spawned right
+// before the tick and a hash of network objects after it. Clients simulate
+// the same ticks from these frames and compare the hashes, so bandwidth
+// depends on the player count instead of the world size.
+// Clients that join (or desync) start from a baseline: network objects
+// after the newest tick, taken from netobj_states.
+// @info(mg) Peers get bit identical results only when:
+//           - inputs are quantized before they're applied (Net_QuantizeUnit)
+//           - float math isn't contracted or reordered (-ffp-contract=off, no fast-math)
+//           - movers are moved in network slot order and collision response
+//             doesn't depend on collider order (see Tick_AdvanceSimulation)
+//           - colliders close to every player are resident (Map_Update)
+//
+static Lockstep_Frame *Lockstep_Get(AppState *app, Uint64 tick_id)
+{
+    Lockstep_Frame *frame = app->lockstep.frames + (tick_id % ArrayCount(app->lockstep.frames));
+    if (!tick_id || frame->tick_id != tick_id)
+        return 0;
+    return frame;
+}
+
+// Network objects only; static objects don't change and
+// their dense order differs between peers.
+static Uint32 Lockstep_StateHash(AppState *app, Uint64 tick_id)
+{
+    Uint64 hash = tick_id;
+    ForU32(slot, app->network_slot_count)
+    {
+        Object *obj = Object_Network(app, slot);
+        if (Object_IsZero(app, obj)) continue;
+
+        hash = HashU64(hash, &slot, sizeof(slot));
+        hash = HashU64(hash, &obj->flags, sizeof(obj->flags));
+        hash = HashU64(hash, &obj->p, sizeof(obj->p));
+        hash = HashU64(hash, &obj->dp, sizeof(obj->dp));
+        hash = HashU64(hash, &obj->sprite_id, sizeof(obj->sprite_id));
+        hash = HashU64(hash, &obj->sprite_clip, sizeof(obj->sprite_clip));
+        hash = HashU64(hash, &obj->sprite_clip_step, sizeof(obj->sprite_clip_step));
+        hash = HashU64(hash, &obj->sprite_clip_t, sizeof(obj->sprite_clip_t));
+    }
+    return (Uint32)(hash ^ (hash >> 32));
+}
+
+//
+// Server
+//
+static void Lockstep_RecordEntry(AppState *app, Lockstep_Frame *frame, Lockstep_Frame *prev,
+                                 Uint32 network_slot, V2 move_dir)
+{
+    Object *player = Object_Network(app, network_slot);
+    if (Object_IsZero(app, player))
+        return; // input wasn't applied to anything
+
+    if (frame->entry_count >= ArrayCount(frame->entries))
+    {
+        Assert(false); // Net_AddUser keeps user count under LOCKSTEP_MAX_PLAYERS
+        return;
+    }
+
+    Lockstep_Entry *entry = frame->entries + frame->entry_count;
+    frame->entry_count += 1;
+    entry->network_slot = network_slot;
+    entry->move_dir = move_dir;
+    entry->handle = app->network_handles[network_slot];
+    // prev_p is the position at the start of the tick (see Tick_AdvanceSimulation)
+    entry->spawn_p = player->prev_p;
+
+    // players that didn't exist during the previous tick were spawned
+    entry->spawned = true;
+    if (prev)
+    {
+        ForU32(i, prev->entry_count)
+        {
+            if (prev->entries[i].handle == entry->handle)
+            {
+                entry->spawned = false;
+                break;
+            }
+        }
+    }
+}
+
+// Called by the server after every tick with the local input it applied.
+static void Lockstep_RecordFrame(AppState *app, Tick_Input local_input)
+{
+    Lockstep_Frame *prev = Lockstep_Get(app, app->tick_id - 1);
+    Lockstep_Frame *frame = app->lockstep.frames + (app->tick_id % ArrayCount(app->lockstep.frames));
+    frame->tick_id = app->tick_id;
+    frame->entry_count = 0;
+
+    if (app->has_local_player)
+        Lockstep_RecordEntry(app, frame, prev, app->player_network_slot, local_input.move_dir);
+
+    ForU32(user_index, app->net.user_count)
+    {
+        Net_User *user = app->net.users + user_index;
+        Lockstep_RecordEntry(app, frame, prev, user->network_slot, user->last_applied_input.move_dir);
+    }
+
+    frame->hash = Lockstep_StateHash(app, app->tick_id);
+    app->lockstep.newest_tick_id = app->tick_id;
+}
+
+//
+// Client
+//
+static void Lockstep_AssignNetworkSlot(AppState *app, Uint32 network_slot, Object *obj)
+{
+    if (!Object_ReserveNetworkSlot(app, network_slot))
+        return;
+
+    Object_ReleaseNetworkSlot(app, network_slot);
+    if (!Object_IsZero(app, obj))
+        app->network_handles[network_slot] = Object_HandleFromPointer(app, obj);
+}
+
+// Baseline objects come from the wire and get simulated; their
+// sprite and clip are used as indices.
+static bool Lockstep_ValidObject(AppState *app, Object *obj)
+{
+    if (obj->sprite_id >= app->sprite_count)
+        return false;
+
+    Sprite *sprite = Sprite_Get(app, obj->sprite_id);
+    if (!sprite->clip_count)
+        return true;
+    return (obj->sprite_clip < sprite->clip_count &&
+            obj->sprite_clip_step < sprite->clips[obj->sprite_clip].frame_count);
+}
+
+// Replaces all network objects; Lockstep_BaselineObject adds them back.
+static void Lockstep_BeginBaseline(AppState *app)
+{
+    ForU32(slot, app->network_slot_count)
+    {
+        if (app->network_handles[slot])
+            Object_ReleaseNetworkSlot(app, slot);
+    }
+}
+
+static void Lockstep_BaselineObject(AppState *app, Uint32 network_slot, Object *src)
+{
+    Object *obj = Object_Create(app, 0, 0);
+    Object_Assign(app, obj, src);
+    Lockstep_AssignNetworkSlot(app, network_slot, obj);
+}
+
+static void Lockstep_EndBaseline(AppState *app, Uint64 tick_id)
+{
+    app->lockstep.sim_tick_id = tick_id;
+    app->lockstep.newest_tick_id = Max(app->lockstep.newest_tick_id, tick_id);
+    app->lockstep.baselines += 1;
+
+    // players can be anywhere; load their surroundings before the first tick
+    Map_Update(app, MAP_MAX_CHUNKS);
+    LogInfo(LogCat_Net, "CLIENT: lockstep baseline at tick %llu", tick_id);
+}
+
+// Returns 0 for frames that aren't needed (duplicates, already simulated
+// or too far ahead). Lockstep_InsertEnd makes the frame visible.
+static Lockstep_Frame *Lockstep_InsertBegin(AppState *app, Uint64 tick_id)
+{
+    Uint64 sim_tick_id = app->lockstep.sim_tick_id;
+    if (!sim_tick_id || tick_id <= sim_tick_id ||
+        tick_id > sim_tick_id + ArrayCount(app->lockstep.frames))
+        return 0;
+
+    Lockstep_Frame *frame = app->lockstep.frames + (tick_id % ArrayCount(app->lockstep.frames));
+    if (frame->tick_id == tick_id)
+        return 0;
+
+    frame->tick_id = 0;
+    frame->entry_count = 0;
+    return frame;
+}
+
+static void Lockstep_InsertEnd(AppState *app, Lockstep_Frame *frame, Uint64 tick_id)
+{
+    frame->tick_id = tick_id;
+    app->lockstep.newest_tick_id = Max(app->lockstep.newest_tick_id, tick_id);
+}
+
+// Makes network objects match players of the frame before it's simulated.
+static void Lockstep_ApplyPlayers(AppState *app, Lockstep_Frame *frame)
+{
+    // players that left
+    ForU32(slot, app->network_slot_count)
+    {
+        if (!app->network_handles[slot]) continue;
+
+        bool found = false;
+        ForU32(i, frame->entry_count)
+        {
+            if (frame->entries[i].network_slot == slot)
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            Object_ReleaseNetworkSlot(app, slot);
+    }
+
+    // players that joined
+    bool spawned = false;
+    ForU32(i, frame->entry_count)
+    {
+        Lockstep_Entry *entry = frame->entries + i;
+        if (!entry->spawned) continue;
+
+        Object *player = Object_CreatePlayer(app);
+        if (!Object_IsZero(app, player))
+            player->p = entry->spawn_p;
+        Lockstep_AssignNetworkSlot(app, entry->network_slot, player);
+        spawned = true;
+    }
+
+    // server streamed around new players before simulating this tick
+    if (spawned)
+        Map_Update(app, MAP_MAX_CHUNKS);
+}
+
+// Called by the client after simulating the frame.
+static void Lockstep_CheckFrame(AppState *app, Lockstep_Frame *frame)
+{
+    app->lockstep.sim_tick_id = frame->tick_id;
+    app->lockstep.ticks += 1;
+
+    Uint32 hash = Lockstep_StateHash(app, frame->tick_id);
+    if (hash != frame->hash)
+    {
+        LogError(LogCat_Net, "CLIENT: lockstep desync at tick %llu (hash %08x, server %08x); waiting for a baseline",
+                             frame->tick_id, hash, frame->hash);
+        app->lockstep.desyncs += 1;
+        app->lockstep.sim_tick_id = 0;
+    }
+}
+
+static void Lockstep_ReportStats(AppState *app)
+{
+    if (app->net.is_server)
+    {
+        LogInfo(LogCat_Net, "SERVER: lockstep sent %llu B/s to %d users; %llu baselines",
+                            app->lockstep.bytes, (int)app->net.user_count, app->lockstep.baselines);
+    }
+    else
+    {
+        Uint64 queued = (app->lockstep.sim_tick_id ?
+                         app->lockstep.newest_tick_id - app->lockstep.sim_tick_id :
+                         0);
+        LogInfo(LogCat_Net, "CLIENT: lockstep recv %llu B/s; simulated %llu ticks, %llu frames queued; "
+                            "%llu baselines, %llu desyncs",
+                            app->lockstep.bytes, app->lockstep.ticks, queued,
+                            app->lockstep.baselines, app->lockstep.desyncs);
+    }
+
+    app->lockstep.bytes = 0;
+    app->lockstep.ticks = 0;
+}
@@ -0,0 +1,552 @@
+//
+// Logging; see de_log.h
+// Record args are the values of format's conversions in order, each
+// stored with memcpy: '*' widths and precisions as int, integers as
+// Sint64/Uint64 (and formatted with "ll"), floats as double, pointers as
+// Uint64, strings as Uint16 length followed by bytes (not terminated).
+//
+static Log_State log_state =
+{
+    .levels = {Log_Info, Log_Info, Log_Info, Log_Info, Log_Info},
+};
+static_assert(LogCat_Count == 5); // update log_state.levels
+
+static const char *log_level_names[] = {"off", "error", "warn", "info", "verbose"};
+static const char *log_category_names[] = {"game", "net", "map", "sprite", "replay"};
+static_assert(ArrayCount(log_level_names) == Log_LevelCount);
+static_assert(ArrayCount(log_category_names) == LogCat_Count);
+
+static bool Log_Enabled(Log_Level level, Log_Category category)
+{
+    return level <= log_state.levels[category];
+}
+
+//
+// Format parsing
+// Shared by Log_Push (to know what to read from va_list)
+// and Log_Print (to know what to read from record args).
+//
+typedef enum
+{
+    LogLength_None,
+    LogLength_hh,
+    LogLength_h,
+    LogLength_l,
+    LogLength_ll,
+    LogLength_z,
+    LogLength_j,
+    LogLength_t,
+    LogLength_L,
+} Log_Length;
+
+typedef struct
+{
+    const char *end; // past the conversion character
+    const char *flags;
+    Uint32 flag_count;
+    int width; // -1 == none
+    int precision; // -1 == none
+    bool width_star;
+    bool precision_star;
+    Log_Length length;
+    char conversion; // 0 == not a supported conversion
+} Log_Spec;
+
+// at points past '%'
+static Log_Spec Log_ParseSpec(const char *at)
+{
+    Log_Spec spec = {0};
+    spec.width = -1;
+    spec.precision = -1;
+
+    spec.flags = at;
+    while (*at == '-' || *at == '+' || *at == ' ' || *at == '#' || *at == '0')
+        at += 1;
+    spec.flag_count = (Uint32)(at - spec.flags);
+
+    if (*at == '*')
+    {
+        spec.width_star = true;
+        at += 1;
+    }
+    else if (ByteIsDigit(*at))
+    {
+        spec.width = 0;
+        while (ByteIsDigit(*at))
+            spec.width = spec.width*10 + (*at++ - '0');
+    }
+
+    if (*at == '.')
+    {
+        at += 1;
+        spec.precision = 0;
+        if (*at == '*')
+        {
+            spec.precision_star = true;
+            at += 1;
+        }
+        else
+        {
+            while (ByteIsDigit(*at))
+                spec.precision = spec.precision*10 + (*at++ - '0');
+        }
+    }
+
+    switch (*at)
+    {
+        case 'h': at += 1; spec.length = LogLength_h; if (*at == 'h') { at += 1; spec.length = LogLength_hh; } break;
+        case 'l': at += 1; spec.length = LogLength_l; if (*at == 'l') { at += 1; spec.length = LogLength_ll; } break;
+        case 'z': at += 1; spec.length = LogLength_z; break;
+        case 'j': at += 1; spec.length = LogLength_j; break;
+        case 't': at += 1; spec.length = LogLength_t; break;
+        case 'L': at += 1; spec.length = LogLength_L; break;
+        default: break;
+    }
+
+    if (*at && SDL_strchr("diuoxXcsfFeEgGaAp%", *at))
+    {
+        spec.conversion = *at;
+        at += 1;
+    }
+    spec.end = at;
+    return spec;
+}
+
+//
+// Producers
+//
+static bool Log_Put(Log_Record *record, void *data, Uint64 size)
+{
+    if (record->arg_size + size > sizeof(record->args))
+        return false;
+    memcpy(record->args + record->arg_size, data, size);
+    record->arg_size += (Uint16)size;
+    return true;
+}
+
+// Copies values of fmt's conversions from args into the record;
+// stops at the first one that doesn't fit (Log_Print marks the message as cut).
+static void Log_Encode(Log_Record *record, const char *fmt, va_list args)
+{
+    record->fmt = fmt;
+    record->arg_size = 0;
+    for (const char *at = fmt; *at; )
+    {
+        if (*at++ != '%')
+            continue;
+
+        Log_Spec spec = Log_ParseSpec(at);
+        at = spec.end;
+        if (!spec.conversion || spec.conversion == '%')
+            continue;
+
+        int star_width = (spec.width_star ? va_arg(args, int) : 0);
+        int star_precision = (spec.precision_star ? va_arg(args, int) : -1);
+        bool ok = true;
+        if (spec.width_star)
+            ok &= Log_Put(record, &star_width, sizeof(star_width));
+        if (spec.precision_star)
+            ok &= Log_Put(record, &star_precision, sizeof(star_precision));
+
+        switch (spec.conversion)
+        {
+            case 'd': case 'i':
+            {
+                Sint64 value;
+                switch (spec.length)
+                {
+                    case LogLength_l:  value = va_arg(args, long); break;
+                    case LogLength_ll: value = va_arg(args, long long); break;
+                    case LogLength_z:  value = (Sint64)va_arg(args, size_t); break;
+                    case LogLength_j:  value = va_arg(args, intmax_t); break;
+                    case LogLength_t:  value = va_arg(args, ptrdiff_t); break;
+                    case LogLength_hh: value = (signed char)va_arg(args, int); break;
+                    case LogLength_h:  value = (short)va_arg(args, int); break;
+                    default:           value = va_arg(args, int); break;
+                }
+                ok &= Log_Put(record, &value, sizeof(value));
+            } break;
+
+            case 'u': case 'o': case 'x': case 'X':
+            {
+                Uint64 value;
+                switch (spec.length)
+                {
+                    case LogLength_l:  value = va_arg(args, unsigned long); break;
+                    case LogLength_ll: value = va_arg(args, unsigned long long); break;
+                    case LogLength_z:  value = va_arg(args, size_t); break;
+                    case LogLength_j:  value = va_arg(args, uintmax_t); break;
+                    case LogLength_t:  value = (Uint64)va_arg(args, ptrdiff_t); break;
+                    case LogLength_hh: value = (unsigned char)va_arg(args, unsigned int); break;
+                    case LogLength_h:  value = (unsigned short)va_arg(args, unsigned int); break;
+                    default:           value = va_arg(args, unsigned int); break;
+                }
+                ok &= Log_Put(record, &value, sizeof(value));
+            } break;
+
+            case 'c':
+            {
+                Sint64 value = va_arg(args, int);
+                ok &= Log_Put(record, &value, sizeof(value));
+            } break;
+
+            case 'p':
+            {
+                Uint64 value = (Uint64)(uintptr_t)va_arg(args, void *);
+                ok &= Log_Put(record, &value, sizeof(value));
+            } break;
+
+            case 's':
+            {
+                const char *str = va_arg(args, const char *);
+                if (!str) str = "(null)";
+                Uint64 max = sizeof(record->args) - Min(record->arg_size + sizeof(Uint16), sizeof(record->args));
+                if (spec.precision_star ? star_precision >= 0 : spec.precision >= 0)
+                    max = Min(max, (Uint64)(spec.precision_star ? star_precision : spec.precision));
+
+                Uint16 size = (Uint16)SDL_strnlen(str, max);
+                ok &= Log_Put(record, &size, sizeof(size));
+                ok &= Log_Put(record, (void *)str, size);
+            } break;
+
+            default: // floats
+            {
+                double value = (spec.length == LogLength_L ? (double)va_arg(args, long double) : va_arg(args, double));
+                ok &= Log_Put(record, &value, sizeof(value));
+            } break;
+        }
+
+        if (!ok)
+            break;
+    }
+}
+
+static void Log_Print(Log_Record *record);
+
+static void Log_Push(Log_Level level, Log_Category category,
+                     SDL_PRINTF_FORMAT_STRING const char *fmt, ...) SDL_PRINTF_VARARG_FUNC(3);
+static void Log_Push(Log_Level level, Log_Category category, const char *fmt, ...)
+{
+    Uint64 time_ns = SDL_GetTicksNS();
+    va_list args;
+    va_start(args, fmt);
+
+    if (!log_state.running)
+    {
+        // before Log_Init, after Log_Deinit and in tools without the log thread
+        Log_Record record;
+        record.level = (Uint8)level;
+        record.category = (Uint8)category;
+        record.time_ns = time_ns;
+        Log_Encode(&record, fmt, args);
+        Log_Print(&record);
+        va_end(args);
+        return;
+    }
+
+    // claim a position; the record at it is free when its sequence == position
+    Log_Ring *ring = &log_state.ring;
+    Uint32 position = SDL_GetAtomicU32(&ring->write);
+    Log_Record *record = 0;
+    for (;;)
+    {
+        record = ring->records + (position & (LOG_RING_SIZE - 1));
+        Sint32 diff = (Sint32)(SDL_GetAtomicU32(&record->sequence) - position);
+        if (diff == 0)
+        {
+            if (SDL_CompareAndSwapAtomicU32(&ring->write, position, position + 1))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // log thread didn't get to this record yet; ring is full
+            SDL_AddAtomicInt(&ring->dropped, 1);
+            va_end(args);
+            return;
+        }
+        position = SDL_GetAtomicU32(&ring->write);
+    }
+
+    record->level = (Uint8)level;
+    record->category = (Uint8)category;
+    record->time_ns = time_ns;
+    Log_Encode(record, fmt, args);
+    va_end(args);
+
+    SDL_SetAtomicU32(&record->sequence, position + 1); // publish
+    if (level == Log_Error)
+        SDL_SignalSemaphore(log_state.wake);
+}
+
+//
+// Log thread
+//
+static bool Log_Get(Log_Record *record, Uint32 *offset, void *data, Uint64 size)
+{
+    if (*offset + size > record->arg_size)
+        return false;
+    memcpy(data, record->args + *offset, size);
+    *offset += (Uint32)size;
+    return true;
+}
+
+static void Log_Print(Log_Record *record)
+{
+    char line[LOG_LINE_SIZE];
+    Uint64 used = 0;
+    Uint32 offset = 0;
+    bool cut = false;
+
+    const char *at = record->fmt;
+    while (*at && used + 1 < sizeof(line))
+    {
+        if (*at != '%')
+        {
+            line[used++] = *at++;
+            continue;
+        }
+
+        at += 1;
+        Log_Spec spec = Log_ParseSpec(at);
+        at = spec.end;
+        if (spec.conversion == '%')
+        {
+            line[used++] = '%';
+            continue;
+        }
+        if (!spec.conversion)
+            continue;
+
+        int width = spec.width;
+        int precision = spec.precision;
+        bool ok = true;
+        if (spec.width_star)
+            ok &= Log_Get(record, &offset, &width, sizeof(width));
+        if (spec.precision_star)
+            ok &= Log_Get(record, &offset, &precision, sizeof(precision));
+
+        // rebuild the conversion with numbers in place of '*' and "ll" for integers
+        char conversion[48];
+        int conversion_size = SDL_snprintf(conversion, sizeof(conversion), "%%%.*s%s",
+                                           (int)spec.flag_count, spec.flags,
+                                           (spec.width_star && width < 0) ? "-" : "");
+        if (spec.width_star || spec.width >= 0)
+            conversion_size += SDL_snprintf(conversion + conversion_size, sizeof(conversion) - conversion_size, "%d", width < 0 ? -width : width);
+        if (precision >= 0 && spec.conversion != 's')
+            conversion_size += SDL_snprintf(conversion + conversion_size, sizeof(conversion) - conversion_size, ".%d", precision);
+
+        char *out = line + used;
+        Uint64 room = sizeof(line) - used;
+        int written = 0;
+        switch (spec.conversion)
+        {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+            {
+                Uint64 value = 0;
+                ok = ok && Log_Get(record, &offset, &value, sizeof(value));
+                SDL_snprintf(conversion + conversion_size, sizeof(conversion) - conversion_size, "ll%c", spec.conversion);
+                if (ok) written = SDL_snprintf(out, room, conversion, (long long)value);
+            } break;
+
+            case 'c':
+            {
+                Sint64 value = 0;
+                ok = ok && Log_Get(record, &offset, &value, sizeof(value));
+                SDL_snprintf(conversion + conversion_size, sizeof(conversion) - conversion_size, "c");
+                if (ok) written = SDL_snprintf(out, room, conversion, (int)value);
+            } break;
+
+            case 'p':
+            {
+                Uint64 value = 0;
+                ok = ok && Log_Get(record, &offset, &value, sizeof(value));
+                SDL_snprintf(conversion + conversion_size, sizeof(conversion) - conversion_size, "p");
+                if (ok) written = SDL_snprintf(out, room, conversion, (void *)(uintptr_t)value);
+            } break;
+
+            case 's':
+            {
+                Uint16 size = 0;
+                ok = ok && Log_Get(record, &offset, &size, sizeof(size));
+                ok = ok && offset + size <= record->arg_size;
+                SDL_snprintf(conversion + conversion_size, sizeof(conversion) - conversion_size, ".*s");
+                if (ok) written = SDL_snprintf(out, room, conversion, (int)size, (const char *)record->args + offset);
+                offset += size;
+            } break;
+
+            default:
+            {
+                double value = 0;
+                ok = ok && Log_Get(record, &offset, &value, sizeof(value));
+                SDL_snprintf(conversion + conversion_size, sizeof(conversion) - conversion_size, "%c", spec.conversion);
+                if (ok) written = SDL_snprintf(out, room, conversion, value);
+            } break;
+        }
+
+        if (!ok)
+        {
+            cut = true;
+            break;
+        }
+        used += (Uint64)Clamp(0, (int)room - 1, written);
+    }
+    line[used] = 0;
+
+    SDL_LogPriority priority = (record->level == Log_Error ? SDL_LOG_PRIORITY_ERROR :
+                                record->level == Log_Warn ? SDL_LOG_PRIORITY_WARN :
+                                SDL_LOG_PRIORITY_INFO); // SDL hides its verbose priority by default
+    SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, priority, "[%.3f] %s: %s%s",
+                   (double)record->time_ns / (double)SDL_NS_PER_SECOND,
+                   log_category_names[record->category], line, cut ? " ..." : "");
+}
+
+// Prints all ready records; returns how many there were.
+static Uint32 Log_Drain(void)
+{
+    Log_Ring *ring = &log_state.ring;
+    Uint32 count = 0;
+    for (;;)
+    {
+        Log_Record *record = ring->records + (ring->read & (LOG_RING_SIZE - 1));
+        if (SDL_GetAtomicU32(&record->sequence) != ring->read + 1)
+            break;
+
+        Log_Print(record);
+        SDL_SetAtomicU32(&record->sequence, ring->read + LOG_RING_SIZE); // free for the next lap
+        ring->read += 1;
+        count += 1;
+    }
+
+    int dropped = SDL_GetAtomicInt(&ring->dropped);
+    if (dropped != log_state.reported_dropped)
+    {
+        SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN,
+                       "log: ring was full, dropped %d records (%d total)",
+                       dropped - log_state.reported_dropped, dropped);
+        log_state.reported_dropped = dropped;
+    }
+    return count;
+}
+
+static int Log_ThreadMain(void *data)
+{
+    (void)data;
+    for (;;)
+    {
+        // read quit before draining so records pushed before Log_Deinit get printed
+        bool quit = SDL_GetAtomicInt(&log_state.quit);
+        Uint32 printed = Log_Drain();
+        if (quit)
+            break;
+        if (!printed)
+            SDL_WaitSemaphoreTimeout(log_state.wake, LOG_FLUSH_INTERVAL_MS);
+    }
+    return 0;
+}
+
+//
+// Setup
+//
+// Parses -log argument: "verbose" sets all categories,
+// "net=verbose,map=warn" sets listed ones.
+static bool Log_Configure(S8 config)
+{
+    while (config.size)
+    {
+        S8 item = config;
+        S8_FindResult comma = S8_Find(config, S8_MakeFromCstr(","), 0, 0);
+        if (comma.found)
+        {
+            item = S8_Prefix(config, comma.index);
+            config = S8_Skip(config, comma.index + 1);
+        }
+        else
+        {
+            config = (S8){0};
+        }
+
+        S8 name = {0};
+        S8 level_name = item;
+        S8_FindResult equals = S8_Find(item, S8_MakeFromCstr("="), 0, 0);
+        if (equals.found)
+        {
+            name = S8_Prefix(item, equals.index);
+            level_name = S8_Skip(item, equals.index + 1);
+        }
+
+        int level = -1;
+        ForArray(i, log_level_names)
+        {
+            if (S8_Match(level_name, S8_MakeFromCstr(log_level_names[i]), S8Match_CaseInsensitive))
+                level = (int)i;
+        }
+        if (level < 0)
+            return false;
+
+        bool found = !name.size;
+        ForArray(i, log_category_names)
+        {
+            if (!name.size || S8_Match(name, S8_MakeFromCstr(log_category_names[i]), S8Match_CaseInsensitive))
+            {
+                log_state.levels[i] = (Uint8)level;
+                found = true;
+            }
+        }
+        if (!found)
+            return false;
+    }
+    return true;
+}
+
+// Starts the log thread; until then records are printed by the caller.
+static void Log_Init(void)
+{
+    if (log_state.running)
+        return;
+
+    bool ok = Arena_Init(&log_state.arena, "log", LOG_RING_SIZE * sizeof(Log_Record));
+    log_state.ring.records = (ok ? Arena_PushArrayNoZero(&log_state.arena, Log_Record, LOG_RING_SIZE) : 0);
+    log_state.wake = SDL_CreateSemaphore(0);
+    if (!log_state.ring.records || !log_state.wake)
+    {
+        SDL_Log("Log: Failed to initialize; logging synchronously");
+        goto cleanup;
+    }
+
+    ForU32(i, LOG_RING_SIZE)
+        SDL_SetAtomicU32(&log_state.ring.records[i].sequence, i);
+
+    log_state.thread = SDL_CreateThread(Log_ThreadMain, "demongus log", 0);
+    if (!log_state.thread)
+    {
+        SDL_Log("Log: Failed to create log thread: %s; logging synchronously", SDL_GetError());
+        goto cleanup;
+    }
+    log_state.running = true;
+    return;
+
+    cleanup:
+    if (log_state.wake)
+        SDL_DestroySemaphore(log_state.wake);
+    log_state.wake = 0;
+    Arena_Release(&log_state.arena);
+    log_state.ring.records = 0;
+}
+
+// Other threads can't log anymore; records pushed so far are printed.
+static void Log_Deinit(void)
+{
+    if (!log_state.running)
+        return;
+
+    SDL_SetAtomicInt(&log_state.quit, 1);
+    SDL_SignalSemaphore(log_state.wake);
+    SDL_WaitThread(log_state.thread, 0);
+    log_state.running = false;
+
+    Log_Drain(); // anything published after the thread's last drain
+    SDL_DestroySemaphore(log_state.wake);
+    log_state.wake = 0;
+    Arena_Release(&log_state.arena);
+    log_state.ring.records = 0;
+}
@@ -0,0 +1,83 @@
+//
+// Logging
+// LogError/LogWarn/LogInfo/LogVerbose take a category and printf-style
+// arguments. Records above LOG_COMPILE_LEVEL are compiled out, the rest
+// are filtered by per category runtime levels (-log command line option).
+// Callers don't format anything: arguments are copied as binary values into
+// a fixed size record of a lock-free ring and a background thread formats
+// and prints them. When the ring is full records are dropped and counted.
+// @info(mg) Format strings have to be string literals; they're read later
+//           by the log thread. Strings passed with %s are copied (up to
+//           what fits in the record). %n isn't supported.
+//
+#ifndef LOG_COMPILE_LEVEL
+#   define LOG_COMPILE_LEVEL Log_Verbose
+#endif
+#define LOG_RING_SIZE 4096 // records; power of 2
+#define LOG_RECORD_SIZE 256
+#define LOG_LINE_SIZE 1024 // formatted message; longer ones are cut
+#define LOG_FLUSH_INTERVAL_MS 10 // log thread sleeps this long when the ring is empty
+
+typedef enum
+{
+    Log_Off,
+    Log_Error,
+    Log_Warn,
+    Log_Info,
+    Log_Verbose,
+    Log_LevelCount
+} Log_Level;
+
+typedef enum
+{
+    LogCat_Game,
+    LogCat_Net,
+    LogCat_Map,
+    LogCat_Sprite,
+    LogCat_Replay,
+    LogCat_Count
+} Log_Category;
+
+typedef struct
+{
+    SDL_AtomicU32 sequence; // == ring position + 1 when the record is ready to be read
+    Uint8 level;
+    Uint8 category;
+    Uint16 arg_size;
+    Uint64 time_ns;
+    const char *fmt;
+    Uint8 args[LOG_RECORD_SIZE - 24]; // see Log_Push for the layout
+} Log_Record;
+static_assert(sizeof(Log_Record) == LOG_RECORD_SIZE);
+
+// Multi producer, single consumer bounded queue of records
+// (a sequence number per record, producers claim positions with CAS).
+typedef struct
+{
+    Log_Record *records; // LOG_RING_SIZE
+    SDL_AtomicU32 write; // claimed by producers
+    Uint32 read; // log thread only
+    SDL_AtomicInt dropped;
+} Log_Ring;
+
+typedef struct
+{
+    bool running; // log thread started; otherwise records are printed right away
+    Uint8 levels[LogCat_Count]; // runtime level per category
+    Arena arena;
+    Log_Ring ring;
+    SDL_Thread *thread;
+    SDL_Semaphore *wake; // errors wake the log thread early; so does quitting
+    SDL_AtomicInt quit;
+    int reported_dropped; // log thread only
+} Log_State;
+
+#define LOG(Level, Category, ...) do { \
+    if ((Level) <= LOG_COMPILE_LEVEL && Log_Enabled((Level), (Category))) \
+        Log_Push((Level), (Category), __VA_ARGS__); \
+} while (0)
+
+#define LogError(Category, ...)   LOG(Log_Error, Category, __VA_ARGS__)
+#define LogWarn(Category, ...)    LOG(Log_Warn, Category, __VA_ARGS__)
+#define LogInfo(Category, ...)    LOG(Log_Info, Category, __VA_ARGS__)
+#define LogVerbose(Category, ...) LOG(Log_Verbose, Category, __VA_ARGS__)
@@ -4,23 +4,27 @@
 //           stuff when it's reasonable.
 //
 
-static void Game_VerticesCameraTransform(AppState *app, V2 verts[4], float camera_scale, V2 window_transform)
+// Camera transform of world space vertices into window space.
+static void Game_VerticesCameraTransform(AppState *app, V2 *verts, Uint64 vert_count,
+                                         float camera_scale, V2 window_transform)
 {
-    ForU32(i, 4)
-    {
-        // apply camera transform
-        verts[i].x -= app->camera_p.x;
-        verts[i].y -= app->camera_p.y;
-
-        verts[i].x *= camera_scale;
-        verts[i].y *= camera_scale;
+    // (p - camera_p) * camera_scale + window_transform, folded into one
+    // affine transform; y axis is flipped to +Y up (SDL uses +Y down)
+    V2 x_axis = {camera_scale, 0};
+    V2 y_axis = {0, -camera_scale};
+    V2 offset = {window_transform.x - app->camera_p.x * camera_scale,
+                 app->window_height - window_transform.y + app->camera_p.y * camera_scale};
+    V2_StreamTransform(verts, verts, vert_count, x_axis, y_axis, offset);
+}
 
-        verts[i].x += window_transform.x;
-        verts[i].y += window_transform.y;
+// Quad that object with this sprite is drawn as (before offsetting by its p).
+static Col_Vertices Game_SpriteDrawVertices(Sprite *sprite)
+{
+    if (!sprite->tex)
+        return sprite->collision_vertices;
 
-        // fix y axis direction to +Y up (SDL uses +Y down, -Y up)
-        verts[i].y = app->window_height - verts[i].y;
-    }
+    V2 tex_dim = {(float)sprite->tex->w, (float)sprite->tex->h / (float)sprite->tex_frames};
+    return Vertices_FromRect((V2){0}, tex_dim);
 }
 
 static void Game_IssueDrawCommands(AppState *app)
@@ -28,19 +32,15 @@ static void Game_IssueDrawCommands(AppState *app)
     // animate collision overlay texture
     if (app->debug.draw_collision_box)
     {
-        Sprite *sprite_overlay = Sprite_Get(app, app->sprite_overlay_id);
-
-        float overlay_speed = 12.f;
-        app->debug.collision_sprite_animation_t += overlay_speed * app->dt;
-
-        float period = 1.f;
-        while (app->debug.collision_sprite_animation_t > period)
+        Sprite *sprite_overlay = Sprite_Get(app, app->sprite_ids[PackSprite_Overlay]);
+        if (sprite_overlay->clip_count)
         {
-            app->debug.collision_sprite_animation_t -= period;
-            app->debug.collision_sprite_frame_index += 1;
+            Sprite_Clip *clip = sprite_overlay->clips;
+            float t = app->debug.collision_sprite_clip_t + clip->fps * app->dt;
+            Uint32 steps = (Uint32)t;
+            app->debug.collision_sprite_clip_t = t - (float)steps;
+            app->debug.collision_sprite_clip_step = (app->debug.collision_sprite_clip_step + steps) % clip->frame_count;
         }
-
-        app->debug.collision_sprite_frame_index %= sprite_overlay->tex_frames;
     }
 
     // draw objects
@@ -52,37 +52,31 @@ static void Game_IssueDrawCommands(AppState *app)
         }
         V2 window_transform = (V2){app->window_width*0.5f, app->window_height*0.5f};
 
-        ForU32(object_index, app->object_count)
-        {
-            Object *obj = app->object_pool + object_index;
-            Sprite *sprite = Sprite_Get(app, obj->sprite_id);
+        // @speed Vertices of all objects are generated and camera transformed
+        //        in batches (see V2_StreamTransform) before draw calls are issued.
+        Uint32 *draw_objects = app->object_lists[ObjectList_Drawables].objects;
+        Uint32 draw_count = app->object_lists[ObjectList_Drawables].count;
+        V2 *draw_verts = Arena_PushArrayNoZero(&app->frame_arena, V2, app->object_count * 4);
+        Assert(draw_verts);
 
-            V2 verts[4];
-            if (sprite->tex)
-            {
-                V2 tex_half_dim = {(float)sprite->tex->w, (float)sprite->tex->h};
-                tex_half_dim.y /= (float)sprite->tex_frames;
-                tex_half_dim = V2_Scale(tex_half_dim, 0.5f);
-
-                verts[0] = (V2){-tex_half_dim.x, -tex_half_dim.y};
-                verts[1] = (V2){ tex_half_dim.x, -tex_half_dim.y};
-                verts[2] = (V2){ tex_half_dim.x,  tex_half_dim.y};
-                verts[3] = (V2){-tex_half_dim.x,  tex_half_dim.y};
-            }
-            else
-            {
-                static_assert(sizeof(verts) == sizeof(sprite->collision_vertices.arr));
-                memcpy(verts, sprite->collision_vertices.arr, sizeof(verts));
-            }
+        ForU32(draw_index, draw_count)
+        {
+            Object *obj = app->object_pool + draw_objects[draw_index];
+            Col_Vertices local = Game_SpriteDrawVertices(Sprite_Get(app, obj->sprite_id));
+            V2x4_Store(draw_verts + draw_index*4, V2x4_Add(V2x4_Load(local.arr), V2x4_Set1(obj->p)));
+        }
+        Game_VerticesCameraTransform(app, draw_verts, draw_count*4, camera_scale, window_transform);
 
-            Vertices_Offset(verts, ArrayCount(verts), obj->p);
-            Game_VerticesCameraTransform(app, verts, camera_scale, window_transform);
+        ForU32(draw_index, draw_count)
+        {
+            Object *obj = app->object_pool + draw_objects[draw_index];
+            Sprite *sprite = Sprite_Get(app, obj->sprite_id);
+            V2 *verts = draw_verts + draw_index*4;
 
             SDL_FColor fcolor = ColorF_To_SDL_FColor(obj->sprite_color);
             SDL_Vertex sdl_verts[4];
             SDL_zerop(sdl_verts);
 
-            static_assert(ArrayCount(verts) == ArrayCount(sdl_verts));
             ForArray(i, sdl_verts)
             {
                 sdl_verts[i].position = V2_To_SDL_FPoint(verts[i]);
@@ -90,19 +84,11 @@ static void Game_IssueDrawCommands(AppState *app)
             }
 
             {
-                float tex_y0 = 0.f;
-                float tex_y1 = 1.f;
-                if (sprite->tex_frames > 1)
-                {
-                    Uint32 frame_index = obj->sprite_frame_index;
-                    float tex_height = 1.f / sprite->tex_frames;
-                    tex_y0 = frame_index * tex_height;
-                    tex_y1 = tex_y0 + tex_height;
-                }
-                sdl_verts[0].tex_coord = (SDL_FPoint){0, tex_y1};
-                sdl_verts[1].tex_coord = (SDL_FPoint){1, tex_y1};
-                sdl_verts[2].tex_coord = (SDL_FPoint){1, tex_y0};
-                sdl_verts[3].tex_coord = (SDL_FPoint){0, tex_y0};
+                RngF tex_y = Sprite_TexY(sprite, obj->sprite_clip, obj->sprite_clip_step);
+                sdl_verts[0].tex_coord = (SDL_FPoint){0, tex_y.max};
+                sdl_verts[1].tex_coord = (SDL_FPoint){1, tex_y.max};
+                sdl_verts[2].tex_coord = (SDL_FPoint){1, tex_y.min};
+                sdl_verts[3].tex_coord = (SDL_FPoint){0, tex_y.min};
             }
 
             int indices[] = { 0, 1, 3, 1, 2, 3 };
@@ -113,18 +99,22 @@ static void Game_IssueDrawCommands(AppState *app)
 
         if (app->debug.draw_collision_box)
         {
-            ForU32(object_index, app->object_count)
+            draw_objects = app->object_lists[ObjectList_Colliders].objects;
+            draw_count = app->object_lists[ObjectList_Colliders].count;
+            ForU32(draw_index, draw_count)
             {
-                Object *obj = app->object_pool + object_index;
-                if (!(obj->flags & ObjectFlag_Collide)) continue;
-
-                Sprite *sprite = Sprite_Get(app, obj->sprite_id);
+                Object *obj = app->object_pool + draw_objects[draw_index];
+                Col_Vertices local = Sprite_Get(app, obj->sprite_id)->collision_vertices;
+                V2x4_Store(draw_verts + draw_index*4, V2x4_Add(V2x4_Load(local.arr), V2x4_Set1(obj->p)));
+            }
+            Game_VerticesCameraTransform(app, draw_verts, draw_count*4, camera_scale, window_transform);
 
-                V2 verts[4];
-                static_assert(sizeof(verts) == sizeof(sprite->collision_vertices.arr));
-                memcpy(verts, sprite->collision_vertices.arr, sizeof(verts));
-                Vertices_Offset(verts, ArrayCount(verts), obj->p);
-                Game_VerticesCameraTransform(app, verts, camera_scale, window_transform);
+            Sprite *overlay_sprite = Sprite_Get(app, app->sprite_ids[PackSprite_Overlay]);
+            RngF tex_y = Sprite_TexY(overlay_sprite, 0, app->debug.collision_sprite_clip_step);
+            ForU32(draw_index, draw_count)
+            {
+                Object *obj = app->object_pool + draw_objects[draw_index];
+                V2 *verts = draw_verts + draw_index*4;
 
                 ColorF color = ColorF_RGBA(1, 0, 0.8f, 0.8f);
                 if (obj->has_collision)
@@ -137,35 +127,55 @@ static void Game_IssueDrawCommands(AppState *app)
                 SDL_Vertex sdl_verts[4];
                 SDL_zerop(sdl_verts);
 
-                static_assert(ArrayCount(verts) == ArrayCount(sdl_verts));
                 ForArray(i, sdl_verts)
                 {
                     sdl_verts[i].position = V2_To_SDL_FPoint(verts[i]);
                     sdl_verts[i].color = fcolor;
                 }
-
-                Sprite *overlay_sprite = Sprite_Get(app, app->sprite_overlay_id);
-                {
-                    float tex_y0 = 0.f;
-                    float tex_y1 = 1.f;
-                    if (overlay_sprite->tex_frames > 1)
-                    {
-                        Uint32 frame_index = app->debug.collision_sprite_frame_index;
-                        float tex_height = 1.f / overlay_sprite->tex_frames;
-                        tex_y0 = frame_index * tex_height;
-                        tex_y1 = tex_y0 + tex_height;
-                    }
-                    sdl_verts[0].tex_coord = (SDL_FPoint){0, tex_y1};
-                    sdl_verts[1].tex_coord = (SDL_FPoint){1, tex_y1};
-                    sdl_verts[2].tex_coord = (SDL_FPoint){1, tex_y0};
-                    sdl_verts[3].tex_coord = (SDL_FPoint){0, tex_y0};
-                }
+                sdl_verts[0].tex_coord = (SDL_FPoint){0, tex_y.max};
+                sdl_verts[1].tex_coord = (SDL_FPoint){1, tex_y.max};
+                sdl_verts[2].tex_coord = (SDL_FPoint){1, tex_y.min};
+                sdl_verts[3].tex_coord = (SDL_FPoint){0, tex_y.min};
 
                 int indices[] = { 0, 1, 3, 1, 2, 3 };
                 SDL_RenderGeometry(app->renderer, overlay_sprite->tex,
                                    sdl_verts, ArrayCount(sdl_verts),
                                    indices, ArrayCount(indices));
             }
+
+            // visibility polygon around the camera (what -fog server would send)
+            Visibility_Polygon *visibility = &app->debug.visibility;
+            if (app->map.bvh.node_count)
+                Visibility_Update(app, visibility, app->camera_p, VISIBILITY_RANGE);
+
+            if (visibility->valid && visibility->count >= 2)
+            {
+                Uint32 vert_count = visibility->count + 1;
+                V2 *fan_verts = Arena_PushArrayNoZero(&app->frame_arena, V2, vert_count);
+                SDL_Vertex *sdl_verts = Arena_PushArray(&app->frame_arena, SDL_Vertex, vert_count);
+                int *indices = Arena_PushArrayNoZero(&app->frame_arena, int, visibility->count * 3);
+                Assert(fan_verts && sdl_verts && indices);
+
+                fan_verts[0] = visibility->viewer;
+                memcpy(fan_verts + 1, visibility->verts, visibility->count * sizeof(V2));
+                Game_VerticesCameraTransform(app, fan_verts, vert_count, camera_scale, window_transform);
+
+                SDL_FColor fcolor = ColorF_To_SDL_FColor(ColorF_RGBA(1, 1, 0.5f, 0.15f));
+                ForU32(i, vert_count)
+                {
+                    sdl_verts[i].position = V2_To_SDL_FPoint(fan_verts[i]);
+                    sdl_verts[i].color = fcolor;
+                }
+                ForU32(i, visibility->count)
+                {
+                    indices[i*3 + 0] = 0;
+                    indices[i*3 + 1] = (int)i + 1;
+                    indices[i*3 + 2] = (int)((i + 1) % visibility->count) + 1;
+                }
+                SDL_RenderGeometry(app->renderer, 0,
+                                   sdl_verts, (int)vert_count,
+                                   indices, (int)visibility->count * 3);
+            }
         }
     }
 
@@ -199,8 +209,45 @@ static void Game_IssueDrawCommands(AppState *app)
     }
 }
 
+static void Game_ReportNetStats(AppState *app)
+{
+    if (app->debug.net_stats &&
+        app->frame_time >= app->debug.net_stats_last_report + 1000)
+    {
+        app->debug.net_stats_last_report = app->frame_time;
+        if (app->lockstep.enabled)   Lockstep_ReportStats(app);
+        else if (app->net.is_server) Interest_ReportStats(app);
+        else                         Jitter_ReportStats(app);
+        Net_ReportStats(app);
+    }
+}
+
+static void Game_ReportMemory(AppState *app)
+{
+    Arena *arenas[] =
+    {
+        &app->perm, &app->frame_arena, &app->tick_arena,
+        &app->object_arena, &app->object_dense_handle_arena,
+        &app->object_handle_arena, &app->object_list_index_arena,
+        &app->object_lists[ObjectList_Movers].arena, &app->object_lists[ObjectList_Colliders].arena,
+        &app->object_lists[ObjectList_Drawables].arena, &app->object_lists[ObjectList_Animated].arena,
+        &app->network_handle_arena,
+        &app->sprite_arena, &app->map.arena, &app->map.bvh_arena,
+        &app->net.arena, &app->net.user_arena, &app->net.user_table_arena,
+    };
+    ForArray(i, arenas)
+    {
+        if (arenas[i]->base) // clients and replays don't use all of them
+            Arena_Report(arenas[i]);
+    }
+}
+
 static void Game_Iterate(AppState *app)
 {
+    Uint64 frame_start_ns = SDL_GetTicksNS();
+    Arena_Reset(&app->frame_arena);
+    Sprite_UploadLoaded(app);
+
     {
         app->frame_id += 1;
 
@@ -217,6 +264,8 @@ static void Game_Iterate(AppState *app)
     }
 
     Net_IterateReceive(app);
+    Replay_RecordFrame(app);
+    Map_Update(app, MAP_MAX_CHUNK_LOADS);
 
     if (app->debug.single_tick_stepping)
     {
@@ -229,15 +278,23 @@ static void Game_Iterate(AppState *app)
     }
     else
     {
-        while (app->tick_dt_accumulator > TIME_STEP)
+        while (app->tick_dt_accumulator > app->time_step)
         {
             app->tick_id += 1;
-            app->tick_dt_accumulator -= TIME_STEP;
+            app->tick_dt_accumulator -= app->time_step;
             Tick_Iterate(app);
         }
     }
 
     Net_IterateSend(app);
+    app->net.work_ns = SDL_GetTicksNS() - frame_start_ns; // without drawing
+
+    if (!app->net.is_server && !app->lockstep.enabled)
+    {
+        Jitter_Playback(app);
+    }
+
+    Game_ReportNetStats(app);
 
     // move camera
     {
@@ -248,15 +305,189 @@ static void Game_Iterate(AppState *app)
     Game_IssueDrawCommands(app);
 }
 
-static Object *Object_CreatePlayer(AppState *app)
+// @info(mg) Dedicated server isn't paced by frames. It sleeps until
+//           the deadline of the next tick and runs exactly one tick.
+//           Deadlines are advanced by a fixed period so sleep/wake
+//           errors don't accumulate into drift.
+static void Game_IterateDedicated(AppState *app)
+{
+    Uint64 period_ns = SDL_NS_PER_SECOND / app->tick_rate;
+
+    {
+        Uint64 now = SDL_GetTicksNS();
+        if (now < app->dedicated.next_tick_ns)
+            SDL_DelayPrecise(app->dedicated.next_tick_ns - now);
+    }
+
+    Uint64 tick_start_ns = SDL_GetTicksNS();
+    Arena_Reset(&app->frame_arena);
+    Uint64 late_ns = tick_start_ns - app->dedicated.next_tick_ns;
+    app->dedicated.next_tick_ns += period_ns;
+
+    // if we fell behind by more than a few ticks (debugger, machine suspend)
+    // skip them instead of running a burst of ticks
+    if (late_ns > 4 * period_ns)
+    {
+        Uint64 skipped = late_ns / period_ns;
+        app->dedicated.skipped_ticks += skipped;
+        app->dedicated.next_tick_ns += skipped * period_ns;
+    }
+
+    {
+        app->frame_id += 1;
+        app->frame_time = tick_start_ns / SDL_NS_PER_MS;
+        app->dt = app->time_step;
+    }
+
+    Net_IterateReceive(app);
+    Replay_RecordFrame(app);
+    Map_Update(app, MAP_MAX_CHUNK_LOADS);
+    app->tick_id += 1;
+    Tick_Iterate(app);
+    Net_IterateSend(app);
+    Game_ReportNetStats(app);
+
+    Uint64 work_ns = SDL_GetTicksNS() - tick_start_ns;
+    app->net.work_ns = work_ns;
+
+    // stats
+    {
+        app->dedicated.tick_count += 1;
+        app->dedicated.late_sum_ns += late_ns;
+        app->dedicated.late_max_ns = Max(app->dedicated.late_max_ns, late_ns);
+        app->dedicated.work_sum_ns += work_ns;
+        app->dedicated.work_max_ns = Max(app->dedicated.work_max_ns, work_ns);
+
+        if (tick_start_ns >= app->dedicated.last_report_ns + DEDICATED_REPORT_INTERVAL_MS * SDL_NS_PER_MS)
+        {
+            app->dedicated.last_report_ns = tick_start_ns;
+
+            double ms = 1.0 / (double)SDL_NS_PER_MS;
+            double count = (double)app->dedicated.tick_count;
+            LogInfo(LogCat_Game, "SERVER: %llu ticks @ %u Hz; start jitter avg %.3f max %.3f ms; "
+                                 "tick time avg %.3f max %.3f ms (budget %.3f ms); skipped %llu ticks; %u users; "
+                                 "%u map chunks resident",
+                                 app->dedicated.tick_count, app->tick_rate,
+                                 app->dedicated.late_sum_ns * ms / count, app->dedicated.late_max_ns * ms,
+                                 app->dedicated.work_sum_ns * ms / count, app->dedicated.work_max_ns * ms,
+                                 period_ns * ms, app->dedicated.skipped_ticks, app->net.user_count,
+                                 app->map.resident_count);
+
+            app->dedicated.tick_count = 0;
+            app->dedicated.skipped_ticks = 0;
+            app->dedicated.late_sum_ns = 0;
+            app->dedicated.late_max_ns = 0;
+            app->dedicated.work_sum_ns = 0;
+            app->dedicated.work_max_ns = 0;
+
+            if (app->debug.net_stats)
+                Game_ReportMemory(app);
+        }
+    }
+}
+
+// @info(mg) Replays a recording made with -record. There is no pacing;
+//           recorded frames and ticks run back to back. Messages go
+//           through the same code as live ones, nothing is sent.
+//           Returns false when done.
+static bool Game_IterateReplay(AppState *app)
 {
-    Object *player = Object_Create(app, app->sprite_dude_id, ObjectFlag_Draw|ObjectFlag_Move|ObjectFlag_Collide);
-    player->sprite_color = ColorF_RGB(1,1,1);
-    return player;
+    if (!app->replay.playing)
+        return false;
+
+    Uint64 iterate_start_ns = SDL_GetTicksNS();
+    while (SDL_GetTicksNS() - iterate_start_ns < REPLAY_ITERATE_MS * SDL_NS_PER_MS)
+    {
+        Replay_Record record = Replay_ReadRecord(app);
+        if (record.kind == Replay_Rec_End || record.kind == Replay_Rec_Invalid)
+        {
+            Replay_Report(app);
+            return false;
+        }
+
+        // users are looked up by id; there are no addresses in a replay
+        Net_User *user = 0;
+        Uint32 user_index = 0;
+        if (record.kind == Replay_Rec_UserRemove || record.kind == Replay_Rec_Message)
+        {
+            ForU32(i, app->net.user_count)
+            {
+                if (app->net.users[i].id == record.user_id)
+                {
+                    user = app->net.users + i;
+                    user_index = i;
+                    break;
+                }
+            }
+
+            if (!user)
+            {
+                LogWarn(LogCat_Replay, "Unknown user %u", record.user_id);
+                Replay_Report(app);
+                return false;
+            }
+        }
+
+        switch (record.kind)
+        {
+            case Replay_Rec_Frame:
+            {
+                Arena_Reset(&app->frame_arena);
+                app->frame_id += 1;
+                app->replay.frames += 1;
+                Map_Update(app, MAP_MAX_CHUNK_LOADS);
+            } break;
+
+            case Replay_Rec_UserAdd:
+            {
+                user = Net_AddUser(app, 0, record.port);
+                if (!user || user->id != record.user_id)
+                {
+                    LogWarn(LogCat_Replay, "Failed to recreate user %u", record.user_id);
+                    Replay_Report(app);
+                    return false;
+                }
+            } break;
+
+            case Replay_Rec_UserRemove:
+            {
+                Net_RemoveUser(app, user_index);
+            } break;
+
+            case Replay_Rec_Message:
+            {
+                app->replay.messages += 1;
+                Net_ReceiveFromUser(app, user, (Net_Reader){ record.message });
+            } break;
+
+            case Replay_Rec_Tick:
+            {
+                Tick_Input input = {};
+                input.tick_id = app->tick_id + 1;
+                input.move_dir = record.move_dir;
+
+                Uint64 tick_start_ns = SDL_GetTicksNS();
+                app->tick_id += 1;
+                Arena_Reset(&app->tick_arena);
+                Tick_AdvanceSimulation(app, input);
+                Uint64 tick_ns = SDL_GetTicksNS() - tick_start_ns;
+
+                app->replay.ticks += 1;
+                app->replay.tick_sum_ns += tick_ns;
+                app->replay.tick_max_ns = Max(app->replay.tick_max_ns, tick_ns);
+                Replay_CheckTick(app, record.hash);
+            } break;
+
+            default: break;
+        }
+    }
+    return true;
 }
 
 static void Game_Init(AppState *app)
 {
+    app->sprite_load.start_ns = SDL_GetTicksNS();
+
     // init debug options
     {
         //app->debug.fixed_dt = 0.1f;
@@ -264,63 +495,73 @@ static void Game_Init(AppState *app)
         app->debug.draw_collision_box = true;
     }
 
-    Net_Init(app);
+    // init memory
+    {
+        Arena_Init(&app->frame_arena, "frame", ARENA_SCRATCH_RESERVE);
+        Arena_Init(&app->tick_arena, "tick", ARENA_SCRATCH_RESERVE);
+        Sim_Init(app);
+        Object_InitPool(app);
+        Sprite_InitPool(app);
+    }
+
+    // clients switch to lockstep when the server sends a frame;
+    // replay overrides settings that decide the initial state
+    app->has_local_player = (app->net.is_server && !app->headless);
+    app->lockstep.enabled = (app->lockstep.enabled && app->net.is_server);
+    if (app->replay.play_path)
+        Replay_Open(app); // on failure Game_IterateReplay quits right away
+    else
+        Net_Init(app);
 
+    app->time_step = 1.f / (float)app->tick_rate;
     app->frame_time = SDL_GetTicks();
-    app->object_count += 1; // reserve object under index 0 as special 'nil' value
-    app->sprite_count += 1; // reserve sprite under index 0 as special 'nil' value
     app->camera_range = 500;
     app->tick_id = NET_MAX_TICK_HISTORY;
 
-    // this assumes we run the game from build directory
-    // @todo in the future we should force CWD or query demongus absolute path etc
-    Sprite *sprite_overlay = Sprite_Create(app, "../res/pxart/overlay.png", 6);
-    app->sprite_overlay_id = Sprite_IdFromPointer(app, sprite_overlay);
-
-    Sprite *sprite_crate = Sprite_Create(app, "../res/pxart/crate.png", 1);
+    // sprites
     {
-        Sprite_CollisionVerticesRotate(sprite_crate, 0.125f);
-        Sprite_CollisionVerticesScale(sprite_crate, 0.6f);
-        Sprite_CollisionVerticesOffset(sprite_crate, (V2){0, -3});
-        Sprite_RecalculateCollsionNormals(sprite_crate);
+        bool from_pack = (!app->sprite_load.skip_pack &&
+                          Sprite_LoadPack(app, PACK_PATH, app->sprite_ids));
+        if (!from_pack)
+        {
+            Sprite_InitLoading(app);
+            ForArray(i, pack_sprite_defs)
+                app->sprite_ids[i] = Sprite_IdFromPointer(app, Sprite_CreateFromDef(app, pack_sprite_defs + i));
+        }
     }
 
-    Sprite *sprite_dude = Sprite_Create(app, "../res/pxart/dude_walk.png", 5);
+    Map_Open(app);
+
+    // add network objs; dedicated server has no local player
+    if (app->has_local_player)
     {
-        sprite_dude->collision_vertices = Vertices_FromRect((V2){0}, (V2){20, 10});
-        Sprite_CollisionVerticesOffset(sprite_dude, (V2){0, -8});
-        app->sprite_dude_id = Sprite_IdFromPointer(app, sprite_dude);
+        Object *player = Object_CreatePlayer(app);
+        player->p = Map_NextSpawn(app);
+        app->camera_p = player->p;
+        app->player_network_slot = Object_AssignNetworkSlot(app, player);
     }
-    Sprite *sprite_ref = Sprite_Create(app, "../res/pxart/reference.png", 1);
 
-    // add walls
+    // make chunks around the camera resident before the first frame
     {
-        float thickness = 20.f;
-        float length = 400.f;
-        float off = length*0.5f - thickness*0.5f;
-        Object_Wall(app, (V2){off, 0}, (V2){thickness, length});
-        Object_Wall(app, (V2){-off, 0}, (V2){thickness, length});
-        Object_Wall(app, (V2){0, off}, (V2){length, thickness});
-        Object_Wall(app, (V2){0,-off}, (V2){length*0.5f, thickness});
-
-        if (1) {
-            Object *ref = Object_Create(app, Sprite_IdFromPointer(app, sprite_ref),
-                                        ObjectFlag_Draw|ObjectFlag_Collide);
-            ref->p = (V2){0, off*0.5f};
-            ref->sprite_color = ColorF_RGBA(1,1,1,1);
-        }
-        {
-            Object *crate = Object_Create(app, Sprite_IdFromPointer(app, sprite_crate),
-                                          ObjectFlag_Draw|ObjectFlag_Collide);
-            crate->p = (V2){0.5f*off, -0.5f*off};
-            (void)crate;
-        }
+        Uint64 stream_start_ns = SDL_GetTicksNS();
+        Map_Update(app, MAP_MAX_CHUNKS);
+        Map_ReportStats(app, SDL_GetTicksNS() - stream_start_ns);
     }
 
-
-    // add network objs
-    if (app->net.is_server)
+    if (!app->headless)
     {
-        app->network_ids[0] = Object_IdFromPointer(app, Object_CreatePlayer(app));
+        Sprite_ReportLoadTime(app, "Game_Init done");
+        if (app->sprite_load.sync || app->sprite_load.from_pack)
+            Sprite_ReportLoadTime(app, "all textures ready");
     }
+
+    if (app->replay.playing)
+        Replay_CheckStart(app);
+    else if (app->replay.record_path)
+        Replay_BeginRecording(app);
+
+    // start tick pacing after loading is done
+    app->dedicated.next_tick_ns = SDL_GetTicksNS();
+    app->dedicated.last_report_ns = app->dedicated.next_tick_ns;
+    app->replay.start_ns = app->dedicated.next_tick_ns;
 }
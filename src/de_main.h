@@ -1,29 +1,192 @@
 // ---
 // Constants
 // ---
-#define TICK_RATE 16
-#define TIME_STEP (1.f / (float)TICK_RATE)
+#define TICK_RATE 16 // default; server can override it with -tickrate
+#define TICK_RATE_MAX 240
+#define OBJECT_HANDLE_INDEX_BITS 20
+#define OBJECT_MAX_COUNT (1u << OBJECT_HANDLE_INDEX_BITS)
+#define SPRITE_MAX_COUNT 1024
+#define SPRITE_MAX_WORKERS 4 // threads decoding images
+#define ARENA_PERM_RESERVE (256ull * 1024 * 1024)
+#define ARENA_SCRATCH_RESERVE (64ull * 1024 * 1024)
+#define OBJECT_HANDLE_INDEX_MASK ((1u << OBJECT_HANDLE_INDEX_BITS) - 1)
+#define OBJECT_HANDLE_GENERATION_MASK ((1u << (32 - OBJECT_HANDLE_INDEX_BITS)) - 1)
+#define DEDICATED_REPORT_INTERVAL_MS 5000
+#define MAP_STREAM_RADIUS 1 // in chunks; chunks this close to a player or the camera are loaded
+#define MAP_KEEP_RADIUS 2 // resident chunks are unloaded only after getting this far
+#define MAP_MAX_CHUNK_LOADS 16 // per update; spreads the cost of loading over frames
+#define MAP_NOT_RESIDENT 0xffffffffu
+#define OBJECT_NOT_LISTED 0xffffffffu
+#define BVH_BINS 16 // SAH candidates per axis
+#define BVH_LEAF_SIZE 4 // nodes with this many shapes or fewer aren't split
+#define BVH_MAX_LEAF_SIZE 32 // bigger nodes are split even when SAH says it doesn't pay off
+#define BVH_MAX_DEPTH 48
+#define SIM_SNAPSHOT_HISTORY 32 // snapshots that can be restored; enough to rewind NET_MAX_TICK_HISTORY ticks
+#define SIM_MAP_RESERVE (256ull * 1024 * 1024) // runtime map state; chunk states and a handle per map object
+#define VISIBILITY_ARENA_RESERVE (4ull * 1024 * 1024) // per polygon; vertices and their angles
+#define SIM_ARENA_COUNT 10
+#define REPLAY_MAGIC 0xde9a'c4a5'4e71'0f11llu
+#define REPLAY_VERSION 3
+#define REPLAY_PATH_SIZE 256
+#define REPLAY_BUF_SIZE (4 * NET_MAX_MESSAGE_SIZE) // recorder writes to disk when it fills up
+#define REPLAY_ITERATE_MS 100 // replay returns to the event loop this often so Ctrl+C works
 
 #define NET_DEFAULT_SEVER_PORT 21037
 #define NET_MAGIC_VALUE 0xfda0'dead'beef'1234llu
 #define NET_MAX_TICK_HISTORY (TICK_RATE * 2)
-#define NET_MAX_NETWORK_OBJECTS 16
+#define NET_MAX_NETWORK_OBJECTS 4096 // sanity limit for network slots received from the wire
+#define NET_MAX_USERS 1024
+#define NET_USER_TIMEOUT_MS 5000
+
+#define INTEREST_ENTER_RADIUS 600.f // objects closer than this to user's player are sent
+#define INTEREST_EXIT_RADIUS 750.f // relevant objects are dropped only after leaving this radius
+#define INTEREST_CELL_SIZE 256.f
+#define VISIBILITY_RANGE INTEREST_EXIT_RADIUS // visibility polygons are clipped to a square this far from the viewer
 #define NET_OLD_PROTOCOL 0
+#define NET_SNAPSHOT_REDUNDANCY 4 // server resends this many most recent states in every packet
+#define NET_INPUT_REDUNDANCY 16 // client resends this many most recent inputs in every packet
+#define NET_INPUT_DELAY_TICKS 2 // server buffers client inputs by this many ticks to absorb jitter
+#define NET_MAX_MESSAGE_SIZE (64 * 1024) // before fragmentation
+#define NET_MTU 1200 // max datagram size on the wire; safe for most paths (IPv6 min MTU is 1280)
+#define NET_MAX_FRAGMENTS 64 // per message; Net_Reassembly tracks them in a Uint64 mask
+#define NET_REASSEMBLY_SLOTS 16 // messages that can be reassembled at the same time
+#define NET_REASSEMBLY_TIMEOUT_MS 500
+#define NET_COMPLETED_MESSAGES 8 // per sender; late fragments of these recently reassembled messages are dropped
+#define NET_COMPLETED_SENDERS 32 // senders with a completed window; least recently completed is evicted
+#define NET_RING_SIZE 32 // packets; power of 2
+#define NET_BUF_SIZE (1024 * 1024) // payload construction buffer; bigger than NET_MAX_MESSAGE_SIZE so overflow is reported in Net_BufSend
+
+#define LOCKSTEP_FRAME_HISTORY 128 // frames the server can resend; clients further behind get a baseline
+#define LOCKSTEP_MAX_PLAYERS 32 // per frame; lockstep is meant for small lobbies
+#define LOCKSTEP_MAX_CATCHUP 4 // frames a client simulates per tick when it fell behind
+#define LOCKSTEP_SPAWNED 0x8000 // marks network slots of spawned players on the wire
+
+#define JITTER_MIN_DELAY 1.f // in ticks; we need at least one snapshot in the future to interpolate
+#define JITTER_MAX_DELAY (NET_MAX_TICK_HISTORY * 0.5f)
+#define JITTER_MAX_EXTRAPOLATION 4.f // in ticks; after that remote objects freeze in place
+#define JITTER_CONVERGED_ERROR 1.f // position error below which client is considered in sync
+
+// Animation clip built from Pack_ClipDef; texture rows are precomputed.
+typedef struct
+{
+    Uint32 frame_count;
+    float fps;
+    float fps_per_move;
+    bool hold[PACK_MAX_CLIP_FRAMES]; // object standing still stops on these
+    RngF tex_y[PACK_MAX_CLIP_FRAMES];
+} Sprite_Clip;
 
 typedef struct
 {
     SDL_Texture *tex;
     Uint32 tex_frames;
+    Sprite_Clip *clips; // 0 when not animated
+    Uint32 clip_count;
     Col_Vertices collision_vertices;
     Col_Normals collision_normals;
 } Sprite;
 
+// Image decoded by a worker thread; texture is created from it on the main thread.
+typedef struct
+{
+    Uint32 sprite_id;
+    const char *path;
+    SDL_Surface *surface; // written by worker before done is set
+    SDL_AtomicInt done;
+    bool uploaded; // main thread only
+} Sprite_LoadJob;
+
+typedef struct
+{
+    Uint32 keep_update_id; // last Map_Update that wanted this chunk resident
+    Uint32 resident_index; // index into map.resident_chunks; MAP_NOT_RESIDENT otherwise
+} Map_ChunkState;
+
+// Bounding volume hierarchy over static collision shapes (see de_bvh.c).
+typedef struct
+{
+    V2 min, max;
+} Bvh_Box;
+
+typedef struct
+{
+    Bvh_Box box;
+    Uint32 first; // leaf: first shape; interior: left child (right child is first + 1)
+    Uint16 count; // shapes in a leaf; 0 for interior nodes
+    Uint16 axis; // split axis of interior nodes; used to visit the near child first
+} Bvh_Node;
+
+typedef struct
+{
+    Col_Vertices verts; // world space convex quad, counterclockwise
+    Col_Normals normals; // outward
+    Bvh_Box box;
+    Uint32 id; // caller's index; map object index for the map's BVH
+} Bvh_Shape;
+
+typedef struct
+{
+    Bvh_Node *nodes; // nodes[0] is the root
+    Uint32 node_count;
+    Bvh_Shape *shapes; // ordered so every leaf is a contiguous range
+    Uint32 shape_count;
+    Uint32 depth;
+} Bvh;
+
+typedef struct
+{
+    V2 origin;
+    V2 dir; // doesn't have to be normalized; t is in units of dir
+    float max_t;
+} Bvh_Ray;
+
+typedef struct
+{
+    bool hit;
+    float t;
+    V2 p;
+    V2 normal; // of the shape's edge that was hit; zero when origin is inside a shape
+    Uint32 id;
+} Bvh_RayHit;
+
+// Star shaped polygon of what can be seen from viewer (see de_visibility.c).
+typedef struct
+{
+    bool valid;
+    V2 viewer;
+    float range;
+    Uint32 bvh_version; // map.bvh_version it was computed against
+    Arena arena; // verts and angles; reset on every recompute
+    V2 *verts; // counterclockwise around viewer
+    float *angles; // pseudo angle of every vertex around viewer; ascending
+    Uint32 count;
+    Uint32 capacity; // while computing; of the scratch arrays
+} Visibility_Polygon;
+
 typedef enum {
     ObjectFlag_Draw          = (1 << 0),
     ObjectFlag_Move          = (1 << 1),
     ObjectFlag_Collide       = (1 << 2),
 } Object_Flags;
 
+// Dense lists of objects that systems iterate (see de_object.c).
+typedef enum
+{
+    ObjectList_Movers, // ObjectFlag_Move
+    ObjectList_Colliders, // ObjectFlag_Collide
+    ObjectList_Drawables, // ObjectFlag_Draw
+    ObjectList_Animated, // sprite has clips
+    ObjectList_Count
+} Object_ListKind;
+
+typedef struct
+{
+    Arena arena; // part of the sim region
+    Uint32 *objects; // object_pool indices
+    Uint32 count;
+    Uint32 capacity;
+} Object_List;
+
 typedef struct
 {
     Uint32 flags;
@@ -35,19 +198,25 @@ typedef struct
     Uint32 sprite_id;
     ColorF sprite_color;
 
-    float sprite_animation_t;
-    Uint32 sprite_animation_index;
-    Uint32 sprite_frame_index;
+    Uint32 sprite_clip; // index into sprite's clips
+    Uint32 sprite_clip_step; // index into clip's frames
+    float sprite_clip_t; // progress to the next step
 
     // temp
     bool has_collision;
 } Object;
 
+// @info(mg) Object handle: low OBJECT_HANDLE_INDEX_BITS select a handle slot,
+//           high bits hold slot's generation. Generation is bumped every time
+//           an object is destroyed, so old handles to a reused slot resolve
+//           to the nil object. Handle 0 is the nil object.
+typedef Uint32 Object_Handle;
+
 typedef struct
 {
-    SDLNet_Address *address;
-    Uint16 port;
-} Net_User;
+    Uint32 dense_index; // index into object_pool; next free slot while on free list
+    Uint32 generation;
+} Object_HandleSlot;
 
 typedef enum
 {
@@ -55,6 +224,9 @@ typedef enum
     Tick_Cmd_Input,
     Tick_Cmd_NetworkObj,
     Tick_Cmd_ObjHistory,
+    Tick_Cmd_UserInfo,
+    Tick_Cmd_Lockstep,
+    Tick_Cmd_LockstepAck,
 } Tick_CommandKind;
 
 typedef struct
@@ -65,29 +237,264 @@ typedef struct
 
 typedef struct
 {
+    Uint64 tick_id;
     V2 move_dir;
     // action buttons etc will be added here
 } Tick_Input;
 
+// @info(mg) Recording is a header followed by a stream of records.
+//           Every record starts with a Uint8 Replay_RecordKind:
+//             Frame                               Map_Update ran
+//             UserAdd    Uint32 user_id, Uint16 port
+//             UserRemove Uint32 user_id
+//             Message    Uint32 user_id, Uint32 size, bytes   as received by the server
+//             Tick       V2 local move_dir, Uint64 state hash after the tick
+//           Like the asset pack it's stored in memory layout of the recording platform.
+typedef enum
+{
+    Replay_Rec_End,
+    Replay_Rec_Frame,
+    Replay_Rec_UserAdd,
+    Replay_Rec_UserRemove,
+    Replay_Rec_Message,
+    Replay_Rec_Tick,
+    Replay_Rec_Invalid,
+} Replay_RecordKind;
+
 typedef struct
 {
-    Object obj;
-    Uint32 network_slot;
-} Tick_NetworkObj;
+    Uint64 magic;
+    Uint32 version;
+    Uint32 tick_rate;
+    Uint64 start_tick_id;
+    Uint64 start_hash; // state after Game_Init; differs when map or assets don't match
+    Uint32 has_local_player;
+    Uint32 lockstep; // movers are moved in network slot order
+    char map_path[REPLAY_PATH_SIZE];
+} Replay_Header;
+static_assert(sizeof(Replay_Header) == 40 + REPLAY_PATH_SIZE);
+
+typedef struct
+{
+    Replay_RecordKind kind;
+    Uint32 user_id;
+    Uint16 port;
+    S8 message; // points into the mapped recording
+    V2 move_dir;
+    Uint64 hash;
+} Replay_Record;
 
 typedef struct
 {
-    Object objs[NET_MAX_NETWORK_OBJECTS];
+    SDLNet_Address *address; // 0 for users recreated by replay
+    Uint16 port;
+    Uint64 address_hash;
+    Uint64 last_receive_time;
+
+    // server side state of the connected client
+    Uint32 network_slot; // player object controlled by this user
+    Uint32 id; // unique for the whole session; identifies user in recordings
+
+    // inputs received from this user, slot = client tick_id % ArrayCount(inputs)
+    Tick_Input inputs[NET_MAX_TICK_HISTORY];
+    Uint64 newest_input_tick_id;
+    Uint64 applied_input_tick_id;
+    Tick_Input last_applied_input;
+
+    // client_tick_id = server tick_id + tick_offset
+    bool tick_offset_initialized;
+    Sint64 tick_offset;
+    Uint64 sync_input_tick_id; // applied_input_tick_id at the moment of (re)sync
+    Uint32 missing_streak;
+
+    Uint64 lockstep_ack_tick_id; // last lockstep frame the client simulated; 0 == it needs a baseline
+
+    // :: interest_bits ::
+    // Bitset of network slots relevant to this user (see de_interest.c).
+    // Sized for every possible slot; users live in net.user_arena.
+    Uint64 interest_bits[NET_MAX_NETWORK_OBJECTS / 64];
+    Uint32 interest_word_count; // words in use; the rest are zero
+    Uint32 interest_count;
+    Visibility_Polygon visibility; // around user's player; only with -fog
+
+    // stats
+    Uint64 input_received;
+    Uint64 input_late;
+    Uint64 input_missing;
+    Uint64 input_late_reported;
+    Uint64 input_missing_reported;
+} Net_User;
+
+typedef struct
+{
+    Uint64 tick_id;
+    Arena arena; // objs; reserved on first resize
+    Object *objs; // indexed by network slot; flags == 0 means empty slot
+    Uint32 obj_count;
+    Uint32 obj_capacity;
 } Tick_NetworkObjState;
 
 typedef struct
 {
+    SDLNet_Address *address; // ref counted; released by the consumer
+    Uint16 port;
+    Uint32 size;
+    Uint8 data[NET_MAX_MESSAGE_SIZE];
+} Net_Packet;
+
+// Message that arrived in multiple fragments; owned by the network thread.
+typedef struct
+{
+    SDLNet_Address *address; // 0 == unused slot
+    Uint16 port;
+    Uint32 message_id;
+    Uint32 fragment_count;
+    Uint64 received_mask;
+    Uint32 received_count;
+    Uint32 size; // known after the last fragment arrives
+    Uint64 first_receive_time;
+    Uint8 data[NET_MAX_MESSAGE_SIZE];
+} Net_Reassembly;
+
+// Ids of messages recently reassembled from one sender; owned by the network thread.
+// Without it a late duplicate fragment would start a new reassembly that can only time out.
+typedef struct
+{
+    SDLNet_Address *address; // 0 == unused slot
+    Uint16 port;
+    Uint64 last_complete_time;
+    Uint32 message_ids[NET_COMPLETED_MESSAGES]; // ring buffer
+    Uint32 message_count;
+    Uint32 next_index;
+} Net_Completed;
+
+// Single producer, single consumer queue of packets between
+// the network thread and the main thread.
+typedef struct
+{
+    Net_Packet *packets; // NET_RING_SIZE; from net.arena
+    SDL_AtomicU32 write; // advanced by producer
+    SDL_AtomicU32 read; // advanced by consumer
+    Uint64 dropped; // written by producer only
+} Net_PacketRing;
+
+// Uniform grid of network objects, cells are hashed into buckets.
+// Rebuilt from frame_arena every time snapshots are sent.
+typedef struct
+{
+    Uint32 bucket_count; // power of 2
+    Uint32 *bucket_start; // bucket_count + 1 entries; slots of bucket b are [start[b], start[b+1])
+    Uint32 *slots;
+} Interest_Grid;
+
+// Simulation state that lives in AppState fields instead of the sim region.
+typedef struct
+{
+    Uint64 tick_id;
+    Uint32 object_count;
+    Uint32 object_handle_count;
+    Uint32 object_free_handle;
+    Uint32 object_list_counts[ObjectList_Count];
+    Uint32 network_slot_count;
+    Uint32 player_network_slot;
+    Uint32 map_resident_count;
+    Uint32 map_resident_object_count;
+    Uint32 map_update_id;
+    Uint32 map_next_spawn;
+} Sim_Scalars;
+
+typedef struct
+{
+    Uint64 id; // 0 == unused
+    Sim_Scalars scalars;
+    // :: undo ::
+    // Pages that changed between this snapshot and the next one,
+    // with their contents at this snapshot. Empty for the newest snapshot
+    // (its contents are in sim.shadow).
+    Arena undo;
+    Uint32 *undo_pages;
+    Uint8 *undo_data;
+    Uint32 undo_count;
+} Sim_Snapshot;
+
+typedef struct
+{
+    Uint32 network_slot;
+    V2 move_dir; // quantized (see Net_QuantizeUnit) so every peer applies the same value
+    bool spawned; // player was created right before this tick
+    V2 spawn_p;
+    Object_Handle handle; // server only; detects spawns when slots are reused
+} Lockstep_Entry;
+
+typedef struct
+{
+    Uint64 tick_id; // 0 == empty
+    Uint32 hash; // Lockstep_StateHash after the tick
+    Uint32 entry_count;
+    Lockstep_Entry entries[LOCKSTEP_MAX_PLAYERS]; // every player that existed during the tick
+} Lockstep_Frame;
+
+typedef struct
+{
+    Uint64 tick_id;
+    Arena arena; // p; reserved on first sample
+    V2 *p; // indexed by network slot
+    Uint32 count;
+    Uint32 capacity;
+} Jitter_ErrorSample;
+
+typedef struct
+{
+    // snapshots received from the server, slot = tick_id % ArrayCount(states)
     Tick_NetworkObjState states[NET_MAX_TICK_HISTORY];
-} Tick_NetworkObjHistory;
+    Uint64 latest_tick_id;
+
+    // :: clock_offset ::
+    // server_tick ~= local_tick + clock_offset
+    // local_tick is derived from frame_time so it's fractional
+    bool clock_initialized;
+    double clock_offset;
+    float jitter; // smoothed packet arrival jitter in ticks
+
+    // remote objects are displayed `delay` ticks in the past,
+    // delay follows target_delay which adapts to measured jitter
+    float delay;
+    float target_delay;
+    double playback_tick;
+
+    // :: error_samples ::
+    // Positions displayed at integer playback ticks, compared against
+    // the real snapshot for that tick once it arrives.
+    Jitter_ErrorSample error_samples[NET_MAX_TICK_HISTORY];
+    Uint64 last_sampled_tick_id;
+
+    // stats
+    Uint64 received_snapshots;
+    Uint64 extrapolated_frames;
+    Uint64 starved_frames;
+    Uint64 received_bytes;
+    float max_position_error; // since last report
+    float sum_position_error;
+    Uint32 position_error_count;
+    Uint64 diverged_at_ms; // 0 if converged
+    Uint64 last_convergence_ms; // duration of the last divergence
+} Jitter_Buffer;
 
 typedef struct
 {
+    // memory
+    Arena perm; // AppState itself and state that lives until exit
+    Arena frame_arena; // scratch; reset at the start of every frame
+    Arena tick_arena; // scratch; reset at the start of every tick
+    Arena object_arena; // object_pool; arenas down to sprite_arena hold one pool each
+    Arena object_dense_handle_arena;
+    Arena object_handle_arena;
+    Arena network_handle_arena;
+    Arena object_list_index_arena;
+    Arena sprite_arena;
+
     // SDL, window stuff
+    bool headless; // dedicated server; no window, renderer or textures
     SDL_Window* window;
     SDL_Renderer* renderer;
     int window_width, window_height;
@@ -108,24 +515,167 @@ typedef struct
     Tick_NetworkObjState netobj_states[NET_MAX_TICK_HISTORY];
     Uint64 netobj_state_next;
 
+    // client side buffer of server snapshots
+    Jitter_Buffer jitter;
+
+    // deterministic lockstep (see de_lockstep.c)
+    struct
+    {
+        bool enabled; // -lockstep on the server; clients switch when they receive a frame
+        Lockstep_Frame frames[LOCKSTEP_FRAME_HISTORY]; // slot = tick_id % ArrayCount(frames)
+        Uint64 newest_tick_id; // recorded (server) or received (client)
+        Uint64 sim_tick_id; // client: last simulated frame; 0 == waiting for a baseline
+
+        // stats
+        Uint64 bytes; // lockstep payload sent (server) or received (client) since last report
+        Uint64 ticks; // simulated by the client since last report
+        Uint64 baselines; // sent or applied
+        Uint64 desyncs;
+    } lockstep;
+
     // time
     Uint64 frame_id;
     Uint64 frame_time;
     float dt;
     Uint64 tick_id;
     float tick_dt_accumulator;
+    Uint32 tick_rate; // ticks per second; client receives it from the server
+    float time_step; // 1 / tick_rate
+
+    // dedicated server tick pacing
+    struct
+    {
+        Uint64 next_tick_ns; // deadline of the next tick
+        Uint64 last_report_ns;
+        Uint64 tick_count; // since last report
+        Uint64 skipped_ticks;
+        Uint64 late_sum_ns; // how much later than deadline ticks started
+        Uint64 late_max_ns;
+        Uint64 work_sum_ns; // how long ticks took
+        Uint64 work_max_ns;
+    } dedicated;
+
+    // :: sim ::
+    // Everything ticks modify lives in one write-watched region: object,
+    // handle, object list and network slot pools and the map's runtime state. Snapshots
+    // copy only pages written since the previous snapshot (see de_sim.c).
+    struct
+    {
+        Os_WriteWatch watch;
+        Arena *arenas[SIM_ARENA_COUNT]; // carved out of watch; in order
+        Uint64 tracked[SIM_ARENA_COUNT]; // committed bytes of each arena that shadow covers
+        Uint8 *shadow; // copy of the region at the newest snapshot; same layout
+        Sim_Snapshot snapshots[SIM_SNAPSHOT_HISTORY]; // ring
+        Uint32 newest; // index into snapshots
+        Uint32 snapshot_count;
+        Uint64 next_id;
+
+        // stats of the last Sim_Save / Sim_Restore
+        Uint32 snapshot_pages;
+        Uint32 restore_pages;
+    } sim;
 
     // objects
-    Object object_pool[4096];
+    // object_pool is dense: [0, object_count) are alive, destroy swap-removes.
+    // Handles stay valid across moves thanks to object_handles indirection.
+    Object *object_pool;
     Uint32 object_count;
-    Uint32 network_ids[NET_MAX_NETWORK_OBJECTS];
+    Uint32 object_capacity;
+    Uint32 *object_dense_handles; // object_pool index -> handle slot index; object_capacity elements
+    Object_HandleSlot *object_handles;
+    Uint32 object_handle_count; // handle slots that were ever used
+    Uint32 object_handle_capacity;
+    Uint32 object_free_handle; // head of free list; 0 == empty (slot 0 is nil and never freed)
+    // :: object_lists ::
+    // Systems iterate these instead of the whole pool; kept in sync by
+    // Object_Create, Object_Destroy, Object_SetFlags and Object_Assign.
+    Object_List object_lists[ObjectList_Count];
+    Uint32 *object_list_index; // [object_pool index * ObjectList_Count + kind] -> position in that list or OBJECT_NOT_LISTED; object_capacity * ObjectList_Count elements
+    Object_Handle *network_handles; // network slot -> object handle; 0 == free slot
+    Uint32 network_slot_count;
+    Uint32 network_slot_capacity;
     Uint32 player_network_slot;
+    bool has_local_player; // server that isn't dedicated; replay takes it from the recording
 
     // sprites
-    Sprite sprite_pool[32];
+    Sprite *sprite_pool;
     Uint32 sprite_count;
-    Uint32 sprite_overlay_id;
-    Uint32 sprite_dude_id; // @todo better organization
+    Uint32 sprite_capacity;
+    Uint32 sprite_ids[PackSprite_Count]; // sprites listed in pack_sprite_defs
+
+    // asynchronous sprite loading
+    struct
+    {
+        bool sync; // -syncload: decode on the main thread like before; for comparison
+        bool skip_pack; // -nopack: ignore baked asset pack; for comparison
+        bool from_pack; // sprites were created from the baked asset pack
+        SDL_Thread *workers[SPRITE_MAX_WORKERS];
+        Uint32 worker_count;
+        SDL_Semaphore *semaphore; // signaled once per job; once per worker on quit
+        SDL_AtomicInt quit;
+        Sprite_LoadJob *jobs; // SPRITE_MAX_COUNT; from perm when workers start
+        SDL_AtomicInt job_count; // published by main thread
+        SDL_AtomicInt next_job; // claimed by workers
+        Uint32 first_pending; // jobs before it are uploaded
+        Uint64 start_ns; // Game_Init start; for startup timing
+        bool reported;
+    } sprite_load;
+
+    // streamed map (see de_map.c)
+    struct
+    {
+        const char *path; // -map
+        Os_MappedFile file;
+        S8 data; // map file contents; mapped file or default level baked into map.arena
+        Arena arena; // runtime chunk state; sized when the map is opened
+        Map_Header *header;
+        Map_Chunk *chunks;
+        Map_Object *objects;
+        V2 *spawns;
+        Uint32 *shape_sprite_ids;
+        Map_ChunkState *chunk_states;
+        Object_Handle *handles; // per map object; valid while its chunk is resident
+        Uint32 *resident_chunks; // dense list of resident chunk indices
+        Uint32 resident_count;
+        Uint32 resident_object_count;
+        Uint32 update_id;
+        Uint32 next_spawn;
+        Uint32 loaded_chunks; // since last Map_ReportStats
+        Uint32 unloaded_chunks;
+
+        // collision shapes of all map objects, resident or not;
+        // built once in Map_Open and never modified
+        Arena bvh_arena;
+        Bvh bvh;
+        Uint32 bvh_version; // bumped every time bvh is built; invalidates visibility polygons
+    } map;
+
+    // input recording and replay (see de_replay.c)
+    struct
+    {
+        const char *record_path; // -record
+        const char *play_path; // -replay
+        SDL_IOStream *record_io; // 0 when not recording
+        Uint8 *buf; // REPLAY_BUF_SIZE; from perm
+        Uint32 buf_used;
+        Uint64 recorded_ticks;
+        Uint64 recorded_bytes;
+
+        // playback
+        bool playing;
+        Os_MappedFile file;
+        Uint64 read_offset;
+        Uint64 start_ns;
+        Uint64 frames;
+        Uint64 ticks;
+        Uint64 messages;
+        Uint64 tick_sum_ns; // Tick_AdvanceSimulation only
+        Uint64 tick_max_ns;
+        Uint64 hash_sum_ns;
+        Uint64 mismatched_ticks;
+        Uint64 first_mismatch_tick_id;
+        bool start_mismatch;
+    } replay;
 
     // camera
     V2 camera_p;
@@ -141,25 +691,71 @@ typedef struct
         bool is_server;
         SDLNet_DatagramSocket *socket;
 
-        Uint8 buf[1024 * 1024 * 1]; // 1 MB scratch buffer for network payload construction
+        Uint8 *buf; // scratch buffer for network payload construction; from frame_arena
+        Uint32 buf_capacity;
         Uint32 buf_used;
         bool buf_err; // true on overflows
 
-        Net_User users[16];
+        Arena arena; // rings and reassembly slots; from Net_Init until Net_Deinit
+        Arena user_arena; // users; reserved for NET_MAX_USERS on first join
+        Arena user_table_arena;
+        Net_User *users;
         Uint32 user_count;
+        Uint32 user_capacity;
+        Uint32 next_user_id;
+        // :: user_table ::
+        // Open addressing hash table keyed by address+port.
+        // Stores user index + 1; 0 == empty. Capacity is a power of 2.
+        Uint32 *user_table;
+        Uint32 user_table_capacity;
         Net_User server_user;
+        Uint16 port; // server listens on it, client sends to it
+
+        Uint64 last_send_tick_id;
+        Uint64 work_ns; // server: receive, ticks and send of the last frame; sent to users in UserInfo
+        Uint32 server_work_us; // client: server's work_ns from the newest UserInfo
+
+        // interest management
+        Interest_Grid interest_grid;
+        Uint64 interest_sent_bytes; // since last report
+        Uint64 interest_saved_bytes;
+        bool fog; // -fog; objects hidden behind walls aren't relevant
+        Uint64 visibility_computed; // since last report
+        Uint64 visibility_reused;
+        Uint64 visibility_ns;
+
+        // network thread owns the socket
+        SDL_Thread *thread;
+        SDL_AtomicInt thread_quit;
+        Net_PacketRing recv_ring; // network thread -> main thread, validated & reassembled
+        Net_PacketRing send_ring; // main thread -> network thread, split into fragments by network thread
+
+        // fragmentation; owned by network thread, stats are only read by main thread
+        Uint32 send_message_id;
+        Net_Reassembly *reassembly; // NET_REASSEMBLY_SLOTS; from net.arena
+        Net_Completed completed[NET_COMPLETED_SENDERS];
+        Uint64 fragmented_messages; // messages larger than NET_MTU that were split
+        Uint64 sent_fragments;
+        Uint64 reassembled_messages;
+        Uint64 reassembly_timeouts; // incomplete messages dropped after timeout or eviction
+        Uint64 late_fragments; // duplicates of already reassembled messages
     } net;
 
     // debug
     struct
     {
+        bool net_stats; // log network stats once per second
+        bool map_stats; // log every chunk streaming update
+        Uint64 net_stats_last_report;
+
         float fixed_dt;
         bool single_tick_stepping;
         bool unpause_one_tick;
 
         bool draw_collision_box;
-        float collision_sprite_animation_t;
-        Uint32 collision_sprite_frame_index;
+        float collision_sprite_clip_t;
+        Uint32 collision_sprite_clip_step;
+        Visibility_Polygon visibility; // around the camera; drawn with the collision overlay
 
         bool draw_texture_box;
     } debug;
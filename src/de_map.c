@@ -0,0 +1,360 @@
+//
+// Map streaming
+// Map file stays mapped for the whole session. Objects of a chunk exist
+// only while that chunk is resident: chunks around players (server) and
+// the camera are loaded, chunks far from all of them are unloaded, so
+// big maps are neither fully resident nor simulated.
+//
+static bool Map_Validate(S8 data)
+{
+    if (data.size < sizeof(Map_Header))
+        return false;
+
+    Map_Header *header = (Map_Header *)data.str;
+    if (header->magic != MAP_MAGIC ||
+        header->version != MAP_VERSION ||
+        header->file_size != data.size ||
+        !(header->chunk_size > 0.f) ||
+        !header->chunks_x || !header->chunks_y ||
+        (Uint64)header->chunks_x * header->chunks_y > MAP_MAX_CHUNKS ||
+        header->shape_count > MAP_MAX_SHAPES)
+    {
+        return false;
+    }
+
+    Uint64 chunk_count = (Uint64)header->chunks_x * header->chunks_y;
+    Uint64 expected_size = (sizeof(Map_Header) +
+                            sizeof(V2) * header->shape_count +
+                            sizeof(Map_Chunk) * chunk_count +
+                            sizeof(Map_Object) * header->object_count +
+                            sizeof(V2) * header->spawn_count);
+    if (expected_size != data.size)
+        return false;
+
+    Map_Chunk *chunks = (Map_Chunk *)(data.str + sizeof(Map_Header) + sizeof(V2) * header->shape_count);
+    ForU64(i, chunk_count)
+    {
+        Map_Chunk *chunk = chunks + i;
+        if ((Uint64)chunk->first_object + chunk->object_count > header->object_count ||
+            (Uint64)chunk->first_spawn + chunk->spawn_count > header->spawn_count)
+        {
+            return false;
+        }
+    }
+
+    Map_Object *objects = (Map_Object *)(chunks + chunk_count);
+    ForU32(i, header->object_count)
+    {
+        Map_Object *obj = objects + i;
+        Uint32 index_limit = (obj->kind == MapObject_Wall ? header->shape_count : PackSprite_Count);
+        if (obj->kind >= MapObject_Count || obj->index >= index_limit)
+            return false;
+    }
+    return true;
+}
+
+// Bytes of map.arena needed for a map; copy_size is the size of
+// the map itself when it's baked in memory instead of mapped.
+static Uint64 Map_RuntimeSize(Map_Header *header, Uint64 copy_size)
+{
+    Uint64 chunk_count = (Uint64)header->chunks_x * header->chunks_y;
+    return (copy_size +
+            sizeof(Uint32) * header->shape_count +
+            sizeof(Map_ChunkState) * chunk_count +
+            sizeof(Uint32) * chunk_count +
+            sizeof(Object_Handle) * header->object_count +
+            ARENA_DEFAULT_ALIGN * 8);
+}
+
+// Collision shapes of all map objects, not only resident ones, so
+// queries don't depend on where players are (or on the peer).
+static void Map_BuildBvh(AppState *app)
+{
+    Uint64 start_ns = SDL_GetTicksNS();
+    Map_Header *header = app->map.header;
+    Uint64 reserve = ((Uint64)header->object_count * (sizeof(Bvh_Shape) + 2 * sizeof(Bvh_Node)) +
+                      ARENA_COMMIT_BLOCK);
+    if (!Arena_Init(&app->map.bvh_arena, "map bvh", reserve))
+    {
+        LogError(LogCat_Map, "Failed to reserve %llu bytes for map BVH", reserve);
+        return;
+    }
+
+    Bvh_Shape *shapes = Arena_PushArrayNoZero(&app->map.bvh_arena, Bvh_Shape, header->object_count);
+    Assert(shapes || !header->object_count);
+    ForU32(i, header->object_count)
+    {
+        Map_Object *src = app->map.objects + i;
+        Uint32 sprite_id = (src->kind == MapObject_Wall ?
+                            app->map.shape_sprite_ids[src->index] :
+                            app->sprite_ids[src->index]);
+        Sprite *sprite = Sprite_Get(app, sprite_id);
+
+        Col_Vertices verts = sprite->collision_vertices;
+        Vertices_Offset(verts.arr, ArrayCount(verts.arr), src->p);
+        shapes[i] = Bvh_MakeShape(verts, sprite->collision_normals, i);
+    }
+
+    app->map.bvh = Bvh_Build(&app->map.bvh_arena, shapes, header->object_count);
+    app->map.bvh_version += 1;
+    LogInfo(LogCat_Map, "BVH: %u shapes, %u nodes, depth %u; built in %.2f ms",
+                        app->map.bvh.shape_count, app->map.bvh.node_count, app->map.bvh.depth,
+                        (double)(SDL_GetTicksNS() - start_ns) / (double)SDL_NS_PER_MS);
+}
+
+// Maps app->map.path; falls back to the default level baked in memory.
+// Sprites have to be created before calling this (props use app->sprite_ids).
+static void Map_Open(AppState *app)
+{
+    Uint64 start_ns = SDL_GetTicksNS();
+    const char *source = app->map.path;
+
+    app->map.file = Os_MapFile(app->map.path);
+    app->map.data = S8_Make(app->map.file.base, app->map.file.size);
+    if (!app->map.file.base)
+    {
+        LogWarn(LogCat_Map, "%s not found; using default level (run packer to bake it)", app->map.path);
+    }
+    else if (!Map_Validate(app->map.data))
+    {
+        LogWarn(LogCat_Map, "%s is invalid or out of date; using default level (run packer to rebake it)", app->map.path);
+        Os_UnmapFile(&app->map.file);
+        app->map.data = (S8){0};
+    }
+    else if (Map_RuntimeSize((Map_Header *)app->map.data.str, 0) > app->map.arena.reserved)
+    {
+        LogWarn(LogCat_Map, "%s needs more runtime state than SIM_MAP_RESERVE; using default level", app->map.path);
+        Os_UnmapFile(&app->map.file);
+        app->map.data = (S8){0};
+    }
+
+    S8 baked = {0};
+    if (!app->map.data.size)
+    {
+        source = "default level";
+        baked = Map_BakeDefaultLevel(&app->frame_arena);
+        Assert(Map_Validate(baked));
+    }
+
+    S8 data = (baked.size ? baked : app->map.data);
+    Map_Header *header = (Map_Header *)data.str;
+    Uint32 chunk_count = header->chunks_x * header->chunks_y;
+
+    // runtime state lives in the sim region so snapshots cover streaming
+    Assert(Map_RuntimeSize(header, baked.size) <= app->map.arena.reserved);
+    if (baked.size)
+    {
+        Uint8 *copy = Arena_PushNoZero(&app->map.arena, baked.size, ARENA_DEFAULT_ALIGN);
+        Assert(copy);
+        memcpy(copy, baked.str, baked.size);
+        app->map.data = S8_Make(copy, baked.size);
+        header = (Map_Header *)copy;
+    }
+
+    app->map.header = header;
+    V2 *shapes = (V2 *)(app->map.data.str + sizeof(Map_Header));
+    app->map.chunks = (Map_Chunk *)(shapes + header->shape_count);
+    app->map.objects = (Map_Object *)(app->map.chunks + chunk_count);
+    app->map.spawns = (V2 *)(app->map.objects + header->object_count);
+
+    app->map.shape_sprite_ids = Arena_PushArray(&app->map.arena, Uint32, header->shape_count);
+    app->map.chunk_states = Arena_PushArrayNoZero(&app->map.arena, Map_ChunkState, chunk_count);
+    app->map.resident_chunks = Arena_PushArrayNoZero(&app->map.arena, Uint32, chunk_count);
+    app->map.handles = Arena_PushArray(&app->map.arena, Object_Handle, header->object_count);
+    Assert(app->map.chunk_states && app->map.resident_chunks && app->map.handles);
+
+    ForU32(i, chunk_count)
+    {
+        app->map.chunk_states[i].keep_update_id = 0;
+        app->map.chunk_states[i].resident_index = MAP_NOT_RESIDENT;
+    }
+
+    // walls of the same size share a collision-only sprite
+    ForU32(i, header->shape_count)
+    {
+        Sprite *sprite = Sprite_CreateNoTex(app, Vertices_FromRect((V2){0}, shapes[i]));
+        app->map.shape_sprite_ids[i] = Sprite_IdFromPointer(app, sprite);
+    }
+
+    Map_BuildBvh(app);
+
+    LogInfo(LogCat_Map, "%s: %u objects, %u spawns in %ux%u chunks of %.0f; opened in %.2f ms",
+                        source, header->object_count, header->spawn_count,
+                        header->chunks_x, header->chunks_y, header->chunk_size,
+                        (double)(SDL_GetTicksNS() - start_ns) / (double)SDL_NS_PER_MS);
+}
+
+static void Map_Close(AppState *app)
+{
+    Os_UnmapFile(&app->map.file);
+    Arena_Release(&app->map.arena);
+    Arena_Release(&app->map.bvh_arena);
+    app->map.bvh = (Bvh){0};
+    app->map.header = 0;
+    app->map.data = (S8){0};
+}
+
+static void Map_LoadChunk(AppState *app, Uint32 chunk_index)
+{
+    Map_Chunk *chunk = app->map.chunks + chunk_index;
+    Uint32 created_count = 0; // objects past the object pool capacity are skipped
+    ForU32(i, chunk->object_count)
+    {
+        Uint32 object_index = chunk->first_object + i;
+        Map_Object *src = app->map.objects + object_index;
+        Uint32 sprite_id = (src->kind == MapObject_Wall ?
+                            app->map.shape_sprite_ids[src->index] :
+                            app->sprite_ids[src->index]);
+
+        Object *obj = Object_Create(app, sprite_id, ObjectFlag_Draw|ObjectFlag_Collide);
+        if (Object_IsZero(app, obj))
+        {
+            app->map.handles[object_index] = 0;
+            continue;
+        }
+        obj->p = src->p;
+        obj->prev_p = src->p;
+        obj->sprite_color = Map_UnpackColor(src->color);
+        app->map.handles[object_index] = Object_HandleFromPointer(app, obj);
+        created_count += 1;
+    }
+
+    Map_ChunkState *state = app->map.chunk_states + chunk_index;
+    state->resident_index = app->map.resident_count;
+    app->map.resident_chunks[app->map.resident_count] = chunk_index;
+    app->map.resident_count += 1;
+    app->map.resident_object_count += created_count;
+    app->map.loaded_chunks += 1;
+}
+
+static void Map_UnloadChunk(AppState *app, Uint32 chunk_index)
+{
+    Map_Chunk *chunk = app->map.chunks + chunk_index;
+    Uint32 destroyed_count = 0;
+    ForU32(i, chunk->object_count)
+    {
+        Object_Handle *handle = app->map.handles + chunk->first_object + i;
+        if (!*handle) continue;
+        Object_Destroy(app, *handle);
+        *handle = 0;
+        destroyed_count += 1;
+    }
+
+    // swap-remove from resident list
+    Map_ChunkState *state = app->map.chunk_states + chunk_index;
+    Uint32 last = app->map.resident_count - 1;
+    Uint32 moved_chunk = app->map.resident_chunks[last];
+    app->map.resident_chunks[state->resident_index] = moved_chunk;
+    app->map.chunk_states[moved_chunk].resident_index = state->resident_index;
+    app->map.resident_count -= 1;
+    state->resident_index = MAP_NOT_RESIDENT;
+
+    app->map.resident_object_count -= destroyed_count;
+    app->map.unloaded_chunks += 1;
+}
+
+// Marks chunks around p to be kept and loads missing ones close to it.
+static void Map_StreamAround(AppState *app, V2 p, Uint32 *load_budget)
+{
+    Map_Header *header = app->map.header;
+    Sint32 center_x = Map_ChunkCoord(p.x, header->chunk_size) - header->chunk_min_x;
+    Sint32 center_y = Map_ChunkCoord(p.y, header->chunk_size) - header->chunk_min_y;
+
+    Sint32 min_x = Max(center_x - MAP_KEEP_RADIUS, 0);
+    Sint32 min_y = Max(center_y - MAP_KEEP_RADIUS, 0);
+    Sint32 max_x = Min(center_x + MAP_KEEP_RADIUS, (Sint32)header->chunks_x - 1);
+    Sint32 max_y = Min(center_y + MAP_KEEP_RADIUS, (Sint32)header->chunks_y - 1);
+
+    for (Sint32 y = min_y; y <= max_y; y += 1)
+    {
+        for (Sint32 x = min_x; x <= max_x; x += 1)
+        {
+            Uint32 chunk_index = (Uint32)y * header->chunks_x + (Uint32)x;
+            Map_ChunkState *state = app->map.chunk_states + chunk_index;
+            state->keep_update_id = app->map.update_id;
+
+            bool in_stream_radius = (x >= center_x - MAP_STREAM_RADIUS && x <= center_x + MAP_STREAM_RADIUS &&
+                                     y >= center_y - MAP_STREAM_RADIUS && y <= center_y + MAP_STREAM_RADIUS);
+            if (in_stream_radius && state->resident_index == MAP_NOT_RESIDENT && *load_budget)
+            {
+                *load_budget -= 1;
+                Map_LoadChunk(app, chunk_index);
+            }
+        }
+    }
+}
+
+static void Map_ReportStats(AppState *app, Uint64 ns)
+{
+    LogInfo(LogCat_Map, "+%u -%u chunks in %.3f ms; resident %u/%u chunks, %u/%u objects",
+                        app->map.loaded_chunks, app->map.unloaded_chunks, (double)ns / (double)SDL_NS_PER_MS,
+                        app->map.resident_count, app->map.header->chunks_x * app->map.header->chunks_y,
+                        app->map.resident_object_count, app->map.header->object_count);
+    app->map.loaded_chunks = 0;
+    app->map.unloaded_chunks = 0;
+}
+
+// Streams chunks around the camera (client) or around every player (server).
+// Lockstep clients simulate every player, so they stream around them too.
+// Has to run between ticks; destroying objects moves them in object_pool.
+static void Map_Update(AppState *app, Uint32 max_chunk_loads)
+{
+    if (!app->map.header)
+        return;
+
+    Uint64 start_ns = SDL_GetTicksNS();
+    app->map.update_id += 1;
+    Uint32 load_budget = max_chunk_loads;
+
+    if (app->net.is_server)
+    {
+        // camera follows the local player, so server streams around players only;
+        // that keeps streaming a function of simulation state which replays rely on
+        Object *player = Object_Network(app, app->player_network_slot);
+        if (app->has_local_player && !Object_IsZero(app, player))
+            Map_StreamAround(app, player->p, &load_budget);
+
+        ForU32(user_index, app->net.user_count)
+        {
+            Object *user_player = Object_Network(app, app->net.users[user_index].network_slot);
+            if (!Object_IsZero(app, user_player))
+                Map_StreamAround(app, user_player->p, &load_budget);
+        }
+    }
+    else
+    {
+        Map_StreamAround(app, app->camera_p, &load_budget);
+
+        if (app->lockstep.enabled)
+        {
+            ForU32(slot, app->network_slot_count)
+            {
+                Object *player = Object_Network(app, slot);
+                if (!Object_IsZero(app, player))
+                    Map_StreamAround(app, player->p, &load_budget);
+            }
+        }
+    }
+
+    // iterate backwards; unloading swap-removes from resident list
+    for (Uint32 i = app->map.resident_count; i > 0; i -= 1)
+    {
+        Uint32 chunk_index = app->map.resident_chunks[i - 1];
+        if (app->map.chunk_states[chunk_index].keep_update_id != app->map.update_id)
+            Map_UnloadChunk(app, chunk_index);
+    }
+
+    if (app->debug.map_stats && (app->map.loaded_chunks || app->map.unloaded_chunks))
+        Map_ReportStats(app, SDL_GetTicksNS() - start_ns);
+}
+
+// Spawn points are handed out round robin.
+static V2 Map_NextSpawn(AppState *app)
+{
+    if (!app->map.header || !app->map.header->spawn_count)
+        return (V2){0};
+
+    V2 result = app->map.spawns[app->map.next_spawn % app->map.header->spawn_count];
+    app->map.next_spawn += 1;
+    return result;
+}
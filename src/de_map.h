@@ -0,0 +1,275 @@
+//
+// Map format
+// Static geometry, props and spawn points bucketed into square chunks:
+//   Map_Header
+//   V2 shapes[shape_count]          wall sizes; one collision-only sprite each
+//   Map_Chunk chunks[chunks_x*chunks_y] row major, starting at chunk_min
+//   Map_Object objects[object_count] grouped by chunk
+//   V2 spawns[spawn_count]           grouped by chunk
+// Game maps the file and streams chunks in and out (see de_map.c).
+// Like the asset pack it's stored in memory layout of the baking platform.
+//
+#define MAP_PATH "level.map" // relative to build directory, next to the executables
+#define MAP_MAGIC 0xde9a'c4a5'3a90'0f11llu
+#define MAP_VERSION 1
+#define MAP_CHUNK_SIZE 512.f // default for baked maps; objects should be smaller than a chunk
+#define MAP_MAX_CHUNKS (1u << 20)
+#define MAP_MAX_SHAPES 512 // every shape takes a sprite
+
+typedef struct
+{
+    Uint64 magic;
+    Uint32 version;
+    float chunk_size;
+    Sint32 chunk_min_x, chunk_min_y;
+    Uint32 chunks_x, chunks_y;
+    Uint32 shape_count;
+    Uint32 object_count;
+    Uint32 spawn_count;
+    Uint32 pad;
+    Uint64 file_size;
+} Map_Header;
+
+typedef struct
+{
+    Uint32 first_object, object_count;
+    Uint32 first_spawn, spawn_count;
+} Map_Chunk;
+
+typedef enum
+{
+    MapObject_Wall, // index is a shape
+    MapObject_Prop, // index is Pack_SpriteKind
+    MapObject_Count
+} Map_ObjectKind;
+
+typedef struct
+{
+    Uint16 kind;
+    Uint16 index;
+    Uint32 color; // RGBA8, R in lowest byte
+    V2 p;
+} Map_Object;
+
+static_assert(sizeof(Map_Header) == 56);
+static_assert(sizeof(Map_Object) == 16);
+
+static Uint32 Map_PackColor(ColorF c)
+{
+    float channels[4] = {c.r, c.g, c.b, c.a};
+    Uint32 result = 0;
+    ForArray(i, channels)
+    {
+        Uint32 byte = (Uint32)(Clamp(0.f, 1.f, channels[i]) * 255.f + 0.5f);
+        result |= byte << (i * 8);
+    }
+    return result;
+}
+static ColorF Map_UnpackColor(Uint32 c)
+{
+    float inv = 1.f / 255.f;
+    return ColorF_RGBA((float)(c & 0xff) * inv, (float)((c >> 8) & 0xff) * inv,
+                       (float)((c >> 16) & 0xff) * inv, (float)(c >> 24) * inv);
+}
+
+//
+// Baking
+// Used offline by the packer and at startup when no map file exists.
+//
+typedef struct
+{
+    Map_ObjectKind kind;
+    Uint32 sprite; // Pack_SpriteKind for props
+    V2 dim; // walls
+    V2 p;
+    ColorF color;
+} Map_BakeObject;
+
+static Sint32 Map_ChunkCoord(float value, float chunk_size)
+{
+    return (Sint32)FloorF(value / chunk_size);
+}
+
+// Returns map file contents allocated from arena; empty on failure.
+static S8 Map_Bake(Arena *arena, float chunk_size,
+                   Map_BakeObject *objects, Uint32 object_count,
+                   V2 *spawns, Uint32 spawn_count)
+{
+    S8 result = {0};
+
+    // chunk bounds
+    Sint32 min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+    ForU32(i, object_count + spawn_count)
+    {
+        V2 p = (i < object_count ? objects[i].p : spawns[i - object_count]);
+        Sint32 x = Map_ChunkCoord(p.x, chunk_size);
+        Sint32 y = Map_ChunkCoord(p.y, chunk_size);
+        if (!i || x < min_x) min_x = x;
+        if (!i || y < min_y) min_y = y;
+        if (!i || x > max_x) max_x = x;
+        if (!i || y > max_y) max_y = y;
+    }
+    Uint64 chunks_x = (Uint64)(max_x - min_x) + 1;
+    Uint64 chunks_y = (Uint64)(max_y - min_y) + 1;
+    if (chunks_x * chunks_y > MAP_MAX_CHUNKS)
+    {
+        SDL_Log("Map: %llux%llu chunks is over the limit; use bigger chunks", chunks_x, chunks_y);
+        return result;
+    }
+    Uint32 chunk_count = (Uint32)(chunks_x * chunks_y);
+
+    // dedup wall sizes into shapes
+    V2 *shapes = Arena_PushArrayNoZero(arena, V2, MAP_MAX_SHAPES);
+    Uint32 *object_index = Arena_PushArrayNoZero(arena, Uint32, object_count);
+    Uint32 *object_chunk = Arena_PushArrayNoZero(arena, Uint32, object_count + spawn_count);
+    Uint32 *object_first = Arena_PushArray(arena, Uint32, chunk_count + 1);
+    Uint32 *spawn_first = Arena_PushArray(arena, Uint32, chunk_count + 1);
+    if (!shapes || !object_index || !object_chunk || !object_first || !spawn_first)
+        return result;
+
+    Uint32 shape_count = 0;
+    ForU32(i, object_count)
+    {
+        Map_BakeObject *obj = objects + i;
+        if (obj->kind == MapObject_Prop)
+        {
+            object_index[i] = obj->sprite;
+            continue;
+        }
+
+        Uint32 shape = 0;
+        while (shape < shape_count &&
+               (shapes[shape].x != obj->dim.x || shapes[shape].y != obj->dim.y))
+        {
+            shape += 1;
+        }
+        if (shape == shape_count)
+        {
+            if (shape_count == MAP_MAX_SHAPES)
+            {
+                SDL_Log("Map: more than %u distinct wall sizes", MAP_MAX_SHAPES);
+                return result;
+            }
+            shapes[shape_count] = obj->dim;
+            shape_count += 1;
+        }
+        object_index[i] = shape;
+
+        if (obj->dim.x > chunk_size || obj->dim.y > chunk_size)
+            SDL_Log("Map: wall %gx%g is bigger than a chunk; it can pop in late", obj->dim.x, obj->dim.y);
+    }
+
+    // counting sort by chunk
+    ForU32(i, object_count + spawn_count)
+    {
+        bool is_object = (i < object_count);
+        V2 p = (is_object ? objects[i].p : spawns[i - object_count]);
+        Uint32 chunk = ((Uint32)(Map_ChunkCoord(p.y, chunk_size) - min_y) * (Uint32)chunks_x +
+                        (Uint32)(Map_ChunkCoord(p.x, chunk_size) - min_x));
+        object_chunk[i] = chunk;
+        if (is_object) object_first[chunk + 1] += 1;
+        else           spawn_first[chunk + 1] += 1;
+    }
+    ForU32(chunk, chunk_count)
+    {
+        object_first[chunk + 1] += object_first[chunk];
+        spawn_first[chunk + 1] += spawn_first[chunk];
+    }
+
+    // layout
+    Uint64 shapes_offset = sizeof(Map_Header);
+    Uint64 chunks_offset = shapes_offset + sizeof(V2) * shape_count;
+    Uint64 objects_offset = chunks_offset + sizeof(Map_Chunk) * chunk_count;
+    Uint64 spawns_offset = objects_offset + sizeof(Map_Object) * object_count;
+    Uint64 file_size = spawns_offset + sizeof(V2) * spawn_count;
+
+    Uint8 *file = Arena_Push(arena, file_size, ARENA_DEFAULT_ALIGN);
+    if (!file)
+        return result;
+
+    Map_Header *header = (Map_Header *)file;
+    header->magic = MAP_MAGIC;
+    header->version = MAP_VERSION;
+    header->chunk_size = chunk_size;
+    header->chunk_min_x = min_x;
+    header->chunk_min_y = min_y;
+    header->chunks_x = (Uint32)chunks_x;
+    header->chunks_y = (Uint32)chunks_y;
+    header->shape_count = shape_count;
+    header->object_count = object_count;
+    header->spawn_count = spawn_count;
+    header->file_size = file_size;
+
+    memcpy(file + shapes_offset, shapes, sizeof(V2) * shape_count);
+
+    Map_Chunk *chunks = (Map_Chunk *)(file + chunks_offset);
+    ForU32(chunk, chunk_count)
+    {
+        chunks[chunk].first_object = object_first[chunk];
+        chunks[chunk].object_count = object_first[chunk + 1] - object_first[chunk];
+        chunks[chunk].first_spawn = spawn_first[chunk];
+        chunks[chunk].spawn_count = spawn_first[chunk + 1] - spawn_first[chunk];
+    }
+
+    // scatter; *_first arrays are used as write cursors
+    Map_Object *map_objects = (Map_Object *)(file + objects_offset);
+    V2 *map_spawns = (V2 *)(file + spawns_offset);
+    ForU32(i, object_count + spawn_count)
+    {
+        Uint32 chunk = object_chunk[i];
+        if (i < object_count)
+        {
+            Map_Object *dst = map_objects + object_first[chunk];
+            object_first[chunk] += 1;
+            dst->kind = (Uint16)objects[i].kind;
+            dst->index = (Uint16)object_index[i];
+            dst->color = Map_PackColor(objects[i].color);
+            dst->p = objects[i].p;
+        }
+        else
+        {
+            map_spawns[spawn_first[chunk]] = spawns[i - object_count];
+            spawn_first[chunk] += 1;
+        }
+    }
+
+    result = S8_Make(file, file_size);
+    return result;
+}
+
+// The level that used to be hardcoded in Game_Init.
+static S8 Map_BakeDefaultLevel(Arena *arena)
+{
+    float thickness = 20.f;
+    float length = 400.f;
+    float off = length*0.5f - thickness*0.5f;
+
+    Map_BakeObject objects[] =
+    {
+        {MapObject_Wall, .p = {off, 0},  .dim = {thickness, length}},
+        {MapObject_Wall, .p = {-off, 0}, .dim = {thickness, length}},
+        {MapObject_Wall, .p = {0, off},  .dim = {length, thickness}},
+        {MapObject_Wall, .p = {0,-off},  .dim = {length*0.5f, thickness}},
+        {MapObject_Prop, PackSprite_Reference, .p = {0, off*0.5f}},
+        {MapObject_Prop, PackSprite_Crate, .p = {0.5f*off, -0.5f*off}},
+    };
+
+    float r = 0.f;
+    float g = 0.5f;
+    ForArray(i, objects)
+    {
+        objects[i].color = ColorF_RGB(1,1,1);
+        if (objects[i].kind != MapObject_Wall) continue;
+
+        r += 0.321f;
+        g += 0.111f;
+        while (r > 1.f) r -= 1.f;
+        while (g > 1.f) g -= 1.f;
+        objects[i].color = ColorF_RGB(r, g, 0.5f);
+    }
+
+    V2 spawns[] = {{0, 0}, {-100, 0}, {100, 0}, {0, -100}};
+
+    return Map_Bake(arena, MAP_CHUNK_SIZE, objects, ArrayCount(objects),
+                    spawns, ArrayCount(spawns));
+}
@@ -18,6 +18,7 @@ static Axis2 Axis2_Other(Axis2 axis)
 #define Min(a, b) ((a) < (b) ? (a) : (b))
 #define Max(a, b) ((a) > (b) ? (a) : (b))
 #define Clamp(min, max, val) (((val)<(min)) ? (min) : ((val)>(max))?(max):(val))
+#define AlignUp(value, align) (((value) + (align) - 1) & ~((Uint64)(align) - 1)) // align has to be a power of 2
 
 static float SqrtF(float a)
 {
@@ -72,6 +73,29 @@ static float RoundF(float a)
     return SDL_roundf(a);
 }
 
+// a must be non-zero
+static Uint32 LowestBitIndexU64(Uint64 a)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, a);
+    return (Uint32)index;
+#else
+    return (Uint32)__builtin_ctzll(a);
+#endif
+}
+// a must be non-zero
+static Uint32 HighestBitIndexU64(Uint64 a)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanReverse64(&index, a);
+    return (Uint32)index;
+#else
+    return 63 - (Uint32)__builtin_clzll(a);
+#endif
+}
+
 static float LerpF(float a, float b, float t)
 {
     return a + (b - a) * t;
@@ -216,6 +240,468 @@ static Uint64 HashU64(Uint64 seed, void *data, Uint64 size)
     return res;
 }
 
+// ---
+// Batch vector math
+// F32x4/F32x8 are 4/8 float lanes; V2x4/V2x8 hold 4/8 vectors with
+// x and y in separate lanes. Stream functions work on plain V2 arrays
+// and use the widest type available, finishing the tail one by one.
+// @info(mg) SSE2 is the baseline on x64. AVX2 is used only when the
+//           compiler targets it (`./build.sh game avx2`). arm64 uses the
+//           scalar code unless NEON is opted into (`./build.sh game neon`
+//           defines MATH_ENABLE_NEON); NEON paths haven't been run on hardware yet.
+//           Define MATH_SCALAR to compile the plain C fallback instead.
+// ---
+#if !defined(MATH_SCALAR)
+#   if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define MATH_SSE2 1
+#       include <emmintrin.h>
+#       if defined(__AVX2__)
+#           define MATH_AVX2 1
+#           include <immintrin.h>
+#       endif
+#   elif MATH_ENABLE_NEON && defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#       define MATH_NEON 1
+#       include <arm_neon.h>
+#   endif
+#endif
+
+#if MATH_SSE2
+typedef __m128 F32x4;
+#elif MATH_NEON
+typedef float32x4_t F32x4;
+#else
+typedef struct { float E[4]; } F32x4;
+#endif
+
+#if MATH_AVX2
+typedef __m256 F32x8;
+#else
+typedef struct { F32x4 lo, hi; } F32x8;
+#endif
+
+typedef struct { F32x4 x, y; } V2x4;
+typedef struct { F32x8 x, y; } V2x8;
+
+static F32x4 F32x4_Set1(float a)
+{
+#if MATH_SSE2
+    return _mm_set1_ps(a);
+#elif MATH_NEON
+    return vdupq_n_f32(a);
+#else
+    return (F32x4){a, a, a, a};
+#endif
+}
+static F32x4 F32x4_Load(float *src)
+{
+#if MATH_SSE2
+    return _mm_loadu_ps(src);
+#elif MATH_NEON
+    return vld1q_f32(src);
+#else
+    F32x4 r; memcpy(r.E, src, sizeof(r.E)); return r;
+#endif
+}
+static void F32x4_Store(float *dst, F32x4 a)
+{
+#if MATH_SSE2
+    _mm_storeu_ps(dst, a);
+#elif MATH_NEON
+    vst1q_f32(dst, a);
+#else
+    memcpy(dst, a.E, sizeof(a.E));
+#endif
+}
+static F32x4 F32x4_Add(F32x4 a, F32x4 b)
+{
+#if MATH_SSE2
+    return _mm_add_ps(a, b);
+#elif MATH_NEON
+    return vaddq_f32(a, b);
+#else
+    ForArray(i, a.E)
+        a.E[i] += b.E[i];
+    return a;
+#endif
+}
+static F32x4 F32x4_Sub(F32x4 a, F32x4 b)
+{
+#if MATH_SSE2
+    return _mm_sub_ps(a, b);
+#elif MATH_NEON
+    return vsubq_f32(a, b);
+#else
+    ForArray(i, a.E)
+        a.E[i] -= b.E[i];
+    return a;
+#endif
+}
+static F32x4 F32x4_Mul(F32x4 a, F32x4 b)
+{
+#if MATH_SSE2
+    return _mm_mul_ps(a, b);
+#elif MATH_NEON
+    return vmulq_f32(a, b);
+#else
+    ForArray(i, a.E)
+        a.E[i] *= b.E[i];
+    return a;
+#endif
+}
+static F32x4 F32x4_Min(F32x4 a, F32x4 b)
+{
+#if MATH_SSE2
+    return _mm_min_ps(a, b);
+#elif MATH_NEON
+    return vminq_f32(a, b);
+#else
+    ForArray(i, a.E)
+        a.E[i] = Min(a.E[i], b.E[i]);
+    return a;
+#endif
+}
+static F32x4 F32x4_Max(F32x4 a, F32x4 b)
+{
+#if MATH_SSE2
+    return _mm_max_ps(a, b);
+#elif MATH_NEON
+    return vmaxq_f32(a, b);
+#else
+    ForArray(i, a.E)
+        a.E[i] = Max(a.E[i], b.E[i]);
+    return a;
+#endif
+}
+// Smallest lane.
+static float F32x4_MinLane(F32x4 a)
+{
+#if MATH_SSE2
+    a = _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+    a = _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(a);
+#elif MATH_NEON
+    return vminvq_f32(a);
+#else
+    return Min(Min(a.E[0], a.E[1]), Min(a.E[2], a.E[3]));
+#endif
+}
+// Biggest lane.
+static float F32x4_MaxLane(F32x4 a)
+{
+#if MATH_SSE2
+    a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+    a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(a);
+#elif MATH_NEON
+    return vmaxvq_f32(a);
+#else
+    return Max(Max(a.E[0], a.E[1]), Max(a.E[2], a.E[3]));
+#endif
+}
+
+static F32x8 F32x8_Set1(float a)
+{
+#if MATH_AVX2
+    return _mm256_set1_ps(a);
+#else
+    return (F32x8){F32x4_Set1(a), F32x4_Set1(a)};
+#endif
+}
+static F32x8 F32x8_Load(float *src)
+{
+#if MATH_AVX2
+    return _mm256_loadu_ps(src);
+#else
+    return (F32x8){F32x4_Load(src), F32x4_Load(src + 4)};
+#endif
+}
+static void F32x8_Store(float *dst, F32x8 a)
+{
+#if MATH_AVX2
+    _mm256_storeu_ps(dst, a);
+#else
+    F32x4_Store(dst, a.lo);
+    F32x4_Store(dst + 4, a.hi);
+#endif
+}
+static F32x8 F32x8_Add(F32x8 a, F32x8 b)
+{
+#if MATH_AVX2
+    return _mm256_add_ps(a, b);
+#else
+    return (F32x8){F32x4_Add(a.lo, b.lo), F32x4_Add(a.hi, b.hi)};
+#endif
+}
+static F32x8 F32x8_Sub(F32x8 a, F32x8 b)
+{
+#if MATH_AVX2
+    return _mm256_sub_ps(a, b);
+#else
+    return (F32x8){F32x4_Sub(a.lo, b.lo), F32x4_Sub(a.hi, b.hi)};
+#endif
+}
+static F32x8 F32x8_Mul(F32x8 a, F32x8 b)
+{
+#if MATH_AVX2
+    return _mm256_mul_ps(a, b);
+#else
+    return (F32x8){F32x4_Mul(a.lo, b.lo), F32x4_Mul(a.hi, b.hi)};
+#endif
+}
+static F32x8 F32x8_Min(F32x8 a, F32x8 b)
+{
+#if MATH_AVX2
+    return _mm256_min_ps(a, b);
+#else
+    return (F32x8){F32x4_Min(a.lo, b.lo), F32x4_Min(a.hi, b.hi)};
+#endif
+}
+static F32x8 F32x8_Max(F32x8 a, F32x8 b)
+{
+#if MATH_AVX2
+    return _mm256_max_ps(a, b);
+#else
+    return (F32x8){F32x4_Max(a.lo, b.lo), F32x4_Max(a.hi, b.hi)};
+#endif
+}
+static F32x4 F32x8_MinHalves(F32x8 a)
+{
+#if MATH_AVX2
+    return _mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+#else
+    return F32x4_Min(a.lo, a.hi);
+#endif
+}
+static F32x4 F32x8_MaxHalves(F32x8 a)
+{
+#if MATH_AVX2
+    return _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+#else
+    return F32x4_Max(a.lo, a.hi);
+#endif
+}
+
+// Loads 4 vectors from a V2 array (x and y get split into lanes).
+static V2x4 V2x4_Load(V2 *src)
+{
+    V2x4 r;
+#if MATH_SSE2
+    __m128 a = _mm_loadu_ps(&src[0].x); // x0 y0 x1 y1
+    __m128 b = _mm_loadu_ps(&src[2].x); // x2 y2 x3 y3
+    r.x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    r.y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+#elif MATH_NEON
+    float32x4x2_t v = vld2q_f32(&src[0].x);
+    r.x = v.val[0];
+    r.y = v.val[1];
+#else
+    ForArray(i, r.x.E)
+    {
+        r.x.E[i] = src[i].x;
+        r.y.E[i] = src[i].y;
+    }
+#endif
+    return r;
+}
+static void V2x4_Store(V2 *dst, V2x4 a)
+{
+#if MATH_SSE2
+    _mm_storeu_ps(&dst[0].x, _mm_unpacklo_ps(a.x, a.y));
+    _mm_storeu_ps(&dst[2].x, _mm_unpackhi_ps(a.x, a.y));
+#elif MATH_NEON
+    float32x4x2_t v = {{a.x, a.y}};
+    vst2q_f32(&dst[0].x, v);
+#else
+    ForArray(i, a.x.E)
+    {
+        dst[i].x = a.x.E[i];
+        dst[i].y = a.y.E[i];
+    }
+#endif
+}
+static V2x4 V2x4_Set1(V2 a)
+{
+    return (V2x4){F32x4_Set1(a.x), F32x4_Set1(a.y)};
+}
+static V2x4 V2x4_Add(V2x4 a, V2x4 b)
+{
+    return (V2x4){F32x4_Add(a.x, b.x), F32x4_Add(a.y, b.y)};
+}
+static V2x4 V2x4_Sub(V2x4 a, V2x4 b)
+{
+    return (V2x4){F32x4_Sub(a.x, b.x), F32x4_Sub(a.y, b.y)};
+}
+static V2x4 V2x4_Mul(V2x4 a, V2x4 b)
+{
+    return (V2x4){F32x4_Mul(a.x, b.x), F32x4_Mul(a.y, b.y)};
+}
+static F32x4 V2x4_Inner(V2x4 a, V2x4 b)
+{
+    return F32x4_Add(F32x4_Mul(a.x, b.x), F32x4_Mul(a.y, b.y));
+}
+// x_axis and y_axis are where (1, 0) and (0, 1) end up.
+static V2x4 V2x4_Transform(V2x4 a, V2x4 x_axis, V2x4 y_axis, V2x4 offset)
+{
+    V2x4 r;
+    r.x = F32x4_Add(F32x4_Add(F32x4_Mul(a.x, x_axis.x), F32x4_Mul(a.y, y_axis.x)), offset.x);
+    r.y = F32x4_Add(F32x4_Add(F32x4_Mul(a.x, x_axis.y), F32x4_Mul(a.y, y_axis.y)), offset.y);
+    return r;
+}
+
+static V2x8 V2x8_Load(V2 *src)
+{
+    V2x8 r;
+#if MATH_AVX2
+    __m256 a = _mm256_loadu_ps(&src[0].x); // x0 y0 x1 y1 | x2 y2 x3 y3
+    __m256 b = _mm256_loadu_ps(&src[4].x); // x4 y4 x5 y5 | x6 y6 x7 y7
+    __m256 x = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)); // x0 x1 x4 x5 | x2 x3 x6 x7
+    __m256 y = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    r.x = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(x), _MM_SHUFFLE(3, 1, 2, 0)));
+    r.y = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(y), _MM_SHUFFLE(3, 1, 2, 0)));
+#else
+    V2x4 lo = V2x4_Load(src);
+    V2x4 hi = V2x4_Load(src + 4);
+    r.x = (F32x8){lo.x, hi.x};
+    r.y = (F32x8){lo.y, hi.y};
+#endif
+    return r;
+}
+static void V2x8_Store(V2 *dst, V2x8 a)
+{
+#if MATH_AVX2
+    __m256 x = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(a.x), _MM_SHUFFLE(3, 1, 2, 0))); // x0 x1 x4 x5 | x2 x3 x6 x7
+    __m256 y = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(a.y), _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm256_storeu_ps(&dst[0].x, _mm256_unpacklo_ps(x, y));
+    _mm256_storeu_ps(&dst[4].x, _mm256_unpackhi_ps(x, y));
+#else
+    V2x4_Store(dst, (V2x4){a.x.lo, a.y.lo});
+    V2x4_Store(dst + 4, (V2x4){a.x.hi, a.y.hi});
+#endif
+}
+static V2x8 V2x8_Set1(V2 a)
+{
+    return (V2x8){F32x8_Set1(a.x), F32x8_Set1(a.y)};
+}
+static V2x8 V2x8_Add(V2x8 a, V2x8 b)
+{
+    return (V2x8){F32x8_Add(a.x, b.x), F32x8_Add(a.y, b.y)};
+}
+static V2x8 V2x8_Sub(V2x8 a, V2x8 b)
+{
+    return (V2x8){F32x8_Sub(a.x, b.x), F32x8_Sub(a.y, b.y)};
+}
+static V2x8 V2x8_Mul(V2x8 a, V2x8 b)
+{
+    return (V2x8){F32x8_Mul(a.x, b.x), F32x8_Mul(a.y, b.y)};
+}
+static F32x8 V2x8_Inner(V2x8 a, V2x8 b)
+{
+    return F32x8_Add(F32x8_Mul(a.x, b.x), F32x8_Mul(a.y, b.y));
+}
+static V2x8 V2x8_Transform(V2x8 a, V2x8 x_axis, V2x8 y_axis, V2x8 offset)
+{
+    V2x8 r;
+    r.x = F32x8_Add(F32x8_Add(F32x8_Mul(a.x, x_axis.x), F32x8_Mul(a.y, y_axis.x)), offset.x);
+    r.y = F32x8_Add(F32x8_Add(F32x8_Mul(a.x, x_axis.y), F32x8_Mul(a.y, y_axis.y)), offset.y);
+    return r;
+}
+
+//
+// Streams
+// dst can be the same array as src.
+//
+static V2 V2_Transform(V2 a, V2 x_axis, V2 y_axis, V2 offset)
+{
+    return (V2){a.x*x_axis.x + a.y*y_axis.x + offset.x,
+                a.x*x_axis.y + a.y*y_axis.y + offset.y};
+}
+
+static void V2_StreamOffset(V2 *dst, V2 *src, Uint64 count, V2 offset)
+{
+    Uint64 i = 0;
+    V2x8 offset8 = V2x8_Set1(offset);
+    for (; i + 8 <= count; i += 8)
+        V2x8_Store(dst + i, V2x8_Add(V2x8_Load(src + i), offset8));
+    if (i + 4 <= count)
+    {
+        V2x4_Store(dst + i, V2x4_Add(V2x4_Load(src + i), V2x4_Set1(offset)));
+        i += 4;
+    }
+    for (; i < count; i += 1)
+        dst[i] = V2_Add(src[i], offset);
+}
+
+// dst = x_axis*src.x + y_axis*src.y + offset; rotation, scale,
+// mirroring and camera transforms are all special cases of it.
+static void V2_StreamTransform(V2 *dst, V2 *src, Uint64 count, V2 x_axis, V2 y_axis, V2 offset)
+{
+    Uint64 i = 0;
+    V2x8 x_axis8 = V2x8_Set1(x_axis);
+    V2x8 y_axis8 = V2x8_Set1(y_axis);
+    V2x8 offset8 = V2x8_Set1(offset);
+    for (; i + 8 <= count; i += 8)
+        V2x8_Store(dst + i, V2x8_Transform(V2x8_Load(src + i), x_axis8, y_axis8, offset8));
+    if (i + 4 <= count)
+    {
+        V2x4 v = V2x4_Transform(V2x4_Load(src + i), V2x4_Set1(x_axis), V2x4_Set1(y_axis), V2x4_Set1(offset));
+        V2x4_Store(dst + i, v);
+        i += 4;
+    }
+    for (; i < count; i += 1)
+        dst[i] = V2_Transform(src[i], x_axis, y_axis, offset);
+}
+
+// dst[i] = V2_Inner(src[i], axis)
+static void V2_StreamProject(float *dst, V2 *src, Uint64 count, V2 axis)
+{
+    Uint64 i = 0;
+    V2x8 axis8 = V2x8_Set1(axis);
+    for (; i + 8 <= count; i += 8)
+        F32x8_Store(dst + i, V2x8_Inner(V2x8_Load(src + i), axis8));
+    if (i + 4 <= count)
+    {
+        F32x4_Store(dst + i, V2x4_Inner(V2x4_Load(src + i), V2x4_Set1(axis)));
+        i += 4;
+    }
+    for (; i < count; i += 1)
+        dst[i] = V2_Inner(src[i], axis);
+}
+
+// Range of V2_Inner(src[i], axis); count has to be non-zero.
+static RngF V2_StreamProjectRange(V2 *src, Uint64 count, V2 axis)
+{
+    RngF result = {FLT_MAX, -FLT_MAX};
+    Uint64 i = 0;
+    if (count >= 8)
+    {
+        V2x8 axis8 = V2x8_Set1(axis);
+        F32x8 min8 = F32x8_Set1(FLT_MAX);
+        F32x8 max8 = F32x8_Set1(-FLT_MAX);
+        for (; i + 8 <= count; i += 8)
+        {
+            F32x8 d = V2x8_Inner(V2x8_Load(src + i), axis8);
+            min8 = F32x8_Min(min8, d);
+            max8 = F32x8_Max(max8, d);
+        }
+        result.min = F32x4_MinLane(F32x8_MinHalves(min8));
+        result.max = F32x4_MaxLane(F32x8_MaxHalves(max8));
+    }
+    if (i + 4 <= count)
+    {
+        F32x4 d = V2x4_Inner(V2x4_Load(src + i), V2x4_Set1(axis));
+        result.min = Min(result.min, F32x4_MinLane(d));
+        result.max = Max(result.max, F32x4_MaxLane(d));
+        i += 4;
+    }
+    for (; i < count; i += 1)
+    {
+        float d = V2_Inner(src[i], axis);
+        result.min = Min(result.min, d);
+        result.max = Max(result.max, d);
+    }
+    return result;
+}
+
 // ---
 // Color
 // ---
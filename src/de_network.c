@@ -1,27 +1,75 @@
-//
-// disable log spam
-//
-//#define NET_VERBOSE_LOG(...)
-#define NET_VERBOSE_LOG(...) SDL_Log(__VA_ARGS__)
-
 typedef struct
 {
     Uint64 magic_value;
     Uint64 hash; // of all values post first 16 bytes
 } Net_BufHeader;
 
+// @info(mg) Every datagram is: Net_BufHeader, Net_FragmentHeader, payload.
+//           Messages bigger than one datagram are split into fragments
+//           that share message_id; receiver reassembles them by
+//           (address, port, message_id). Messages that fit get
+//           fragment_count == 1 and skip reassembly.
+typedef struct
+{
+    Uint32 message_id;
+    Uint16 fragment_index;
+    Uint16 fragment_count;
+} Net_FragmentHeader;
+
+#define NET_FRAGMENT_PAYLOAD (NET_MTU - sizeof(Net_BufHeader) - sizeof(Net_FragmentHeader))
+static_assert(NET_MAX_MESSAGE_SIZE <= NET_MAX_FRAGMENTS * NET_FRAGMENT_PAYLOAD);
+
 static const char *Net_Label(AppState *app)
 {
     return app->net.is_server ? "SERVER" : "CLIENT";
 }
 
+//
+// Packet rings
+//
+static Net_Packet *Net_RingPushBegin(Net_PacketRing *ring)
+{
+    Uint32 write = SDL_GetAtomicU32(&ring->write);
+    Uint32 read = SDL_GetAtomicU32(&ring->read);
+    if (write - read >= NET_RING_SIZE)
+    {
+        ring->dropped += 1;
+        return 0;
+    }
+    return ring->packets + (write % NET_RING_SIZE);
+}
+
+static void Net_RingPushCommit(Net_PacketRing *ring)
+{
+    SDL_MemoryBarrierRelease(); // publish packet contents before the index
+    Uint32 write = SDL_GetAtomicU32(&ring->write);
+    SDL_SetAtomicU32(&ring->write, write + 1);
+}
+
+static Net_Packet *Net_RingPopBegin(Net_PacketRing *ring)
+{
+    Uint32 read = SDL_GetAtomicU32(&ring->read);
+    Uint32 write = SDL_GetAtomicU32(&ring->write);
+    if (read == write)
+        return 0;
+    SDL_MemoryBarrierAcquire();
+    return ring->packets + (read % NET_RING_SIZE);
+}
+
+static void Net_RingPopEnd(Net_PacketRing *ring)
+{
+    SDL_MemoryBarrierRelease(); // finish reading packet before producer can reuse it
+    Uint32 read = SDL_GetAtomicU32(&ring->read);
+    SDL_SetAtomicU32(&ring->read, read + 1);
+}
+
 static Uint8 *Net_BufAlloc(AppState *app, Uint32 size)
 {
     Uint8 *result = app->net.buf + app->net.buf_used;
     {
         // return ptr to start of the buffer
         // on overflow
-        Uint8 *end = (app->net.buf + sizeof(app->net.buf));
+        Uint8 *end = (app->net.buf + app->net.buf_capacity);
         if (end < (result + size))
         {
             Assert(false);
@@ -40,83 +88,971 @@ static Uint8 *Net_BufMemcpy(AppState *app, void *data, Uint32 size)
     return result;
 }
 
-static void Net_BufSend(AppState *app, Net_User destination)
-{
-    bool send_res = SDLNet_SendDatagram(app->net.socket,
-                                        destination.address,
-                                        destination.port,
-                                        app->net.buf, app->net.buf_used);
-    (void)send_res;
+static void Net_BufSend(AppState *app, Net_User destination)
+{
+    Net_Packet *packet = Net_RingPushBegin(&app->net.send_ring);
+    if (!packet)
+    {
+        LogWarn(LogCat_Net, "%s: Send ring is full; dropping packet", Net_Label(app));
+        return;
+    }
+
+    if (app->net.buf_used > sizeof(packet->data))
+    {
+        LogWarn(LogCat_Net, "%s: Payload of size %d is bigger than max message size (%d); dropping packet",
+                            Net_Label(app), (int)app->net.buf_used, (int)sizeof(packet->data));
+        return;
+    }
+
+    // network thread adds headers and splits the message into fragments
+    memcpy(packet->data, app->net.buf, app->net.buf_used);
+    packet->size = app->net.buf_used;
+    packet->address = SDLNet_RefAddress(destination.address);
+    packet->port = destination.port;
+    Net_RingPushCommit(&app->net.send_ring);
+}
+
+// @info(mg) Object state wire format:
+//           Uint64 tick_id, Uint32 entry_count,
+//           entry_count * (Uint32 network_slot, Object)
+//           Empty network slots and slots that aren't relevant
+//           to the destination user are skipped; user == 0 sends
+//           all of them (lockstep baselines).
+static void Net_BufObjState(AppState *app, Tick_NetworkObjState *state, Net_User *user)
+{
+    Net_BufMemcpy(app, &state->tick_id, sizeof(state->tick_id));
+
+    Uint32 entry_count = 0;
+    Uint8 *entry_count_dst = Net_BufAlloc(app, sizeof(entry_count));
+
+    ForU32(slot, state->obj_count)
+    {
+        Object *obj = state->objs + slot;
+        if (!obj->flags) continue;
+
+        if (user)
+        {
+            Uint32 entry_size = sizeof(slot) + sizeof(*obj);
+            if (!Interest_IsRelevant(user, slot))
+            {
+                app->net.interest_saved_bytes += entry_size;
+                continue;
+            }
+            app->net.interest_sent_bytes += entry_size;
+        }
+
+        Net_BufMemcpy(app, &slot, sizeof(slot));
+        Net_BufMemcpy(app, obj, sizeof(*obj));
+        entry_count += 1;
+    }
+
+    memcpy(entry_count_dst, &entry_count, sizeof(entry_count));
+}
+
+static void Net_BufObjHistory(AppState *app, Net_User *user)
+{
+    Tick_Command cmd = {};
+    cmd.tick_id = app->tick_id;
+    cmd.kind = Tick_Cmd_ObjHistory;
+    Net_BufMemcpy(app, &cmd, sizeof(cmd));
+
+    // @info(mg) Resend a few of the most recent states in every packet.
+    //           Client's jitter buffer drops duplicates, so a lost
+    //           packet doesn't create a hole in the playback.
+    Uint32 state_count = NET_SNAPSHOT_REDUNDANCY;
+    Net_BufMemcpy(app, &state_count, sizeof(state_count));
+
+    Uint64 history_count = ArrayCount(app->netobj_states);
+    ForU32(i, state_count)
+    {
+        // oldest to newest; netobj_state_next points one past the newest state
+        Uint64 index = (app->netobj_state_next + history_count - state_count + i) % history_count;
+        Net_BufObjState(app, app->netobj_states + index, user);
+    }
+}
+
+//
+// Message reader
+// @info(mg) Reads directly from the received message - nothing is copied
+//           to temporary structs. Decoders validate the size of a whole
+//           block once with Net_ReadView and then load fields from it with
+//           unaligned-safe Net_Load* functions. Reads past the end set err
+//           and return zeroes, so err can be checked once after a run of reads.
+//
+typedef struct
+{
+    S8 msg;
+    bool err;
+} Net_Reader;
+
+static Uint16 Net_LoadU16(Uint8 *src) { Uint16 result; memcpy(&result, src, sizeof(result)); return result; }
+static Uint32 Net_LoadU32(Uint8 *src) { Uint32 result; memcpy(&result, src, sizeof(result)); return result; }
+static Uint64 Net_LoadU64(Uint8 *src) { Uint64 result; memcpy(&result, src, sizeof(result)); return result; }
+
+static Uint8 *Net_ReadView(Net_Reader *reader, Uint64 size)
+{
+    if (reader->err || reader->msg.size < size)
+    {
+        reader->err = true;
+        return 0;
+    }
+
+    Uint8 *result = reader->msg.str;
+    reader->msg = S8_Skip(reader->msg, size);
+    return result;
+}
+
+static Uint8 Net_ReadU8(Net_Reader *reader)
+{
+    Uint8 *src = Net_ReadView(reader, sizeof(Uint8));
+    return src ? *src : 0;
+}
+
+static Uint16 Net_ReadU16(Net_Reader *reader)
+{
+    Uint8 *src = Net_ReadView(reader, sizeof(Uint16));
+    return src ? Net_LoadU16(src) : 0;
+}
+
+static Uint32 Net_ReadU32(Net_Reader *reader)
+{
+    Uint8 *src = Net_ReadView(reader, sizeof(Uint32));
+    return src ? Net_LoadU32(src) : 0;
+}
+
+static Uint64 Net_ReadU64(Net_Reader *reader)
+{
+    Uint8 *src = Net_ReadView(reader, sizeof(Uint64));
+    return src ? Net_LoadU64(src) : 0;
+}
+
+static Tick_Command Net_ReadCommand(Net_Reader *reader)
+{
+    Tick_Command result = {};
+    Uint8 *src = Net_ReadView(reader, sizeof(result));
+    if (src)
+        memcpy(&result, src, sizeof(result));
+    return result;
+}
+
+static bool Net_UserMatch(Net_User a, Net_User b)
+{
+    return (a.port == b.port &&
+            SDLNet_CompareAddresses(a.address, b.address) == 0);
+}
+
+static bool Net_UserMatchAddrPort(Net_User a, SDLNet_Address *address, Uint16 port)
+{
+    return (a.port == port &&
+            SDLNet_CompareAddresses(a.address, address) == 0);
+}
+
+//
+// User table
+// Users are stored in a dense array; user_table maps address+port
+// hash to user index so every received packet is an O(1) lookup.
+//
+static Uint64 Net_AddressHash(SDLNet_Address *address, Uint16 port)
+{
+    // SDLNet caches the address string, so this doesn't format anything
+    S8 address_string = {0};
+    if (address)
+        address_string = S8_MakeFromCstr(SDLNet_GetAddressString(address));
+    return S8_Hash(port, address_string);
+}
+
+static void Net_UserTableInsert(AppState *app, Uint32 user_index)
+{
+    Uint32 mask = app->net.user_table_capacity - 1;
+    Uint32 pos = (Uint32)app->net.users[user_index].address_hash & mask;
+    while (app->net.user_table[pos])
+        pos = (pos + 1) & mask;
+    app->net.user_table[pos] = user_index + 1;
+}
+
+static void Net_UserTableRebuild(AppState *app)
+{
+    // keep load factor under 50%; capacity stays a power of 2 as the table only doubles
+    Uint32 capacity = 64;
+    while (capacity < app->net.user_count * 2)
+        capacity *= 2;
+
+    if (!app->net.user_table_arena.base)
+        Arena_Init(&app->net.user_table_arena, "user table", NET_MAX_USERS * 2 * sizeof(*app->net.user_table));
+    app->net.user_table = Pool_Grow(&app->net.user_table_arena, sizeof(*app->net.user_table),
+                                    &app->net.user_table_capacity, capacity);
+    Assert(app->net.user_table);
+
+    memset(app->net.user_table, 0, app->net.user_table_capacity * sizeof(*app->net.user_table));
+    ForU32(i, app->net.user_count)
+        Net_UserTableInsert(app, i);
+}
+
+static Net_User *Net_FindUser(AppState *app, SDLNet_Address *address, Uint16 port)
+{
+    if (!app->net.user_table_capacity)
+        return 0;
+
+    Uint64 hash = Net_AddressHash(address, port);
+    Uint32 mask = app->net.user_table_capacity - 1;
+    for (Uint32 pos = (Uint32)hash & mask;; pos = (pos + 1) & mask)
+    {
+        Uint32 entry = app->net.user_table[pos];
+        if (!entry)
+            return 0;
+
+        Net_User *user = app->net.users + (entry - 1);
+        if (user->address_hash == hash &&
+            Net_UserMatchAddrPort(*user, address, port))
+            return user;
+    }
+}
+
+static Net_User *Net_AddUser(AppState *app, SDLNet_Address *address, Uint16 port)
+{
+    if (app->net.user_count >= NET_MAX_USERS)
+        return 0;
+
+    // every player has to fit into a lockstep frame; one of them can be local
+    if (app->lockstep.enabled && app->net.user_count + 1 >= LOCKSTEP_MAX_PLAYERS)
+        return 0;
+
+    if (!app->net.user_arena.base)
+        Arena_Init(&app->net.user_arena, "users", NET_MAX_USERS * sizeof(*app->net.users));
+    Net_User *users = Pool_Grow(&app->net.user_arena, sizeof(*app->net.users),
+                                &app->net.user_capacity, app->net.user_count + 1);
+    if (!users)
+        return 0;
+    app->net.users = users;
+
+    // players without a network slot would stay in the world with no owner
+    Object *player = Object_CreatePlayer(app);
+    Uint32 network_slot = Object_AssignNetworkSlot(app, player);
+    if (network_slot == NET_MAX_NETWORK_OBJECTS)
+    {
+        LogWarn(LogCat_Net, "%s: no free network slot for a new user", Net_Label(app));
+        Object_Destroy(app, Object_HandleFromPointer(app, player));
+        return 0;
+    }
+    player->p = Map_NextSpawn(app);
+
+    Uint32 user_index = app->net.user_count;
+    app->net.user_count += 1;
+
+    Net_User *user = app->net.users + user_index;
+    SDL_zerop(user);
+    user->address = (address ? SDLNet_RefAddress(address) : 0);
+    user->port = port;
+    user->address_hash = Net_AddressHash(address, port);
+    user->last_receive_time = app->frame_time;
+    user->id = app->net.next_user_id;
+    app->net.next_user_id += 1;
+    user->network_slot = network_slot;
+    Replay_RecordUserAdd(app, user);
+
+    if (app->net.user_count * 2 > app->net.user_table_capacity)
+        Net_UserTableRebuild(app);
+    else
+        Net_UserTableInsert(app, user_index);
+
+    return user;
+}
+
+static void Net_RemoveUser(AppState *app, Uint32 user_index)
+{
+    Assert(user_index < app->net.user_count);
+    Net_User *user = app->net.users + user_index;
+
+    Replay_RecordUserRemove(app, user);
+    Object_ReleaseNetworkSlot(app, user->network_slot);
+    if (user->address)
+        SDLNet_UnrefAddress(user->address);
+    Visibility_Free(&user->visibility);
+
+    // swap remove; table stores indices so it has to be rebuilt
+    // @speed rebuild is O(users) but disconnects are rare
+    app->net.user_count -= 1;
+    *user = app->net.users[app->net.user_count];
+    Net_UserTableRebuild(app);
+}
+
+static void Net_TimeoutUsers(AppState *app)
+{
+    for (Uint32 i = app->net.user_count; i > 0; i -= 1)
+    {
+        Uint32 user_index = i - 1;
+        Net_User *user = app->net.users + user_index;
+        if (app->frame_time > user->last_receive_time + NET_USER_TIMEOUT_MS)
+        {
+            LogWarn(LogCat_Net, "%s: user %s:%d timed out; releasing network slot %d",
+                                Net_Label(app), SDLNet_GetAddressString(user->address),
+                                (int)user->port, (int)user->network_slot);
+            Net_RemoveUser(app, user_index);
+        }
+    }
+}
+
+//
+// Input stream
+// @info(mg) Client sends its last NET_INPUT_REDUNDANCY inputs in every packet
+//           so a lost packet doesn't lose any input. Inputs are quantized to
+//           Sint8 per axis and delta-encoded: a bitmask marks entries that
+//           differ from the previous (newer) entry, only those carry a value.
+//
+static Sint8 Net_QuantizeUnit(float value)
+{
+    return (Sint8)RoundF(Clamp(-1.f, 1.f, value) * 127.f);
+}
+
+static float Net_DequantizeUnit(Sint8 value)
+{
+    return (float)value * (1.f / 127.f);
+}
+
+// Tick_Cmd_Input with the most inputs; see Net_EncodeInputs
+#define NET_MAX_INPUTS_SIZE (sizeof(Tick_Command) + sizeof(Uint8) + sizeof(Uint16) + \
+                             NET_INPUT_REDUNDANCY * 2 * sizeof(Sint8))
+
+// Writes Tick_Cmd_Input into dst (at least NET_MAX_INPUTS_SIZE bytes); returns its size.
+// inputs go from newest to oldest, one per tick. Only inputs that differ from
+// the newer one are sent; changed_mask has a bit for each of them.
+// Shared by the client and loadgen bots.
+static Uint32 Net_EncodeInputs(Uint8 *dst, Tick_Input *inputs, Uint32 input_count)
+{
+    static_assert(NET_INPUT_REDUNDANCY <= 16); // changed_mask is Uint16
+    Assert(input_count && input_count <= NET_INPUT_REDUNDANCY);
+    Sint8 packed[NET_INPUT_REDUNDANCY][2];
+    Uint16 changed_mask = 0;
+
+    ForU32(i, input_count)
+    {
+        Assert(inputs[i].tick_id == inputs[0].tick_id - i); // inputs are polled once per tick
+        packed[i][0] = Net_QuantizeUnit(inputs[i].move_dir.x);
+        packed[i][1] = Net_QuantizeUnit(inputs[i].move_dir.y);
+
+        if (i == 0 || memcmp(packed[i], packed[i - 1], sizeof(packed[i])))
+            changed_mask |= (1 << i);
+    }
+
+    Tick_Command cmd = {};
+    cmd.tick_id = inputs[0].tick_id;
+    cmd.kind = Tick_Cmd_Input;
+    Uint8 count = (Uint8)input_count;
+
+    Uint32 size = 0;
+    memcpy(dst + size, &cmd, sizeof(cmd));                   size += sizeof(cmd);
+    memcpy(dst + size, &count, sizeof(count));               size += sizeof(count);
+    memcpy(dst + size, &changed_mask, sizeof(changed_mask)); size += sizeof(changed_mask);
+    ForU32(i, input_count)
+    {
+        if (changed_mask & (1 << i))
+        {
+            memcpy(dst + size, packed[i], sizeof(packed[i]));
+            size += sizeof(packed[i]);
+        }
+    }
+    return size;
+}
+
+static void Net_BufInputs(AppState *app)
+{
+    Uint64 available = app->tick_input_max - app->tick_input_min;
+    Uint32 input_count = (Uint32)Min(available, NET_INPUT_REDUNDANCY);
+    if (!input_count)
+        return;
+
+    // newest to oldest
+    Tick_Input inputs[NET_INPUT_REDUNDANCY];
+    ForU32(i, input_count)
+    {
+        Uint64 index = (app->tick_input_max - 1 - i) % ArrayCount(app->tick_input_buf);
+        inputs[i] = app->tick_input_buf[index];
+    }
+
+    Uint8 encoded[NET_MAX_INPUTS_SIZE];
+    Uint32 size = Net_EncodeInputs(encoded, inputs, input_count);
+    Net_BufMemcpy(app, encoded, size);
+}
+
+static void Net_UserPushInput(AppState *app, Net_User *user, Tick_Input input)
+{
+    if (!user->tick_offset_initialized)
+    {
+        user->tick_offset_initialized = true;
+        user->tick_offset = (Sint64)input.tick_id - (Sint64)app->tick_id - NET_INPUT_DELAY_TICKS;
+        user->applied_input_tick_id = (Uint64)((Sint64)app->tick_id + user->tick_offset);
+        user->sync_input_tick_id = user->applied_input_tick_id;
+        user->missing_streak = 0;
+    }
+
+    Tick_Input *slot = user->inputs + (input.tick_id % ArrayCount(user->inputs));
+    if (slot->tick_id >= input.tick_id)
+        return; // duplicate from redundant stream
+
+    if (input.tick_id <= user->applied_input_tick_id)
+    {
+        // we had to simulate this tick before the input arrived
+        // (inputs older than the sync point were never expected)
+        if (input.tick_id > user->sync_input_tick_id)
+            user->input_late += 1;
+    }
+    else
+    {
+        user->input_received += 1;
+    }
+
+    *slot = input;
+    user->newest_input_tick_id = Max(user->newest_input_tick_id, input.tick_id);
+}
+
+// Called by the server once per simulated tick for every user.
+static Tick_Input Net_UserInputForTick(AppState *app, Net_User *user)
+{
+    Tick_Input result = user->last_applied_input;
+    if (user->tick_offset_initialized)
+    {
+        Uint64 client_tick_id = (Uint64)((Sint64)app->tick_id + user->tick_offset);
+        Tick_Input *slot = user->inputs + (client_tick_id % ArrayCount(user->inputs));
+
+        if (slot->tick_id == client_tick_id)
+        {
+            result = *slot;
+            user->missing_streak = 0;
+        }
+        else
+        {
+            // repeat last known input
+            user->input_missing += 1;
+            user->missing_streak += 1;
+        }
+
+        user->applied_input_tick_id = client_tick_id;
+        user->last_applied_input = result;
+
+        // resync when client stalled for a long time or when
+        // it's so far ahead that its inputs wrap around the queue
+        bool stalled = user->missing_streak > app->tick_rate;
+        bool overrun = (user->newest_input_tick_id > client_tick_id + ArrayCount(user->inputs) / 2);
+        if (stalled || overrun)
+        {
+            LogWarn(LogCat_Net, "%s: user port %d input stream out of sync (%s); resyncing",
+                                Net_Label(app), (int)user->port, stalled ? "stalled" : "overrun");
+            user->tick_offset_initialized = false;
+        }
+    }
+
+    if (app->tick_id % app->tick_rate == 0 &&
+        (user->input_late != user->input_late_reported ||
+         user->input_missing != user->input_missing_reported))
+    {
+        LogWarn(LogCat_Net, "%s: user port %d inputs: %llu late, %llu missing (received %llu)",
+                            Net_Label(app), (int)user->port,
+                            user->input_late - user->input_late_reported,
+                            user->input_missing - user->input_missing_reported,
+                            user->input_received);
+        user->input_late_reported = user->input_late;
+        user->input_missing_reported = user->input_missing;
+    }
+
+    return result;
+}
+
+//
+// Lockstep
+// Server sends frames of inputs instead of object state (see de_lockstep.c).
+//
+// @info(mg) Lockstep wire format:
+//           Uint8 has_baseline, baseline in object state format (if has_baseline),
+//           Uint64 first_tick_id, Uint32 frame_count,
+//           frame_count * (Uint32 hash, Uint8 entry_count,
+//                          entry_count * (Uint16 network_slot, Sint8 move_dir[2],
+//                                         V2 spawn_p if network_slot has LOCKSTEP_SPAWNED))
+//           Frames follow the last one the user acknowledged.
+static void Net_BufLockstep(AppState *app, Net_User *user)
+{
+    static_assert(NET_MAX_NETWORK_OBJECTS <= LOCKSTEP_SPAWNED);
+    static_assert(LOCKSTEP_MAX_PLAYERS <= 0xff);
+
+    Uint64 newest_tick_id = app->lockstep.newest_tick_id;
+    if (!newest_tick_id)
+        return; // nothing was simulated yet
+
+    Uint32 buf_start = app->net.buf_used;
+    Tick_Command cmd = {};
+    cmd.tick_id = app->tick_id;
+    cmd.kind = Tick_Cmd_Lockstep;
+    Net_BufMemcpy(app, &cmd, sizeof(cmd));
+
+    Uint64 ack_tick_id = user->lockstep_ack_tick_id;
+    Uint8 has_baseline = (!ack_tick_id || ack_tick_id > newest_tick_id ||
+                          newest_tick_id - ack_tick_id >= ArrayCount(app->lockstep.frames));
+    Net_BufMemcpy(app, &has_baseline, sizeof(has_baseline));
+
+    Uint64 first_tick_id = ack_tick_id + 1;
+    if (has_baseline)
+    {
+        // netobj_state_next points one past the newest state
+        Uint64 history_count = ArrayCount(app->netobj_states);
+        Tick_NetworkObjState *state = app->netobj_states + (app->netobj_state_next + history_count - 1) % history_count;
+        Assert(state->tick_id == newest_tick_id); // both are saved by the same tick
+        Net_BufObjState(app, state, 0);
+        first_tick_id = newest_tick_id + 1;
+        app->lockstep.baselines += 1;
+    }
+
+    Uint32 frame_count = (Uint32)(newest_tick_id + 1 - first_tick_id);
+    Net_BufMemcpy(app, &first_tick_id, sizeof(first_tick_id));
+    Net_BufMemcpy(app, &frame_count, sizeof(frame_count));
+    ForU32(frame_index, frame_count)
+    {
+        Lockstep_Frame *frame = Lockstep_Get(app, first_tick_id + frame_index);
+        Assert(frame);
+
+        Uint8 entry_count = (Uint8)frame->entry_count;
+        Net_BufMemcpy(app, &frame->hash, sizeof(frame->hash));
+        Net_BufMemcpy(app, &entry_count, sizeof(entry_count));
+        ForU32(entry_index, entry_count)
+        {
+            Lockstep_Entry *entry = frame->entries + entry_index;
+            Uint16 network_slot = (Uint16)entry->network_slot;
+            if (entry->spawned)
+                network_slot |= LOCKSTEP_SPAWNED;
+
+            Sint8 packed[2] = { Net_QuantizeUnit(entry->move_dir.x), Net_QuantizeUnit(entry->move_dir.y) };
+            Net_BufMemcpy(app, &network_slot, sizeof(network_slot));
+            Net_BufMemcpy(app, packed, sizeof(packed));
+            if (entry->spawned)
+                Net_BufMemcpy(app, &entry->spawn_p, sizeof(entry->spawn_p));
+        }
+    }
+
+    app->lockstep.bytes += app->net.buf_used - buf_start;
+}
+
+static void Net_BufLockstepAck(AppState *app)
+{
+    Tick_Command cmd = {};
+    cmd.tick_id = app->lockstep.sim_tick_id; // 0 asks for a baseline
+    cmd.kind = Tick_Cmd_LockstepAck;
+    Net_BufMemcpy(app, &cmd, sizeof(cmd));
+}
+
+// Sends the shared part of the payload to every user, with per user commands appended.
+static void Net_BufSendFlush(AppState *app)
+{
+    if (app->net.is_server)
+    {
+        Uint32 shared_buf_used = app->net.buf_used;
+        ForU32(i, app->net.user_count)
+        {
+            Net_User *user = app->net.users + i;
+
+            // append per user commands
+            if (app->lockstep.enabled)
+            {
+                Net_BufLockstep(app, user);
+            }
+            else if (!NET_OLD_PROTOCOL)
+            {
+                Net_BufObjHistory(app, user);
+            }
+
+            // @info(mg) UserInfo wire format:
+            //           Uint32 network_slot, Uint32 tick_rate,
+            //           Uint64 input_tick_id (client tick of the newest input applied to the user),
+            //           Uint32 work_us (server's work during the previous frame)
+            {
+                Tick_Command cmd = {};
+                cmd.tick_id = app->tick_id;
+                cmd.kind = Tick_Cmd_UserInfo;
+                Uint64 input_tick_id = user->last_applied_input.tick_id;
+                Uint32 work_us = (Uint32)Min(app->net.work_ns / 1000, 0xffff'ffffllu);
+                Net_BufMemcpy(app, &cmd, sizeof(cmd));
+                Net_BufMemcpy(app, &user->network_slot, sizeof(user->network_slot));
+                Net_BufMemcpy(app, &app->tick_rate, sizeof(app->tick_rate));
+                Net_BufMemcpy(app, &input_tick_id, sizeof(input_tick_id));
+                Net_BufMemcpy(app, &work_us, sizeof(work_us));
+            }
+
+            Net_BufSend(app, *user);
+            app->net.buf_used = shared_buf_used;
+        }
+    }
+    else
+    {
+        Net_BufSend(app, app->net.server_user);
+    }
+
+    app->net.buf_used = 0;
+}
+
+//
+// Network thread
+// Owns the socket. Validates incoming datagrams and queues them
+// for the main thread; sends packets queued by the main thread.
+//
+static void Net_ThreadPushReceived(AppState *app, S8 msg, SDLNet_Address *address, Uint16 port)
+{
+    Net_Packet *packet = Net_RingPushBegin(&app->net.recv_ring);
+    if (!packet)
+    {
+        LogWarn(LogCat_Net, "%s: dgram dropped - receive ring is full", Net_Label(app));
+        return;
+    }
+
+    memcpy(packet->data, msg.str, msg.size);
+    packet->size = (Uint32)msg.size;
+    packet->address = SDLNet_RefAddress(address);
+    packet->port = port;
+    Net_RingPushCommit(&app->net.recv_ring);
+}
+
+static void Net_ReassemblyRelease(Net_Reassembly *slot)
+{
+    SDLNet_UnrefAddress(slot->address);
+    slot->address = 0;
+}
+
+static void Net_ReassemblyTimeout(AppState *app)
+{
+    Uint64 now = SDL_GetTicks();
+    ForU32(i, NET_REASSEMBLY_SLOTS)
+    {
+        Net_Reassembly *slot = app->net.reassembly + i;
+        if (slot->address &&
+            now > slot->first_receive_time + NET_REASSEMBLY_TIMEOUT_MS)
+        {
+            LogVerbose(LogCat_Net, "%s: message %u timed out with %d/%d fragments",
+                                   Net_Label(app), slot->message_id,
+                                   (int)slot->received_count,
+                                   (int)slot->fragment_count);
+            app->net.reassembly_timeouts += 1;
+            Net_ReassemblyRelease(slot);
+        }
+    }
+}
+
+static Net_Reassembly *Net_ReassemblyFind(AppState *app, SDLNet_Address *address, Uint16 port,
+                                          Net_FragmentHeader frag)
+{
+    Net_Reassembly *oldest = 0;
+    ForU32(i, NET_REASSEMBLY_SLOTS)
+    {
+        Net_Reassembly *slot = app->net.reassembly + i;
+        if (slot->address &&
+            slot->message_id == frag.message_id &&
+            slot->port == port &&
+            !SDLNet_CompareAddresses(slot->address, address))
+        {
+            return slot;
+        }
+
+        if (!oldest || !slot->address ||
+            (oldest->address && slot->first_receive_time < oldest->first_receive_time))
+        {
+            oldest = slot;
+        }
+    }
+
+    // start a new message; evict the oldest incomplete one if needed
+    if (oldest->address)
+    {
+        app->net.reassembly_timeouts += 1;
+        Net_ReassemblyRelease(oldest);
+    }
+
+    oldest->address = SDLNet_RefAddress(address);
+    oldest->port = port;
+    oldest->message_id = frag.message_id;
+    oldest->fragment_count = frag.fragment_count;
+    oldest->received_mask = 0;
+    oldest->received_count = 0;
+    oldest->size = 0;
+    oldest->first_receive_time = SDL_GetTicks();
+    return oldest;
+}
+
+static Net_Completed *Net_CompletedFind(AppState *app, SDLNet_Address *address, Uint16 port)
+{
+    ForArray(i, app->net.completed)
+    {
+        Net_Completed *completed = app->net.completed + i;
+        if (completed->address &&
+            completed->port == port &&
+            !SDLNet_CompareAddresses(completed->address, address))
+        {
+            return completed;
+        }
+    }
+    return 0;
+}
+
+static bool Net_CompletedContains(AppState *app, SDLNet_Address *address, Uint16 port,
+                                  Uint32 message_id)
+{
+    Net_Completed *completed = Net_CompletedFind(app, address, port);
+    if (!completed) return false;
+
+    ForU32(i, completed->message_count)
+    {
+        if (completed->message_ids[i] == message_id)
+            return true;
+    }
+    return false;
+}
+
+static void Net_CompletedPush(AppState *app, SDLNet_Address *address, Uint16 port,
+                              Uint32 message_id)
+{
+    Net_Completed *completed = Net_CompletedFind(app, address, port);
+    if (!completed)
+    {
+        // reuse the sender that completed a message least recently
+        completed = app->net.completed;
+        ForArray(i, app->net.completed)
+        {
+            Net_Completed *candidate = app->net.completed + i;
+            if (!candidate->address)
+            {
+                completed = candidate;
+                break;
+            }
+            if (candidate->last_complete_time < completed->last_complete_time)
+                completed = candidate;
+        }
+
+        if (completed->address)
+            SDLNet_UnrefAddress(completed->address);
+        SDL_zerop(completed);
+        completed->address = SDLNet_RefAddress(address);
+        completed->port = port;
+    }
+
+    completed->message_ids[completed->next_index] = message_id;
+    completed->next_index = (completed->next_index + 1) % NET_COMPLETED_MESSAGES;
+    completed->message_count = Min(completed->message_count + 1, NET_COMPLETED_MESSAGES);
+    completed->last_complete_time = SDL_GetTicks();
+}
+
+static void Net_ThreadReceiveFragment(AppState *app, S8 msg, SDLNet_Address *address, Uint16 port)
+{
+    Net_FragmentHeader frag;
+    if (msg.size < sizeof(frag))
+    {
+        LogWarn(LogCat_Net, "%s: dgram rejected - too small for FragmentHeader",
+                            Net_Label(app));
+        return;
+    }
+    memcpy(&frag, msg.str, sizeof(frag));
+    msg = S8_Skip(msg, sizeof(frag));
+
+    bool is_last = (frag.fragment_index + 1 == frag.fragment_count);
+    if (!frag.fragment_count ||
+        frag.fragment_count > NET_MAX_FRAGMENTS ||
+        frag.fragment_index >= frag.fragment_count ||
+        msg.size > NET_FRAGMENT_PAYLOAD ||
+        (!is_last && msg.size != NET_FRAGMENT_PAYLOAD))
+    {
+        LogWarn(LogCat_Net, "%s: dgram rejected - invalid fragment %d/%d of size %d",
+                            Net_Label(app), (int)frag.fragment_index,
+                            (int)frag.fragment_count, (int)msg.size);
+        return;
+    }
+
+    if (frag.fragment_count == 1)
+    {
+        Net_ThreadPushReceived(app, msg, address, port);
+        return;
+    }
+
+    if (Net_CompletedContains(app, address, port, frag.message_id))
+    {
+        app->net.late_fragments += 1;
+        return; // duplicate of a message that was already delivered
+    }
+
+    Net_Reassembly *slot = Net_ReassemblyFind(app, address, port, frag);
+    if (slot->fragment_count != frag.fragment_count)
+    {
+        LogWarn(LogCat_Net, "%s: dgram rejected - fragment count mismatch (%d != %d) for message %u",
+                            Net_Label(app), (int)frag.fragment_count,
+                            (int)slot->fragment_count, frag.message_id);
+        return;
+    }
+
+    Uint64 bit = 1llu << frag.fragment_index;
+    if (slot->received_mask & bit)
+        return; // duplicate
+
+    Uint32 offset = frag.fragment_index * NET_FRAGMENT_PAYLOAD;
+    if (offset + msg.size > sizeof(slot->data))
+    {
+        LogWarn(LogCat_Net, "%s: dgram rejected - message %u exceeds max message size",
+                            Net_Label(app), frag.message_id);
+        Net_ReassemblyRelease(slot);
+        return;
+    }
+
+    memcpy(slot->data + offset, msg.str, msg.size);
+    slot->received_mask |= bit;
+    slot->received_count += 1;
+    if (is_last)
+        slot->size = offset + (Uint32)msg.size;
 
-    NET_VERBOSE_LOG("%s: Sending buffer of size %d to %s:%d; %s",
-                    Net_Label(app), app->net.buf_used,
-                    SDLNet_GetAddressString(destination.address),
-                    (int)destination.port,
-                    send_res ? "success" : "fail");
+    if (slot->received_count == slot->fragment_count)
+    {
+        app->net.reassembled_messages += 1;
+        Net_CompletedPush(app, address, port, slot->message_id);
+        Net_ThreadPushReceived(app, S8_Make(slot->data, slot->size), address, port);
+        Net_ReassemblyRelease(slot);
+    }
 }
 
-static void Net_BufSendFlush(AppState *app)
+static void Net_ThreadReceive(AppState *app)
 {
-    if (app->net.is_server)
+    bool is_client = !app->net.is_server;
+
+    for (;;)
     {
-        ForU32(i, app->net.user_count)
+        SDLNet_Datagram *dgram = 0;
+        int receive = SDLNet_ReceiveDatagram(app->net.socket, &dgram);
+        if (!receive) break;
+        if (!dgram) break;
+
+        LogVerbose(LogCat_Net, "%s: got %d-byte datagram from %s:%d",
+                               Net_Label(app),
+                               (int)dgram->buflen,
+                               SDLNet_GetAddressString(dgram->addr),
+                               (int)dgram->port);
+
+        if (is_client)
         {
-            Net_BufSend(app, app->net.users[i]);
+            if (!Net_UserMatchAddrPort(app->net.server_user, dgram->addr, dgram->port))
+            {
+                LogWarn(LogCat_Net, "%s: dgram rejected - received from non-server address %s:%d",
+                                    Net_Label(app),
+                                    SDLNet_GetAddressString(dgram->addr), (int)dgram->port);
+                goto datagram_cleanup;
+            }
         }
-    }
-    else
-    {
-        Net_BufSend(app, app->net.server_user);
-    }
 
-    app->net.buf_used = 0;
-}
+        S8 msg = S8_Make(dgram->buf, dgram->buflen);
 
-static bool Net_ConsumeMsg(S8 *msg, void *dest, Uint64 size)
-{
-    Uint64 copy_size = Min(size, msg->size);
-    bool err = copy_size != size;
+        // validate header
+        {
+            if (msg.size < sizeof(Net_BufHeader))
+            {
+                LogWarn(LogCat_Net, "%s: dgram rejected - too small for BufHeader",
+                                    Net_Label(app));
+                goto datagram_cleanup;
+            }
 
-    if (err)
-        memset(dest, 0, size); // fill dest with zeroes
+            Net_BufHeader header;
+            memcpy(&header, msg.str, sizeof(header));
+            msg = S8_Skip(msg, sizeof(header));
 
-    memcpy(dest, msg->str, copy_size);
-    *msg = S8_Skip(*msg, size);
+            if (header.magic_value != NET_MAGIC_VALUE)
+            {
+                LogWarn(LogCat_Net, "%s: dgram rejected - invalid magic value %llu",
+                                    Net_Label(app), header.magic_value);
+                goto datagram_cleanup;
+            }
 
-    return err;
-}
+            Uint64 msg_hash = S8_Hash(0, msg);
+            if (header.hash != msg_hash)
+            {
+                LogWarn(LogCat_Net, "%s: dgram rejected - dgram hash (%llu) != calculated hash (%llu)",
+                                    Net_Label(app), header.hash, msg_hash);
+                goto datagram_cleanup;
+            }
+        }
 
-static bool Net_UserMatch(Net_User a, Net_User b)
-{
-    return (a.port == b.port &&
-            SDLNet_CompareAddresses(a.address, b.address) == 0);
+        Net_ThreadReceiveFragment(app, msg, dgram->addr, dgram->port);
+
+        datagram_cleanup:
+        SDLNet_DestroyDatagram(dgram);
+    }
+
+    Net_ReassemblyTimeout(app);
 }
 
-static bool Net_UserMatchAddrPort(Net_User a, SDLNet_Address *address, Uint16 port)
+// Writes headers and chunk (at most NET_FRAGMENT_PAYLOAD bytes) to dgram;
+// returns the datagram size.
+static Uint64 Net_PackDatagram(Uint8 dgram[NET_MTU], Net_FragmentHeader frag, S8 chunk)
 {
-    return (a.port == port &&
-            SDLNet_CompareAddresses(a.address, address) == 0);
+    Assert(chunk.size <= NET_FRAGMENT_PAYLOAD);
+    Uint64 dgram_size = sizeof(Net_BufHeader) + sizeof(frag) + chunk.size;
+    memcpy(dgram + sizeof(Net_BufHeader), &frag, sizeof(frag));
+    memcpy(dgram + sizeof(Net_BufHeader) + sizeof(frag), chunk.str, chunk.size);
+
+    Net_BufHeader header = {};
+    header.magic_value = NET_MAGIC_VALUE;
+    S8 msg = S8_Make(dgram, dgram_size);
+    msg = S8_Skip(msg, sizeof(header));
+    header.hash = S8_Hash(0, msg);
+    memcpy(dgram, &header, sizeof(header));
+    return dgram_size;
 }
 
-static Net_User *Net_FindUser(AppState *app, SDLNet_Address *address, Uint16 port)
+static void Net_ThreadSend(AppState *app)
 {
-    ForU32(i, app->net.user_count)
+    for (;;)
     {
-        if (Net_UserMatchAddrPort(app->net.users[i], address, port))
-            return app->net.users + i;
+        Net_Packet *packet = Net_RingPopBegin(&app->net.send_ring);
+        if (!packet) break;
+
+        Net_FragmentHeader frag = {};
+        frag.message_id = app->net.send_message_id++;
+        frag.fragment_count = (Uint16)Max(1, (packet->size + NET_FRAGMENT_PAYLOAD - 1) / NET_FRAGMENT_PAYLOAD);
+        Assert(frag.fragment_count <= NET_MAX_FRAGMENTS);
+
+        if (frag.fragment_count > 1)
+        {
+            app->net.fragmented_messages += 1;
+            LogVerbose(LogCat_Net, "%s: message of size %d exceeds MTU (%d); splitting into %d fragments",
+                                   Net_Label(app), (int)packet->size, NET_MTU, (int)frag.fragment_count);
+        }
+
+        S8 payload = S8_Make(packet->data, packet->size);
+        for (; frag.fragment_index < frag.fragment_count; frag.fragment_index += 1)
+        {
+            S8 chunk = S8_Prefix(payload, NET_FRAGMENT_PAYLOAD);
+            payload = S8_Skip(payload, chunk.size);
+
+            Uint8 dgram[NET_MTU];
+            Uint64 dgram_size = Net_PackDatagram(dgram, frag, chunk);
+
+            bool send_res = SDLNet_SendDatagram(app->net.socket,
+                                                packet->address,
+                                                packet->port,
+                                                dgram, (int)dgram_size);
+            app->net.sent_fragments += 1;
+
+            LogVerbose(LogCat_Net, "%s: Sending fragment %d/%d of size %d to %s:%d; %s",
+                                   Net_Label(app),
+                                   (int)frag.fragment_index + 1, (int)frag.fragment_count,
+                                   (int)dgram_size,
+                                   SDLNet_GetAddressString(packet->address),
+                                   (int)packet->port,
+                                   send_res ? "success" : "fail");
+        }
+
+        SDLNet_UnrefAddress(packet->address);
+        Net_RingPopEnd(&app->net.send_ring);
     }
-    return 0;
 }
 
-static Net_User *Net_AddUser(AppState *app, SDLNet_Address *address, Uint16 port)
+static int Net_ThreadMain(void *data)
 {
-    if (app->net.user_count < ArrayCount(app->net.users))
+    AppState *app = (AppState *)data;
+    while (!SDL_GetAtomicInt(&app->net.thread_quit))
     {
-        Net_User *user = app->net.users + app->net.user_count;
-        app->net.user_count += 1;
-        user->address = SDLNet_RefAddress(address);
-        user->port = port;
-        return user;
+        Net_ThreadSend(app);
+        Net_ThreadReceive(app);
+
+        // wake up at least every 1ms to flush the send ring
+        void *sockets[] = { app->net.socket };
+        SDLNet_WaitUntilInputAvailable(sockets, ArrayCount(sockets), 1);
     }
     return 0;
 }
@@ -127,23 +1063,25 @@ static void Net_IterateSend(AppState *app)
     bool is_client = !app->net.is_server;
     if (app->net.err) return;
 
+    // send at most one packet per simulated tick
+    if (app->net.last_send_tick_id == app->tick_id)
+        return;
+    app->net.last_send_tick_id = app->tick_id;
+
+    app->net.buf_capacity = NET_BUF_SIZE;
+    app->net.buf = Arena_PushArrayNoZero(&app->frame_arena, Uint8, app->net.buf_capacity);
+    app->net.buf_used = 0;
+    if (!app->net.buf)
     {
-        // hacky temporary network activity rate-limitting
-        static Uint64 last_timestamp = 0;
-        if (app->frame_time < last_timestamp + 1000)
-            return;
-        last_timestamp = app->frame_time;
+        app->net.buf_capacity = 0;
+        return;
     }
 
-    Net_BufHeader header = {};
-    header.magic_value = NET_MAGIC_VALUE;
-    Uint8 *buf_header = Net_BufAlloc(app, sizeof(Net_BufHeader));
-
-    if (is_server)
+    if (is_server && !app->lockstep.enabled)
     {
         if (NET_OLD_PROTOCOL)
         {
-            ForArray(i, app->network_ids)
+            ForU32(i, app->network_slot_count)
             {
                 Object *obj = Object_Network(app, i);
                 if (Object_IsZero(app, obj))
@@ -162,181 +1100,424 @@ static void Net_IterateSend(AppState *app)
         }
         else
         {
-            Tick_Command cmd = {};
-            cmd.tick_id = app->tick_id;
-            cmd.kind = Tick_Cmd_ObjHistory;
-            Net_BufMemcpy(app, &cmd, sizeof(cmd));
-
-            if (app->netobj_state_next + 1 < ArrayCount(app->netobj_states)) // copy range (next..Max)
-            {
-                Uint64 start = app->netobj_state_next + 1;
-                Uint64 states_to_copy = ArrayCount(app->netobj_states) - start;
-                Net_BufMemcpy(app, app->netobj_states + start, states_to_copy*sizeof(Tick_NetworkObjState));
-            }
-
-            if (app->netobj_state_next > 0) // copy range [0..next)
-            {
-                Uint64 states_to_copy = app->netobj_state_next - 1;
-                Net_BufMemcpy(app, app->netobj_states, states_to_copy*sizeof(Tick_NetworkObjState));
-            }
+            // snapshots are filtered per user, see Net_BufSendFlush
+            Interest_Update(app);
         }
     }
 
     if (is_client)
     {
-        // empty msg
+        Net_BufInputs(app);
+        if (app->lockstep.enabled)
+            Net_BufLockstepAck(app);
     }
 
-    S8 msg = S8_Make(app->net.buf, app->net.buf_used);
-    msg = S8_Skip(msg, sizeof(header));
-    header.hash = S8_Hash(0, msg);
-    memcpy(buf_header, &header, sizeof(header));
     Net_BufSendFlush(app);
 }
 
-static void Net_IterateReceive(AppState *app)
+// Commands sent by a client; replay feeds recorded messages through here too.
+static void Net_ReceiveFromUser(AppState *app, Net_User *user, Net_Reader reader)
 {
-    bool is_server = app->net.is_server;
-    bool is_client = !app->net.is_server;
-    if (app->net.err) return;
-
-    {
-        // hacky temporary network activity rate-limitting
-        static Uint64 last_timestamp = 0;
-        if (app->frame_time < last_timestamp + 1000)
-            return;
-        last_timestamp = app->frame_time;
-    }
-
-    for (;;)
+    while (reader.msg.size)
     {
-        SDLNet_Datagram *dgram = 0;
-        int receive = SDLNet_ReceiveDatagram(app->net.socket, &dgram);
-        if (!receive) break;
-        if (!dgram) break;
-
-        NET_VERBOSE_LOG("%s: got %d-byte datagram from %s:%d",
-                        Net_Label(app),
-                        (int)dgram->buflen,
-                        SDLNet_GetAddressString(dgram->addr),
-                        (int)dgram->port);
-
-        if (is_client)
+        Tick_Command cmd = Net_ReadCommand(&reader);
+        if (reader.err)
         {
-            if (!Net_UserMatchAddrPort(app->net.server_user, dgram->addr, dgram->port))
-            {
-                SDL_Log("%s: dgram rejected - received from non-server address %s:%d",
-                        Net_Label(app),
-                        SDLNet_GetAddressString(dgram->addr), (int)dgram->port);
-                goto datagram_cleanup;
-            }
+            LogWarn(LogCat_Net, "%s: Command truncated", Net_Label(app));
+            return;
         }
 
-        S8 msg = S8_Make(dgram->buf, dgram->buflen);
-
-        // validate header
+        if (cmd.kind == Tick_Cmd_Input)
         {
-            if (msg.size < sizeof(Net_BufHeader))
+            Uint8 input_count = Net_ReadU8(&reader);
+            Uint16 changed_mask = Net_ReadU16(&reader);
+            if (reader.err || input_count > NET_INPUT_REDUNDANCY || !(changed_mask & 1))
             {
-                SDL_Log("%s: dgram rejected - too small for BufHeader",
-                        Net_Label(app));
-                goto datagram_cleanup;
+                LogWarn(LogCat_Net, "%s: Invalid Input cmd header", Net_Label(app));
+                return;
             }
 
-            Net_BufHeader header;
-            memcpy(&header, msg.str, sizeof(header));
-            msg = S8_Skip(msg, sizeof(header));
-
-            if (header.magic_value != NET_MAGIC_VALUE)
+            // validate size of all changed inputs at once
+            Uint32 changed_count = 0;
+            ForU32(i, input_count)
+                changed_count += (changed_mask >> i) & 1;
+            Uint8 *packed = Net_ReadView(&reader, changed_count * 2 * sizeof(Sint8));
+            if (!packed)
             {
-                SDL_Log("%s: dgram rejected - invalid magic value %llu",
-                        Net_Label(app), header.magic_value);
-                goto datagram_cleanup;
+                LogWarn(LogCat_Net, "%s: Input cmd truncated", Net_Label(app));
+                return;
             }
 
-            Uint64 msg_hash = S8_Hash(0, msg);
-            if (header.hash != msg_hash)
+            Sint8 *value = 0; // bit 0 is always set, so it's assigned before use
+            ForU32(i, input_count)
             {
-                SDL_Log("%s: dgram rejected - dgram hash (%llu) != calculated hash (%llu)",
-                        Net_Label(app), header.hash, msg_hash);
-                goto datagram_cleanup;
+                if (changed_mask & (1 << i))
+                {
+                    value = (Sint8 *)packed;
+                    packed += 2 * sizeof(Sint8);
+                }
+
+                Tick_Input input = {};
+                input.tick_id = cmd.tick_id - i;
+                input.move_dir.x = Net_DequantizeUnit(value[0]);
+                input.move_dir.y = Net_DequantizeUnit(value[1]);
+                Net_UserPushInput(app, user, input);
             }
         }
+        else if (cmd.kind == Tick_Cmd_LockstepAck)
+        {
+            // acks can be reordered; 0 (client needs a baseline) always wins
+            user->lockstep_ack_tick_id = (cmd.tick_id ? Max(user->lockstep_ack_tick_id, cmd.tick_id) : 0);
+        }
+        else
+        {
+            LogWarn(LogCat_Net, "%s: Unsupported cmd kind: %d",
+                                Net_Label(app), (int)cmd.kind);
+            return;
+        }
+    }
+}
+
+static void Net_IterateReceive(AppState *app)
+{
+    bool is_server = app->net.is_server;
+    bool is_client = !app->net.is_server;
+    if (app->net.err) return;
+
+    for (;;)
+    {
+        Net_Packet *packet = Net_RingPopBegin(&app->net.recv_ring);
+        if (!packet) break;
+
+        // header was validated and fragments reassembled by the network thread
+        Net_Reader reader = { S8_Make(packet->data, packet->size) };
+        app->jitter.received_bytes += packet->size;
 
         if (is_server)
         {
-            if (!Net_FindUser(app, dgram->addr, dgram->port))
+            Net_User *user = Net_FindUser(app, packet->address, packet->port);
+            if (!user)
             {
-                SDL_Log("%s: saving user with port: %d",
-                        Net_Label(app), (int)dgram->port);
-                Net_AddUser(app, dgram->addr, dgram->port);
+                LogInfo(LogCat_Net, "%s: saving user with port: %d",
+                                    Net_Label(app), (int)packet->port);
+                user = Net_AddUser(app, packet->address, packet->port);
             }
+
+            if (!user)
+            {
+                LogWarn(LogCat_Net, "%s: dgram rejected - user limit reached",
+                                    Net_Label(app));
+                goto packet_cleanup;
+            }
+            user->last_receive_time = app->frame_time;
+
+            Replay_RecordMessage(app, user, reader.msg);
+            Net_ReceiveFromUser(app, user, reader);
         }
 
         if (is_client)
         {
-            while (msg.size)
+            while (reader.msg.size)
             {
-                Tick_Command cmd;
-                Net_ConsumeMsg(&msg, &cmd, sizeof(cmd));
+                Tick_Command cmd = Net_ReadCommand(&reader);
+                if (reader.err)
+                {
+                    LogWarn(LogCat_Net, "%s: Command truncated", Net_Label(app));
+                    goto packet_cleanup;
+                }
 
                 if (cmd.kind == Tick_Cmd_NetworkObj)
                 {
-                    Tick_NetworkObj msg_obj;
-                    Net_ConsumeMsg(&msg, &msg_obj, sizeof(msg_obj));
+                    // Object followed by Uint32 network slot; see Net_IterateSend
+                    Uint8 *src = Net_ReadView(&reader, sizeof(Object) + sizeof(Uint32));
+                    if (!src)
+                    {
+                        LogWarn(LogCat_Net, "%s: NetworkObj truncated", Net_Label(app));
+                        goto packet_cleanup;
+                    }
 
-                    if (msg_obj.network_slot >= ArrayCount(app->network_ids))
+                    Uint32 network_slot = Net_LoadU32(src + sizeof(Object));
+                    if (!Object_ReserveNetworkSlot(app, network_slot))
                     {
-                        SDL_Log("%s: Network slot overflow: %d",
-                                Net_Label(app), (int)msg_obj.network_slot);
-                        goto datagram_cleanup;
+                        LogWarn(LogCat_Net, "%s: Network slot overflow: %d",
+                                            Net_Label(app), (int)network_slot);
+                        goto packet_cleanup;
                     }
 
-                    if (!app->network_ids[msg_obj.network_slot])
+                    if (!app->network_handles[network_slot])
                     {
-                        app->network_ids[msg_obj.network_slot] =
-                            Object_IdFromPointer(app, Object_Create(app, 0, 0));
+                        app->network_handles[network_slot] =
+                            Object_HandleFromPointer(app, Object_Create(app, 0, 0));
                     }
 
-                    Object *obj = Object_Network(app, msg_obj.network_slot);
-                    *obj = msg_obj.obj;
+                    Object obj;
+                    memcpy(&obj, src, sizeof(obj));
+                    Object_Assign(app, Object_Network(app, network_slot), &obj);
                 }
                 else if (cmd.kind == Tick_Cmd_ObjHistory)
                 {
-                    Tick_NetworkObjHistory history;
-                    Net_ConsumeMsg(&msg, &history, sizeof(history));
+                    Uint32 state_count = Net_ReadU32(&reader);
+                    if (reader.err || state_count > NET_MAX_TICK_HISTORY)
+                    {
+                        LogWarn(LogCat_Net, "%s: Invalid ObjHistory state count: %d",
+                                            Net_Label(app), (int)state_count);
+                        goto packet_cleanup;
+                    }
+
+                    ForU32(state_index, state_count)
+                    {
+                        Uint64 tick_id = Net_ReadU64(&reader);
+                        Uint32 entry_count = Net_ReadU32(&reader);
+
+                        Uint64 entry_size = sizeof(Uint32) + sizeof(Object);
+                        Uint8 *entries = 0;
+                        if (!reader.err && entry_count <= NET_MAX_NETWORK_OBJECTS)
+                            entries = Net_ReadView(&reader, entry_count * entry_size);
+
+                        if (!entries)
+                        {
+                            LogWarn(LogCat_Net, "%s: ObjHistory truncated at state %d/%d",
+                                                Net_Label(app), (int)state_index, (int)state_count);
+                            goto packet_cleanup;
+                        }
+
+                        Tick_NetworkObjState *state = Jitter_InsertBegin(&app->jitter, tick_id);
+                        if (!state)
+                            continue; // already have it from an earlier packet
+
+                        // entries are sorted by slot; size the state once up front
+                        if (entry_count)
+                        {
+                            Uint32 last_slot = Net_LoadU32(entries + (entry_count - 1) * entry_size);
+                            if (last_slot < NET_MAX_NETWORK_OBJECTS)
+                                Object_NetworkStateResize(state, last_slot + 1);
+                        }
+
+                        ForU32(entry_index, entry_count)
+                        {
+                            Uint8 *entry = entries + entry_index * entry_size;
+                            Uint32 slot = Net_LoadU32(entry);
+                            if (slot >= NET_MAX_NETWORK_OBJECTS)
+                            {
+                                LogWarn(LogCat_Net, "%s: Network slot overflow: %d",
+                                                    Net_Label(app), (int)slot);
+                                goto packet_cleanup;
+                            }
+
+                            if (slot >= state->obj_count)
+                                Object_NetworkStateResize(state, slot + 1);
+                            memcpy(state->objs + slot, entry + sizeof(Uint32), sizeof(Object));
+                        }
+
+                        Jitter_InsertEnd(app, state, tick_id);
+                    }
+
+                    Jitter_OnPacket(app, cmd.tick_id);
+                }
+                else if (cmd.kind == Tick_Cmd_Lockstep)
+                {
+                    Uint64 cmd_size = reader.msg.size;
+                    if (!app->lockstep.enabled)
+                    {
+                        LogInfo(LogCat_Net, "%s: Server runs in lockstep mode", Net_Label(app));
+                        app->lockstep.enabled = true;
+                    }
+
+                    Uint8 has_baseline = Net_ReadU8(&reader);
+                    if (has_baseline)
+                    {
+                        Uint64 tick_id = Net_ReadU64(&reader);
+                        Uint32 entry_count = Net_ReadU32(&reader);
+
+                        Uint64 entry_size = sizeof(Uint32) + sizeof(Object);
+                        Uint8 *entries = 0;
+                        if (!reader.err && entry_count <= NET_MAX_NETWORK_OBJECTS)
+                            entries = Net_ReadView(&reader, entry_count * entry_size);
+
+                        if (!entries)
+                        {
+                            LogWarn(LogCat_Net, "%s: Lockstep baseline truncated", Net_Label(app));
+                            goto packet_cleanup;
+                        }
+
+                        // only when waiting for one; validate everything before
+                        // network objects are replaced
+                        if (!app->lockstep.sim_tick_id && tick_id)
+                        {
+                            ForU32(entry_index, entry_count)
+                            {
+                                Uint8 *entry = entries + entry_index * entry_size;
+                                Object obj;
+                                memcpy(&obj, entry + sizeof(Uint32), sizeof(obj));
+                                if (Net_LoadU32(entry) >= NET_MAX_NETWORK_OBJECTS || !Lockstep_ValidObject(app, &obj))
+                                {
+                                    LogWarn(LogCat_Net, "%s: Invalid lockstep baseline object", Net_Label(app));
+                                    goto packet_cleanup;
+                                }
+                            }
+
+                            Lockstep_BeginBaseline(app);
+                            ForU32(entry_index, entry_count)
+                            {
+                                Uint8 *entry = entries + entry_index * entry_size;
+                                Object obj;
+                                memcpy(&obj, entry + sizeof(Uint32), sizeof(obj));
+                                Lockstep_BaselineObject(app, Net_LoadU32(entry), &obj);
+                            }
+                            Lockstep_EndBaseline(app, tick_id);
+                        }
+                    }
+
+                    Uint64 first_tick_id = Net_ReadU64(&reader);
+                    Uint32 frame_count = Net_ReadU32(&reader);
+                    if (reader.err || frame_count > LOCKSTEP_FRAME_HISTORY)
+                    {
+                        LogWarn(LogCat_Net, "%s: Invalid lockstep frame count: %d",
+                                            Net_Label(app), (int)frame_count);
+                        goto packet_cleanup;
+                    }
+
+                    ForU32(frame_index, frame_count)
+                    {
+                        Uint64 tick_id = first_tick_id + frame_index;
+                        Uint32 hash = Net_ReadU32(&reader);
+                        Uint8 entry_count = Net_ReadU8(&reader);
+                        if (reader.err || entry_count > LOCKSTEP_MAX_PLAYERS)
+                        {
+                            LogWarn(LogCat_Net, "%s: Invalid lockstep frame %d/%d",
+                                                Net_Label(app), (int)frame_index, (int)frame_count);
+                            goto packet_cleanup;
+                        }
+
+                        Lockstep_Frame *frame = Lockstep_InsertBegin(app, tick_id);
+                        ForU32(entry_index, entry_count)
+                        {
+                            Uint8 *src = Net_ReadView(&reader, sizeof(Uint16) + 2 * sizeof(Sint8));
+                            if (!src)
+                            {
+                                LogWarn(LogCat_Net, "%s: Lockstep frame truncated", Net_Label(app));
+                                goto packet_cleanup;
+                            }
+
+                            Uint16 network_slot = Net_LoadU16(src);
+                            bool spawned = (network_slot & LOCKSTEP_SPAWNED);
+                            network_slot &= ~LOCKSTEP_SPAWNED;
+
+                            V2 spawn_p = {};
+                            if (spawned)
+                            {
+                                Uint8 *p_src = Net_ReadView(&reader, sizeof(spawn_p));
+                                if (!p_src)
+                                {
+                                    LogWarn(LogCat_Net, "%s: Lockstep frame truncated", Net_Label(app));
+                                    goto packet_cleanup;
+                                }
+                                memcpy(&spawn_p, p_src, sizeof(spawn_p));
+                            }
+
+                            if (network_slot >= NET_MAX_NETWORK_OBJECTS)
+                            {
+                                LogWarn(LogCat_Net, "%s: Network slot overflow: %d",
+                                                    Net_Label(app), (int)network_slot);
+                                goto packet_cleanup;
+                            }
+
+                            if (frame)
+                            {
+                                Lockstep_Entry *entry = frame->entries + entry_index;
+                                SDL_zerop(entry);
+                                entry->network_slot = network_slot;
+                                entry->move_dir.x = Net_DequantizeUnit((Sint8)src[2]);
+                                entry->move_dir.y = Net_DequantizeUnit((Sint8)src[3]);
+                                entry->spawned = spawned;
+                                entry->spawn_p = spawn_p;
+                            }
+                        }
+
+                        if (frame)
+                        {
+                            frame->hash = hash;
+                            frame->entry_count = entry_count;
+                            Lockstep_InsertEnd(app, frame, tick_id);
+                        }
+                    }
+
+                    app->lockstep.bytes += cmd_size - reader.msg.size;
+                }
+                else if (cmd.kind == Tick_Cmd_UserInfo)
+                {
+                    Uint32 network_slot = Net_ReadU32(&reader);
+                    Uint32 tick_rate = Net_ReadU32(&reader);
+                    Net_ReadU64(&reader); // input_tick_id; used by loadgen bots to measure input latency
+                    Uint32 work_us = Net_ReadU32(&reader);
+                    if (reader.err || !tick_rate || tick_rate > TICK_RATE_MAX)
+                    {
+                        LogWarn(LogCat_Net, "%s: Invalid UserInfo", Net_Label(app));
+                        goto packet_cleanup;
+                    }
+                    app->player_network_slot = network_slot;
+                    app->net.server_work_us = work_us;
+
+                    if (app->tick_rate != tick_rate)
+                    {
+                        LogInfo(LogCat_Net, "%s: Server tick rate: %u", Net_Label(app), tick_rate);
+                        app->tick_rate = tick_rate;
+                        app->time_step = 1.f / (float)tick_rate;
 
-                    // @todo handle
-                    Assert(false);
+                        // jitter buffer clock is measured in ticks
+                        app->jitter.clock_initialized = false;
+                        app->jitter.playback_tick = 0;
+                    }
                 }
                 else
                 {
-                    SDL_Log("%s: Unsupported cmd kind: %d",
-                            Net_Label(app), (int)cmd.kind);
-                    goto datagram_cleanup;
+                    LogWarn(LogCat_Net, "%s: Unsupported cmd kind: %d",
+                                        Net_Label(app), (int)cmd.kind);
+                    goto packet_cleanup;
                 }
             }
         }
 
-        datagram_cleanup:
-        SDLNet_DestroyDatagram(dgram);
+        packet_cleanup:
+        SDLNet_UnrefAddress(packet->address);
+        Net_RingPopEnd(&app->net.recv_ring);
+    }
+
+    if (is_server)
+    {
+        Net_TimeoutUsers(app);
     }
 }
 
+static void Net_ReportStats(AppState *app)
+{
+    // @info(mg) Counters are written by the network thread;
+    //           a slightly stale read is fine for stats.
+    LogInfo(LogCat_Net, "%s: sent %llu fragments; split %llu oversized messages; "
+                        "reassembled %llu, timed out %llu messages; %llu late fragments; "
+                        "ring drops send %llu recv %llu",
+                        Net_Label(app), app->net.sent_fragments, app->net.fragmented_messages,
+                        app->net.reassembled_messages, app->net.reassembly_timeouts,
+                        app->net.late_fragments,
+                        app->net.send_ring.dropped, app->net.recv_ring.dropped);
+}
+
 static void Net_Init(AppState *app)
 {
     bool is_server = app->net.is_server;
     bool is_client = !app->net.is_server;
 
-    SDL_Log(is_server ? "Launching as server" : "Launching as client");
+    LogInfo(LogCat_Net, "%s", is_server ? "Launching as server" : "Launching as client");
+    if (is_server && app->lockstep.enabled)
+        LogInfo(LogCat_Net, "%s: Lockstep mode; only inputs are sent", Net_Label(app));
 
     if (is_client)
     {
         const char *hostname = "localhost";
-        SDL_Log("%s: Resolving server hostname '%s' ...",
-                Net_Label(app), hostname);
+        LogInfo(LogCat_Net, "%s: Resolving server hostname '%s' ...",
+                            Net_Label(app), hostname);
         app->net.server_user.address = SDLNet_ResolveHostname(hostname);
-        app->net.server_user.port = NET_DEFAULT_SEVER_PORT;
+        app->net.server_user.port = app->net.port;
         if (app->net.server_user.address)
         {
             if (SDLNet_WaitUntilResolved(app->net.server_user.address, -1) < 0)
@@ -349,27 +1530,118 @@ static void Net_Init(AppState *app)
         if (!app->net.server_user.address)
         {
             app->net.err = true;
-            SDL_Log("%s: Failed to resolve server hostname '%s'",
-                    Net_Label(app), hostname);
+            LogError(LogCat_Net, "%s: Failed to resolve server hostname '%s'",
+                                 Net_Label(app), hostname);
         }
     }
 
-    Uint16 port = (app->net.is_server ? NET_DEFAULT_SEVER_PORT : 0);
+    // rings and reassembly slots are only touched once packets flow
+    Uint64 ring_bytes = NET_RING_SIZE * sizeof(Net_Packet);
+    Uint64 reassembly_bytes = NET_REASSEMBLY_SLOTS * sizeof(Net_Reassembly);
+    if (Arena_Init(&app->net.arena, "net", 2 * ring_bytes + reassembly_bytes + 3 * ARENA_DEFAULT_ALIGN))
+    {
+        app->net.recv_ring.packets = Arena_PushArrayNoZero(&app->net.arena, Net_Packet, NET_RING_SIZE);
+        app->net.send_ring.packets = Arena_PushArrayNoZero(&app->net.arena, Net_Packet, NET_RING_SIZE);
+        app->net.reassembly = Arena_PushArrayNoZero(&app->net.arena, Net_Reassembly, NET_REASSEMBLY_SLOTS);
+    }
+    if (!app->net.recv_ring.packets || !app->net.send_ring.packets || !app->net.reassembly)
+    {
+        app->net.err = true;
+        app->net.reassembly = 0;
+        LogError(LogCat_Net, "%s: Failed to allocate packet rings", Net_Label(app));
+        return;
+    }
+    ForU32(i, NET_REASSEMBLY_SLOTS)
+        app->net.reassembly[i].address = 0;
+
+    Uint16 port = (app->net.is_server ? app->net.port : 0);
     app->net.socket = SDLNet_CreateDatagramSocket(0, port);
     if (!app->net.socket)
     {
         app->net.err = true;
-        SDL_Log("%s: Failed to create socket",
-                Net_Label(app));
+        LogError(LogCat_Net, "%s: Failed to create socket",
+                             Net_Label(app));
     }
     else
     {
-        SDL_Log("%s: Created socket",
-                Net_Label(app));
+        LogInfo(LogCat_Net, "%s: Created socket",
+                            Net_Label(app));
+
+        app->net.thread = SDL_CreateThread(Net_ThreadMain, "demongus net", app);
+        if (!app->net.thread)
+        {
+            app->net.err = true;
+            LogError(LogCat_Net, "%s: Failed to create network thread: %s",
+                                 Net_Label(app), SDL_GetError());
+        }
     }
 }
 
-static void Net_Deinit()
+static void Net_Deinit(AppState *app)
 {
-    Assert(!"@todo");
+    if (app->net.thread)
+    {
+        SDL_SetAtomicInt(&app->net.thread_quit, 1);
+        SDL_WaitThread(app->net.thread, 0);
+        app->net.thread = 0;
+    }
+
+    // release addresses of packets that are still in flight
+    Net_PacketRing *rings[] = { &app->net.recv_ring, &app->net.send_ring };
+    ForArray(i, rings)
+    {
+        for (;;)
+        {
+            Net_Packet *packet = Net_RingPopBegin(rings[i]);
+            if (!packet) break;
+            SDLNet_UnrefAddress(packet->address);
+            Net_RingPopEnd(rings[i]);
+        }
+    }
+
+    if (app->net.reassembly)
+    {
+        ForU32(i, NET_REASSEMBLY_SLOTS)
+        {
+            if (app->net.reassembly[i].address)
+                Net_ReassemblyRelease(app->net.reassembly + i);
+        }
+    }
+
+    ForArray(i, app->net.completed)
+    {
+        if (app->net.completed[i].address)
+            SDLNet_UnrefAddress(app->net.completed[i].address);
+        SDL_zerop(app->net.completed + i);
+    }
+
+    ForU32(i, app->net.user_count)
+    {
+        if (app->net.users[i].address)
+            SDLNet_UnrefAddress(app->net.users[i].address);
+        Visibility_Free(&app->net.users[i].visibility);
+    }
+    app->net.user_count = 0;
+    Arena_Release(&app->net.user_arena);
+    Arena_Release(&app->net.user_table_arena);
+    Arena_Release(&app->net.arena);
+    app->net.recv_ring.packets = 0;
+    app->net.send_ring.packets = 0;
+    app->net.reassembly = 0;
+    app->net.users = 0;
+    app->net.user_table = 0;
+    app->net.user_capacity = 0;
+    app->net.user_table_capacity = 0;
+
+    if (app->net.server_user.address)
+    {
+        SDLNet_UnrefAddress(app->net.server_user.address);
+        app->net.server_user.address = 0;
+    }
+
+    if (app->net.socket)
+    {
+        SDLNet_DestroyDatagramSocket(app->net.socket);
+        app->net.socket = 0;
+    }
 }
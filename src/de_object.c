@@ -1,8 +1,7 @@
-static Object *Object_Get(AppState *app, Uint32 id)
+static Object *Object_Get(AppState *app, Uint32 dense_index)
 {
-    Assert(app->object_count < ArrayCount(app->object_pool));
-    Assert(id < app->object_count);
-    return app->object_pool + id;
+    Assert(dense_index < app->object_count);
+    return app->object_pool + dense_index;
 }
 
 static bool Object_IsZero(AppState *app, Object *obj)
@@ -10,61 +9,353 @@ static bool Object_IsZero(AppState *app, Object *obj)
     return obj == app->object_pool + 0;
 }
 
-static Object *Object_Network(AppState *app, Uint32 network_slot)
+//
+// Handles
+//
+static Object_Handle Object_MakeHandle(Uint32 slot_index, Uint32 generation)
+{
+    Assert(slot_index <= OBJECT_HANDLE_INDEX_MASK);
+    return (generation << OBJECT_HANDLE_INDEX_BITS) | slot_index;
+}
+
+static Uint32 Object_HandleSlotIndex(Object_Handle handle)
 {
-    if (network_slot >= ArrayCount(app->network_ids))
+    return handle & OBJECT_HANDLE_INDEX_MASK;
+}
+
+static Uint32 Object_HandleGeneration(Object_Handle handle)
+{
+    return handle >> OBJECT_HANDLE_INDEX_BITS;
+}
+
+// Returns the nil object for stale or invalid handles.
+static Object *Object_FromHandle(AppState *app, Object_Handle handle)
+{
+    Uint32 slot_index = Object_HandleSlotIndex(handle);
+    if (slot_index >= app->object_handle_count)
         return Object_Get(app, 0);
 
-    Uint32 id = app->network_ids[network_slot];
-    return Object_Get(app, id);
+    Object_HandleSlot *slot = app->object_handles + slot_index;
+    if (slot->generation != Object_HandleGeneration(handle))
+        return Object_Get(app, 0); // object was destroyed
+
+    return Object_Get(app, slot->dense_index);
 }
 
-// @info(mg) This function will probably be replaced in the future
-//           when we track 'key/index' in the object itself.
-static Uint32 Object_IdFromPointer(AppState *app, Object *obj)
+static Uint32 Object_DenseIndex(AppState *app, Object *obj)
 {
     size_t byte_delta = (size_t)obj - (size_t)app->object_pool;
-    size_t id = byte_delta / sizeof(*obj);
-    Assert(id < ArrayCount(app->object_pool));
-    return (Uint32)id;
+    size_t dense_index = byte_delta / sizeof(*obj);
+    Assert(dense_index < app->object_count);
+    return (Uint32)dense_index;
+}
+
+static Object_Handle Object_HandleFromPointer(AppState *app, Object *obj)
+{
+    Uint32 dense_index = Object_DenseIndex(app, obj);
+    Uint32 slot_index = app->object_dense_handles[dense_index];
+    return Object_MakeHandle(slot_index, app->object_handles[slot_index].generation);
+}
+
+static Object *Object_Network(AppState *app, Uint32 network_slot)
+{
+    if (network_slot >= app->network_slot_count)
+        return Object_Get(app, 0);
+
+    return Object_FromHandle(app, app->network_handles[network_slot]);
+}
+
+// Makes sure pools can hold at least object_count objects and handle slots.
+// On failure pool pointers and object_capacity are left as they were, so
+// callers can keep using the existing objects (and the nil object).
+static bool Object_GrowPools(AppState *app, Uint32 object_count, Uint32 handle_count)
+{
+    Uint32 capacity = app->object_capacity;
+    Object *pool = Pool_Grow(&app->object_arena, sizeof(Object),
+                             &capacity, object_count);
+    Uint32 dense_capacity = app->object_capacity;
+    Uint32 *dense_handles = Pool_Grow(&app->object_dense_handle_arena, sizeof(Uint32),
+                                      &dense_capacity, object_count);
+    Uint32 list_index_capacity = app->object_capacity;
+    Uint32 *list_index = Pool_Grow(&app->object_list_index_arena, sizeof(Uint32) * ObjectList_Count,
+                                   &list_index_capacity, object_count);
+    Object_HandleSlot *handles = Pool_Grow(&app->object_handle_arena, sizeof(Object_HandleSlot),
+                                           &app->object_handle_capacity, handle_count);
+    if (!pool || !dense_handles || !list_index || !handles)
+        return false;
+
+    app->object_pool = pool;
+    app->object_dense_handles = dense_handles;
+    app->object_list_index = list_index;
+    app->object_handles = handles;
+    app->object_capacity = Min(Min(capacity, dense_capacity), list_index_capacity);
+    return true;
+}
+
+// Creates object under index 0 (and handle 0) as special 'nil' value.
+// Pool arenas are part of the sim region; Sim_Init has to run first.
+static void Object_InitPool(AppState *app)
+{
+    bool ok = Object_GrowPools(app, 1, 1);
+    Assert(ok);
+
+    app->object_count = 1;
+    app->object_handle_count = 1;
+    app->object_free_handle = 0;
+    ForU32(kind, ObjectList_Count)
+    {
+        app->object_list_index[kind] = OBJECT_NOT_LISTED;
+        app->object_lists[kind].count = 0;
+    }
+}
+
+//
+// Object lists
+// Dense lists of object_pool indices per system (see Object_ListKind).
+// Kept in sync by Object_Create, Object_Destroy, Object_SetFlags and
+// Object_Assign; code that changes flags or sprite_id in place has to
+// go through them.
+//
+static Uint32 *Object_ListIndex(AppState *app, Uint32 dense_index, Object_ListKind kind)
+{
+    return app->object_list_index + dense_index * ObjectList_Count + kind;
+}
+
+static bool Object_WantsList(AppState *app, Object *obj, Object_ListKind kind)
+{
+    switch (kind)
+    {
+        case ObjectList_Movers:    return (obj->flags & ObjectFlag_Move);
+        case ObjectList_Colliders: return (obj->flags & ObjectFlag_Collide);
+        case ObjectList_Drawables: return (obj->flags & ObjectFlag_Draw);
+        case ObjectList_Animated:
+        {
+            // sprite_id of objects received from the network isn't validated
+            return (obj->sprite_id < app->sprite_count &&
+                    Sprite_Get(app, obj->sprite_id)->clip_count);
+        }
+        case ObjectList_Count: break;
+    }
+    return false;
+}
+
+static void Object_ListAdd(AppState *app, Uint32 dense_index, Object_ListKind kind)
+{
+    Object_List *list = app->object_lists + kind;
+    list->objects = Pool_Grow(&list->arena, sizeof(Uint32),
+                              &list->capacity, list->count + 1);
+    Assert(list->objects); // same capacity as object pool
+
+    *Object_ListIndex(app, dense_index, kind) = list->count;
+    list->objects[list->count] = dense_index;
+    list->count += 1;
+}
+
+static void Object_ListRemove(AppState *app, Uint32 dense_index, Object_ListKind kind)
+{
+    Uint32 *index = Object_ListIndex(app, dense_index, kind);
+    if (*index == OBJECT_NOT_LISTED)
+        return;
+
+    Object_List *list = app->object_lists + kind;
+    Uint32 last = list->count - 1;
+    if (*index != last)
+    {
+        Uint32 moved = list->objects[last];
+        list->objects[*index] = moved;
+        *Object_ListIndex(app, moved, kind) = *index;
+    }
+    list->count -= 1;
+    *index = OBJECT_NOT_LISTED;
+}
+
+// Adds or removes the object from lists after its flags or sprite changed.
+// @speed Writes only when membership changes; list pages are
+//        part of the sim region and every write dirties a page.
+static void Object_SyncLists(AppState *app, Uint32 dense_index)
+{
+    Object *obj = Object_Get(app, dense_index);
+    ForU32(kind, ObjectList_Count)
+    {
+        bool listed = (*Object_ListIndex(app, dense_index, kind) != OBJECT_NOT_LISTED);
+        bool wants = Object_WantsList(app, obj, kind);
+        if (wants && !listed)
+            Object_ListAdd(app, dense_index, kind);
+        else if (!wants && listed)
+            Object_ListRemove(app, dense_index, kind);
+    }
+}
+
+static void Object_SetFlags(AppState *app, Object *obj, Uint32 flags)
+{
+    if (Object_IsZero(app, obj) || obj->flags == flags)
+        return;
+
+    obj->flags = flags;
+    Object_SyncLists(app, Object_DenseIndex(app, obj));
+}
+
+// Overwrites the whole object (network state, snapshots...).
+static void Object_Assign(AppState *app, Object *obj, Object *src)
+{
+    if (Object_IsZero(app, obj))
+        return;
+
+    *obj = *src;
+    Object_SyncLists(app, Object_DenseIndex(app, obj));
 }
 
 static Object *Object_Create(AppState *app, Uint32 sprite_id, Uint32 flags)
 {
-    Assert(app->object_count < ArrayCount(app->object_pool));
-    Object *obj = app->object_pool + app->object_count;
+    Assert(app->object_count > 0); // Object_InitPool wasn't called
+
+    // O(1) handle slot allocation: reuse from free list or append
+    Uint32 slot_index = app->object_free_handle;
+    if (!Object_GrowPools(app, app->object_count + 1,
+                          slot_index ? 0 : app->object_handle_count + 1))
+    {
+        LogWarn(LogCat_Game, "Object pool is full (%u objects)", app->object_count);
+        return Object_Get(app, 0);
+    }
+
+    if (slot_index)
+    {
+        app->object_free_handle = app->object_handles[slot_index].dense_index;
+    }
+    else
+    {
+        slot_index = app->object_handle_count;
+        app->object_handle_count += 1;
+    }
+
+    Uint32 dense_index = app->object_count;
     app->object_count += 1;
+    app->object_handles[slot_index].dense_index = dense_index;
+    app->object_dense_handles[dense_index] = slot_index;
 
+    Object *obj = app->object_pool + dense_index;
     SDL_zerop(obj);
     obj->flags = flags;
     obj->sprite_id = sprite_id;
     obj->sprite_color = ColorF_RGB(1,1,1);
+
+    ForU32(kind, ObjectList_Count)
+        *Object_ListIndex(app, dense_index, kind) = OBJECT_NOT_LISTED;
+    Object_SyncLists(app, dense_index);
     return obj;
 }
 
-static Object *Object_Wall(AppState *app, V2 p, V2 dim)
+// @info(mg) Swap-removes the object so object_pool stays dense.
+//           The last object is moved into the hole; pointers to it
+//           are invalidated, handles are not.
+static bool Object_Destroy(AppState *app, Object_Handle handle)
 {
-    V2 half_dim = V2_Scale(dim, 0.5f);
-    Col_Vertices collision_verts = {0};
-    collision_verts.arr[0] = (V2){-half_dim.x, -half_dim.y};
-    collision_verts.arr[1] = (V2){ half_dim.x, -half_dim.y};
-    collision_verts.arr[2] = (V2){ half_dim.x,  half_dim.y};
-    collision_verts.arr[3] = (V2){-half_dim.x,  half_dim.y};
+    Object *obj = Object_FromHandle(app, handle);
+    if (Object_IsZero(app, obj))
+        return false;
 
-    Sprite *sprite = Sprite_CreateNoTex(app, collision_verts);
-    Object *obj = Object_Create(app, Sprite_IdFromPointer(app, sprite),
-                                ObjectFlag_Draw|ObjectFlag_Collide);
-    obj->p = p;
+    Uint32 slot_index = Object_HandleSlotIndex(handle);
+    Object_HandleSlot *slot = app->object_handles + slot_index;
+    Uint32 dense_index = slot->dense_index;
+    Uint32 last_index = app->object_count - 1;
 
-    static float r = 0.f;
-    static float g = 0.5f;
-    r += 0.321f;
-    g += 0.111f;
-    while (r > 1.f) r -= 1.f;
-    while (g > 1.f) g -= 1.f;
+    ForU32(kind, ObjectList_Count)
+        Object_ListRemove(app, dense_index, kind);
 
-    obj->sprite_color = ColorF_RGB(r, g, 0.5f);
-    return obj;
+    if (dense_index != last_index)
+    {
+        Uint32 moved_slot_index = app->object_dense_handles[last_index];
+        app->object_pool[dense_index] = app->object_pool[last_index];
+        app->object_dense_handles[dense_index] = moved_slot_index;
+        app->object_handles[moved_slot_index].dense_index = dense_index;
+
+        ForU32(kind, ObjectList_Count)
+        {
+            Uint32 list_index = *Object_ListIndex(app, last_index, kind);
+            *Object_ListIndex(app, dense_index, kind) = list_index;
+            if (list_index != OBJECT_NOT_LISTED)
+                app->object_lists[kind].objects[list_index] = dense_index;
+        }
+    }
+    app->object_count -= 1;
+
+    slot->generation = (slot->generation + 1) & OBJECT_HANDLE_GENERATION_MASK;
+    slot->dense_index = app->object_free_handle;
+    app->object_free_handle = slot_index;
+    return true;
+}
+
+static Object *Object_CreatePlayer(AppState *app)
+{
+    Object *player = Object_Create(app, app->sprite_ids[PackSprite_Dude], ObjectFlag_Draw|ObjectFlag_Move|ObjectFlag_Collide);
+    player->sprite_color = ColorF_RGB(1,1,1);
+    return player;
+}
+
+// Grows network_handles so network_slot is a valid index.
+// Returns false when slot is over NET_MAX_NETWORK_OBJECTS.
+static bool Object_ReserveNetworkSlot(AppState *app, Uint32 network_slot)
+{
+    if (network_slot >= NET_MAX_NETWORK_OBJECTS)
+        return false;
+
+    if (network_slot >= app->network_slot_count)
+    {
+        Uint32 new_count = Max(16, app->network_slot_count * 2);
+        while (new_count <= network_slot) new_count *= 2;
+        new_count = Min(new_count, NET_MAX_NETWORK_OBJECTS);
+
+        app->network_handles = Pool_Grow(&app->network_handle_arena, sizeof(*app->network_handles),
+                                         &app->network_slot_capacity, new_count);
+        Assert(app->network_handles);
+        memset(app->network_handles + app->network_slot_count, 0,
+               (new_count - app->network_slot_count) * sizeof(*app->network_handles));
+        app->network_slot_count = new_count;
+    }
+    return true;
+}
+
+// Returns NET_MAX_NETWORK_OBJECTS if there are no free slots.
+// Object_Network treats that as the nil object.
+static Uint32 Object_AssignNetworkSlot(AppState *app, Object *obj)
+{
+    ForU32(slot, NET_MAX_NETWORK_OBJECTS)
+    {
+        if (!Object_ReserveNetworkSlot(app, slot))
+            break;
+
+        if (!app->network_handles[slot])
+        {
+            app->network_handles[slot] = Object_HandleFromPointer(app, obj);
+            return slot;
+        }
+    }
+    return NET_MAX_NETWORK_OBJECTS;
+}
+
+// Destroys object assigned to network slot and releases the slot for reuse.
+static void Object_ReleaseNetworkSlot(AppState *app, Uint32 network_slot)
+{
+    if (network_slot >= app->network_slot_count)
+        return;
+
+    Object_Destroy(app, app->network_handles[network_slot]);
+    app->network_handles[network_slot] = 0;
+}
+
+static void Object_NetworkStateResize(Tick_NetworkObjState *state, Uint32 obj_count)
+{
+    if (!state->arena.base)
+        Arena_Init(&state->arena, "network state", NET_MAX_NETWORK_OBJECTS * sizeof(*state->objs));
+    state->objs = Pool_Grow(&state->arena, sizeof(*state->objs), &state->obj_capacity, obj_count);
+    Assert(state->objs);
+
+    if (obj_count > state->obj_count)
+    {
+        memset(state->objs + state->obj_count, 0,
+               (obj_count - state->obj_count) * sizeof(*state->objs));
+    }
+    state->obj_count = obj_count;
 }
 
 typedef struct
@@ -76,22 +367,23 @@ static Col_Projection CollisionProjection(Col_Normals normals, Col_Vertices vert
 {
     Col_Projection result = {0};
 
+    // every vertex is projected on all 4 normals at once;
+    // lanes hold normals so min/max don't need horizontal ops
     static_assert(ArrayCount(result.arr) == ArrayCount(normals.arr));
-    ForArray(normal_index, normals.arr)
+    static_assert(ArrayCount(normals.arr) == 4);
+    V2x4 normals4 = V2x4_Load(normals.arr);
+    F32x4 min = F32x4_Set1(FLT_MAX);
+    F32x4 max = F32x4_Set1(-FLT_MAX);
+    ForArray(vert_index, verts.arr)
     {
-        RngF *projection = result.arr + normal_index;
-        projection->min = FLT_MAX;
-        projection->max = -FLT_MAX;
-
-        V2 normal = normals.arr[normal_index];
-        ForArray(vert_index, verts.arr)
-        {
-            V2 vert = verts.arr[vert_index];
-            float inner = V2_Inner(normal, vert);
-            projection->min = Min(inner, projection->min);
-            projection->max = Max(inner, projection->max);
-        }
+        F32x4 inner = V2x4_Inner(normals4, V2x4_Set1(verts.arr[vert_index]));
+        min = F32x4_Min(min, inner);
+        max = F32x4_Max(max, inner);
     }
 
+    // RngF array has the same layout as V2 array: min, max, min, max...
+    static_assert(sizeof(RngF) == sizeof(V2));
+    V2x4_Store((V2 *)result.arr, (V2x4){min, max});
+
     return result;
 }
@@ -0,0 +1,129 @@
+//
+// Asset pack
+// Sprites baked offline by the packer (see packer_main.c) into one file:
+//   Pack_Header
+//   Pack_Sprite[sprite_count]
+//   RGBA32 pixels of every sprite, each block aligned to PACK_PIXEL_ALIGN
+// Game maps the file and uploads pixels straight from the mapping.
+// @info(mg) Structs are written as they are laid out in memory,
+//           so the pack is only valid for the platform it was baked on
+//           (byte swapped magic fails the check on the other endianness).
+//
+#define PACK_PATH "assets.pack" // relative to build directory, next to the executables
+#define PACK_MAGIC 0xde9a'c4a5'5e75'0f11llu
+#define PACK_VERSION 2
+#define PACK_PIXEL_ALIGN 64
+#define PACK_NAME_SIZE 32
+#define PACK_MAX_CLIPS 2
+#define PACK_MAX_CLIP_FRAMES 16
+
+typedef struct
+{
+    Uint64 magic;
+    Uint32 version;
+    Uint32 sprite_count;
+    Uint64 file_size;
+    Uint64 defs_hash; // Pack_DefsHash of pack_sprite_defs the pack was baked from
+} Pack_Header;
+
+typedef struct
+{
+    char name[PACK_NAME_SIZE];
+    Uint32 width, height; // whole sheet; animation frames are stacked vertically
+    Uint32 tex_frames;
+    Uint32 pitch;
+    Uint64 pixel_offset; // from the start of the file
+    Col_Vertices collision_vertices;
+    Col_Normals collision_normals;
+} Pack_Sprite;
+
+static_assert(sizeof(Pack_Header) == 32);
+static_assert(sizeof(Pack_Sprite) == 120);
+
+//
+// Sprite definitions
+// Source images, collision tweaks and animation clips. Packer bakes
+// collision; game applies it at load time when the pack is missing.
+// Clips are always taken from here.
+//
+typedef enum
+{
+    PackSprite_Overlay,
+    PackSprite_Crate,
+    PackSprite_Dude,
+    PackSprite_Reference,
+    PackSprite_Count
+} Pack_SpriteKind;
+
+// Animation clip; sequence of sheet frames played at a given rate.
+typedef struct
+{
+    Uint8 frames[PACK_MAX_CLIP_FRAMES]; // frames of the sheet in playback order
+    Uint32 frame_count;
+    float fps;
+    float fps_per_move; // added to fps for every unit the object moved during a tick
+    bool hold_on_first; // object standing still stops on frames that show frames[0]
+} Pack_ClipDef;
+
+typedef struct
+{
+    const char *name;
+    // this assumes we run from build directory
+    // @todo in the future we should force CWD or query demongus absolute path etc
+    const char *path;
+    Uint32 tex_frames;
+
+    // Collision tweaks; applied in this order to a rectangle of a single frame's size.
+    V2 collision_dim; // replaces frame size when non zero
+    float collision_rotation;
+    float collision_scale; // 0 keeps the size
+    V2 collision_offset;
+
+    // Objects with sprites that have clips are animated by ticks (clip 0 by default).
+    Pack_ClipDef clips[PACK_MAX_CLIPS];
+} Pack_SpriteDef;
+
+static Pack_SpriteDef pack_sprite_defs[PackSprite_Count] =
+{
+    [PackSprite_Overlay] = {"overlay", "../res/pxart/overlay.png", 6,
+        .clips = {{.frames = {0, 1, 2, 3, 4, 5}, .frame_count = 6, .fps = 12}}},
+    [PackSprite_Crate] = {"crate", "../res/pxart/crate.png", 1,
+        .collision_rotation = 0.125f, .collision_scale = 0.6f, .collision_offset = {0, -3}},
+    [PackSprite_Dude] = {"dude_walk", "../res/pxart/dude_walk.png", 5,
+        .collision_dim = {20, 10}, .collision_offset = {0, -8},
+        .clips = {{.frames = {0, 1, 2, 1, 0, 3, 4, 3}, .frame_count = 8,
+                   .fps = 16, .fps_per_move = 5, .hold_on_first = true}}},
+    [PackSprite_Reference] = {"reference", "../res/pxart/reference.png", 1},
+};
+
+// Hashes everything in pack_sprite_defs that ends up baked into the pack
+// (clips are read from the defs at load time so they are left out).
+static Uint64 Pack_DefsHash(void)
+{
+    Uint64 hash = PACK_VERSION;
+    ForArray(i, pack_sprite_defs)
+    {
+        Pack_SpriteDef *def = pack_sprite_defs + i;
+        hash = HashU64(hash, (void *)def->name, SDL_strlen(def->name) + 1);
+        hash = HashU64(hash, (void *)def->path, SDL_strlen(def->path) + 1);
+        hash = HashU64(hash, &def->tex_frames, sizeof(def->tex_frames));
+        hash = HashU64(hash, &def->collision_dim, sizeof(def->collision_dim));
+        hash = HashU64(hash, &def->collision_rotation, sizeof(def->collision_rotation));
+        hash = HashU64(hash, &def->collision_scale, sizeof(def->collision_scale));
+        hash = HashU64(hash, &def->collision_offset, sizeof(def->collision_offset));
+    }
+    return hash;
+}
+
+static Col_Vertices Pack_CollisionVertices(Pack_SpriteDef *def, Col_Vertices verts)
+{
+    Uint64 vert_count = ArrayCount(verts.arr);
+    if (def->collision_dim.x || def->collision_dim.y)
+        verts = Vertices_FromRect((V2){0}, def->collision_dim);
+    if (def->collision_rotation)
+        Vertices_Rotate(verts.arr, vert_count, def->collision_rotation);
+    if (def->collision_scale)
+        Vertices_Scale(verts.arr, vert_count, def->collision_scale);
+    Vertices_Offset(verts.arr, vert_count, def->collision_offset);
+    return verts;
+}
@@ -0,0 +1,346 @@
+//
+// Input recording and replay
+// Server records everything that can change the simulation: the tick rate
+// and map it started with, every received message, users joining and
+// leaving, local player's input and map streaming points. Replay runs
+// the same ticks headlessly at full speed and compares state hashes
+// after every tick (see Game_IterateReplay).
+// @info(mg) Replays need the assets and map of the recording; the hash
+//           after Game_Init catches a different map. A build that simulates
+//           differently diverges at the first affected tick.
+//
+static Uint64 Replay_StateHash(AppState *app)
+{
+    // dense order is part of the state (object lists follow it and
+    // they set the collision resolution order)
+    // padding isn't, so fields are hashed one by one
+    Uint64 hash = app->tick_id;
+    ForU32(obj_id, app->object_count)
+    {
+        Object *obj = app->object_pool + obj_id;
+        hash = HashU64(hash, &obj->flags, sizeof(obj->flags));
+        hash = HashU64(hash, &obj->p, sizeof(obj->p));
+        hash = HashU64(hash, &obj->dp, sizeof(obj->dp));
+        hash = HashU64(hash, &obj->sprite_id, sizeof(obj->sprite_id));
+        hash = HashU64(hash, &obj->sprite_clip, sizeof(obj->sprite_clip));
+        hash = HashU64(hash, &obj->sprite_clip_step, sizeof(obj->sprite_clip_step));
+        hash = HashU64(hash, &obj->sprite_clip_t, sizeof(obj->sprite_clip_t));
+    }
+    return hash;
+}
+
+//
+// Recording
+//
+static void Replay_Flush(AppState *app)
+{
+    if (!app->replay.record_io || !app->replay.buf_used)
+        return;
+
+    if (SDL_WriteIO(app->replay.record_io, app->replay.buf, app->replay.buf_used) != app->replay.buf_used)
+    {
+        LogError(LogCat_Replay, "Failed to write %s: %s; recording stopped",
+                                app->replay.record_path, SDL_GetError());
+        SDL_CloseIO(app->replay.record_io);
+        app->replay.record_io = 0;
+    }
+    app->replay.recorded_bytes += app->replay.buf_used;
+    app->replay.buf_used = 0;
+}
+
+static void Replay_Write(AppState *app, void *data, Uint32 size)
+{
+    if (!app->replay.record_io)
+        return;
+
+    Assert(size <= REPLAY_BUF_SIZE);
+    if (app->replay.buf_used + size > REPLAY_BUF_SIZE)
+        Replay_Flush(app);
+
+    memcpy(app->replay.buf + app->replay.buf_used, data, size);
+    app->replay.buf_used += size;
+}
+
+static void Replay_WriteKind(AppState *app, Replay_RecordKind kind)
+{
+    Uint8 value = (Uint8)kind;
+    Replay_Write(app, &value, sizeof(value));
+}
+
+// Called at the end of Game_Init; state created by it is stored as a hash.
+static void Replay_BeginRecording(AppState *app)
+{
+    if (!app->net.is_server)
+    {
+        LogWarn(LogCat_Replay, "only server can record; client doesn't simulate");
+        return;
+    }
+    if (SDL_strlen(app->map.path) >= REPLAY_PATH_SIZE)
+    {
+        LogWarn(LogCat_Replay, "map path is too long to record: %s", app->map.path);
+        return;
+    }
+
+    app->replay.record_io = SDL_IOFromFile(app->replay.record_path, "wb");
+    if (!app->replay.record_io)
+    {
+        LogError(LogCat_Replay, "Failed to open %s: %s", app->replay.record_path, SDL_GetError());
+        return;
+    }
+
+    app->replay.buf = Arena_PushNoZero(&app->perm, REPLAY_BUF_SIZE, ARENA_DEFAULT_ALIGN);
+    Assert(app->replay.buf);
+
+    Replay_Header header = {0};
+    header.magic = REPLAY_MAGIC;
+    header.version = REPLAY_VERSION;
+    header.tick_rate = app->tick_rate;
+    header.start_tick_id = app->tick_id;
+    header.start_hash = Replay_StateHash(app);
+    header.has_local_player = app->has_local_player;
+    header.lockstep = app->lockstep.enabled;
+    SDL_strlcpy(header.map_path, app->map.path, sizeof(header.map_path));
+    Replay_Write(app, &header, sizeof(header));
+
+    LogInfo(LogCat_Replay, "Recording to %s", app->replay.record_path);
+}
+
+static void Replay_EndRecording(AppState *app)
+{
+    if (!app->replay.record_io)
+        return;
+
+    Replay_Flush(app);
+    if (app->replay.record_io)
+    {
+        if (!SDL_CloseIO(app->replay.record_io))
+            LogWarn(LogCat_Replay, "Failed to close %s: %s", app->replay.record_path, SDL_GetError());
+        app->replay.record_io = 0;
+
+        LogInfo(LogCat_Replay, "Recorded %llu ticks to %s (%.1f KB)",
+                               app->replay.recorded_ticks, app->replay.record_path,
+                               app->replay.recorded_bytes / 1024.0);
+    }
+}
+
+static void Replay_RecordFrame(AppState *app)
+{
+    Replay_WriteKind(app, Replay_Rec_Frame);
+}
+
+static void Replay_RecordUserAdd(AppState *app, Net_User *user)
+{
+    Replay_WriteKind(app, Replay_Rec_UserAdd);
+    Replay_Write(app, &user->id, sizeof(user->id));
+    Replay_Write(app, &user->port, sizeof(user->port));
+}
+
+static void Replay_RecordUserRemove(AppState *app, Net_User *user)
+{
+    Replay_WriteKind(app, Replay_Rec_UserRemove);
+    Replay_Write(app, &user->id, sizeof(user->id));
+}
+
+static void Replay_RecordMessage(AppState *app, Net_User *user, S8 message)
+{
+    Uint32 size = (Uint32)message.size;
+    Replay_WriteKind(app, Replay_Rec_Message);
+    Replay_Write(app, &user->id, sizeof(user->id));
+    Replay_Write(app, &size, sizeof(size));
+    Replay_Write(app, message.str, size);
+}
+
+static void Replay_RecordTick(AppState *app, Tick_Input input)
+{
+    if (!app->replay.record_io)
+        return;
+
+    Uint64 hash = Replay_StateHash(app);
+    Replay_WriteKind(app, Replay_Rec_Tick);
+    Replay_Write(app, &input.move_dir, sizeof(input.move_dir));
+    Replay_Write(app, &hash, sizeof(hash));
+    app->replay.recorded_ticks += 1;
+}
+
+//
+// Playback
+// Recording is mapped and read in place.
+//
+static Uint8 *Replay_ReadView(AppState *app, Uint64 size)
+{
+    if (app->replay.file.size - app->replay.read_offset < size)
+        return 0;
+
+    Uint8 *result = app->replay.file.base + app->replay.read_offset;
+    app->replay.read_offset += size;
+    return result;
+}
+
+// Called by Game_Init before anything is created; overrides tick rate,
+// map path and local player with the recorded ones.
+static bool Replay_Open(AppState *app)
+{
+    app->replay.file = Os_MapFile(app->replay.play_path);
+    if (!app->replay.file.base)
+    {
+        LogError(LogCat_Replay, "Failed to open %s", app->replay.play_path);
+        return false;
+    }
+
+    Replay_Header *header = (Replay_Header *)Replay_ReadView(app, sizeof(Replay_Header));
+    if (!header ||
+        header->magic != REPLAY_MAGIC ||
+        header->version != REPLAY_VERSION ||
+        !header->tick_rate || header->tick_rate > TICK_RATE_MAX ||
+        SDL_strnlen(header->map_path, sizeof(header->map_path)) == sizeof(header->map_path))
+    {
+        LogWarn(LogCat_Replay, "%s is invalid or out of date", app->replay.play_path);
+        Os_UnmapFile(&app->replay.file);
+        return false;
+    }
+
+    app->tick_rate = header->tick_rate;
+    app->map.path = header->map_path; // recording stays mapped until exit
+    app->has_local_player = header->has_local_player;
+    app->lockstep.enabled = header->lockstep;
+    app->replay.playing = true;
+
+    LogInfo(LogCat_Replay, "Playing %s (%.1f KB) recorded at %u Hz on %s%s%s",
+                           app->replay.play_path, app->replay.file.size / 1024.0,
+                           header->tick_rate, header->map_path,
+                           header->has_local_player ? " with local player" : "",
+                           header->lockstep ? " in lockstep mode" : "");
+    return true;
+}
+
+// Called at the end of Game_Init.
+static void Replay_CheckStart(AppState *app)
+{
+    Replay_Header *header = (Replay_Header *)app->replay.file.base;
+    app->tick_id = header->start_tick_id;
+
+    if (Replay_StateHash(app) != header->start_hash)
+    {
+        app->replay.start_mismatch = true;
+        LogWarn(LogCat_Replay, "Initial state differs from the recording; map or assets changed?");
+    }
+}
+
+static Replay_Record Replay_ReadRecord(AppState *app)
+{
+    Replay_Record result = {0};
+    Uint8 *kind = Replay_ReadView(app, sizeof(Uint8));
+    if (!kind)
+        return result; // Replay_Rec_End
+
+    result.kind = (Replay_RecordKind)*kind;
+    bool ok = true;
+    switch (result.kind)
+    {
+        case Replay_Rec_Frame: break;
+
+        case Replay_Rec_UserAdd:
+        case Replay_Rec_UserRemove:
+        {
+            Uint8 *src = Replay_ReadView(app, sizeof(result.user_id));
+            ok = (src != 0);
+            if (ok)
+                memcpy(&result.user_id, src, sizeof(result.user_id));
+
+            if (ok && result.kind == Replay_Rec_UserAdd)
+            {
+                src = Replay_ReadView(app, sizeof(result.port));
+                ok = (src != 0);
+                if (ok)
+                    memcpy(&result.port, src, sizeof(result.port));
+            }
+        } break;
+
+        case Replay_Rec_Message:
+        {
+            Uint32 size = 0;
+            Uint8 *src = Replay_ReadView(app, sizeof(result.user_id) + sizeof(size));
+            if (src)
+            {
+                memcpy(&result.user_id, src, sizeof(result.user_id));
+                memcpy(&size, src + sizeof(result.user_id), sizeof(size));
+            }
+            Uint8 *bytes = (src && size <= NET_MAX_MESSAGE_SIZE ? Replay_ReadView(app, size) : 0);
+            ok = (bytes != 0);
+            result.message = S8_Make(bytes, size);
+        } break;
+
+        case Replay_Rec_Tick:
+        {
+            Uint8 *src = Replay_ReadView(app, sizeof(result.move_dir) + sizeof(result.hash));
+            ok = (src != 0);
+            if (ok)
+            {
+                memcpy(&result.move_dir, src, sizeof(result.move_dir));
+                memcpy(&result.hash, src + sizeof(result.move_dir), sizeof(result.hash));
+            }
+        } break;
+
+        default: ok = false; break;
+    }
+
+    if (!ok)
+    {
+        LogWarn(LogCat_Replay, "Invalid record at offset %llu", app->replay.read_offset);
+        result.kind = Replay_Rec_Invalid;
+    }
+    return result;
+}
+
+static void Replay_CheckTick(AppState *app, Uint64 recorded_hash)
+{
+    Uint64 start_ns = SDL_GetTicksNS();
+    Uint64 hash = Replay_StateHash(app);
+    app->replay.hash_sum_ns += SDL_GetTicksNS() - start_ns;
+
+    if (hash != recorded_hash)
+    {
+        if (!app->replay.mismatched_ticks)
+        {
+            app->replay.first_mismatch_tick_id = app->tick_id;
+            LogError(LogCat_Replay, "State diverged from the recording at tick %llu", app->tick_id);
+        }
+        app->replay.mismatched_ticks += 1;
+    }
+}
+
+static void Replay_Report(AppState *app)
+{
+    double ms = 1.0 / (double)SDL_NS_PER_MS;
+    double total_ns = (double)(SDL_GetTicksNS() - app->replay.start_ns);
+    double ticks = (double)Max(app->replay.ticks, 1);
+    LogInfo(LogCat_Replay, "%llu ticks, %llu frames, %llu messages in %.2f ms (%.0f ticks/s); "
+                           "tick time avg %.3f max %.3f ms; hashing %.2f ms",
+                           app->replay.ticks, app->replay.frames, app->replay.messages, total_ns * ms,
+                           app->replay.ticks / (total_ns / (double)SDL_NS_PER_SECOND),
+                           app->replay.tick_sum_ns * ms / ticks, app->replay.tick_max_ns * ms,
+                           app->replay.hash_sum_ns * ms);
+
+    if (app->replay.read_offset < app->replay.file.size)
+    {
+        LogWarn(LogCat_Replay, "Stopped early at offset %llu of %llu",
+                               app->replay.read_offset, app->replay.file.size);
+    }
+
+    if (app->replay.mismatched_ticks)
+    {
+        LogError(LogCat_Replay, "DIVERGED at tick %llu; %llu of %llu ticks don't match",
+                                app->replay.first_mismatch_tick_id, app->replay.mismatched_ticks, app->replay.ticks);
+    }
+    else
+    {
+        LogInfo(LogCat_Replay, "All %llu tick hashes match%s", app->replay.ticks,
+                               app->replay.start_mismatch ? " (initial state didn't)" : "");
+    }
+}
+
+static void Replay_Close(AppState *app)
+{
+    Os_UnmapFile(&app->replay.file);
+    app->replay.playing = false;
+}
@@ -0,0 +1,214 @@
+//
+// Simulation snapshots
+// Sim region is a single write-watched reservation split into the arenas
+// listed in Sim_Init. Shadow is a second reservation with the same layout
+// that holds the region as it was at the newest snapshot.
+// Snapshot copies pages written since the previous snapshot into shadow
+// (old shadow contents go to the previous snapshot's undo list).
+// Restore copies them back and then walks undo lists back in time.
+// Both are O(pages written), not O(state size).
+//
+static Sim_Scalars Sim_GetScalars(AppState *app)
+{
+    Sim_Scalars result = {0};
+    result.tick_id = app->tick_id;
+    result.object_count = app->object_count;
+    result.object_handle_count = app->object_handle_count;
+    result.object_free_handle = app->object_free_handle;
+    ForU32(kind, ObjectList_Count)
+        result.object_list_counts[kind] = app->object_lists[kind].count;
+    result.network_slot_count = app->network_slot_count;
+    result.player_network_slot = app->player_network_slot;
+    result.map_resident_count = app->map.resident_count;
+    result.map_resident_object_count = app->map.resident_object_count;
+    result.map_update_id = app->map.update_id;
+    result.map_next_spawn = app->map.next_spawn;
+    return result;
+}
+
+// Capacities aren't restored; pools only grow and memory past counts is unused.
+static void Sim_SetScalars(AppState *app, Sim_Scalars *scalars)
+{
+    app->tick_id = scalars->tick_id;
+    app->object_count = scalars->object_count;
+    app->object_handle_count = scalars->object_handle_count;
+    app->object_free_handle = scalars->object_free_handle;
+    ForU32(kind, ObjectList_Count)
+        app->object_lists[kind].count = scalars->object_list_counts[kind];
+    app->network_slot_count = scalars->network_slot_count;
+    app->player_network_slot = scalars->player_network_slot;
+    app->map.resident_count = scalars->map_resident_count;
+    app->map.resident_object_count = scalars->map_resident_object_count;
+    app->map.update_id = scalars->map_update_id;
+    app->map.next_spawn = scalars->map_next_spawn;
+}
+
+static void Sim_Init(AppState *app)
+{
+    struct { Arena *arena; const char *name; Uint64 reserve; } layout[] =
+    {
+        {&app->object_arena, "objects", OBJECT_MAX_COUNT * sizeof(Object)},
+        {&app->object_dense_handle_arena, "object dense", OBJECT_MAX_COUNT * sizeof(Uint32)},
+        {&app->object_handle_arena, "object handles", OBJECT_MAX_COUNT * sizeof(Object_HandleSlot)},
+        {&app->object_list_index_arena, "object list index", OBJECT_MAX_COUNT * ObjectList_Count * sizeof(Uint32)},
+        {&app->object_lists[ObjectList_Movers].arena, "movers", OBJECT_MAX_COUNT * sizeof(Uint32)},
+        {&app->object_lists[ObjectList_Colliders].arena, "colliders", OBJECT_MAX_COUNT * sizeof(Uint32)},
+        {&app->object_lists[ObjectList_Drawables].arena, "drawables", OBJECT_MAX_COUNT * sizeof(Uint32)},
+        {&app->object_lists[ObjectList_Animated].arena, "animated", OBJECT_MAX_COUNT * sizeof(Uint32)},
+        {&app->network_handle_arena, "network slots", NET_MAX_NETWORK_OBJECTS * sizeof(Object_Handle)},
+        {&app->map.arena, "map", SIM_MAP_RESERVE},
+    };
+    static_assert(ArrayCount(layout) == SIM_ARENA_COUNT);
+
+    Uint64 total = 0;
+    ForArray(i, layout)
+        total += AlignUp(layout[i].reserve, ARENA_COMMIT_BLOCK);
+
+    bool ok = Os_WatchInit(&app->sim.watch, total);
+    app->sim.shadow = (Uint8 *)Os_Reserve(total);
+    Assert(ok && app->sim.shadow);
+
+    Uint64 offset = 0;
+    ForArray(i, layout)
+    {
+        Uint64 reserve = AlignUp(layout[i].reserve, ARENA_COMMIT_BLOCK);
+        Arena_InitBorrowed(layout[i].arena, layout[i].name, app->sim.watch.base + offset, reserve);
+        app->sim.arenas[i] = layout[i].arena;
+        offset += reserve;
+    }
+}
+
+static void Sim_Deinit(AppState *app)
+{
+    ForArray(i, app->sim.snapshots)
+        Arena_Release(&app->sim.snapshots[i].undo);
+    if (app->sim.shadow)
+        Os_Release(app->sim.shadow, app->sim.watch.size);
+    Os_WatchRelease(&app->sim.watch);
+    SDL_zero(app->sim);
+}
+
+// Saves simulation state and returns its id for Sim_Restore.
+// The oldest snapshot is dropped after SIM_SNAPSHOT_HISTORY of them.
+// Has to run between ticks like Map_Update.
+static Uint64 Sim_Save(AppState *app)
+{
+    Os_WriteWatch *watch = &app->sim.watch;
+    Uint64 page_size = watch->page_size;
+    Os_WatchStart(watch); // fault handler is installed on the first snapshot only
+    Os_WatchCollect(watch);
+
+    // pages committed since the last snapshot aren't watched yet; all of them count as written
+    ForArray(i, app->sim.arenas)
+    {
+        Arena *arena = app->sim.arenas[i];
+        Uint64 tracked = app->sim.tracked[i];
+        if (arena->committed <= tracked)
+            continue;
+
+        Uint64 offset = (Uint64)(arena->base - watch->base);
+        bool ok = Os_Commit(app->sim.shadow + offset + tracked, arena->committed - tracked);
+        Assert(ok);
+        for (Uint64 at = tracked; at < arena->committed; at += page_size)
+            Os_WatchMark(watch, (Uint32)((offset + at) / page_size));
+        app->sim.tracked[i] = arena->committed;
+    }
+
+    // previous snapshot keeps what these pages looked like at its time
+    Sim_Snapshot *prev = (app->sim.snapshot_count ? app->sim.snapshots + app->sim.newest : 0);
+    if (prev)
+    {
+        prev->undo_count = watch->dirty_count;
+        prev->undo_pages = Arena_PushArrayNoZero(&prev->undo, Uint32, watch->dirty_count);
+        prev->undo_data = Arena_PushNoZero(&prev->undo, watch->dirty_count * page_size, ARENA_DEFAULT_ALIGN);
+        Assert(prev->undo_pages && prev->undo_data);
+        memcpy(prev->undo_pages, watch->dirty_pages, watch->dirty_count * sizeof(Uint32));
+    }
+
+    ForU32(i, watch->dirty_count)
+    {
+        Uint64 offset = (Uint64)watch->dirty_pages[i] * page_size;
+        if (prev)
+            memcpy(prev->undo_data + i * page_size, app->sim.shadow + offset, page_size);
+        memcpy(app->sim.shadow + offset, watch->base + offset, page_size);
+    }
+    app->sim.snapshot_pages = watch->dirty_count;
+    Os_WatchReset(watch);
+
+    Uint32 index = (app->sim.snapshot_count ? (app->sim.newest + 1) % SIM_SNAPSHOT_HISTORY : 0);
+    Sim_Snapshot *snapshot = app->sim.snapshots + index;
+    if (!snapshot->undo.base)
+        Arena_Init(&snapshot->undo, "sim undo", watch->size); // can't run out; undo is at most the whole region
+    Arena_Reset(&snapshot->undo);
+    snapshot->undo_count = 0;
+    app->sim.next_id += 1;
+    snapshot->id = app->sim.next_id;
+    snapshot->scalars = Sim_GetScalars(app);
+
+    app->sim.newest = index;
+    app->sim.snapshot_count = Min(app->sim.snapshot_count + 1, SIM_SNAPSHOT_HISTORY);
+    return snapshot->id;
+}
+
+// Puts simulation state back to how it was at Sim_Save that returned snapshot_id.
+// Snapshots newer than it are dropped and their ids are handed out again.
+// Returns false if the snapshot is too old or doesn't exist.
+static bool Sim_Restore(AppState *app, Uint64 snapshot_id)
+{
+    if (!app->sim.snapshot_count)
+        return false;
+
+    Sim_Snapshot *newest = app->sim.snapshots + app->sim.newest;
+    Uint64 oldest_id = newest->id - (app->sim.snapshot_count - 1);
+    if (snapshot_id > newest->id || snapshot_id < oldest_id)
+        return false;
+
+    Os_WriteWatch *watch = &app->sim.watch;
+    Uint64 page_size = watch->page_size;
+
+    // back to the newest snapshot
+    Os_WatchCollect(watch);
+    Uint32 restored = watch->dirty_count;
+    ForU32(i, watch->dirty_count)
+    {
+        Uint64 offset = (Uint64)watch->dirty_pages[i] * page_size;
+        memcpy(watch->base + offset, app->sim.shadow + offset, page_size);
+    }
+
+    // then back in time one snapshot at a time;
+    // writing clean pages lists them as dirty so they're reset below
+    Uint32 steps = (Uint32)(newest->id - snapshot_id);
+    ForU32(step, steps)
+    {
+        Uint32 index = (app->sim.newest + SIM_SNAPSHOT_HISTORY - 1 - step) % SIM_SNAPSHOT_HISTORY;
+        Sim_Snapshot *snapshot = app->sim.snapshots + index;
+        ForU32(i, snapshot->undo_count)
+        {
+            Uint64 offset = (Uint64)snapshot->undo_pages[i] * page_size;
+            Uint8 *src = snapshot->undo_data + i * page_size;
+            memcpy(app->sim.shadow + offset, src, page_size);
+            memcpy(watch->base + offset, src, page_size);
+        }
+        restored += snapshot->undo_count;
+
+        Sim_Snapshot *dropped = app->sim.snapshots + (index + 1) % SIM_SNAPSHOT_HISTORY;
+        dropped->id = 0;
+    }
+
+    // region matches shadow again
+    Os_WatchCollect(watch);
+    Os_WatchReset(watch);
+
+    app->sim.newest = (app->sim.newest + SIM_SNAPSHOT_HISTORY - steps) % SIM_SNAPSHOT_HISTORY;
+    app->sim.snapshot_count -= steps;
+    app->sim.next_id = snapshot_id;
+
+    Sim_Snapshot *target = app->sim.snapshots + app->sim.newest;
+    Assert(target->id == snapshot_id);
+    Arena_Reset(&target->undo);
+    target->undo_count = 0;
+    Sim_SetScalars(app, &target->scalars);
+
+    app->sim.restore_pages = restored;
+    return true;
+}
@@ -5,16 +5,26 @@ static Uint32 Sprite_IdFromPointer(AppState *app, Sprite *sprite)
 {
     size_t byte_delta = (size_t)sprite - (size_t)app->sprite_pool;
     size_t id = byte_delta / sizeof(*sprite);
-    Assert(id < ArrayCount(app->sprite_pool));
+    Assert(id < app->sprite_count);
     return (Uint32)id;
 }
 
 static Sprite *Sprite_Get(AppState *app, Uint32 sprite_id)
 {
-    Assert(sprite_id < ArrayCount(app->sprite_pool));
+    Assert(sprite_id < app->sprite_count);
     return app->sprite_pool + sprite_id;
 }
 
+// Reserves address space for sprite pool and
+// creates sprite under index 0 as special 'nil' value.
+static void Sprite_InitPool(AppState *app)
+{
+    Arena_Init(&app->sprite_arena, "sprites", SPRITE_MAX_COUNT * sizeof(Sprite));
+    app->sprite_pool = Pool_Grow(&app->sprite_arena, sizeof(Sprite), &app->sprite_capacity, 1);
+    Assert(app->sprite_pool);
+    app->sprite_count = 1;
+}
+
 // @todo delete these helpers?
 static void Sprite_CollisionVerticesRotate(Sprite *sprite, float rotation)
 {
@@ -49,17 +59,10 @@ static void Sprite_CollisionVerticesMin(Sprite *sprite, V2 val)
 
 static void Sprite_RecalculateCollsionNormals(Sprite *sprite)
 {
-    Uint64 vert_count = ArrayCount(sprite->collision_vertices.arr);
-    ForU64(vert_id, vert_count)
-    {
-        Uint64 next_vert_id = vert_id + 1;
-        if (next_vert_id >= vert_count)
-            next_vert_id -= vert_count;
-
-        sprite->collision_normals.arr[vert_id]
-            = V2_CalculateNormal(sprite->collision_vertices.arr[vert_id],
-                                 sprite->collision_vertices.arr[next_vert_id]);
-    }
+    static_assert(ArrayCount(sprite->collision_normals.arr) == ArrayCount(sprite->collision_vertices.arr));
+    Vertices_Normals(sprite->collision_normals.arr,
+                     sprite->collision_vertices.arr,
+                     ArrayCount(sprite->collision_vertices.arr));
 }
 
 static void Sprite_UpdateCollisionVertices(Sprite *sprite, Col_Vertices collision_vertices)
@@ -70,7 +73,9 @@ static void Sprite_UpdateCollisionVertices(Sprite *sprite, Col_Vertices collisio
 
 static Sprite *Sprite_CreateNoTex(AppState *app, Col_Vertices collision_vertices)
 {
-    Assert(app->sprite_count < ArrayCount(app->sprite_pool));
+    app->sprite_pool = Pool_Grow(&app->sprite_arena, sizeof(Sprite),
+                                 &app->sprite_capacity, app->sprite_count + 1);
+    Assert(app->sprite_pool);
     Sprite *sprite = app->sprite_pool + app->sprite_count;
     app->sprite_count += 1;
 
@@ -78,15 +83,210 @@ static Sprite *Sprite_CreateNoTex(AppState *app, Col_Vertices collision_vertices
     return sprite;
 }
 
+// Reads image dimensions from PNG's IHDR chunk without decoding pixels.
+static bool Sprite_ReadPngSize(const char *path, int *w, int *h)
+{
+    // 8 byte signature, Uint32 chunk length, "IHDR", Uint32 width, Uint32 height
+    Uint8 header[24];
+    bool ok = false;
+
+    SDL_IOStream *io = SDL_IOFromFile(path, "rb");
+    if (io)
+    {
+        if (SDL_ReadIO(io, header, sizeof(header)) == sizeof(header) &&
+            0 == memcmp(header, "\x89PNG\r\n\x1a\n", 8) &&
+            0 == memcmp(header + 12, "IHDR", 4))
+        {
+            Uint32 width, height;
+            memcpy(&width, header + 16, sizeof(width));
+            memcpy(&height, header + 20, sizeof(height));
+            *w = (int)SDL_Swap32BE(width);
+            *h = (int)SDL_Swap32BE(height);
+            ok = true;
+        }
+        SDL_CloseIO(io);
+    }
+
+    if (!ok)
+        LogWarn(LogCat_Sprite, "Failed to read PNG header of %s", path);
+    return ok;
+}
+
+//
+// Asynchronous loading
+// Worker threads decode images into surfaces; main thread
+// (which owns the renderer) turns them into textures.
+//
+static int Sprite_WorkerMain(void *data)
+{
+    AppState *app = (AppState *)data;
+    for (;;)
+    {
+        SDL_WaitSemaphore(app->sprite_load.semaphore);
+        if (SDL_GetAtomicInt(&app->sprite_load.quit))
+            break;
+
+        // semaphore was signaled once per job, so there is a job to claim
+        int job_index = SDL_AddAtomicInt(&app->sprite_load.next_job, 1);
+        Sprite_LoadJob *job = app->sprite_load.jobs + job_index;
+        job->surface = IMG_Load(job->path);
+        if (!job->surface)
+            LogWarn(LogCat_Sprite, "Failed to load %s: %s", job->path, SDL_GetError());
+        SDL_SetAtomicInt(&job->done, 1);
+    }
+    return 0;
+}
+
+static void Sprite_InitLoading(AppState *app)
+{
+    if (app->headless || app->sprite_load.sync)
+        return;
+
+    app->sprite_load.jobs = Arena_PushArray(&app->perm, Sprite_LoadJob, SPRITE_MAX_COUNT);
+    if (!app->sprite_load.jobs)
+    {
+        app->sprite_load.sync = true;
+        return;
+    }
+
+    app->sprite_load.semaphore = SDL_CreateSemaphore(0);
+    if (!app->sprite_load.semaphore)
+    {
+        LogError(LogCat_Sprite, "Failed to create sprite loading semaphore: %s; loading synchronously", SDL_GetError());
+        app->sprite_load.sync = true;
+        return;
+    }
+
+    // leave one core for the main thread
+    Uint32 worker_count = (Uint32)Clamp(1, SPRITE_MAX_WORKERS, SDL_GetNumLogicalCPUCores() - 1);
+    ForU32(i, worker_count)
+    {
+        SDL_Thread *thread = SDL_CreateThread(Sprite_WorkerMain, "demongus sprite", app);
+        if (!thread)
+        {
+            LogError(LogCat_Sprite, "Failed to create sprite worker: %s", SDL_GetError());
+            break;
+        }
+        app->sprite_load.workers[app->sprite_load.worker_count] = thread;
+        app->sprite_load.worker_count += 1;
+    }
+
+    if (!app->sprite_load.worker_count)
+    {
+        SDL_DestroySemaphore(app->sprite_load.semaphore);
+        app->sprite_load.semaphore = 0;
+        app->sprite_load.sync = true;
+    }
+}
+
+static void Sprite_DeinitLoading(AppState *app)
+{
+    if (!app->sprite_load.semaphore)
+        return;
+
+    SDL_SetAtomicInt(&app->sprite_load.quit, 1);
+    ForU32(i, app->sprite_load.worker_count)
+        SDL_SignalSemaphore(app->sprite_load.semaphore);
+    ForU32(i, app->sprite_load.worker_count)
+        SDL_WaitThread(app->sprite_load.workers[i], 0);
+
+    int job_count = SDL_GetAtomicInt(&app->sprite_load.job_count);
+    for (int i = 0; i < job_count; i += 1)
+    {
+        Sprite_LoadJob *job = app->sprite_load.jobs + i;
+        if (!job->uploaded && SDL_GetAtomicInt(&job->done))
+            SDL_DestroySurface(job->surface);
+    }
+
+    SDL_DestroySemaphore(app->sprite_load.semaphore);
+    app->sprite_load.semaphore = 0;
+}
+
+static void Sprite_QueueLoad(AppState *app, Uint32 sprite_id, const char *path)
+{
+    int job_index = SDL_GetAtomicInt(&app->sprite_load.job_count);
+    Assert(job_index < SPRITE_MAX_COUNT);
+
+    Sprite_LoadJob *job = app->sprite_load.jobs + job_index;
+    job->sprite_id = sprite_id;
+    job->path = path;
+
+    SDL_SetAtomicInt(&app->sprite_load.job_count, job_index + 1);
+    SDL_SignalSemaphore(app->sprite_load.semaphore);
+}
+
+static void Sprite_ReportLoadTime(AppState *app, const char *label)
+{
+    Uint64 ns = SDL_GetTicksNS() - app->sprite_load.start_ns;
+    LogInfo(LogCat_Sprite, "%s %.2f ms after start (%u sprites, %s)",
+                           label, (double)ns / (double)SDL_NS_PER_MS, app->sprite_count - 1,
+                           app->sprite_load.from_pack ? "pack" : app->sprite_load.sync ? "sync" : "async");
+}
+
+// Creates textures for decoded surfaces. Called every frame on the main thread.
+static void Sprite_UploadLoaded(AppState *app)
+{
+    int job_count = SDL_GetAtomicInt(&app->sprite_load.job_count);
+    bool all_uploaded = true;
+
+    for (int i = app->sprite_load.first_pending; i < job_count; i += 1)
+    {
+        Sprite_LoadJob *job = app->sprite_load.jobs + i;
+        if (job->uploaded) continue;
+        if (!SDL_GetAtomicInt(&job->done))
+        {
+            all_uploaded = false;
+            continue;
+        }
+
+        if (job->surface)
+        {
+            Sprite *sprite = Sprite_Get(app, job->sprite_id);
+            sprite->tex = SDL_CreateTextureFromSurface(app->renderer, job->surface);
+            SDL_SetTextureScaleMode(sprite->tex, SDL_SCALEMODE_NEAREST);
+            SDL_DestroySurface(job->surface);
+            job->surface = 0;
+        }
+        job->uploaded = true;
+    }
+
+    while ((int)app->sprite_load.first_pending < job_count &&
+           app->sprite_load.jobs[app->sprite_load.first_pending].uploaded)
+    {
+        app->sprite_load.first_pending += 1;
+    }
+
+    if (all_uploaded && job_count && !app->sprite_load.reported)
+    {
+        app->sprite_load.reported = true;
+        Sprite_ReportLoadTime(app, "all textures ready");
+    }
+}
+
 static Sprite *Sprite_Create(AppState *app, const char *texture_path, Uint32 tex_frames)
 {
     if (tex_frames == 0)
         tex_frames = 1;
 
-    SDL_Texture *tex = IMG_LoadTexture(app->renderer, texture_path);
-    SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_NEAREST);
+    // @info(mg) Collision shape only needs image dimensions, they are read
+    //           from the PNG header so the sprite is usable immediately.
+    //           Texture streams in later (see Sprite_UploadLoaded); until then
+    //           objects are drawn untextured. Headless server never loads textures.
+    SDL_Texture *tex = 0;
+    int tex_w = 0, tex_h = 0;
+    if (app->headless || !app->sprite_load.sync)
+    {
+        Sprite_ReadPngSize(texture_path, &tex_w, &tex_h);
+    }
+    else
+    {
+        tex = IMG_LoadTexture(app->renderer, texture_path);
+        SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_NEAREST);
+        tex_w = tex->w;
+        tex_h = tex->h;
+    }
 
-    V2 tex_half_dim = {(float)tex->w, (float)tex->h};
+    V2 tex_half_dim = {(float)tex_w, (float)tex_h};
     tex_half_dim.y /= (float)tex_frames;
     tex_half_dim = V2_Scale(tex_half_dim, 0.5f);
 
@@ -99,5 +299,162 @@ static Sprite *Sprite_Create(AppState *app, const char *texture_path, Uint32 tex
     Sprite *sprite = Sprite_CreateNoTex(app, default_col_verts);
     sprite->tex = tex;
     sprite->tex_frames = tex_frames;
+
+    if (!app->headless && !app->sprite_load.sync)
+        Sprite_QueueLoad(app, Sprite_IdFromPointer(app, sprite), texture_path);
+
+    return sprite;
+}
+
+// Builds clips of a sprite created from def; tex_frames has to be set.
+static void Sprite_SetClips(AppState *app, Sprite *sprite, Pack_SpriteDef *def)
+{
+    Uint32 clip_count = 0;
+    while (clip_count < ArrayCount(def->clips) && def->clips[clip_count].frame_count)
+        clip_count += 1;
+    if (!clip_count)
+        return;
+
+    sprite->clips = Arena_PushArray(&app->perm, Sprite_Clip, clip_count);
+    Assert(sprite->clips);
+    sprite->clip_count = clip_count;
+
+    float tex_height = 1.f / (float)Max(sprite->tex_frames, 1);
+    ForU32(clip_index, clip_count)
+    {
+        Pack_ClipDef *src = def->clips + clip_index;
+        Sprite_Clip *clip = sprite->clips + clip_index;
+        Assert(src->frame_count <= ArrayCount(src->frames));
+        clip->frame_count = src->frame_count;
+        clip->fps = src->fps;
+        clip->fps_per_move = src->fps_per_move;
+
+        ForU32(i, src->frame_count)
+        {
+            Uint32 frame = src->frames[i];
+            Assert(frame < Max(sprite->tex_frames, 1));
+            clip->hold[i] = (src->hold_on_first && frame == src->frames[0]);
+            clip->tex_y[i] = (RngF){frame * tex_height, (frame + 1) * tex_height};
+        }
+    }
+}
+
+// Texture rows of a clip step; out of range clip or step
+// (e.g. received from the server) show the first frame.
+static RngF Sprite_TexY(Sprite *sprite, Uint32 clip_index, Uint32 step)
+{
+    if (clip_index < sprite->clip_count)
+    {
+        Sprite_Clip *clip = sprite->clips + clip_index;
+        if (step < clip->frame_count)
+            return clip->tex_y[step];
+    }
+    float tex_height = (sprite->tex_frames > 1 ? 1.f / sprite->tex_frames : 1.f);
+    return (RngF){0.f, tex_height};
+}
+
+static Sprite *Sprite_CreateFromDef(AppState *app, Pack_SpriteDef *def)
+{
+    Sprite *sprite = Sprite_Create(app, def->path, def->tex_frames);
+    Sprite_UpdateCollisionVertices(sprite, Pack_CollisionVertices(def, sprite->collision_vertices));
+    Sprite_SetClips(app, sprite, def);
     return sprite;
 }
+
+//
+// Baked asset pack
+//
+static bool Sprite_ValidatePack(Os_MappedFile file)
+{
+    if (file.size < sizeof(Pack_Header))
+        return false;
+
+    Pack_Header *header = (Pack_Header *)file.base;
+    if (header->magic != PACK_MAGIC ||
+        header->version != PACK_VERSION ||
+        header->file_size != file.size ||
+        header->sprite_count != PackSprite_Count ||
+        header->defs_hash != Pack_DefsHash()) // collision tweaks or images changed since baking
+    {
+        return false;
+    }
+
+    if (file.size < sizeof(Pack_Header) + sizeof(Pack_Sprite) * PackSprite_Count)
+        return false;
+
+    Pack_Sprite *entries = (Pack_Sprite *)(header + 1);
+    ForU32(i, PackSprite_Count)
+    {
+        Pack_Sprite *entry = entries + i;
+        Pack_SpriteDef *def = pack_sprite_defs + i;
+
+        // defs_hash matched, so this only catches a corrupted pack
+        if (0 != strncmp(entry->name, def->name, sizeof(entry->name)) ||
+            entry->tex_frames != def->tex_frames)
+        {
+            return false;
+        }
+
+        Uint64 pixel_size = (Uint64)entry->pitch * entry->height;
+        if (!entry->width || !entry->height ||
+            entry->width > entry->pitch / 4 ||
+            entry->pixel_offset > file.size ||
+            pixel_size > file.size - entry->pixel_offset)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Creates sprites listed in pack_sprite_defs from the baked pack.
+// Textures are created straight from the mapped pixels; the mapping is
+// released once they are uploaded. Returns false (without creating any
+// sprites) if the pack is missing, stale or malformed.
+static bool Sprite_LoadPack(AppState *app, const char *path, Uint32 *out_sprite_ids)
+{
+    Os_MappedFile file = Os_MapFile(path);
+    if (!file.base)
+    {
+        LogWarn(LogCat_Sprite, "Asset pack %s not found; loading images (run packer to bake it)", path);
+        return false;
+    }
+
+    bool ok = Sprite_ValidatePack(file);
+    if (!ok)
+    {
+        LogWarn(LogCat_Sprite, "Asset pack %s is invalid or out of date; loading images (run packer to rebake it)", path);
+        goto pack_cleanup;
+    }
+
+    Pack_Sprite *entries = (Pack_Sprite *)(file.base + sizeof(Pack_Header));
+    ForU32(i, PackSprite_Count)
+    {
+        Pack_Sprite *entry = entries + i;
+        Sprite *sprite = Sprite_CreateNoTex(app, entry->collision_vertices);
+        sprite->collision_normals = entry->collision_normals;
+        sprite->tex_frames = entry->tex_frames;
+        Sprite_SetClips(app, sprite, pack_sprite_defs + i);
+        out_sprite_ids[i] = Sprite_IdFromPointer(app, sprite);
+
+        if (app->headless)
+            continue;
+
+        sprite->tex = SDL_CreateTexture(app->renderer, SDL_PIXELFORMAT_RGBA32,
+                                        SDL_TEXTUREACCESS_STATIC,
+                                        (int)entry->width, (int)entry->height);
+        if (!sprite->tex)
+        {
+            LogError(LogCat_Sprite, "Failed to create texture for %s: %s", pack_sprite_defs[i].name, SDL_GetError());
+            continue;
+        }
+        SDL_UpdateTexture(sprite->tex, 0, file.base + entry->pixel_offset, (int)entry->pitch);
+        SDL_SetTextureBlendMode(sprite->tex, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(sprite->tex, SDL_SCALEMODE_NEAREST);
+    }
+    app->sprite_load.from_pack = true;
+
+    pack_cleanup:
+    Os_UnmapFile(&file);
+    return ok;
+}
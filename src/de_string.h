@@ -181,38 +181,239 @@ static bool S8_EndsWith(S8 haystack, S8 needle, S8_MatchFlags flags)
 
 //
 // S8_Find
+// Candidates are offsets where the first and the last byte of the needle
+// match; a block of them is tested at once and only those are compared
+// in full, so rare first/last bytes skip most of the haystack like memchr.
+// Match flags are resolved once per search in S8_MakeFinder: each needle
+// byte that can match more than one haystack byte (case, slashes) gets
+// both variants and exact searches compare candidates with memcmp.
 //
-static S8_FindResult S8_Find(S8 str, S8 substring, Uint64 start_pos, S8_MatchFlags flags)
+typedef struct
+{
+    S8 needle;
+    S8_MatchFlags flags; // only CaseInsensitive and SlashInsensitive are left
+    Uint8 first[2]; // haystack bytes that match needle's first byte
+    Uint8 last[2]; // haystack bytes that match needle's last byte
+} S8_Finder;
+
+#if MATH_SSE2
+#define S8_FIND_BLOCK 16
+#define S8_FIND_MASK_STRIDE 1 // mask bits per haystack byte
+static Uint64 S8_FindCandidates(Uint8 *first_at, Uint8 *last_at, S8_Finder *finder)
+{
+    __m128i first = _mm_loadu_si128((__m128i *)first_at);
+    __m128i last = _mm_loadu_si128((__m128i *)last_at);
+    __m128i first_eq = _mm_or_si128(_mm_cmpeq_epi8(first, _mm_set1_epi8((char)finder->first[0])),
+                                    _mm_cmpeq_epi8(first, _mm_set1_epi8((char)finder->first[1])));
+    __m128i last_eq = _mm_or_si128(_mm_cmpeq_epi8(last, _mm_set1_epi8((char)finder->last[0])),
+                                   _mm_cmpeq_epi8(last, _mm_set1_epi8((char)finder->last[1])));
+    return (Uint64)_mm_movemask_epi8(_mm_and_si128(first_eq, last_eq));
+}
+#elif MATH_NEON
+#define S8_FIND_BLOCK 16
+#define S8_FIND_MASK_STRIDE 4
+static Uint64 S8_FindCandidates(Uint8 *first_at, Uint8 *last_at, S8_Finder *finder)
+{
+    uint8x16_t first = vld1q_u8(first_at);
+    uint8x16_t last = vld1q_u8(last_at);
+    uint8x16_t first_eq = vorrq_u8(vceqq_u8(first, vdupq_n_u8(finder->first[0])),
+                                   vceqq_u8(first, vdupq_n_u8(finder->first[1])));
+    uint8x16_t last_eq = vorrq_u8(vceqq_u8(last, vdupq_n_u8(finder->last[0])),
+                                  vceqq_u8(last, vdupq_n_u8(finder->last[1])));
+    // no movemask on NEON; narrowing shift leaves a nibble per byte
+    uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(vandq_u8(first_eq, last_eq)), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ull;
+}
+#else
+#define S8_FIND_BLOCK 8
+#define S8_FIND_MASK_STRIDE 1
+static Uint64 S8_FindCandidates(Uint8 *first_at, Uint8 *last_at, S8_Finder *finder)
+{
+    Uint64 mask = 0;
+    ForU32(i, S8_FIND_BLOCK)
+    {
+        bool first = (first_at[i] == finder->first[0] || first_at[i] == finder->first[1]);
+        bool last = (last_at[i] == finder->last[0] || last_at[i] == finder->last[1]);
+        mask |= (Uint64)(first & last) << i;
+    }
+    return mask;
+}
+#endif
+
+static Uint8 S8_FoldByte(Uint8 c, S8_MatchFlags flags)
+{
+    if (flags & S8Match_CaseInsensitive)
+        c = ByteToLower(c);
+    if (flags & S8Match_SlashInsensitive)
+        c = ByteToForwardSlash(c);
+    return c;
+}
+
+static S8_Finder S8_MakeFinder(S8 needle, S8_MatchFlags flags)
+{
+    S8_Finder result = {0};
+    result.needle = needle;
+    result.flags = flags & (S8Match_CaseInsensitive | S8Match_SlashInsensitive);
+    if (needle.size)
+    {
+        Uint8 ends[2] = {needle.str[0], needle.str[needle.size - 1]};
+        Uint8 *variants[2] = {result.first, result.last};
+        ForArray(i, ends)
+        {
+            Uint8 c = ends[i];
+            variants[i][0] = c;
+            variants[i][1] = c;
+            if ((result.flags & S8Match_CaseInsensitive) && ByteIsAlpha(c))
+            {
+                variants[i][0] = ByteToLower(c);
+                variants[i][1] = ByteToUpper(c);
+            }
+            if ((result.flags & S8Match_SlashInsensitive) && (c == '/' || c == '\\'))
+            {
+                variants[i][0] = '/';
+                variants[i][1] = '\\';
+            }
+        }
+    }
+    return result;
+}
+
+// Compares the needle at a candidate offset; the first and the last byte already matched.
+static bool S8_FinderMatch(S8_Finder *finder, Uint8 *at)
+{
+    Uint8 *needle = finder->needle.str;
+    Uint64 size = finder->needle.size;
+    if (!finder->flags)
+        return memcmp(at, needle, size) == 0;
+
+    for (Uint64 i = 1; i + 1 < size; i += 1)
+    {
+        if (at[i] != needle[i] &&
+            S8_FoldByte(at[i], finder->flags) != S8_FoldByte(needle[i], finder->flags))
+            return false;
+    }
+    return true;
+}
+
+static bool S8_FinderCheck(S8_Finder *finder, Uint8 *at)
+{
+    Uint8 first = at[0];
+    Uint8 last = at[finder->needle.size - 1];
+    return ((first == finder->first[0] || first == finder->first[1]) &&
+            (last == finder->last[0] || last == finder->last[1]) &&
+            S8_FinderMatch(finder, at));
+}
+
+// First match at or after start_pos.
+static S8_FindResult S8_FinderNext(S8_Finder *finder, S8 str, Uint64 start_pos)
 {
-    S8_FindResult result = {};
-    for (Uint64 i = start_pos; i < str.size; i += 1)
+    S8_FindResult result = {0};
+    Uint64 size = finder->needle.size;
+    if (!size)
     {
-        if (i + substring.size <= str.size)
+        // empty needle matches right away, same as S8_Match on empty strings
+        result.index = start_pos;
+        result.found = (start_pos < str.size);
+        return result;
+    }
+    if (size > str.size || start_pos > str.size - size)
+        return result;
+
+    Uint64 candidate_end = str.size - size + 1;
+    Uint64 i = start_pos;
+    for (; i + S8_FIND_BLOCK <= candidate_end; i += S8_FIND_BLOCK)
+    {
+        Uint64 mask = S8_FindCandidates(str.str + i, str.str + i + size - 1, finder);
+        while (mask)
         {
-            S8 substr_from_str = S8_Substring(str, i, i+substring.size);
-            if (S8_Match(substr_from_str, substring, flags))
+            Uint64 at = i + LowestBitIndexU64(mask) / S8_FIND_MASK_STRIDE;
+            if (S8_FinderMatch(finder, str.str + at))
             {
-                result.index = i;
+                result.index = at;
                 result.found = 1;
-                if (!(flags & S8Match_FindLast))
-                {
-                    // @speed faster implementation that searches in reverse!
-                    break;
-                }
+                return result;
             }
+            mask &= mask - 1;
+        }
+    }
+
+    for (; i < candidate_end; i += 1)
+    {
+        if (S8_FinderCheck(finder, str.str + i))
+        {
+            result.index = i;
+            result.found = 1;
+            break;
         }
     }
     return result;
 }
 
+// Last match at or after start_pos; scans backwards from the end.
+static S8_FindResult S8_FinderPrev(S8_Finder *finder, S8 str, Uint64 start_pos)
+{
+    S8_FindResult result = {0};
+    Uint64 size = finder->needle.size;
+    if (!size)
+    {
+        result.index = (str.size ? str.size - 1 : 0);
+        result.found = (start_pos < str.size);
+        return result;
+    }
+    if (size > str.size || start_pos > str.size - size)
+        return result;
+
+    Uint64 i = str.size - size + 1; // one past the last candidate
+    for (; i >= start_pos + S8_FIND_BLOCK; )
+    {
+        i -= S8_FIND_BLOCK;
+        Uint64 mask = S8_FindCandidates(str.str + i, str.str + i + size - 1, finder);
+        while (mask)
+        {
+            Uint32 bit = HighestBitIndexU64(mask);
+            Uint64 at = i + bit / S8_FIND_MASK_STRIDE;
+            if (S8_FinderMatch(finder, str.str + at))
+            {
+                result.index = at;
+                result.found = 1;
+                return result;
+            }
+            mask &= ~(1ull << bit);
+        }
+    }
+
+    while (i > start_pos)
+    {
+        i -= 1;
+        if (S8_FinderCheck(finder, str.str + i))
+        {
+            result.index = i;
+            result.found = 1;
+            break;
+        }
+    }
+    return result;
+}
+
+static S8_FindResult S8_Find(S8 str, S8 substring, Uint64 start_pos, S8_MatchFlags flags)
+{
+    S8_Finder finder = S8_MakeFinder(substring, flags);
+    if (flags & S8Match_FindLast)
+        return S8_FinderPrev(&finder, str, start_pos);
+    return S8_FinderNext(&finder, str, start_pos);
+}
+
+// Counts non-overlapping matches.
 static Uint64 S8_Count(S8 str, S8 substring, Uint64 start_pos, S8_MatchFlags flags)
 {
-    flags &= ~S8Match_FindLast; // clear FindLast flag, doesn't work here
+    if (!substring.size)
+        return 0; // would match at every offset without advancing
 
+    S8_Finder finder = S8_MakeFinder(substring, flags); // FindLast is ignored here
     Uint64 counter = 0;
     for (;;)
     {
-        S8_FindResult find = S8_Find(str, substring, start_pos, flags);
+        S8_FindResult find = S8_FinderNext(&finder, str, start_pos);
         if (!find.found)
         {
             break;
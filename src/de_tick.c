@@ -15,6 +15,7 @@ static Tick_Input *Tick_PollInput(AppState *app)
     }
 
     Tick_Input *input = app->tick_input_buf + current;
+    input->tick_id = app->tick_id;
 
     V2 dir = {0};
     if (app->keyboard[SDL_SCANCODE_W] || app->keyboard[SDL_SCANCODE_UP])    dir.y += 1;
@@ -26,37 +27,95 @@ static Tick_Input *Tick_PollInput(AppState *app)
     return input;
 }
 
-static void Tick_AdvanceSimulation(AppState *app)
+static void Tick_ApplyInput(AppState *app, Object *player, Tick_Input input)
 {
-    Tick_Input *input = Tick_PollInput(app);
+    if (!Object_IsZero(app, player))
+    {
+        float player_speed = 200.f * app->time_step;
+        player->dp = V2_Scale(input.move_dir, player_speed);
+    }
+}
 
+// local_input is applied to the local player (if there is one);
+// it's polled from the keyboard or read from a recording.
+static void Tick_AdvanceSimulation(AppState *app, Tick_Input local_input)
+{
     // update prev_p
-    ForU32(obj_id, app->object_count)
+    // @info(mg) Objects that didn't change aren't written to; it keeps their
+    //           pages clean for Sim_Save (most objects are static).
+    //           Only movers change p in ticks; animated objects need prev_p
+    //           even if they were moved from outside (network, jitter).
     {
-        Object *obj = app->object_pool + obj_id;
-        obj->prev_p = obj->p;
+        Object_ListKind kinds[] = {ObjectList_Movers, ObjectList_Animated};
+        ForArray(kind_index, kinds)
+        {
+            Object_List *list = app->object_lists + kinds[kind_index];
+            ForU32(i, list->count)
+            {
+                Object *obj = app->object_pool + list->objects[i];
+                if (obj->prev_p.x != obj->p.x || obj->prev_p.y != obj->p.y)
+                    obj->prev_p = obj->p;
+            }
+        }
     }
 
     // player input
+    if (app->has_local_player)
     {
         Object *player = Object_Network(app, app->player_network_slot);
-        if (!Object_IsZero(app, player))
+        Tick_ApplyInput(app, player, local_input);
+    }
+
+    // remote players input
+    ForU32(user_index, app->net.user_count)
+    {
+        Net_User *user = app->net.users + user_index;
+        Tick_Input user_input = Net_UserInputForTick(app, user);
+        Object *player = Object_Network(app, user->network_slot);
+        Tick_ApplyInput(app, player, user_input);
+    }
+
+    // movement & collision
+    // has_collision is only ever set on movers and colliders
+    {
+        Object_ListKind kinds[] = {ObjectList_Movers, ObjectList_Colliders};
+        ForArray(kind_index, kinds)
         {
-            float player_speed = 200.f * TIME_STEP;
-            player->dp = V2_Scale(input->move_dir, player_speed);
+            Object_List *list = app->object_lists + kinds[kind_index];
+            ForU32(i, list->count)
+            {
+                Object *obj = app->object_pool + list->objects[i];
+                if (obj->has_collision)
+                    obj->has_collision = false;
+            }
         }
     }
 
-    // movement & collision
-    ForU32(obj_id, app->object_count)
+    Uint32 collider_count = app->object_lists[ObjectList_Colliders].count;
+    Uint32 *colliders = app->object_lists[ObjectList_Colliders].objects;
+    Uint32 mover_count = app->object_lists[ObjectList_Movers].count;
+    Uint32 *movers = app->object_lists[ObjectList_Movers].objects;
+
+    // @info(mg) Lockstep peers create objects in different orders, so dense
+    //           (and list) order isn't the same on all of them. Movers are
+    //           moved in network slot order instead (only players move).
+    if (app->lockstep.enabled)
     {
-        Object *obj = app->object_pool + obj_id;
-        obj->has_collision = false;
+        mover_count = 0;
+        movers = Arena_PushArrayNoZero(&app->tick_arena, Uint32, app->network_slot_count);
+        Assert(movers);
+        ForU32(slot, app->network_slot_count)
+        {
+            Object *obj = Object_Network(app, slot);
+            if (Object_IsZero(app, obj) || !(obj->flags & ObjectFlag_Move)) continue;
+            movers[mover_count] = Object_DenseIndex(app, obj);
+            mover_count += 1;
+        }
     }
-    ForU32(obj_id, app->object_count)
+
+    ForU32(mover_index, mover_count)
     {
-        Object *obj = app->object_pool + obj_id;
-        if (!(obj->flags & ObjectFlag_Move)) continue;
+        Object *obj = app->object_pool + movers[mover_index];
         Sprite *obj_sprite = Sprite_Get(app, obj->sprite_id);
 
         obj->p = V2_Add(obj->p, obj->dp);
@@ -70,10 +129,9 @@ static void Tick_AdvanceSimulation(AppState *app)
             Vertices_Offset(obj_verts.arr, ArrayCount(obj_verts.arr), obj->p);
             V2 obj_center = Vertices_Average(obj_verts.arr, ArrayCount(obj_verts.arr));
 
-            ForU32(obstacle_id, app->object_count)
+            ForU32(collider_index, collider_count)
             {
-                Object *obstacle = app->object_pool + obstacle_id;
-                if (!(obstacle->flags & ObjectFlag_Collide)) continue;
+                Object *obstacle = app->object_pool + colliders[collider_index];
                 if (obj == obstacle) continue;
                 Sprite *obstacle_sprite = Sprite_Get(app, obstacle->sprite_id);
 
@@ -132,14 +190,27 @@ static void Tick_AdvanceSimulation(AppState *app)
                     }
                 }
 
-                if (closest_obstacle_separation_dist > biggest_dist)
+                // ties are broken by the normal so the result doesn't
+                // depend on collider order (it differs between lockstep peers)
+                bool closer = (closest_obstacle_separation_dist > biggest_dist);
+                if (closest_obstacle_separation_dist == biggest_dist)
+                {
+                    closer = (wall_normal.x < closest_obstacle_wall_normal.x ||
+                              (wall_normal.x == closest_obstacle_wall_normal.x &&
+                               wall_normal.y < closest_obstacle_wall_normal.y));
+                }
+
+                if (closer)
                 {
                     closest_obstacle_separation_dist = biggest_dist;
                     closest_obstacle_wall_normal = wall_normal;
                 }
 
-                obj->has_collision |= (biggest_dist < 0.f);
-                obstacle->has_collision |= (biggest_dist < 0.f);
+                if (biggest_dist < 0.f)
+                {
+                    obj->has_collision = true;
+                    obstacle->has_collision = true;
+                }
 
                 skip_this_obstacle:;
             }
@@ -163,42 +234,46 @@ static void Tick_AdvanceSimulation(AppState *app)
                 break;
             }
         } // collision_iteration
-    } // obj_id
+    } // mover_index
 
 
-    // animate textures
-    ForU32(obj_id, app->object_count)
+    // animate sprites
+    // @speed Only objects with clips are visited. Gather and scatter passes
+    //        do the random access; the update in between is a straight loop
+    //        over arrays that compilers vectorize.
     {
-        Object *obj = app->object_pool + obj_id;
-        if (Sprite_Get(app, obj->sprite_id)->tex_frames <= 1) continue;
-
-        Uint32 frame_index_map[8] =
+        Uint32 *animated = app->object_lists[ObjectList_Animated].objects;
+        Uint32 count = app->object_lists[ObjectList_Animated].count;
+        float *ts = Arena_PushArrayNoZero(&app->tick_arena, float, count);
+        float *rates = Arena_PushArrayNoZero(&app->tick_arena, float, count);
+        float *steps = Arena_PushArrayNoZero(&app->tick_arena, float, count);
+        Assert(ts && rates && steps);
+
+        ForU32(i, count)
         {
-            0, 1, 2, 1,
-            0, 3, 4, 3
-        };
-
-        bool in_idle_frame = (0 == frame_index_map[obj->sprite_animation_index]);
-
-        float distance = V2_Length(V2_Sub(obj->p, obj->prev_p));
-        float anim_speed = (16.f * TIME_STEP);
-        anim_speed += (5.f * distance * TIME_STEP);
+            Object *obj = app->object_pool + animated[i];
+            Sprite_Clip *clip = Sprite_Get(app, obj->sprite_id)->clips + obj->sprite_clip;
+            float moved = V2_Length(V2_Sub(obj->p, obj->prev_p));
+            bool hold = (!moved && clip->hold[obj->sprite_clip_step]);
+            rates[i] = (hold ? 0.f : (clip->fps + clip->fps_per_move * moved) * app->time_step);
+            ts[i] = obj->sprite_clip_t;
+        }
 
-        if (!distance && in_idle_frame)
+        ForU32(i, count)
         {
-            anim_speed = 0.f;
+            float t = ts[i] + rates[i];
+            steps[i] = (float)(Sint32)t;
+            ts[i] = t - steps[i];
         }
-        obj->sprite_animation_t += anim_speed;
 
-        float period = 1.f;
-        while (obj->sprite_animation_t > period)
+        ForU32(i, count)
         {
-            obj->sprite_animation_t -= period;
-            obj->sprite_animation_index += 1;
+            if (!rates[i]) continue; // keeps pages of idle objects clean
+            Object *obj = app->object_pool + animated[i];
+            Sprite_Clip *clip = Sprite_Get(app, obj->sprite_id)->clips + obj->sprite_clip;
+            obj->sprite_clip_t = ts[i];
+            obj->sprite_clip_step = (obj->sprite_clip_step + (Uint32)steps[i]) % clip->frame_count;
         }
-
-        obj->sprite_animation_index %= ArrayCount(frame_index_map);
-        obj->sprite_frame_index = frame_index_map[obj->sprite_animation_index];
     }
 
 
@@ -206,9 +281,10 @@ static void Tick_AdvanceSimulation(AppState *app)
     {
         Tick_NetworkObjState *state = app->netobj_states + app->netobj_state_next;
         app->netobj_state_next = (app->netobj_state_next + 1) % ArrayCount(app->netobj_states);
+        state->tick_id = app->tick_id;
+        Object_NetworkStateResize(state, app->network_slot_count);
 
-        static_assert(ArrayCount(state->objs) == ArrayCount(app->network_ids));
-        ForArray(i, state->objs)
+        ForU32(i, state->obj_count)
         {
             Object *dst = state->objs + i;
             Object *src = Object_Network(app, i);
@@ -217,14 +293,63 @@ static void Tick_AdvanceSimulation(AppState *app)
     }
 }
 
+// Lockstep client simulates ticks the server sent frames for, in tick_id order.
+// When it fell behind it catches up a few frames per tick.
+static void Tick_AdvanceLockstep(AppState *app)
+{
+    ForU32(catchup_index, LOCKSTEP_MAX_CATCHUP)
+    {
+        if (!app->lockstep.sim_tick_id)
+            break; // waiting for a baseline
+
+        Lockstep_Frame *frame = Lockstep_Get(app, app->lockstep.sim_tick_id + 1);
+        if (!frame)
+            break;
+
+        Arena_Reset(&app->tick_arena);
+        Lockstep_ApplyPlayers(app, frame);
+        ForU32(entry_index, frame->entry_count)
+        {
+            Lockstep_Entry *entry = frame->entries + entry_index;
+            Tick_Input input = {};
+            input.tick_id = frame->tick_id;
+            input.move_dir = entry->move_dir;
+            Tick_ApplyInput(app, Object_Network(app, entry->network_slot), input);
+        }
+
+        // client has no local player and no users; all input was applied above
+        Tick_AdvanceSimulation(app, (Tick_Input){});
+        Lockstep_CheckFrame(app, frame);
+    }
+}
+
 static void Tick_Iterate(AppState *app)
 {
+    Arena_Reset(&app->tick_arena);
+
     if (app->net.is_server)
     {
-        Tick_AdvanceSimulation(app);
+        Tick_Input *input = Tick_PollInput(app);
+        if (app->lockstep.enabled)
+        {
+            // clients only know the quantized value
+            input->move_dir.x = Net_DequantizeUnit(Net_QuantizeUnit(input->move_dir.x));
+            input->move_dir.y = Net_DequantizeUnit(Net_QuantizeUnit(input->move_dir.y));
+        }
+
+        Tick_AdvanceSimulation(app, *input);
+        if (app->lockstep.enabled)
+            Lockstep_RecordFrame(app, *input);
+        Replay_RecordTick(app, *input);
     }
     else
     {
-        //Tick_PlaybackSimulation(app); // @todo
+        // Polled inputs are sent to the server by Net_IterateSend.
+        Tick_PollInput(app);
+
+        // Client doesn't simulate outside of lockstep; remote objects
+        // are interpolated every frame by Jitter_Playback.
+        if (app->lockstep.enabled)
+            Tick_AdvanceLockstep(app);
     }
 }
@@ -21,18 +21,17 @@ static Col_Vertices Vertices_FromRect(V2 p, V2 dim)
 static void Vertices_Rotate(V2 *verts, Uint64 vert_count, float rotation)
 {
     SinCosResult sincos = SinCosF(rotation);
-    ForU64(i, vert_count)
-        verts[i] = V2_RotateSinCos(verts[i], sincos);
+    V2 x_axis = {sincos.cos, sincos.sin};
+    V2 y_axis = {-sincos.sin, sincos.cos};
+    V2_StreamTransform(verts, verts, vert_count, x_axis, y_axis, (V2){0});
 }
 static void Vertices_Scale(V2 *verts, Uint64 vert_count, float scale)
 {
-    ForU64(i, vert_count)
-        verts[i] = V2_Scale(verts[i], scale);
+    V2_StreamTransform(verts, verts, vert_count, (V2){scale, 0}, (V2){0, scale}, (V2){0});
 }
 static void Vertices_Offset(V2 *verts, Uint64 vert_count, V2 offset)
 {
-    ForU64(i, vert_count)
-        verts[i] = V2_Add(verts[i], offset);
+    V2_StreamOffset(verts, verts, vert_count, offset);
 }
 static void Vertices_Max(V2 *verts, Uint64 vert_count, V2 val)
 {
@@ -63,3 +62,16 @@ static V2 Vertices_Average(V2 *verts, Uint64 vert_count)
     V2 avg = V2_Scale(sum, inv);
     return avg;
 }
+
+// Calculates outward normal for every edge (vertex i -> vertex i+1).
+static void Vertices_Normals(V2 *normals, V2 *verts, Uint64 vert_count)
+{
+    ForU64(vert_id, vert_count)
+    {
+        Uint64 next_vert_id = vert_id + 1;
+        if (next_vert_id >= vert_count)
+            next_vert_id -= vert_count;
+
+        normals[vert_id] = V2_CalculateNormal(verts[vert_id], verts[next_vert_id]);
+    }
+}
@@ -0,0 +1,403 @@
+//
+// Visibility
+// Polygon of everything a viewer can see: static collision shapes of
+// the map (map.bvh) block the view, the result is clipped to a square
+// of VISIBILITY_RANGE around the viewer. Players and other network
+// objects don't block it.
+// Angular sweep: edges of shapes close to the viewer (found through the
+// BVH) that face the viewer are sorted by the angle of their endpoints.
+// A ray sweeps around the viewer keeping the set of edges it crosses;
+// every time the closest of them changes the polygon gets a vertex.
+// Polygons are cached; they're recomputed only when the viewer moved or
+// the BVH was rebuilt (bvh_version), so standing players cost nothing.
+//
+typedef struct
+{
+    V2 a, b; // a comes first going counterclockwise around the viewer
+} Visibility_Edge;
+
+typedef struct
+{
+    float angle;
+    Uint32 edge;
+    Uint32 is_begin;
+} Visibility_Event;
+
+#define VISIBILITY_NONE 0xffffffffu
+#define VISIBILITY_SWEEP_EPSILON 1e-4f // relative offset of rays just before/after an event
+
+// Monotonic in the angle of d; [0, 4) counterclockwise, starting at +x.
+// Cheaper than atan2 and exact enough to sort by.
+static float Visibility_PseudoAngle(V2 d)
+{
+    float sum = AbsF(d.x) + AbsF(d.y);
+    if (!sum)
+        return 0.f;
+    float p = d.x / sum;
+    return (d.y < 0.f ? 3.f + p : 1.f - p);
+}
+
+static float Visibility_Cross(V2 a, V2 b)
+{
+    return a.x*b.y - a.y*b.x;
+}
+
+// Distance along dir from origin to the line through edge; FLT_MAX if parallel
+// or behind. Lines, not segments: edges are only tested at angles they cover.
+static float Visibility_RayLine(V2 origin, V2 dir, Visibility_Edge *edge)
+{
+    V2 edge_dir = V2_Sub(edge->b, edge->a);
+    float denom = Visibility_Cross(dir, edge_dir);
+    if (denom == 0.f)
+        return FLT_MAX;
+
+    float t = Visibility_Cross(V2_Sub(edge->a, origin), edge_dir) / denom;
+    return (t >= 0.f ? t : FLT_MAX);
+}
+
+static Uint32 Visibility_Closest(Visibility_Edge *edges, Uint32 *active, Uint32 active_count,
+                                 V2 origin, V2 dir)
+{
+    Uint32 result = VISIBILITY_NONE;
+    float best_t = FLT_MAX;
+    ForU32(i, active_count)
+    {
+        float t = Visibility_RayLine(origin, dir, edges + active[i]);
+        if (t < best_t || (t == best_t && active[i] < result))
+        {
+            best_t = t;
+            result = active[i];
+        }
+    }
+    return result;
+}
+
+// @speed LSD radix sort by angle; angles are non-negative, so their
+//        bits sort like unsigned ints. Passes over bytes that are the same
+//        for every event are skipped. Result ends up in events.
+static void Visibility_SortEvents(Visibility_Event *events, Visibility_Event *temp, Uint32 count)
+{
+    if (!count)
+        return;
+
+    Visibility_Event *src = events;
+    Visibility_Event *dst = temp;
+    for (Uint32 shift = 0; shift < 32; shift += 8)
+    {
+        Uint32 offsets[256] = {0};
+        ForU32(i, count)
+        {
+            Uint32 key;
+            memcpy(&key, &src[i].angle, sizeof(key));
+            offsets[(key >> shift) & 0xff] += 1;
+        }
+
+        Uint32 first_key;
+        memcpy(&first_key, &src[0].angle, sizeof(first_key));
+        if (offsets[(first_key >> shift) & 0xff] == count)
+            continue;
+
+        Uint32 sum = 0;
+        ForArray(bucket, offsets)
+        {
+            Uint32 bucket_count = offsets[bucket];
+            offsets[bucket] = sum;
+            sum += bucket_count;
+        }
+        ForU32(i, count)
+        {
+            Uint32 key;
+            memcpy(&key, &src[i].angle, sizeof(key));
+            dst[offsets[(key >> shift) & 0xff]++] = src[i];
+        }
+
+        Visibility_Event *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != events)
+        memcpy(events, src, count * sizeof(*events));
+}
+
+static void Visibility_Push(Visibility_Polygon *poly, V2 p)
+{
+    if (poly->count)
+    {
+        V2 d = V2_Sub(poly->verts[poly->count - 1], p);
+        if (AbsF(d.x) + AbsF(d.y) < 1e-3f)
+            return; // corners where one edge ends and the next begins
+    }
+
+    Assert(poly->count < poly->capacity);
+    poly->verts[poly->count] = p;
+    poly->angles[poly->count] = Visibility_PseudoAngle(V2_Sub(p, poly->viewer));
+    poly->count += 1;
+}
+
+static void Visibility_PushOnEdge(Visibility_Polygon *poly, Visibility_Edge *edge, V2 dir)
+{
+    float t = Visibility_RayLine(poly->viewer, dir, edge);
+    if (t != FLT_MAX)
+        Visibility_Push(poly, V2_Add(poly->viewer, V2_Scale(dir, t)));
+}
+
+// Adds the edge oriented counterclockwise around the viewer; edges
+// the viewer sees edge-on don't hide anything and are skipped.
+static void Visibility_AddEdge(Visibility_Edge *edges, Uint32 *edge_count, V2 viewer, V2 a, V2 b)
+{
+    float cross = Visibility_Cross(V2_Sub(a, viewer), V2_Sub(b, viewer));
+    if (cross == 0.f)
+        return;
+
+    Visibility_Edge *edge = edges + *edge_count;
+    *edge_count += 1;
+    edge->a = (cross > 0.f ? a : b);
+    edge->b = (cross > 0.f ? b : a);
+}
+
+// Vertices are collected in scratch and then copied to poly->arena,
+// so it only keeps as much memory as the biggest polygon needed.
+static void Visibility_Compute(Arena *scratch, Bvh *bvh, V2 viewer, float range,
+                               Visibility_Polygon *poly)
+{
+    Uint64 scratch_mark = scratch->used;
+    if (!poly->arena.base)
+        Arena_Init(&poly->arena, "visibility", VISIBILITY_ARENA_RESERVE);
+    Arena_Reset(&poly->arena);
+    poly->valid = true;
+    poly->viewer = viewer;
+    poly->range = range;
+    poly->verts = 0;
+    poly->angles = 0;
+    poly->count = 0;
+    poly->capacity = 0;
+
+    Bvh_Box box = {V2_Sub(viewer, (V2){range, range}), V2_Add(viewer, (V2){range, range})};
+    Uint32 shape_count = Bvh_QueryBoxShapes(bvh, box, 0, 0);
+    Uint32 *shape_indices = Arena_PushArrayNoZero(scratch, Uint32, shape_count);
+    Uint32 max_edges = shape_count * 4 + 4;
+    Visibility_Edge *edges = Arena_PushArrayNoZero(scratch, Visibility_Edge, max_edges);
+    Visibility_Event *events = Arena_PushArrayNoZero(scratch, Visibility_Event, max_edges * 2);
+    Visibility_Event *sort_temp = Arena_PushArrayNoZero(scratch, Visibility_Event, max_edges * 2);
+    Uint32 *active = Arena_PushArrayNoZero(scratch, Uint32, max_edges);
+    Uint32 *active_index = Arena_PushArrayNoZero(scratch, Uint32, max_edges);
+    // every group of events adds at most 3 vertices: a crossing, the hit before and after it
+    Uint32 max_verts = max_edges * 2 * 3;
+    V2 *verts = Arena_PushArrayNoZero(scratch, V2, max_verts);
+    float *angles = Arena_PushArrayNoZero(scratch, float, max_verts);
+    if (!edges || !events || !sort_temp || !active || !active_index || !verts || !angles ||
+        (shape_count && !shape_indices))
+    {
+        LogWarn(LogCat_Game, "Visibility: out of scratch memory for %u shapes", shape_count);
+        poly->valid = false;
+        Arena_PopTo(scratch, scratch_mark);
+        return;
+    }
+    Bvh_QueryBoxShapes(bvh, box, shape_indices, shape_count);
+    poly->verts = verts;
+    poly->angles = angles;
+    poly->capacity = max_verts;
+
+    // @speed Only edges facing the viewer can be the closest ones
+    //        (shapes are convex), which halves the edge count.
+    Uint32 edge_count = 0;
+    ForU32(i, shape_count)
+    {
+        Bvh_Shape *shape = bvh->shapes + shape_indices[i];
+        if (Bvh_PointShape(shape, viewer))
+            continue; // viewer inside of a wall sees through it
+
+        ForArray(vert, shape->verts.arr)
+        {
+            V2 a = shape->verts.arr[vert];
+            V2 b = shape->verts.arr[(vert + 1) % ArrayCount(shape->verts.arr)];
+            if (V2_Inner(shape->normals.arr[vert], V2_Sub(viewer, a)) > 0.f)
+                Visibility_AddEdge(edges, &edge_count, viewer, a, b);
+        }
+    }
+
+    // range square; every ray hits at least one of its edges
+    {
+        V2 c0 = {box.min.x, box.min.y};
+        V2 c1 = {box.max.x, box.min.y};
+        V2 c2 = {box.max.x, box.max.y};
+        V2 c3 = {box.min.x, box.max.y};
+        Visibility_AddEdge(edges, &edge_count, viewer, c0, c1);
+        Visibility_AddEdge(edges, &edge_count, viewer, c1, c2);
+        Visibility_AddEdge(edges, &edge_count, viewer, c2, c3);
+        Visibility_AddEdge(edges, &edge_count, viewer, c3, c0);
+    }
+
+    // events; edges that cross the +x axis are active from the start
+    Uint32 active_count = 0;
+    Uint32 event_count = 0;
+    ForU32(edge_id, edge_count)
+    {
+        Visibility_Edge *edge = edges + edge_id;
+        float angle_a = Visibility_PseudoAngle(V2_Sub(edge->a, viewer));
+        float angle_b = Visibility_PseudoAngle(V2_Sub(edge->b, viewer));
+        events[event_count++] = (Visibility_Event){angle_a, edge_id, true};
+        events[event_count++] = (Visibility_Event){angle_b, edge_id, false};
+
+        active_index[edge_id] = VISIBILITY_NONE;
+        if (angle_a > angle_b)
+        {
+            active_index[edge_id] = active_count;
+            active[active_count++] = edge_id;
+        }
+    }
+    Visibility_SortEvents(events, sort_temp, event_count);
+
+    // sweep; events with the same angle are handled together
+    Uint32 prev_closest = VISIBILITY_NONE;
+    Uint32 event_index = 0;
+    while (event_index < event_count)
+    {
+        float angle = events[event_index].angle;
+        Visibility_Edge *event_edge = edges + events[event_index].edge;
+        V2 dir = V2_Sub(events[event_index].is_begin ? event_edge->a : event_edge->b, viewer);
+        V2 side = V2_Scale(V2_RotateCounterclockwise90(dir), VISIBILITY_SWEEP_EPSILON);
+
+        Uint32 group_end = event_index;
+        while (group_end < event_count && events[group_end].angle == angle)
+            group_end += 1;
+
+        // @speed Edges that start or end behind the closest edge can't
+        //        change what's visible; only the active set is updated.
+        //        In dense maps that's most of the events.
+        bool hidden = false;
+        if (prev_closest != VISIBILITY_NONE)
+        {
+            float closest_t = Visibility_RayLine(viewer, dir, edges + prev_closest);
+            float dir_length_sq = V2_LengthSq(dir);
+            hidden = (closest_t != FLT_MAX && dir_length_sq > 0.f);
+            for (Uint32 i = event_index; hidden && i < group_end; i += 1)
+            {
+                Visibility_Edge *edge = edges + events[i].edge;
+                V2 p = V2_Sub(events[i].is_begin ? edge->a : edge->b, viewer);
+                float t = V2_Inner(p, dir) / dir_length_sq;
+                hidden = (events[i].edge != prev_closest && t > closest_t * (1.f + VISIBILITY_SWEEP_EPSILON));
+            }
+        }
+
+        Uint32 before = prev_closest;
+        if (!hidden)
+            before = Visibility_Closest(edges, active, active_count, viewer, V2_Sub(dir, side));
+        if (event_index && before != prev_closest &&
+            before != VISIBILITY_NONE && prev_closest != VISIBILITY_NONE)
+        {
+            // edges crossed each other between events (overlapping walls)
+            Visibility_Edge *prev = edges + prev_closest;
+            Visibility_Edge *next = edges + before;
+            V2 prev_dir = V2_Sub(prev->b, prev->a);
+            V2 next_dir = V2_Sub(next->b, next->a);
+            float denom = Visibility_Cross(prev_dir, next_dir);
+            if (denom != 0.f)
+            {
+                float t = Visibility_Cross(V2_Sub(next->a, prev->a), next_dir) / denom;
+                Visibility_Push(poly, V2_Add(prev->a, V2_Scale(prev_dir, t)));
+            }
+        }
+
+        for (; event_index < group_end; event_index += 1)
+        {
+            Visibility_Event *event = events + event_index;
+            if (event->is_begin)
+            {
+                if (active_index[event->edge] != VISIBILITY_NONE) continue;
+                active_index[event->edge] = active_count;
+                active[active_count++] = event->edge;
+            }
+            else
+            {
+                Uint32 index = active_index[event->edge];
+                if (index == VISIBILITY_NONE) continue;
+                Uint32 moved = active[active_count - 1];
+                active[index] = moved;
+                active_index[moved] = index;
+                active_count -= 1;
+                active_index[event->edge] = VISIBILITY_NONE;
+            }
+        }
+
+        if (hidden)
+            continue;
+
+        Uint32 after = Visibility_Closest(edges, active, active_count, viewer, V2_Add(dir, side));
+        if (after != before)
+        {
+            if (before != VISIBILITY_NONE) Visibility_PushOnEdge(poly, edges + before, dir);
+            if (after != VISIBILITY_NONE)  Visibility_PushOnEdge(poly, edges + after, dir);
+        }
+        prev_closest = after;
+    }
+
+    poly->verts = Arena_PushArrayNoZero(&poly->arena, V2, poly->count);
+    poly->angles = Arena_PushArrayNoZero(&poly->arena, float, poly->count);
+    if (!poly->verts || !poly->angles)
+    {
+        poly->valid = false;
+        poly->count = 0;
+    }
+    else
+    {
+        memcpy(poly->verts, verts, poly->count * sizeof(*verts));
+        memcpy(poly->angles, angles, poly->count * sizeof(*angles));
+    }
+    poly->capacity = poly->count;
+    Arena_PopTo(scratch, scratch_mark);
+}
+
+// Recomputes the polygon only when it's out of date;
+// returns false when the cached one is still valid.
+static bool Visibility_Update(AppState *app, Visibility_Polygon *poly, V2 viewer, float range)
+{
+    if (poly->valid && poly->viewer.x == viewer.x && poly->viewer.y == viewer.y &&
+        poly->range == range && poly->bvh_version == app->map.bvh_version)
+    {
+        return false;
+    }
+
+    Visibility_Compute(&app->frame_arena, &app->map.bvh, viewer, range, poly);
+    poly->bvh_version = app->map.bvh_version;
+    return true;
+}
+
+static void Visibility_Free(Visibility_Polygon *poly)
+{
+    Arena_Release(&poly->arena);
+    SDL_zerop(poly);
+}
+
+// O(log n): finds the wedge (viewer, verts[i], verts[i+1]) that
+// contains p's angle and checks on which side of its far edge p is.
+static bool Visibility_Contains(Visibility_Polygon *poly, V2 p)
+{
+    if (!poly->valid || poly->count < 2)
+        return false;
+
+    V2 d = V2_Sub(p, poly->viewer);
+    if (AbsF(d.x) > poly->range || AbsF(d.y) > poly->range)
+        return false;
+    if (!d.x && !d.y)
+        return true;
+
+    // first vertex with angle > p's; wedge ends at it
+    float angle = Visibility_PseudoAngle(d);
+    Uint32 lo = 0;
+    Uint32 hi = poly->count;
+    while (lo < hi)
+    {
+        Uint32 mid = (lo + hi) / 2;
+        if (poly->angles[mid] <= angle) lo = mid + 1;
+        else                            hi = mid;
+    }
+    Uint32 next = (lo == poly->count ? 0 : lo);
+    Uint32 prev = (lo == 0 ? poly->count - 1 : lo - 1);
+
+    V2 a = poly->verts[prev];
+    V2 b = poly->verts[next];
+    // small tolerance; objects touching a wall count as visible
+    return Visibility_Cross(V2_Sub(b, a), V2_Sub(p, a)) >= -1e-3f * V2_Length(V2_Sub(b, a));
+}
@@ -0,0 +1,638 @@
+//
+// @info(mg) Load generator: runs many headless bots in one process
+//           against a running server. Bots don't simulate or draw
+//           anything. Every bot has its own socket (server tells users
+//           apart by address and port), sends a Tick_Input every tick
+//           (random walk or a scripted circle) and parses snapshots it
+//           receives.
+//           Once per second it logs:
+//             - server frame time (work_us from UserInfo)
+//             - bandwidth in both directions
+//             - input latency percentiles: from sending an input until a
+//               message with it applied arrives (UserInfo input_tick_id);
+//               includes NET_INPUT_DELAY_TICKS of server buffering
+//
+// Example:
+//   ./demongus -dedicated
+//   ./loadgen -bots 200
+//   ./loadgen -bots 500 -ramp 50 -seconds 60      # 50 new bots per second
+//   ./loadgen -bots 50 -behavior circle -port 21038 # through the proxy
+//
+#define SDL_ASSERT_LEVEL 2
+#include <SDL3/SDL_stdinc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <float.h>
+
+#define SDL_MAIN_USE_CALLBACKS
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+#include <SDL3_image/SDL_image.h>
+#include <SDL3_net/SDL_net.h>
+
+#define WINDOW_HEIGHT 640
+#define WINDOW_WIDTH 854
+
+#include "de_base.h"
+#include "de_math.h"
+#include "de_vertices.h"
+#include "de_string.h"
+#include "de_arena.h"
+#include "de_log.h"
+#include "de_pack.h"
+#include "de_map.h"
+#include "de_main.h"
+#include "de_log.c"
+#include "de_sprite.c"
+#include "de_object.c"
+#include "de_sim.c"
+#include "de_bvh.c"
+#include "de_map.c"
+#include "de_visibility.c"
+#include "de_replay.c"
+#include "de_jitter.c"
+#include "de_interest.c"
+#include "de_lockstep.c"
+#include "de_network.c"
+#include "de_tick.c"
+
+#define LOADGEN_INPUT_HISTORY 256 // send times of inputs by tick id; older inputs aren't measured
+#define LOADGEN_MAX_LATENCY_SAMPLES (64 * 1024) // per report; the rest is counted as dropped
+
+typedef enum
+{
+    LoadgenBehavior_Walk, // random walk; changes direction or stops every now and then
+    LoadgenBehavior_Circle, // walks in circles; same for every run
+} Loadgen_Behavior;
+
+typedef struct
+{
+    SDLNet_DatagramSocket *socket;
+
+    // input stream; same as the client's tick_input_buf
+    Uint64 tick_id; // of the newest input
+    Tick_Input inputs[NET_INPUT_REDUNDANCY];
+    Uint64 input_send_ns[LOADGEN_INPUT_HISTORY]; // when input of a tick was sent for the first time
+    Uint64 applied_input_tick_id; // newest input the server reported as applied
+    V2 move_dir;
+    float turns; // circle behavior
+    Uint32 send_message_id;
+
+    // received
+    bool joined; // got UserInfo
+    Uint32 network_slot;
+    Uint64 snapshot_tick_id; // newest state received
+
+    // reassembly; server sends messages in order so one at a time is enough
+    Uint32 message_id;
+    Uint32 fragment_count; // 0 == no message in progress
+    Uint32 received_count;
+    Uint64 received_mask;
+    Uint32 message_size;
+    Uint8 message[NET_MAX_FRAGMENTS * NET_FRAGMENT_PAYLOAD];
+} Loadgen_Bot;
+
+typedef struct
+{
+    Uint64 sent_bytes;
+    Uint64 sent_packets;
+    Uint64 received_bytes;
+    Uint64 received_packets;
+    Uint64 invalid_packets;
+    Uint64 incomplete_messages; // dropped when fragments of a newer message arrived
+    Uint64 snapshots; // new states
+    Uint64 snapshot_objects;
+    Uint64 snapshots_without_player; // bot's own player wasn't relevant to it
+
+    Uint64 work_sum_us; // once per server tick
+    Uint64 work_max_us;
+    Uint64 work_count;
+
+    Uint32 latency_us[LOADGEN_MAX_LATENCY_SAMPLES];
+    Uint32 latency_count;
+    Uint64 latency_dropped;
+} Loadgen_Stats;
+
+typedef struct
+{
+    Uint16 port;
+    SDLNet_Address *server_address;
+    Loadgen_Behavior behavior;
+    Uint32 seconds; // 0 == run until closed
+    Uint32 ramp; // bots started per second; 0 == all at once
+
+    Loadgen_Bot *bots;
+    Uint32 bot_count;
+    Uint32 active_count; // bots[0..active_count) are running
+    void **sockets; // of active bots; for SDLNet_WaitUntilInputAvailable
+
+    Uint32 tick_rate; // from the server
+    Uint64 next_tick_ns;
+    Uint64 start_ns;
+    Uint64 server_tick_id; // newest server tick seen in UserInfo
+    bool lockstep_warned;
+
+    Uint64 rng;
+    Loadgen_Stats stats;
+    Uint64 stats_last_ns;
+} LoadgenState;
+
+//
+// Sending
+//
+static void Loadgen_NextInput(LoadgenState *loadgen, Loadgen_Bot *bot)
+{
+    if (loadgen->behavior == LoadgenBehavior_Circle)
+    {
+        // one circle every 4 seconds; bots start at different angles
+        bot->turns += 1.f / (4.f * (float)loadgen->tick_rate);
+        bot->turns -= (float)(Sint32)bot->turns;
+        bot->move_dir = (V2){CosF(bot->turns), SinF(bot->turns)};
+    }
+    else
+    {
+        // about twice per second pick a new direction; sometimes stand still
+        if (SDL_randf_r(&loadgen->rng) * (float)loadgen->tick_rate < 2.f)
+        {
+            if (SDL_randf_r(&loadgen->rng) < 0.2f)
+                bot->move_dir = (V2){0};
+            else
+                bot->move_dir = V2_Rotate((V2){1, 0}, SDL_randf_r(&loadgen->rng));
+        }
+    }
+
+    bot->tick_id += 1;
+    Tick_Input *input = bot->inputs + (bot->tick_id % ArrayCount(bot->inputs));
+    input->tick_id = bot->tick_id;
+    input->move_dir = bot->move_dir;
+}
+
+static Uint32 Loadgen_WriteInputs(Loadgen_Bot *bot, Uint8 *dst)
+{
+    Uint32 input_count = (Uint32)Min(bot->tick_id, NET_INPUT_REDUNDANCY);
+
+    // newest to oldest
+    Tick_Input inputs[NET_INPUT_REDUNDANCY];
+    ForU32(i, input_count)
+        inputs[i] = bot->inputs[(bot->tick_id - i) % ArrayCount(bot->inputs)];
+
+    return Net_EncodeInputs(dst, inputs, input_count);
+}
+
+static void Loadgen_SendInputs(LoadgenState *loadgen, Loadgen_Bot *bot, Uint64 now)
+{
+    Loadgen_NextInput(loadgen, bot);
+    bot->input_send_ns[bot->tick_id % LOADGEN_INPUT_HISTORY] = now;
+
+    Uint8 payload[NET_MAX_INPUTS_SIZE];
+    Uint32 payload_size = Loadgen_WriteInputs(bot, payload);
+    static_assert(sizeof(payload) <= NET_FRAGMENT_PAYLOAD);
+
+    Net_FragmentHeader frag = {};
+    frag.message_id = bot->send_message_id++;
+    frag.fragment_count = 1;
+
+    Uint8 dgram[NET_MTU];
+    Uint64 dgram_size = Net_PackDatagram(dgram, frag, S8_Make(payload, payload_size));
+    if (SDLNet_SendDatagram(bot->socket, loadgen->server_address, loadgen->port, dgram, (int)dgram_size))
+    {
+        loadgen->stats.sent_packets += 1;
+        loadgen->stats.sent_bytes += dgram_size;
+    }
+}
+
+//
+// Receiving
+//
+static void Loadgen_OnUserInfo(LoadgenState *loadgen, Loadgen_Bot *bot, Uint64 server_tick_id,
+                               Uint32 tick_rate, Uint64 input_tick_id, Uint32 work_us, Uint64 now)
+{
+    Loadgen_Stats *stats = &loadgen->stats;
+    bot->joined = true;
+
+    if (loadgen->tick_rate != tick_rate)
+    {
+        SDL_Log("LOADGEN: server tick rate: %u", tick_rate);
+        loadgen->tick_rate = tick_rate;
+    }
+
+    // every bot gets the same value; count it once per server tick
+    if (server_tick_id > loadgen->server_tick_id)
+    {
+        loadgen->server_tick_id = server_tick_id;
+        stats->work_sum_us += work_us;
+        stats->work_max_us = Max(stats->work_max_us, work_us);
+        stats->work_count += 1;
+    }
+
+    if (input_tick_id > bot->applied_input_tick_id)
+    {
+        bot->applied_input_tick_id = input_tick_id;
+        bool in_history = (input_tick_id <= bot->tick_id &&
+                           bot->tick_id - input_tick_id < LOADGEN_INPUT_HISTORY);
+        if (in_history)
+        {
+            Uint64 latency_ns = now - bot->input_send_ns[input_tick_id % LOADGEN_INPUT_HISTORY];
+            if (stats->latency_count < ArrayCount(stats->latency_us))
+                stats->latency_us[stats->latency_count++] = (Uint32)Min(latency_ns / 1000, 0xffff'ffffllu);
+            else
+                stats->latency_dropped += 1;
+        }
+    }
+}
+
+// Parses a whole message; see Net_IterateReceive for the client side.
+static bool Loadgen_ReceiveMessage(LoadgenState *loadgen, Loadgen_Bot *bot, S8 msg, Uint64 now)
+{
+    Net_Reader reader = { msg };
+    while (reader.msg.size)
+    {
+        Tick_Command cmd = Net_ReadCommand(&reader);
+        if (reader.err)
+            return false;
+
+        if (cmd.kind == Tick_Cmd_NetworkObj)
+        {
+            if (!Net_ReadView(&reader, sizeof(Object) + sizeof(Uint32)))
+                return false;
+        }
+        else if (cmd.kind == Tick_Cmd_ObjHistory)
+        {
+            Uint32 state_count = Net_ReadU32(&reader);
+            if (reader.err || state_count > NET_MAX_TICK_HISTORY)
+                return false;
+
+            ForU32(state_index, state_count)
+            {
+                Uint64 tick_id = Net_ReadU64(&reader);
+                Uint32 entry_count = Net_ReadU32(&reader);
+
+                Uint64 entry_size = sizeof(Uint32) + sizeof(Object);
+                Uint8 *entries = 0;
+                if (!reader.err && entry_count <= NET_MAX_NETWORK_OBJECTS)
+                    entries = Net_ReadView(&reader, entry_count * entry_size);
+                if (!entries)
+                    return false;
+
+                if (tick_id <= bot->snapshot_tick_id)
+                    continue; // redundant copy of a state we already have
+
+                bot->snapshot_tick_id = tick_id;
+                loadgen->stats.snapshots += 1;
+                loadgen->stats.snapshot_objects += entry_count;
+
+                bool has_player = false;
+                ForU32(entry_index, entry_count)
+                    has_player |= (Net_LoadU32(entries + entry_index * entry_size) == bot->network_slot);
+                if (bot->joined && !has_player)
+                    loadgen->stats.snapshots_without_player += 1;
+            }
+        }
+        else if (cmd.kind == Tick_Cmd_UserInfo)
+        {
+            Uint32 network_slot = Net_ReadU32(&reader);
+            Uint32 tick_rate = Net_ReadU32(&reader);
+            Uint64 input_tick_id = Net_ReadU64(&reader);
+            Uint32 work_us = Net_ReadU32(&reader);
+            if (reader.err || !tick_rate || tick_rate > TICK_RATE_MAX)
+                return false;
+
+            bot->network_slot = network_slot;
+            Loadgen_OnUserInfo(loadgen, bot, cmd.tick_id, tick_rate, input_tick_id, work_us, now);
+        }
+        else if (cmd.kind == Tick_Cmd_Lockstep)
+        {
+            // @todo(mg) lockstep bots would have to ack frames
+            if (!loadgen->lockstep_warned)
+            {
+                SDL_Log("LOADGEN: server runs in lockstep mode; bots don't support it");
+                loadgen->lockstep_warned = true;
+            }
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void Loadgen_ReceiveDatagram(LoadgenState *loadgen, Loadgen_Bot *bot, S8 msg, Uint64 now)
+{
+    Loadgen_Stats *stats = &loadgen->stats;
+    stats->received_packets += 1;
+    stats->received_bytes += msg.size;
+
+    Net_BufHeader header;
+    Net_FragmentHeader frag;
+    if (msg.size < sizeof(header) + sizeof(frag))
+        goto invalid;
+
+    memcpy(&header, msg.str, sizeof(header));
+    msg = S8_Skip(msg, sizeof(header));
+    if (header.magic_value != NET_MAGIC_VALUE || header.hash != S8_Hash(0, msg))
+        goto invalid;
+
+    memcpy(&frag, msg.str, sizeof(frag));
+    msg = S8_Skip(msg, sizeof(frag));
+    bool is_last = (frag.fragment_index + 1 == frag.fragment_count);
+    if (!frag.fragment_count ||
+        frag.fragment_count > NET_MAX_FRAGMENTS ||
+        frag.fragment_index >= frag.fragment_count ||
+        msg.size > NET_FRAGMENT_PAYLOAD ||
+        (!is_last && msg.size != NET_FRAGMENT_PAYLOAD))
+        goto invalid;
+
+    if (frag.fragment_count == 1)
+    {
+        if (!Loadgen_ReceiveMessage(loadgen, bot, msg, now))
+            goto invalid;
+        return;
+    }
+
+    if (!bot->fragment_count || bot->message_id != frag.message_id)
+    {
+        if (bot->fragment_count)
+            stats->incomplete_messages += 1;
+        bot->message_id = frag.message_id;
+        bot->fragment_count = frag.fragment_count;
+        bot->received_count = 0;
+        bot->received_mask = 0;
+        bot->message_size = 0;
+    }
+
+    Uint64 bit = 1llu << frag.fragment_index;
+    if (bot->fragment_count != frag.fragment_count)
+        goto invalid;
+    if (bot->received_mask & bit)
+        return; // duplicate
+
+    Uint32 offset = frag.fragment_index * NET_FRAGMENT_PAYLOAD;
+    memcpy(bot->message + offset, msg.str, msg.size);
+    bot->received_mask |= bit;
+    bot->received_count += 1;
+    if (is_last)
+        bot->message_size = offset + (Uint32)msg.size;
+
+    if (bot->received_count == bot->fragment_count)
+    {
+        bot->fragment_count = 0;
+        if (!Loadgen_ReceiveMessage(loadgen, bot, S8_Make(bot->message, bot->message_size), now))
+            goto invalid;
+    }
+    return;
+
+    invalid:
+    stats->invalid_packets += 1;
+}
+
+//
+// Stats
+//
+static int Loadgen_CompareU32(const void *a, const void *b)
+{
+    Uint32 value_a = *(Uint32 *)a;
+    Uint32 value_b = *(Uint32 *)b;
+    return (value_a < value_b ? -1 : value_a > value_b ? 1 : 0);
+}
+
+static double Loadgen_PercentileMs(Uint32 *sorted, Uint32 count, double percentile)
+{
+    if (!count)
+        return 0.0;
+    Uint32 index = (Uint32)(percentile * (double)(count - 1) + 0.5);
+    return (double)sorted[index] / 1000.0;
+}
+
+static void Loadgen_ReportStats(LoadgenState *loadgen, Uint64 now)
+{
+    Loadgen_Stats *stats = &loadgen->stats;
+    double seconds = (double)(now - loadgen->stats_last_ns) / (double)SDL_NS_PER_SECOND;
+    if (seconds <= 0.0) return;
+
+    Uint32 joined = 0;
+    ForU32(i, loadgen->active_count)
+        joined += loadgen->bots[i].joined;
+    double bots = (double)Max(loadgen->active_count, 1);
+
+    SDL_Log("LOADGEN: %u/%u bots joined; up %.0f B/s (%.0f per bot), down %.0f B/s (%.0f per bot); "
+            "%.1f snapshots/s per bot with %.1f objects (%llu without own player); "
+            "%llu invalid packets, %llu incomplete messages",
+            joined, loadgen->active_count,
+            (double)stats->sent_bytes / seconds, (double)stats->sent_bytes / seconds / bots,
+            (double)stats->received_bytes / seconds, (double)stats->received_bytes / seconds / bots,
+            (double)stats->snapshots / seconds / bots,
+            (double)stats->snapshot_objects / (double)Max(stats->snapshots, 1),
+            stats->snapshots_without_player,
+            stats->invalid_packets, stats->incomplete_messages);
+
+    SDL_qsort(stats->latency_us, stats->latency_count, sizeof(*stats->latency_us), Loadgen_CompareU32);
+    SDL_Log("LOADGEN: server frame avg %.2f max %.2f ms; input latency p50 %.1f p90 %.1f p99 %.1f max %.1f ms "
+            "(%u samples, %llu dropped)",
+            (double)stats->work_sum_us / (double)Max(stats->work_count, 1) / 1000.0,
+            (double)stats->work_max_us / 1000.0,
+            Loadgen_PercentileMs(stats->latency_us, stats->latency_count, 0.5),
+            Loadgen_PercentileMs(stats->latency_us, stats->latency_count, 0.9),
+            Loadgen_PercentileMs(stats->latency_us, stats->latency_count, 0.99),
+            Loadgen_PercentileMs(stats->latency_us, stats->latency_count, 1.0),
+            stats->latency_count, stats->latency_dropped);
+
+    SDL_zerop(stats);
+    loadgen->stats_last_ns = now;
+}
+
+//
+// Main loop
+//
+static void Loadgen_StartBots(LoadgenState *loadgen, Uint64 now)
+{
+    Uint32 target = loadgen->bot_count;
+    if (loadgen->ramp)
+    {
+        Uint64 elapsed_ms = (now - loadgen->start_ns) / SDL_NS_PER_MS;
+        target = (Uint32)Min(loadgen->bot_count, 1 + elapsed_ms * loadgen->ramp / 1000);
+    }
+
+    for (; loadgen->active_count < target; loadgen->active_count += 1)
+    {
+        Loadgen_Bot *bot = loadgen->bots + loadgen->active_count;
+        loadgen->sockets[loadgen->active_count] = bot->socket;
+    }
+}
+
+SDL_AppResult SDL_AppIterate(void *appstate)
+{
+    LoadgenState *loadgen = (LoadgenState *)appstate;
+    Uint64 now = SDL_GetTicksNS();
+    Loadgen_StartBots(loadgen, now);
+
+    // one input per bot per tick, paced like the dedicated server
+    if (now >= loadgen->next_tick_ns)
+    {
+        Uint64 period_ns = SDL_NS_PER_SECOND / loadgen->tick_rate;
+        loadgen->next_tick_ns += period_ns;
+        if (now > loadgen->next_tick_ns + 4 * period_ns)
+            loadgen->next_tick_ns = now + period_ns; // fell behind; don't burst
+
+        ForU32(i, loadgen->active_count)
+            Loadgen_SendInputs(loadgen, loadgen->bots + i, now);
+    }
+
+    ForU32(i, loadgen->active_count)
+    {
+        Loadgen_Bot *bot = loadgen->bots + i;
+        for (;;)
+        {
+            SDLNet_Datagram *dgram = 0;
+            if (!SDLNet_ReceiveDatagram(bot->socket, &dgram) || !dgram) break;
+
+            if (dgram->port == loadgen->port)
+                Loadgen_ReceiveDatagram(loadgen, bot, S8_Make(dgram->buf, dgram->buflen), SDL_GetTicksNS());
+            SDLNet_DestroyDatagram(dgram);
+        }
+    }
+
+    now = SDL_GetTicksNS();
+    if (now >= loadgen->stats_last_ns + SDL_NS_PER_SECOND)
+        Loadgen_ReportStats(loadgen, now);
+
+    if (loadgen->seconds &&
+        now >= loadgen->start_ns + loadgen->seconds * SDL_NS_PER_SECOND)
+    {
+        return SDL_APP_SUCCESS;
+    }
+
+    // sleep until something arrives; 1ms keeps tick pacing precise enough
+    if (loadgen->active_count)
+        SDLNet_WaitUntilInputAvailable(loadgen->sockets, (int)loadgen->active_count, 1);
+
+    return SDL_APP_CONTINUE;
+}
+
+SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
+{
+    (void)appstate;
+    if (event->type == SDL_EVENT_QUIT)
+        return SDL_APP_SUCCESS;
+    return SDL_APP_CONTINUE;
+}
+
+static bool Loadgen_ParseCmd(LoadgenState *loadgen, int argc, char **argv)
+{
+    for (int i = 1; i < argc; i += 1)
+    {
+        const char *arg = argv[i];
+        const char *next_arg = (i + 1 < argc ? argv[i + 1] : 0);
+        if (!next_arg)
+        {
+            SDL_Log("%s needs to be followed by a value", arg);
+            return false;
+        }
+        i += 1;
+
+        if (0 == strcmp(arg, "-behavior"))
+        {
+            if      (0 == strcmp(next_arg, "walk"))   loadgen->behavior = LoadgenBehavior_Walk;
+            else if (0 == strcmp(next_arg, "circle")) loadgen->behavior = LoadgenBehavior_Circle;
+            else
+            {
+                SDL_Log("Unknown behavior: %s (walk or circle)", next_arg);
+                return false;
+            }
+        }
+        else if (0 == strcmp(arg, "-bots"))    loadgen->bot_count = (Uint32)SDL_strtoul(next_arg, 0, 0);
+        else if (0 == strcmp(arg, "-port"))    loadgen->port = (Uint16)SDL_strtoul(next_arg, 0, 0);
+        else if (0 == strcmp(arg, "-seconds")) loadgen->seconds = (Uint32)SDL_strtoul(next_arg, 0, 0);
+        else if (0 == strcmp(arg, "-ramp"))    loadgen->ramp = (Uint32)SDL_strtoul(next_arg, 0, 0);
+        else
+        {
+            SDL_Log("Unhandled argument: %s", arg);
+            return false;
+        }
+    }
+
+    if (!loadgen->bot_count || loadgen->bot_count > NET_MAX_USERS)
+    {
+        SDL_Log("-bots has to be between 1 and %d", NET_MAX_USERS);
+        return false;
+    }
+    return true;
+}
+
+SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
+{
+    *appstate = SDL_calloc(1, sizeof(LoadgenState));
+    LoadgenState *loadgen = (LoadgenState *)*appstate;
+    if (!loadgen)
+        return SDL_APP_FAILURE;
+
+    loadgen->port = NET_DEFAULT_SEVER_PORT;
+    loadgen->bot_count = 16;
+    loadgen->tick_rate = TICK_RATE;
+    loadgen->rng = SDL_GetPerformanceCounter();
+
+    if (!Loadgen_ParseCmd(loadgen, argc, argv))
+        return SDL_APP_FAILURE;
+
+    if (!SDL_Init(0) || !SDLNet_Init())
+    {
+        SDL_Log("LOADGEN: Failed to initialize SDL: %s", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+
+    loadgen->server_address = SDLNet_ResolveHostname("localhost");
+    if (!loadgen->server_address ||
+        SDLNet_WaitUntilResolved(loadgen->server_address, -1) < 0)
+    {
+        SDL_Log("LOADGEN: Failed to resolve localhost");
+        return SDL_APP_FAILURE;
+    }
+
+    loadgen->bots = SDL_calloc(loadgen->bot_count, sizeof(*loadgen->bots));
+    loadgen->sockets = SDL_calloc(loadgen->bot_count, sizeof(*loadgen->sockets));
+    if (!loadgen->bots || !loadgen->sockets)
+        return SDL_APP_FAILURE;
+
+    ForU32(i, loadgen->bot_count)
+    {
+        Loadgen_Bot *bot = loadgen->bots + i;
+        bot->turns = (float)i / (float)loadgen->bot_count;
+        bot->socket = SDLNet_CreateDatagramSocket(0, 0);
+        if (!bot->socket)
+        {
+            SDL_Log("LOADGEN: Failed to create socket for bot %u: %s", i, SDL_GetError());
+            return SDL_APP_FAILURE;
+        }
+    }
+
+    SDL_Log("LOADGEN: %u bots (%s) -> port %d%s", loadgen->bot_count,
+            loadgen->behavior == LoadgenBehavior_Circle ? "circle" : "walk", (int)loadgen->port,
+            loadgen->ramp ? "; ramping up" : "");
+
+    loadgen->start_ns = SDL_GetTicksNS();
+    loadgen->next_tick_ns = loadgen->start_ns;
+    loadgen->stats_last_ns = loadgen->start_ns;
+    return SDL_APP_CONTINUE;
+}
+
+void SDL_AppQuit(void *appstate, SDL_AppResult result)
+{
+    (void)result;
+    LoadgenState *loadgen = (LoadgenState *)appstate;
+    if (loadgen)
+    {
+        if (loadgen->bots)
+        {
+            ForU32(i, loadgen->bot_count)
+            {
+                if (loadgen->bots[i].socket)
+                    SDLNet_DestroyDatagramSocket(loadgen->bots[i].socket);
+            }
+        }
+        SDL_free(loadgen->bots);
+        SDL_free(loadgen->sockets);
+        if (loadgen->server_address) SDLNet_UnrefAddress(loadgen->server_address);
+    }
+    SDL_free(appstate);
+}
@@ -17,9 +17,22 @@
 #include "de_math.h"
 #include "de_vertices.h"
 #include "de_string.h"
+#include "de_arena.h"
+#include "de_log.h"
+#include "de_pack.h"
+#include "de_map.h"
 #include "de_main.h"
+#include "de_log.c"
 #include "de_sprite.c"
 #include "de_object.c"
+#include "de_sim.c"
+#include "de_bvh.c"
+#include "de_map.c"
+#include "de_visibility.c"
+#include "de_replay.c"
+#include "de_jitter.c"
+#include "de_interest.c"
+#include "de_lockstep.c"
 #include "de_network.c"
 #include "de_tick.c"
 #include "de_main.c"
@@ -28,6 +41,17 @@ SDL_AppResult SDL_AppIterate(void* appstate)
 {
     AppState* app = (AppState*)appstate;
 
+    if (app->replay.play_path)
+    {
+        return Game_IterateReplay(app) ? SDL_APP_CONTINUE : SDL_APP_SUCCESS;
+    }
+
+    if (app->headless)
+    {
+        Game_IterateDedicated(app);
+        return SDL_APP_CONTINUE;
+    }
+
     // input
     {
         app->mouse_keys = SDL_GetMouseState(&app->mouse.x, &app->mouse.y);
@@ -98,6 +122,11 @@ static void Game_ParseCmd(AppState *app, int argc, char** argv)
         {
             app->net.is_server = true;
         }
+        else if (0 == strcmp(arg, "-dedicated"))
+        {
+            app->net.is_server = true;
+            app->headless = true;
+        }
         else if (0 == strcmp(arg, "-top"))
         {
             app->window_on_top = true;
@@ -106,10 +135,84 @@ static void Game_ParseCmd(AppState *app, int argc, char** argv)
         {
             app->window_borderless = true;
         }
+        else if (0 == strcmp(arg, "-syncload"))
+        {
+            app->sprite_load.sync = true;
+        }
+        else if (0 == strcmp(arg, "-nopack"))
+        {
+            app->sprite_load.skip_pack = true;
+        }
+        else if (0 == strcmp(arg, "-mapstats"))
+        {
+            app->debug.map_stats = true;
+        }
+        else if (0 == strcmp(arg, "-map"))
+        {
+            if (i + 1 < argc)
+            {
+                i += 1;
+                app->map.path = argv[i];
+            }
+            else
+            {
+                LogWarn(LogCat_Game, "%s needs to be followed by a path", arg);
+            }
+        }
+        else if (0 == strcmp(arg, "-record") ||
+                 0 == strcmp(arg, "-replay"))
+        {
+            if (i + 1 < argc)
+            {
+                i += 1;
+                if (0 == strcmp(arg, "-record"))
+                {
+                    app->replay.record_path = argv[i];
+                }
+                else
+                {
+                    // replay runs the server simulation without a window
+                    app->replay.play_path = argv[i];
+                    app->net.is_server = true;
+                    app->headless = true;
+                }
+            }
+            else
+            {
+                LogWarn(LogCat_Game, "%s needs to be followed by a path", arg);
+            }
+        }
+        else if (0 == strcmp(arg, "-log"))
+        {
+            if (i + 1 < argc)
+            {
+                i += 1;
+                if (!Log_Configure(S8_MakeFromCstr(argv[i])))
+                    LogWarn(LogCat_Game, "Invalid %s levels: %s", arg, argv[i]);
+            }
+            else
+            {
+                LogWarn(LogCat_Game, "%s needs to be followed by levels, e.g. verbose or net=verbose,map=warn", arg);
+            }
+        }
+        else if (0 == strcmp(arg, "-lockstep"))
+        {
+            app->lockstep.enabled = true;
+        }
+        else if (0 == strcmp(arg, "-fog"))
+        {
+            app->net.fog = true;
+        }
+        else if (0 == strcmp(arg, "-netstats"))
+        {
+            app->debug.net_stats = true;
+        }
         else if (0 == strcmp(arg, "-w") ||
                  0 == strcmp(arg, "-h") ||
                  0 == strcmp(arg, "-px") ||
-                 0 == strcmp(arg, "-py"))
+                 0 == strcmp(arg, "-py") ||
+                 0 == strcmp(arg, "-port") ||
+                 0 == strcmp(arg, "-tickrate"))
         {
             bool found_number = false;
             if (i + 1 < argc)
@@ -125,34 +228,68 @@ static void Game_ParseCmd(AppState *app, int argc, char** argv)
                     else if (0 == strcmp(arg, "-h"))  app->window_height = number;
                     else if (0 == strcmp(arg, "-px")) app->window_px = number;
                     else if (0 == strcmp(arg, "-py")) app->window_py = number;
+                    else if (0 == strcmp(arg, "-port")) app->net.port = (Uint16)number;
+                    else if (0 == strcmp(arg, "-tickrate")) app->tick_rate = (Uint32)Min(number, TICK_RATE_MAX);
                 }
             }
 
             if (!found_number)
             {
-                SDL_Log("%s needs to be followed by positive number", arg);
+                LogWarn(LogCat_Game, "%s needs to be followed by positive number", arg);
             }
         }
         else
         {
-            SDL_Log("Unhandled argument: %s", arg);
+            LogWarn(LogCat_Game, "Unhandled argument: %s", arg);
         }
     }
 }
 
 SDL_AppResult SDL_AppInit(void** appstate, int argc, char** argv)
 {
-    *appstate = SDL_calloc(1, sizeof(AppState));
-    AppState *app = (AppState *)*appstate;
-    if (!app)
+    // AppState lives at the start of its own permanent arena
+    AppState *app = 0;
     {
-        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Failed to allocate appstate", SDL_GetError(), NULL);
-        return SDL_APP_FAILURE;
+        Arena perm;
+        if (Arena_Init(&perm, "perm", ARENA_PERM_RESERVE))
+            app = Arena_PushStruct(&perm, AppState);
+
+        if (!app)
+        {
+            SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Failed to allocate appstate", SDL_GetError(), NULL);
+            return SDL_APP_FAILURE;
+        }
+        app->perm = perm;
     }
+    *appstate = app;
+
     app->window_width = WINDOW_WIDTH;
     app->window_height = WINDOW_HEIGHT;
+    app->net.port = NET_DEFAULT_SEVER_PORT;
+    app->tick_rate = TICK_RATE;
+    app->map.path = MAP_PATH;
 
     Game_ParseCmd(app, argc, argv);
+    Log_Init();
+
+    if (app->headless)
+    {
+        // events are still needed to receive SDL_EVENT_QUIT on Ctrl+C
+        if (!SDL_Init(SDL_INIT_EVENTS))
+        {
+            LogError(LogCat_Game, "Failed to initialize SDL3: %s", SDL_GetError());
+            return SDL_APP_FAILURE;
+        }
+
+        if (!SDLNet_Init())
+        {
+            LogError(LogCat_Game, "Failed to initialize SDL3 Net: %s", SDL_GetError());
+            return SDL_APP_FAILURE;
+        }
+
+        Game_Init(app);
+        return SDL_APP_CONTINUE;
+    }
 
     if (!SDL_Init(SDL_INIT_VIDEO))
     {
@@ -204,6 +341,38 @@ void SDL_AppQuit(void* appstate, SDL_AppResult result)
         SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s\n", error);
     }
 
-    // No need to check for null
-    SDL_free(appstate);
+    AppState *app = (AppState *)appstate;
+    if (app)
+    {
+        Replay_EndRecording(app);
+        Game_ReportMemory(app); // before Net_Deinit releases network arenas
+        Net_Deinit(app);
+        Sprite_DeinitLoading(app);
+        Visibility_Free(&app->debug.visibility);
+        Map_Close(app);
+        Replay_Close(app);
+
+        Arena_Release(&app->frame_arena);
+        Arena_Release(&app->tick_arena);
+        Arena_Release(&app->object_arena);
+        Arena_Release(&app->object_dense_handle_arena);
+        Arena_Release(&app->object_handle_arena);
+        Arena_Release(&app->object_list_index_arena);
+        ForArray(i, app->object_lists)
+            Arena_Release(&app->object_lists[i].arena);
+        Arena_Release(&app->network_handle_arena);
+        Arena_Release(&app->sprite_arena);
+        ForArray(i, app->netobj_states)
+            Arena_Release(&app->netobj_states[i].arena);
+        ForArray(i, app->jitter.states)
+            Arena_Release(&app->jitter.states[i].arena);
+        ForArray(i, app->jitter.error_samples)
+            Arena_Release(&app->jitter.error_samples[i].arena);
+        Sim_Deinit(app);
+
+        Log_Deinit(); // after everything that logs from other threads
+
+        Arena perm = app->perm; // app lives inside of perm
+        Arena_Release(&perm);
+    }
 }
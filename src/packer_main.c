@@ -0,0 +1,282 @@
+//
+// @info(mg) Offline asset packer.
+//           Decodes every image listed in pack_sprite_defs (see de_pack.h),
+//           bakes collision vertices/normals and writes them together with
+//           RGBA32 pixels into one pack that the game maps at startup.
+//           It also bakes the default level into a chunked map (see de_map.h).
+//           Run it from build directory after changing images, sprite defs or the level:
+//             ./packer                  # writes assets.pack and level.map
+//             ./packer -o other.pack
+//             ./packer -stressmap 200000  # also writes stress.map with that many static objects
+//
+#define SDL_ASSERT_LEVEL 2
+#include <SDL3/SDL_stdinc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <float.h>
+
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+
+#include "de_base.h"
+#include "de_math.h"
+#include "de_vertices.h"
+#include "de_string.h"
+#include "de_arena.h"
+#include "de_pack.h"
+#include "de_map.h"
+
+#define PACKER_ARENA_RESERVE (4ull * 1024 * 1024 * 1024)
+#define PACKER_STRESS_MAP_PATH "stress.map"
+
+static bool Packer_Write(SDL_IOStream *io, const void *data, Uint64 size)
+{
+    return SDL_WriteIO(io, data, size) == size;
+}
+
+static bool Packer_BakeAssets(const char *out_path)
+{
+    Uint64 start_ns = SDL_GetTicksNS();
+    bool ok = false;
+    SDL_IOStream *io = 0;
+    SDL_Surface *surfaces[PackSprite_Count] = {0};
+    Pack_Sprite entries[PackSprite_Count] = {0};
+
+    Pack_Header header = {0};
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.sprite_count = PackSprite_Count;
+    header.defs_hash = Pack_DefsHash();
+    Uint64 offset = AlignUp(sizeof(header) + sizeof(entries), PACK_PIXEL_ALIGN);
+
+    // decode images and lay out pixel blocks
+    ForArray(i, pack_sprite_defs)
+    {
+        Pack_SpriteDef *def = pack_sprite_defs + i;
+        Pack_Sprite *entry = entries + i;
+        Assert(SDL_strlen(def->name) < sizeof(entry->name));
+
+        SDL_Surface *loaded = IMG_Load(def->path);
+        if (!loaded)
+        {
+            SDL_Log("PACKER: Failed to load %s: %s", def->path, SDL_GetError());
+            goto packer_cleanup;
+        }
+        surfaces[i] = SDL_ConvertSurface(loaded, SDL_PIXELFORMAT_RGBA32);
+        SDL_DestroySurface(loaded);
+        if (!surfaces[i])
+        {
+            SDL_Log("PACKER: Failed to convert %s: %s", def->path, SDL_GetError());
+            goto packer_cleanup;
+        }
+
+        SDL_Surface *surface = surfaces[i];
+        SDL_strlcpy(entry->name, def->name, sizeof(entry->name));
+        entry->width = (Uint32)surface->w;
+        entry->height = (Uint32)surface->h;
+        entry->tex_frames = Max(def->tex_frames, 1);
+        entry->pitch = entry->width * 4; // tightly packed; surface pitch might be padded
+        entry->pixel_offset = offset;
+        offset = AlignUp(offset + (Uint64)entry->pitch * entry->height, PACK_PIXEL_ALIGN);
+
+        V2 frame_dim = {(float)entry->width, (float)entry->height / (float)entry->tex_frames};
+        entry->collision_vertices = Pack_CollisionVertices(def, Vertices_FromRect((V2){0}, frame_dim));
+        Vertices_Normals(entry->collision_normals.arr, entry->collision_vertices.arr,
+                         ArrayCount(entry->collision_vertices.arr));
+    }
+    header.file_size = offset;
+
+    // write pack
+    io = SDL_IOFromFile(out_path, "wb");
+    if (!io)
+    {
+        SDL_Log("PACKER: Failed to open %s: %s", out_path, SDL_GetError());
+        goto packer_cleanup;
+    }
+
+    static Uint8 padding[PACK_PIXEL_ALIGN];
+    Uint64 written = sizeof(header) + sizeof(entries);
+    if (!Packer_Write(io, &header, sizeof(header)) ||
+        !Packer_Write(io, entries, sizeof(entries)))
+    {
+        goto packer_write_error;
+    }
+
+    ForArray(i, entries)
+    {
+        Pack_Sprite *entry = entries + i;
+        SDL_Surface *surface = surfaces[i];
+
+        if (!Packer_Write(io, padding, entry->pixel_offset - written))
+            goto packer_write_error;
+        written = entry->pixel_offset;
+
+        ForU32(y, entry->height)
+        {
+            Uint8 *row = (Uint8 *)surface->pixels + (Uint64)y * surface->pitch;
+            if (!Packer_Write(io, row, entry->pitch))
+                goto packer_write_error;
+        }
+        written += (Uint64)entry->pitch * entry->height;
+
+        SDL_Log("PACKER: %-12s %4ux%-4u %u frames", entry->name,
+                entry->width, entry->height, entry->tex_frames);
+    }
+    if (!Packer_Write(io, padding, header.file_size - written))
+        goto packer_write_error;
+
+    if (!SDL_CloseIO(io))
+    {
+        io = 0;
+        goto packer_write_error;
+    }
+    io = 0;
+
+    SDL_Log("PACKER: Wrote %u sprites to %s (%.1f KB) in %.2f ms",
+            header.sprite_count, out_path, header.file_size / 1024.0,
+            (double)(SDL_GetTicksNS() - start_ns) / (double)SDL_NS_PER_MS);
+    ok = true;
+    goto packer_cleanup;
+
+    packer_write_error:
+    SDL_Log("PACKER: Failed to write %s: %s", out_path, SDL_GetError());
+
+    packer_cleanup:
+    if (io)
+        SDL_CloseIO(io);
+    ForArray(i, surfaces)
+        SDL_DestroySurface(surfaces[i]);
+    return ok;
+}
+
+static bool Packer_WriteMap(const char *out_path, S8 map)
+{
+    if (!map.size)
+        return false;
+
+    Map_Header *header = (Map_Header *)map.str;
+    bool ok = SDL_SaveFile(out_path, map.str, map.size);
+    if (ok)
+    {
+        SDL_Log("PACKER: Wrote %u objects, %u spawns in %ux%u chunks to %s (%.1f KB)",
+                header->object_count, header->spawn_count,
+                header->chunks_x, header->chunks_y, out_path, map.size / 1024.0);
+    }
+    else
+    {
+        SDL_Log("PACKER: Failed to write %s: %s", out_path, SDL_GetError());
+    }
+    return ok;
+}
+
+static Uint32 Packer_Random(Uint32 *state)
+{
+    // xorshift32
+    Uint32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static float Packer_RandomF(Uint32 *state, float min, float max)
+{
+    float t = (float)(Packer_Random(state) >> 8) * (1.f / (float)(1u << 24));
+    return min + t * (max - min);
+}
+
+// Big map for streaming benchmarks: walls and crates scattered over
+// a square area with roughly constant density, plus a few spawn points.
+static S8 Packer_BakeStressMap(Arena *arena, Uint32 object_count)
+{
+    Uint32 rng = 0x1234'5678;
+    float half_size = 0.5f * 60.f * SqrtF((float)object_count);
+
+    V2 wall_dims[] =
+    {
+        {20, 40}, {20, 80}, {20, 120}, {20, 200},
+        {40, 20}, {80, 20}, {120, 20}, {200, 20},
+    };
+
+    Map_BakeObject *objects = Arena_PushArray(arena, Map_BakeObject, object_count);
+    if (!objects)
+        return (S8){0};
+
+    ForU32(i, object_count)
+    {
+        Map_BakeObject *obj = objects + i;
+        obj->p = (V2){Packer_RandomF(&rng, -half_size, half_size),
+                      Packer_RandomF(&rng, -half_size, half_size)};
+        if (Packer_Random(&rng) % 5 == 0)
+        {
+            obj->kind = MapObject_Prop;
+            obj->sprite = PackSprite_Crate;
+            obj->color = ColorF_RGB(1,1,1);
+        }
+        else
+        {
+            obj->kind = MapObject_Wall;
+            obj->dim = wall_dims[Packer_Random(&rng) % ArrayCount(wall_dims)];
+            obj->color = ColorF_RGB(Packer_RandomF(&rng, 0.2f, 1.f), Packer_RandomF(&rng, 0.2f, 1.f), 0.5f);
+        }
+    }
+
+    V2 spawns[16];
+    ForArray(i, spawns)
+    {
+        spawns[i] = (V2){Packer_RandomF(&rng, -half_size, half_size),
+                         Packer_RandomF(&rng, -half_size, half_size)};
+    }
+
+    return Map_Bake(arena, MAP_CHUNK_SIZE, objects, object_count, spawns, ArrayCount(spawns));
+}
+
+int main(int argc, char **argv)
+{
+    const char *out_path = PACK_PATH;
+    Uint32 stress_object_count = 0;
+    for (int i = 1; i < argc; i += 1)
+    {
+        if (0 == strcmp(argv[i], "-o") && i + 1 < argc)
+        {
+            i += 1;
+            out_path = argv[i];
+        }
+        else if (0 == strcmp(argv[i], "-stressmap") && i + 1 < argc)
+        {
+            i += 1;
+            stress_object_count = (Uint32)SDL_strtoul(argv[i], 0, 0);
+        }
+        else
+        {
+            SDL_Log("PACKER: Unknown argument %s; usage: packer [-o output.pack] [-stressmap object_count]", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!Packer_BakeAssets(out_path))
+        return 1;
+
+    Arena arena;
+    if (!Arena_Init(&arena, "packer", PACKER_ARENA_RESERVE))
+        return 1;
+
+    int result = 0;
+    if (!Packer_WriteMap(MAP_PATH, Map_BakeDefaultLevel(&arena)))
+        result = 1;
+
+    if (stress_object_count)
+    {
+        Uint64 start_ns = SDL_GetTicksNS();
+        Arena_Reset(&arena);
+        S8 map = Packer_BakeStressMap(&arena, stress_object_count);
+        SDL_Log("PACKER: Baked stress map in %.2f ms",
+                (double)(SDL_GetTicksNS() - start_ns) / (double)SDL_NS_PER_MS);
+        if (!Packer_WriteMap(PACKER_STRESS_MAP_PATH, map))
+            result = 1;
+    }
+
+    Arena_Release(&arena);
+    return result;
+}
@@ -0,0 +1,442 @@
+//
+// @info(mg) Local UDP proxy that simulates bad network conditions.
+//           It sits between clients and the server on loopback:
+//             client -(-port listen_port)-> proxy -> server (server_port)
+//           Every client gets its own socket towards the server
+//           so the server still sees distinct users.
+//
+// Example:
+//   ./demongus -server
+//   ./proxy -profile wifi
+//   ./demongus -port 21038 -netstats
+//
+// `-schedule N` cycles through all profiles every N seconds;
+// client's -netstats log then shows position error and convergence time
+// for each profile while proxy logs bandwidth.
+//
+#define SDL_ASSERT_LEVEL 2
+#include <SDL3/SDL_stdinc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <float.h>
+
+#define SDL_MAIN_USE_CALLBACKS
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+#include <SDL3_net/SDL_net.h>
+
+#include "de_base.h"
+#include "de_math.h"
+#include "de_vertices.h"
+#include "de_string.h"
+#include "de_arena.h"
+#include "de_pack.h"
+#include "de_map.h"
+#include "de_main.h"
+
+#define PROXY_MAX_CLIENTS 64
+#define PROXY_MAX_PENDING 4096
+
+typedef struct
+{
+    const char *name;
+    float latency_ms; // one way
+    float jitter_ms; // +- uniform; also causes natural reordering
+    float loss; // 0..1
+    float duplicate; // 0..1
+    float reorder; // 0..1; chance to hold the packet for extra jitter_ms*2
+} Proxy_Profile;
+
+static Proxy_Profile proxy_profiles[] =
+{
+    {"none",     0.f,  0.f,   0.f,    0.f,    0.f},
+    {"lan",      1.f,  0.5f,  0.f,    0.f,    0.f},
+    {"wifi",    15.f,  8.f,   0.01f,  0.005f, 0.01f},
+    {"mobile",  60.f, 25.f,   0.03f,  0.01f,  0.03f},
+    {"bad",    150.f, 60.f,   0.10f,  0.05f,  0.10f},
+};
+
+typedef struct
+{
+    SDLNet_Address *address;
+    Uint16 port;
+    SDLNet_DatagramSocket *server_socket;
+} Proxy_Client;
+
+typedef struct
+{
+    Uint64 deliver_ns;
+    SDLNet_DatagramSocket *socket;
+    SDLNet_Address *address;
+    Uint16 port;
+    Uint32 size;
+    Uint8 *data;
+} Proxy_Pending;
+
+typedef struct
+{
+    Uint64 packets;
+    Uint64 bytes;
+    Uint64 dropped;
+    Uint64 duplicated;
+    Uint64 reordered;
+} Proxy_Stats;
+
+typedef enum
+{
+    Proxy_ToServer,
+    Proxy_ToClient,
+    Proxy_DirectionCount
+} Proxy_Direction;
+
+typedef struct
+{
+    Uint16 listen_port;
+    Uint16 server_port;
+    SDLNet_Address *server_address;
+    SDLNet_DatagramSocket *listen_socket;
+
+    Proxy_Profile profile;
+    Uint32 schedule_seconds; // 0 == don't cycle profiles
+    Uint32 schedule_index;
+    Uint64 schedule_last_ns;
+
+    Proxy_Client clients[PROXY_MAX_CLIENTS];
+    Uint32 client_count;
+
+    Proxy_Pending pending[PROXY_MAX_PENDING];
+    Uint32 pending_count;
+
+    Uint64 rng;
+    Proxy_Stats stats[Proxy_DirectionCount];
+    Uint64 stats_last_ns;
+} ProxyState;
+
+static void Proxy_SetProfile(ProxyState *proxy, Proxy_Profile profile)
+{
+    proxy->profile = profile;
+    SDL_Log("PROXY: profile '%s': latency %.1f ms, jitter %.1f ms, loss %.1f%%, dup %.1f%%, reorder %.1f%%",
+            profile.name, profile.latency_ms, profile.jitter_ms,
+            profile.loss * 100.f, profile.duplicate * 100.f, profile.reorder * 100.f);
+}
+
+static void Proxy_Enqueue(ProxyState *proxy, Proxy_Direction direction, Uint64 now,
+                          SDLNet_DatagramSocket *socket, SDLNet_Address *address, Uint16 port,
+                          void *data, Uint32 size)
+{
+    Proxy_Stats *stats = proxy->stats + direction;
+    Proxy_Profile *profile = &proxy->profile;
+
+    stats->packets += 1;
+    stats->bytes += size;
+
+    if (SDL_randf_r(&proxy->rng) < profile->loss)
+    {
+        stats->dropped += 1;
+        return;
+    }
+
+    Uint32 copies = 1;
+    if (SDL_randf_r(&proxy->rng) < profile->duplicate)
+    {
+        copies = 2;
+        stats->duplicated += 1;
+    }
+
+    ForU32(copy, copies)
+    {
+        if (proxy->pending_count >= ArrayCount(proxy->pending))
+        {
+            stats->dropped += 1;
+            return;
+        }
+
+        float delay_ms = profile->latency_ms;
+        delay_ms += (SDL_randf_r(&proxy->rng) * 2.f - 1.f) * profile->jitter_ms;
+        if (SDL_randf_r(&proxy->rng) < profile->reorder)
+        {
+            delay_ms += profile->jitter_ms * 2.f;
+            stats->reordered += 1;
+        }
+        delay_ms = Max(delay_ms, 0.f);
+
+        Proxy_Pending *pending = proxy->pending + proxy->pending_count;
+        proxy->pending_count += 1;
+        pending->deliver_ns = now + (Uint64)(delay_ms * (float)SDL_NS_PER_MS);
+        pending->socket = socket;
+        pending->address = SDLNet_RefAddress(address);
+        pending->port = port;
+        pending->size = size;
+        pending->data = SDL_malloc(size);
+        memcpy(pending->data, data, size);
+    }
+}
+
+static void Proxy_DeliverDue(ProxyState *proxy, Uint64 now)
+{
+    for (Uint32 i = 0; i < proxy->pending_count;)
+    {
+        Proxy_Pending *pending = proxy->pending + i;
+        if (pending->deliver_ns > now)
+        {
+            i += 1;
+            continue;
+        }
+
+        SDLNet_SendDatagram(pending->socket, pending->address, pending->port,
+                            pending->data, pending->size);
+        SDLNet_UnrefAddress(pending->address);
+        SDL_free(pending->data);
+
+        // swap remove
+        proxy->pending_count -= 1;
+        *pending = proxy->pending[proxy->pending_count];
+    }
+}
+
+static Proxy_Client *Proxy_FindOrAddClient(ProxyState *proxy, SDLNet_Address *address, Uint16 port)
+{
+    ForU32(i, proxy->client_count)
+    {
+        Proxy_Client *client = proxy->clients + i;
+        if (client->port == port && SDLNet_CompareAddresses(client->address, address) == 0)
+            return client;
+    }
+
+    if (proxy->client_count >= ArrayCount(proxy->clients))
+        return 0;
+
+    SDLNet_DatagramSocket *server_socket = SDLNet_CreateDatagramSocket(0, 0);
+    if (!server_socket)
+    {
+        SDL_Log("PROXY: Failed to create socket for client: %s", SDL_GetError());
+        return 0;
+    }
+
+    Proxy_Client *client = proxy->clients + proxy->client_count;
+    proxy->client_count += 1;
+    client->address = SDLNet_RefAddress(address);
+    client->port = port;
+    client->server_socket = server_socket;
+    SDL_Log("PROXY: new client %s:%d", SDLNet_GetAddressString(address), (int)port);
+    return client;
+}
+
+static void Proxy_ReportStats(ProxyState *proxy, Uint64 now)
+{
+    float seconds = (float)(now - proxy->stats_last_ns) / (float)SDL_NS_PER_SECOND;
+    if (seconds <= 0.f) return;
+
+    const char *labels[] = {"to server", "to client"};
+    static_assert(ArrayCount(labels) == Proxy_DirectionCount);
+    ForArray(i, labels)
+    {
+        Proxy_Stats *stats = proxy->stats + i;
+        SDL_Log("PROXY: %s: %.0f B/s, %llu packets, %llu dropped, %llu duplicated, %llu reordered",
+                labels[i], (float)stats->bytes / seconds, stats->packets,
+                stats->dropped, stats->duplicated, stats->reordered);
+        SDL_zerop(stats);
+    }
+    proxy->stats_last_ns = now;
+}
+
+SDL_AppResult SDL_AppIterate(void *appstate)
+{
+    ProxyState *proxy = (ProxyState *)appstate;
+    Uint64 now = SDL_GetTicksNS();
+
+    if (proxy->schedule_seconds &&
+        now >= proxy->schedule_last_ns + proxy->schedule_seconds * SDL_NS_PER_SECOND)
+    {
+        proxy->schedule_last_ns = now;
+        proxy->schedule_index = (proxy->schedule_index + 1) % ArrayCount(proxy_profiles);
+        Proxy_SetProfile(proxy, proxy_profiles[proxy->schedule_index]);
+    }
+
+    // client -> server
+    for (;;)
+    {
+        SDLNet_Datagram *dgram = 0;
+        if (!SDLNet_ReceiveDatagram(proxy->listen_socket, &dgram) || !dgram) break;
+
+        Proxy_Client *client = Proxy_FindOrAddClient(proxy, dgram->addr, dgram->port);
+        if (client)
+        {
+            Proxy_Enqueue(proxy, Proxy_ToServer, now, client->server_socket,
+                          proxy->server_address, proxy->server_port,
+                          dgram->buf, dgram->buflen);
+        }
+        SDLNet_DestroyDatagram(dgram);
+    }
+
+    // server -> client
+    ForU32(i, proxy->client_count)
+    {
+        Proxy_Client *client = proxy->clients + i;
+        for (;;)
+        {
+            SDLNet_Datagram *dgram = 0;
+            if (!SDLNet_ReceiveDatagram(client->server_socket, &dgram) || !dgram) break;
+
+            Proxy_Enqueue(proxy, Proxy_ToClient, now, proxy->listen_socket,
+                          client->address, client->port,
+                          dgram->buf, dgram->buflen);
+            SDLNet_DestroyDatagram(dgram);
+        }
+    }
+
+    Proxy_DeliverDue(proxy, now);
+
+    if (now >= proxy->stats_last_ns + SDL_NS_PER_SECOND)
+    {
+        Proxy_ReportStats(proxy, now);
+    }
+
+    // sleep until something arrives; 1ms keeps delivery timing precise enough
+    {
+        void *sockets[PROXY_MAX_CLIENTS + 1];
+        int socket_count = 0;
+        sockets[socket_count++] = proxy->listen_socket;
+        ForU32(i, proxy->client_count)
+            sockets[socket_count++] = proxy->clients[i].server_socket;
+        SDLNet_WaitUntilInputAvailable(sockets, socket_count, 1);
+    }
+
+    return SDL_APP_CONTINUE;
+}
+
+SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
+{
+    (void)appstate;
+    if (event->type == SDL_EVENT_QUIT)
+        return SDL_APP_SUCCESS;
+    return SDL_APP_CONTINUE;
+}
+
+// -profile is applied first wherever it is; other flags override its
+// values and the profile is then reported as "custom".
+static bool Proxy_ParseCmd(ProxyState *proxy, int argc, char **argv)
+{
+    for (int i = 1; i < argc; i += 1)
+    {
+        if (0 != strcmp(argv[i], "-profile") || i + 1 >= argc)
+            continue;
+
+        const char *name = argv[i + 1];
+        bool found = false;
+        ForArray(profile_index, proxy_profiles)
+        {
+            if (0 == strcmp(name, proxy_profiles[profile_index].name))
+            {
+                proxy->profile = proxy_profiles[profile_index];
+                proxy->schedule_index = profile_index;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            SDL_Log("Unknown profile: %s", name);
+            return false;
+        }
+    }
+
+    bool overridden = false;
+    for (int i = 1; i < argc; i += 1)
+    {
+        const char *arg = argv[i];
+        const char *next_arg = (i + 1 < argc ? argv[i + 1] : 0);
+        if (!next_arg)
+        {
+            SDL_Log("%s needs to be followed by a value", arg);
+            return false;
+        }
+        i += 1;
+
+        if      (0 == strcmp(arg, "-profile"))  {} // applied above
+        else if (0 == strcmp(arg, "-listen"))   proxy->listen_port = (Uint16)SDL_strtoul(next_arg, 0, 0);
+        else if (0 == strcmp(arg, "-server"))   proxy->server_port = (Uint16)SDL_strtoul(next_arg, 0, 0);
+        else if (0 == strcmp(arg, "-schedule")) proxy->schedule_seconds = (Uint32)SDL_strtoul(next_arg, 0, 0);
+        else if (0 == strcmp(arg, "-latency"))  { proxy->profile.latency_ms = (float)SDL_strtod(next_arg, 0); overridden = true; }
+        else if (0 == strcmp(arg, "-jitter"))   { proxy->profile.jitter_ms = (float)SDL_strtod(next_arg, 0); overridden = true; }
+        else if (0 == strcmp(arg, "-loss"))     { proxy->profile.loss = (float)SDL_strtod(next_arg, 0) * 0.01f; overridden = true; }
+        else if (0 == strcmp(arg, "-dup"))      { proxy->profile.duplicate = (float)SDL_strtod(next_arg, 0) * 0.01f; overridden = true; }
+        else if (0 == strcmp(arg, "-reorder"))  { proxy->profile.reorder = (float)SDL_strtod(next_arg, 0) * 0.01f; overridden = true; }
+        else
+        {
+            SDL_Log("Unhandled argument: %s", arg);
+            return false;
+        }
+    }
+
+    if (overridden)
+        proxy->profile.name = "custom";
+    return true;
+}
+
+SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
+{
+    *appstate = SDL_calloc(1, sizeof(ProxyState));
+    ProxyState *proxy = (ProxyState *)*appstate;
+    if (!proxy)
+        return SDL_APP_FAILURE;
+
+    proxy->listen_port = NET_DEFAULT_SEVER_PORT + 1;
+    proxy->server_port = NET_DEFAULT_SEVER_PORT;
+    proxy->profile = proxy_profiles[0];
+    proxy->rng = SDL_GetPerformanceCounter();
+
+    if (!Proxy_ParseCmd(proxy, argc, argv))
+        return SDL_APP_FAILURE;
+
+    if (!SDL_Init(0) || !SDLNet_Init())
+    {
+        SDL_Log("PROXY: Failed to initialize SDL: %s", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+
+    proxy->server_address = SDLNet_ResolveHostname("localhost");
+    if (!proxy->server_address ||
+        SDLNet_WaitUntilResolved(proxy->server_address, -1) < 0)
+    {
+        SDL_Log("PROXY: Failed to resolve localhost");
+        return SDL_APP_FAILURE;
+    }
+
+    proxy->listen_socket = SDLNet_CreateDatagramSocket(0, proxy->listen_port);
+    if (!proxy->listen_socket)
+    {
+        SDL_Log("PROXY: Failed to listen on port %d: %s",
+                (int)proxy->listen_port, SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+
+    SDL_Log("PROXY: forwarding port %d -> %d",
+            (int)proxy->listen_port, (int)proxy->server_port);
+    Proxy_SetProfile(proxy, proxy->profile);
+
+    proxy->stats_last_ns = SDL_GetTicksNS();
+    proxy->schedule_last_ns = proxy->stats_last_ns;
+    return SDL_APP_CONTINUE;
+}
+
+void SDL_AppQuit(void *appstate, SDL_AppResult result)
+{
+    (void)result;
+    ProxyState *proxy = (ProxyState *)appstate;
+    if (proxy)
+    {
+        ForU32(i, proxy->pending_count)
+        {
+            SDLNet_UnrefAddress(proxy->pending[i].address);
+            SDL_free(proxy->pending[i].data);
+        }
+        ForU32(i, proxy->client_count)
+        {
+            SDLNet_DestroyDatagramSocket(proxy->clients[i].server_socket);
+            SDLNet_UnrefAddress(proxy->clients[i].address);
+        }
+        if (proxy->listen_socket) SDLNet_DestroyDatagramSocket(proxy->listen_socket);
+        if (proxy->server_address) SDLNet_UnrefAddress(proxy->server_address);
+    }
+    SDL_free(appstate);
+}